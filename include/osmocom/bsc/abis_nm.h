@@ -22,6 +22,9 @@
 #ifndef _NM_H
 #define _NM_H
 
+#include <sys/types.h>
+#include <time.h>
+
 #include <osmocom/gsm/tlv.h>
 #include <osmocom/gsm/abis_nm.h>
 #include <osmocom/gsm/protocol/gsm_12_21.h>
@@ -97,6 +100,37 @@ int abis_nm_software_load(struct gsm_bts *bts, int trx_nr, const char *fname,
 			  uint8_t win_size, int forced,
 			  gsm_cbfn *cbfn, void *cb_data);
 int abis_nm_software_load_status(struct gsm_bts *bts);
+
+/* A software image file, shared by all Software Load sessions sending it, so that many BTS can be loaded with the
+ * same image in parallel without reading the file for each one. */
+struct abis_nm_sw_image {
+	struct llist_head entry;
+	dev_t dev;
+	ino_t ino;
+	/* status change time of the file when it was read, and when it was read (CLOCK_REALTIME seconds) */
+	struct timespec ctime;
+	time_t read_time;
+	const uint8_t *data;
+	size_t len;
+	unsigned int use_count;
+};
+
+struct abis_nm_sw_image *abis_nm_sw_image_get(const char *fname);
+void abis_nm_sw_image_put(struct abis_nm_sw_image *img);
+
+/* Progress and throughput of the most recent Software Load of a BTS */
+struct abis_nm_sw_load_progress {
+	size_t bytes_sent;
+	size_t bytes_total;
+	unsigned int segments_sent;
+	unsigned int windows_acked;
+	unsigned int window_size;
+	/* time since the Load Data Initiate, until the Load Data End ACK once finished */
+	unsigned long duration_ms;
+	/* bytes_sent / duration_ms, in bytes per second */
+	unsigned long bytes_per_sec;
+};
+int abis_nm_software_load_progress(struct gsm_bts *bts, struct abis_nm_sw_load_progress *progress);
 int abis_nm_software_activate(struct gsm_bts *bts, const char *fname,
 			      gsm_cbfn *cbfn, void *cb_data);
 
@@ -168,6 +202,11 @@ void abis_nm_clear_queue(struct gsm_bts *bts);
 int _abis_nm_sendmsg(struct msgb *msg);
 
 void abis_nm_queue_send_next(struct gsm_bts *bts);	/* for bs11_config. */
+void abis_nm_queue_resume(struct gsm_bts *bts);
+
+void abis_nm_bringup_start(struct gsm_bts *bts);
+void abis_nm_bringup_check(struct gsm_bts *bts);
+void abis_nm_bringup_done(struct gsm_bts *bts);
 
 int abis_nm_select_newest_sw(const struct abis_nm_sw_desc *sw, const size_t len);
 
@@ -109,6 +109,10 @@ enum {
 enum {
 	MSC_STAT_MSC_LINKS_ACTIVE,
 	MSC_STAT_MSC_LINKS_TOTAL,
+	MSC_STAT_SCCP_CONN_PENDING,
+	MSC_STAT_SCCP_CONN_ACTIVE,
+	MSC_STAT_SCCP_CR_CC_LATENCY,
+	MSC_STAT_MSCPOOL_WEIGHT,
 };
 
 /*! /brief Information on a remote MSC for libbsc.
@@ -189,6 +193,20 @@ struct bsc_msc_data {
 
 	struct osmo_nri_ranges *nri_ranges;
 	bool allow_attach;
+
+	/* Relative share of new subscribers for 'mscpool selection weighted' */
+	unsigned int pool_weight;
+
+	/* SCCP connection load, tracked in osmo_bsc_sigtran.c */
+	struct {
+		/* Connections with a CR sent and no CC received yet */
+		unsigned int pending;
+		/* Established connections */
+		unsigned int active;
+		/* Moving average of the time from CR to CC, valid once the first CC was received */
+		uint32_t cr_cc_latency_us;
+		bool cr_cc_latency_valid;
+	} load;
 };
 
 int osmo_bsc_msc_init(struct bsc_msc_data *msc);
@@ -200,6 +218,10 @@ struct bsc_msc_data *osmo_msc_data_find(struct gsm_network *, int);
 struct bsc_msc_data *osmo_msc_data_alloc(struct gsm_network *, int);
 
 
+uint32_t osmo_msc_pool_neutral_latency(const struct gsm_network *net);
+bool osmo_msc_pool_weighted_better(const struct bsc_msc_data *a, const struct bsc_msc_data *b,
+				   uint8_t round_robin_next_nr, uint32_t neutral_latency_us);
+
 struct osmo_cell_global_id *cgi_for_msc(struct bsc_msc_data *msc, struct gsm_bts *bts);
 
 /* Helper function to calculate the port number for a given
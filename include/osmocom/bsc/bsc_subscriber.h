@@ -17,6 +17,9 @@ struct bsc_subscr {
 	char imsi[GSM23003_IMSI_MAX_DIGITS+1];
 	uint32_t tmsi;
 	uint16_t lac;
+
+	/* bsc_subscr_name(), composed on first use after the IMSI or TMSI changed */
+	char name[32];
 };
 
 const char *bsc_subscr_name(struct bsc_subscr *bsub);
@@ -35,6 +38,7 @@ struct bsc_subscr *bsc_subscr_find_by_tmsi(struct llist_head *list,
 struct bsc_subscr *bsc_subscr_find_by_mi(struct llist_head *list, const struct osmo_mobile_identity *mi);
 
 void bsc_subscr_set_imsi(struct bsc_subscr *bsub, const char *imsi);
+void bsc_subscr_set_tmsi(struct bsc_subscr *bsub, uint32_t tmsi);
 
 struct bsc_subscr *_bsc_subscr_get(struct bsc_subscr *bsub,
 				   const char *file, int line);
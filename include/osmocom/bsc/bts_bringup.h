@@ -0,0 +1,63 @@
+/* Throttled, prioritized bring-up of many BTS connecting at once */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <osmocom/core/linuxlist.h>
+#include <osmocom/core/timer.h>
+#include <osmocom/core/utils.h>
+
+struct gsm_bts;
+struct gsm_network;
+
+/*!
+ * After a BSC restart or a transport outage, all BTS reconnect at the same time, and configuring all of them at once
+ * keeps the main loop too busy to answer keepalives. With "bts-bringup max-concurrent N", at most N BTS get their OML
+ * configuration sent at a time; the others keep their OML messages queued until it is their turn, the BTS with the
+ * highest "bringup-priority" first.
+ */
+
+enum bts_bringup_state {
+	/* OML is down, or the BTS is up and no longer throttled */
+	BTS_BRINGUP_IDLE,
+	/* OML is up, the configuration waits for its turn */
+	BTS_BRINGUP_WAITING,
+	/* the configuration is in progress and counts against max-concurrent */
+	BTS_BRINGUP_ACTIVE,
+};
+
+extern const struct value_string bts_bringup_state_names[];
+
+/* Bring-up scheduling state of one BTS */
+struct bts_bringup {
+	/* BTS with a higher priority get configured first */
+	uint8_t priority;
+	enum bts_bringup_state state;
+	/* entry in the network's list of waiting BTS */
+	struct llist_head entry;
+	/* X993103: stop throttling a BTS that takes too long to come up */
+	struct osmo_timer_list timer;
+};
+
+bool bts_bringup_request(struct gsm_bts *bts);
+void bts_bringup_done(struct gsm_bts *bts);
+void bts_bringup_abort(struct gsm_bts *bts);
+void bts_bringup_schedule(struct gsm_network *net);
+bool bts_bringup_admitted(const struct gsm_bts *bts);
@@ -24,6 +24,9 @@
 #include <stdint.h>
 #include <osmocom/core/msgb.h>
 
+struct gsm_bts;
+struct gsm_bts_trx;
+
 struct msgb *nanobts_attr_bts_get(struct gsm_bts *bts);
 struct msgb *nanobts_attr_nse_get(struct gsm_bts *bts);
 struct msgb *nanobts_attr_cell_get(struct gsm_bts *bts);
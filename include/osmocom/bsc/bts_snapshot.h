@@ -0,0 +1,29 @@
+/* Persist the System Information of each BTS across restarts */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct gsm_bts;
+struct gsm_network;
+
+int bts_snapshot_load(struct gsm_network *net);
+unsigned int bts_snapshot_count(const struct gsm_network *net);
+bool bts_snapshot_restore_si(struct gsm_bts *bts, uint32_t si_gen, int *si_len);
+void bts_snapshot_store_si(struct gsm_bts *bts, uint32_t si_gen, const int *si_len);
@@ -34,5 +34,6 @@ struct pchan_load {
 void bts_chan_load(struct pchan_load *cl, const struct gsm_bts *bts);
 void network_chan_load(struct pchan_load *pl, struct gsm_network *net);
 void bts_update_t3122_chan_load(struct gsm_bts *bts);
+void network_chan_load_publish(struct gsm_network *net);
 
 #endif /* _CHAN_ALLOC_H */
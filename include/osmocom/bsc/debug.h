@@ -30,8 +30,12 @@ enum {
 	Debug_LastEntry,
 };
 
+/* LOGP() only evaluates its arguments when some log target has subsys enabled at level. Where building the log
+ * message takes more than the arguments, e.g. a loop or a series of DEBUGPC() calls, check LOG_ENABLED() first. */
+#define LOG_ENABLED(subsys, level) log_check_level(subsys, level)
+
 #define LOG_BTS(bts, subsys, level, fmt, args...) \
-	LOGP(subsys, level, "(bts=%d) " fmt, (bts)->nr, ## args)
+	LOGP(subsys, level, "%s " fmt, (bts)->name, ## args)
 
 #define LOG_TRX(trx, subsys, level, fmt, args...) \
-	LOGP(subsys, level, "(bts=%d,trx=%d) " fmt, (trx)->bts->nr, (trx)->nr, ## args)
+	LOGP(subsys, level, "%s " fmt, (trx)->name, ## args)
@@ -31,13 +31,17 @@
 #include <osmocom/abis/e1_input.h>
 #include <osmocom/bsc/meas_rep.h>
 #include <osmocom/bsc/acc_ramp.h>
+#include <osmocom/bsc/bts_bringup.h>
 #include <osmocom/bsc/neighbor_ident.h>
 #include <osmocom/bsc/osmux.h>
+#include <osmocom/bsc/nri_lookup.h>
 
 #define GSM_T3122_DEFAULT 10
 
 struct mgcp_client_conf;
 struct mgcp_client;
+struct mgw_pool_member;
+struct abis_nm_sw;
 struct gsm0808_cell_id;
 struct osmo_mgcpc_ep;
 
@@ -46,9 +50,13 @@ struct osmo_mgcpc_ep;
 
 #define OBSC_NM_W_ACK_CB(__msgb) (__msgb)->cb[3]
 
+/* Most OML messages waiting for their response per BTS, for BTS models with one message in flight per MO */
+#define ABIS_NM_MAX_IN_FLIGHT 16
+
 struct bsc_subscr;
 struct gprs_ra_id;
 struct handover;
+struct nanobts_attr_cache;
 
 #define OBSC_LINKID_CB(__msgb)	(__msgb)->cb[3]
 
@@ -90,6 +98,14 @@ struct gsm_classmark {
 	uint8_t classmark3[14]; /* if cm3 gets extended by spec, it will be truncated */
 };
 
+/* How bsc_find_msc() distributes new subscribers across the MSC pool */
+enum mscpool_selection {
+	/* Strictly by msc->nr, one after the other */
+	MSCPOOL_SEL_ROUND_ROBIN,
+	/* By the lowest load relative to the configured weight, see bsc_msc_data->load */
+	MSCPOOL_SEL_WEIGHTED,
+};
+
 enum subscr_sccp_state {
 	SUBSCR_SCCP_ST_NONE,
 	SUBSCR_SCCP_ST_WAIT_CONN_CONF,
@@ -141,6 +157,14 @@ struct assignment_fsm_data {
 	 * existed before or isn't needed at all.)*/
 	struct osmo_mgcpc_ep_ci *created_ci_for_msc;
 
+	/* In pipelined mode, the MSC side CI is requested along with the lchan activation: whether that
+	 * request was sent, and whether the MGW has confirmed it yet. */
+	bool msc_mgw_requested;
+	bool msc_mgw_ready;
+
+	/* When the Assignment started, to feed the assignment latency stats. */
+	struct timespec start_time;
+
 	enum gsm0808_cause failure_cause;
 	enum gsm48_rr_cause rr_cause;
 
@@ -269,6 +293,8 @@ struct gsm_subscriber_connection {
 		/* Sigtran connection ID */
 		int conn_id;
 		enum subscr_sccp_state state;
+		/* When the SCCP CR was sent, to measure the CR -> CC latency */
+		struct timespec cr_sent;
 	} sccp;
 
 	/* for audio handling */
@@ -282,6 +308,8 @@ struct gsm_subscriber_connection {
 		/* The endpoint at the MGW used to join both BTS and MSC side connections, e.g.
 		 * "rtpbridge/23@mgw". */
 		struct osmo_mgcpc_ep *mgw_endpoint;
+		/* The MGW of the pool that mgw_endpoint was allocated on, NULL if not from the pool. */
+		struct mgw_pool_member *mgw_pool_member;
 
 		/* The connection identifier of the osmo_mgcpc_ep used to transceive RTP towards the MSC.
 		 * (The BTS side CI is handled by struct gsm_lchan and the lchan_fsm.) */
@@ -292,6 +320,8 @@ struct gsm_subscriber_connection {
 	struct {
 		uint8_t global_call_ref[15];
 		uint8_t global_call_ref_len; /* length of global_call_ref */
+		/* entry in gsm_network->lcls_gcr_hash, to find the other call leg by GCR */
+		struct llist_head gcr_hash_entry;
 		enum gsm0808_lcls_config config;	/* TS 48.008 3.2.2.116 */
 		enum gsm0808_lcls_control control;	/* TS 48.008 3.2.2.117 */
 		/* LCLS FSM */
@@ -543,6 +573,20 @@ struct lchan_activate_info {
 	struct gsm_lchan *re_use_mgw_endpoint_from_lchan;
 };
 
+/* Measurement history of an lchan. At more than 1 KB, this is by far the largest part of an lchan, yet only needed
+ * while the lchan is in use. It is allocated on the first measurement report and freed when the lchan is released,
+ * so that the lchans of idle timeslots stay small and scanning them for free channels touches less memory. */
+struct gsm_lchan_meas {
+	/* table of neighbor cell measurements */
+	struct neigh_meas_proc neigh_meas[MAX_NEIGH_MEAS];
+
+	/* cache of last measurement reports on this lchan */
+	struct gsm_meas_rep meas_rep[MAX_MEAS_REP];
+	int meas_rep_idx;
+	int meas_rep_count;
+	uint8_t meas_rep_last_seen_nr;
+};
+
 struct gsm_lchan {
 	/* The TS that we're part of */
 	struct gsm_bts_trx_ts *ts;
@@ -555,6 +599,12 @@ struct gsm_lchan {
 	struct osmo_fsm_inst *fi;
 	struct osmo_fsm_inst *fi_rtp;
 	struct osmo_mgcpc_ep_ci *mgw_endpoint_ci_bts;
+	/* While a CRCX for mgw_endpoint_ci_bts is pending, the MGW it was sent to and the time it was sent,
+	 * to feed the MGW pool's latency and health tracking. */
+	struct {
+		struct mgw_pool_member *member;
+		struct timespec sent;
+	} mgw_crcx;
 
 	struct {
 		struct lchan_activate_info info;
@@ -628,14 +678,8 @@ struct gsm_lchan {
 
 	uint8_t rqd_ta;
 
-	/* table of neighbor cell measurements */
-	struct neigh_meas_proc neigh_meas[MAX_NEIGH_MEAS];
-
-	/* cache of last measurement reports on this lchan */
-	struct gsm_meas_rep meas_rep[MAX_MEAS_REP];
-	int meas_rep_idx;
-	int meas_rep_count;
-	uint8_t meas_rep_last_seen_nr;
+	/* Measurement history, NULL until the first measurement report on this lchan, see lchan_meas_get() */
+	struct gsm_lchan_meas *meas;
 
 	/* GSM Random Access data */
 	/* TODO: don't allocate this, rather keep an "is_present" flag */
@@ -677,13 +721,15 @@ struct gsm_bts_trx_ts {
 	 * enters IN_USE state, i.e. after each TCH use we try to PDCH ACT once again. */
 	bool pdch_act_allowed;
 
+	/* Whether this unused dynamic timeslot was kept off PDCH for the BTS's dyn-ts-reserve */
+	bool dyn_reserve_kept;
+
 	/* Whether TS_EV_OML_READY was received */
 	bool is_oml_ready;
 	/* Whether TS_EV_RSL_READY was received */
 	bool is_rsl_ready;
 
 	struct gsm_abis_mo mo;
-	struct tlv_parsed nm_attr;
 	uint8_t nm_chan_comb;
 	int tsc;		/* -1 == use BTS TSC */
 
@@ -720,6 +766,8 @@ struct gsm_bts_trx {
 	struct gsm_bts *bts;
 	/* number of this TRX in the BTS */
 	uint8_t nr;
+	/* "(bts=N,trx=M)", composed once for logging, like lchan->name */
+	char *name;
 	/* human readable name / description */
 	char *description;
 	/* how do we talk RSL with this TRX? */
@@ -734,7 +782,6 @@ struct gsm_bts_trx {
 	struct e1inp_sign_link *oml_link;
 
 	struct gsm_abis_mo mo;
-	struct tlv_parsed nm_attr;
 	struct {
 		struct gsm_abis_mo mo;
 	} bb_transc;
@@ -743,6 +790,9 @@ struct gsm_bts_trx {
 	int nominal_power;		/* in dBm */
 	unsigned int max_power_red;	/* in actual dB */
 
+	/* Encoded Radio Carrier attributes of a nanoBTS, see bts_ipaccess_nanobts_omlattr.c */
+	struct nanobts_attr_cache *nanobts_attr_cache;
+
 	union {
 		struct {
 			struct {
@@ -834,6 +884,9 @@ struct gsm_bts_model {
 };
 
 
+/* Most paging groups there can be: 9 CCCH blocks per 51-multiframe, times 9 multiframes, see
+ * gsm48_number_of_paging_subchannels() */
+#define PAGING_GROUPS_MAX 81
 
 /*
  * This keeps track of the paging status of one BTS. It
@@ -845,6 +898,13 @@ struct gsm_bts_paging_state {
 	struct llist_head pending_requests;
 	struct gsm_bts *bts;
 
+	/* The pending requests once more, queued by their paging group. The groups get their turn round-robin, so
+	 * that the requests of a crowded group do not hold up those of the others. */
+	struct llist_head groups[PAGING_GROUPS_MAX];
+	unsigned int group_depth[PAGING_GROUPS_MAX];
+	/* the group to look at first for the next request to send */
+	unsigned int next_group;
+
 	struct osmo_timer_list work_timer;
 	struct osmo_timer_list credit_timer;
 
@@ -1014,6 +1074,8 @@ struct gsm_bts {
 
 	/* number of this BTS in network */
 	uint8_t nr;
+	/* "(bts=N)", composed once for logging, like lchan->name */
+	char *name;
 	/* human readable name / description */
 	char *description;
 	/* Cell Identity */
@@ -1186,9 +1248,44 @@ struct gsm_bts {
 	bool force_combined_si_set;
 	int bcch_change_mark;
 
-	/* Abis NM queue */
+	/* Abis NM queue: messages not sent yet, in order */
 	struct llist_head abis_queue;
+	/* number of sent messages waiting for their response */
 	int abis_nm_pend;
+	/* the managed objects of those, oldest first, for BTS models with one message in flight per MO */
+	struct {
+		bool has_mo;
+		uint8_t obj_class;
+		struct abis_om_obj_inst obj_inst;
+	} abis_nm_in_flight[ABIS_NM_MAX_IN_FLIGHT];
+	/* the most recent messages sent without waiting for their response, e.g. IPA Restart; a response to one of
+	 * them is processed all the same. An unused entry has msg_type 0. */
+	struct {
+		uint8_t msg_type;
+		uint8_t obj_class;
+		struct abis_om_obj_inst obj_inst;
+	} abis_nm_direct[ABIS_NM_MAX_IN_FLIGHT];
+	unsigned int abis_nm_direct_next;
+
+	/* Turn of this BTS when many BTS connect at once, see bts_bringup.c */
+	struct bts_bringup bringup;
+
+	/* Set once the System Information was regenerated after startup, from then on the warm start snapshot is
+	 * neither used nor updated, see bts_snapshot.c */
+	bool warm_start_done;
+
+	/* Encoded BTS and GPRS attributes of a nanoBTS, reused for as long as the parameters they were encoded from
+	 * remain the same, see bts_ipaccess_nanobts_omlattr.c */
+	struct nanobts_attr_cache *nanobts_attr_cache;
+
+	/* Duration of bringing up the BTS, from the OML link coming up until all TRX and timeslots run */
+	struct {
+		bool running;
+		struct timespec start;
+		unsigned int msgs;
+		unsigned int max_in_flight;
+		unsigned long long duration_ms;
+	} oml_bringup;
 
 	struct gsm_network *network;
 
@@ -1196,6 +1293,16 @@ struct gsm_bts {
 	 * rather than starting from TRX0 and go upwards? */
 	int chan_alloc_reverse;
 
+	/* Dynamic timeslots to keep switched away from PDCH while there is voice demand, so that a TCH
+	 * request does not have to wait for a PDCH deactivation first. */
+	struct {
+		/* vty 'dyn-ts-reserve', 0 to always use idle dynamic timeslots as PDCH */
+		uint8_t num;
+		/* whether a TCH was requested within X993104 */
+		bool demand;
+		struct osmo_timer_list idle_timer;
+	} dyn_ts_reserve;
+
 	enum neigh_list_manual_mode neigh_list_manual_mode;
 	/* parameters from which we build SYSTEM INFORMATION */
 	struct {
@@ -1250,6 +1357,9 @@ struct gsm_bts {
 	char *pcu_sock_path;
 	struct pcu_sock_state *pcu_state;
 
+	/* Software Load / Activate session, allocated on first use */
+	struct abis_nm_sw *sw_load;
+
 	struct rate_ctr_group *bts_ctrs;
 	struct osmo_stat_item_group *bts_statg;
 
@@ -1268,6 +1378,40 @@ struct gsm_bts {
 	struct load_counter chan_load_samples[7];
 	int chan_load_samples_idx;
 	uint8_t chan_load_avg; /* current channel load average in percent (0 - 100). */
+	/* The most recent of these samples per pchan type, so that readers need not walk all lchans again. */
+	struct load_counter chan_load_last[_GSM_PCHAN_MAX];
+
+	/* Admission of CHANNEL REQUIRED from the RACH, see abis_rsl.c */
+	struct {
+		/* struct chan_rqd waiting to be served, by priority */
+		struct llist_head queue;
+		unsigned int queue_len;
+		struct osmo_timer_list timer;
+		/* request references served recently, to drop RACH bursts reported more than once */
+		struct gsm48_req_ref recent[8];
+		struct timespec recent_time[8];
+		unsigned int recent_idx;
+	} chan_rqd;
+
+	/* Immediate Assignments and Rejects held back to share AGCH blocks, see abis_rsl.c */
+	struct {
+		struct osmo_timer_list timer;
+		/* rejected MS for the next IMMEDIATE ASSIGNMENT REJECT */
+		struct {
+			struct gsm48_req_ref ref;
+			uint8_t wait_ind;
+		} rej[4];
+		unsigned int rej_num;
+		/* encoded IMMEDIATE ASSIGNMENT waiting for a second one, valid if ass_len > 0 */
+		uint8_t ass[GSM_MACBLOCK_LEN];
+		uint8_t ass_len;
+		/* the lchan assigned in ass, to fail it if ass cannot be sent */
+		struct gsm_lchan *ass_lchan;
+	} agch;
+
+	/* CTRL bts-snapshot record of this BTS, rebuilt at most once per channel load sample interval. */
+	char *ctrl_snapshot;
+	unsigned int ctrl_snapshot_gen;
 
 	/* cell broadcast system */
 	struct osmo_timer_list cbch_timer;
@@ -1384,10 +1528,20 @@ static inline struct gsm_bts *conn_get_bts(struct gsm_subscriber_connection *con
 void conn_update_ms_power_class(struct gsm_subscriber_connection *conn, uint8_t power_class);
 void lchan_update_ms_power_ctrl_level(struct gsm_lchan *lchan, int ms_power_dbm);
 
+struct gsm_lchan_meas *lchan_meas_get(struct gsm_lchan *lchan);
+void lchan_meas_free(struct gsm_lchan *lchan);
+
 enum bts_counter_id {
 	BTS_CTR_CHREQ_TOTAL,
 	BTS_CTR_CHREQ_SUCCESSFUL,
 	BTS_CTR_CHREQ_NO_CHANNEL,
+	BTS_CTR_CHREQ_DUPLICATE,
+	BTS_CTR_CHREQ_PRIORITIZED,
+	BTS_CTR_CHREQ_SHED,
+	BTS_CTR_CHREQ_EXPIRED,
+	BTS_CTR_AGCH_IMM_ASS_EXT,
+	BTS_CTR_AGCH_BLOCKS_SAVED,
+	BTS_CTR_AGCH_SEND_FAILED,
 	BTS_CTR_CHAN_RF_FAIL,
 	BTS_CTR_CHAN_RLL_ERR,
 	BTS_CTR_BTS_OML_FAIL,
@@ -1437,12 +1591,29 @@ enum bts_counter_id {
 	BTS_CTR_ASSIGNMENT_TIMEOUT,
 	BTS_CTR_ASSIGNMENT_FAILED,
 	BTS_CTR_ASSIGNMENT_ERROR,
+	BTS_CTR_PCU_TX_DROPPED,
+	BTS_CTR_DYN_TS_PDCH_DEACT_AVOIDED,
+	BTS_CTR_DYN_TS_PDCH_DEACT_WAIT,
+	BTS_CTR_PAGING_GROUP_DEPTH_0,
+	BTS_CTR_PAGING_GROUP_DEPTH_1,
+	BTS_CTR_PAGING_GROUP_DEPTH_2_3,
+	BTS_CTR_PAGING_GROUP_DEPTH_4_7,
+	BTS_CTR_PAGING_GROUP_DEPTH_8_15,
+	BTS_CTR_PAGING_GROUP_DEPTH_16_31,
+	BTS_CTR_PAGING_GROUP_DEPTH_32_MORE,
 };
 
 static const struct rate_ctr_desc bts_ctr_description[] = {
 	[BTS_CTR_CHREQ_TOTAL] = 		{"chreq:total", "Received channel requests"},
 	[BTS_CTR_CHREQ_SUCCESSFUL] =  		{"chreq:successful", "Successful channel requests (immediate assign sent)"},
 	[BTS_CTR_CHREQ_NO_CHANNEL] = 		{"chreq:no_channel", "Sent to MS no channel available"},
+	[BTS_CTR_CHREQ_DUPLICATE] = 		{"chreq:duplicate", "Dropped channel requests already received"},
+	[BTS_CTR_CHREQ_PRIORITIZED] = 		{"chreq:prioritized", "Channel requests queued ahead of others by cause"},
+	[BTS_CTR_CHREQ_SHED] = 			{"chreq:shed", "Channel requests rejected for a full admission queue"},
+	[BTS_CTR_CHREQ_EXPIRED] = 		{"chreq:expired", "Queued channel requests dropped for their age"},
+	[BTS_CTR_AGCH_IMM_ASS_EXT] = 		{"agch:imm_ass_ext", "Immediate Assignment Extended sent, each for two MS"},
+	[BTS_CTR_AGCH_BLOCKS_SAVED] = 		{"agch:blocks_saved", "AGCH blocks saved by assigning or rejecting several MS at once"},
+	[BTS_CTR_AGCH_SEND_FAILED] = 		{"agch:send_failed", "Immediate Assignments and Rejects failed to be sent to the BTS"},
 	[BTS_CTR_CHAN_RF_FAIL] = 		{"chan:rf_fail", "Received a RF failure indication from BTS"},
 	[BTS_CTR_CHAN_RLL_ERR] = 		{"chan:rll_err", "Received a RLL failure with T200 cause from BTS"},
 	[BTS_CTR_BTS_OML_FAIL] = 		{"oml_fail", "Received a TEI down on a OML link"},
@@ -1495,6 +1666,16 @@ static const struct rate_ctr_desc bts_ctr_description[] = {
 	[BTS_CTR_ASSIGNMENT_TIMEOUT] =               {"assignment:timeout", "Assignment timed out"},
 	[BTS_CTR_ASSIGNMENT_FAILED] =                {"assignment:failed", "Received Assignment Failure message"},
 	[BTS_CTR_ASSIGNMENT_ERROR] =                 {"assignment:error", "Assignment failed for other reason"},
+	[BTS_CTR_PCU_TX_DROPPED] =                   {"pcu:tx_dropped", "Messages to the PCU dropped because the PCU socket queue was full"},
+	[BTS_CTR_DYN_TS_PDCH_DEACT_AVOIDED] =        {"dyn_ts:pdch_deact_avoided", "lchans on a dynamic timeslot kept switched away from PDCH by the dyn-ts-reserve"},
+	[BTS_CTR_DYN_TS_PDCH_DEACT_WAIT] =           {"dyn_ts:pdch_deact_wait", "lchans on a dynamic timeslot that had to wait for PDCH deactivation"},
+	[BTS_CTR_PAGING_GROUP_DEPTH_0] =             {"paging:group_depth:0", "Paging requests for a paging group without other pending requests"},
+	[BTS_CTR_PAGING_GROUP_DEPTH_1] =             {"paging:group_depth:1", "Paging requests for a paging group with 1 other pending request"},
+	[BTS_CTR_PAGING_GROUP_DEPTH_2_3] =           {"paging:group_depth:2_3", "Paging requests for a paging group with 2 to 3 other pending requests"},
+	[BTS_CTR_PAGING_GROUP_DEPTH_4_7] =           {"paging:group_depth:4_7", "Paging requests for a paging group with 4 to 7 other pending requests"},
+	[BTS_CTR_PAGING_GROUP_DEPTH_8_15] =          {"paging:group_depth:8_15", "Paging requests for a paging group with 8 to 15 other pending requests"},
+	[BTS_CTR_PAGING_GROUP_DEPTH_16_31] =         {"paging:group_depth:16_31", "Paging requests for a paging group with 16 to 31 other pending requests"},
+	[BTS_CTR_PAGING_GROUP_DEPTH_32_MORE] =       {"paging:group_depth:32_more", "Paging requests for a paging group with 32 or more other pending requests"},
 
 };
 
@@ -1531,6 +1712,9 @@ enum {
 	BTS_STAT_RSL_CONNECTED,
 	BTS_STAT_LCHAN_BORKEN,
 	BTS_STAT_TS_BORKEN,
+	BTS_STAT_CHREQ_QUEUE_LENGTH,
+	BTS_STAT_OML_BRINGUP_TIME,
+	BTS_STAT_OML_BRINGUP_MSGS,
 };
 
 enum {
@@ -1568,6 +1752,11 @@ enum {
 	BSC_CTR_MSCPOOL_SUBSCR_NO_MSC,
 	BSC_CTR_MSCPOOL_EMERG_FORWARDED,
 	BSC_CTR_MSCPOOL_EMERG_LOST,
+	BSC_CTR_BTS_BRINGUP_COMPLETED,
+	BSC_CTR_BTS_BRINGUP_TIMEOUT,
+	BSC_CTR_WARM_START_SI_REUSED,
+	BSC_CTR_WARM_START_SI_STALE,
+	BSC_CTR_MEAS_FEED_DROPPED,
 };
 
 static const struct rate_ctr_desc bsc_ctr_description[] = {
@@ -1621,6 +1810,15 @@ static const struct rate_ctr_desc bsc_ctr_description[] = {
 						 "Emergency call requests forwarded to an MSC (see also per-MSC counters)"},
 	[BSC_CTR_MSCPOOL_EMERG_LOST] =		{"mscpool:emerg:lost",
 						 "Emergency call requests lost because no MSC was found available."},
+	[BSC_CTR_BTS_BRINGUP_COMPLETED] =	{"bts_bringup:completed", "BTS configured up to all TRX and timeslots running."},
+	[BSC_CTR_BTS_BRINGUP_TIMEOUT] =		{"bts_bringup:timeout",
+						 "BTS no longer throttled for taking longer than X993103 to come up."},
+	[BSC_CTR_WARM_START_SI_REUSED] =	{"warm_start:si_reused",
+						 "TRX System Information taken from the snapshot of the previous run."},
+	[BSC_CTR_WARM_START_SI_STALE] =		{"warm_start:si_stale",
+						 "Snapshots of the previous run not used because the BTS configuration changed."},
+	[BSC_CTR_MEAS_FEED_DROPPED] =		{"meas_feed:dropped",
+						 "Measurement reports not sent to the meas-feed because encoding or queueing failed."},
 };
 
 
@@ -1636,8 +1834,23 @@ static const struct rate_ctr_group_desc bsc_ctrg_desc = {
 /* Constants for the BSC stats */
 enum {
 	BSC_STAT_NUM_BTS_TOTAL,
+	BSC_STAT_ASSIGNMENT_LATENCY_P50,
+	BSC_STAT_ASSIGNMENT_LATENCY_P90,
+	BSC_STAT_ASSIGNMENT_LATENCY_P99,
+	BSC_STAT_BTS_BRINGUP_WAITING,
+	BSC_STAT_BTS_BRINGUP_ACTIVE,
+	BSC_STAT_CHAN_TCH_USED,
+	BSC_STAT_CHAN_TCH_TOTAL,
+	BSC_STAT_CHAN_SDCCH_USED,
+	BSC_STAT_CHAN_SDCCH_TOTAL,
 };
 
+/* Number of hash buckets for looking up subscriber connections by LCLS Global Call Reference */
+#define LCLS_GCR_HASH_BUCKETS 4096
+
+/* Number of most recent successful Assignments the latency percentiles are calculated from */
+#define ASSIGNMENT_LATENCY_SAMPLES 256
+
 struct gsm_tz {
 	int override; /* if 0, use system's time zone instead. */
 	int hr; /* hour */
@@ -1672,6 +1885,25 @@ struct gsm_network {
 	struct llist_head bts_list;
 	struct llist_head bts_rejected;
 
+	/* BTS bring-up scheduling, see bts_bringup.c */
+	struct {
+		/* most BTS configured at the same time, 0 for no limit */
+		unsigned int max_concurrent;
+		/* struct gsm_bts waiting for their turn, by priority */
+		struct llist_head waiting;
+		unsigned int num_waiting;
+		unsigned int num_active;
+	} bts_bringup;
+
+	/* System Information of each BTS persisted across restarts, see bts_snapshot.c */
+	struct {
+		/* vty 'warm-start snapshot', NULL when disabled */
+		char *path;
+		/* struct bts_snapshot loaded from or to be written to path */
+		struct llist_head snapshots;
+		struct osmo_timer_list write_timer;
+	} warm_start;
+
 	/* see gsm_network_T_defs */
 	struct osmo_tdef *T_defs;
 
@@ -1686,6 +1918,8 @@ struct gsm_network {
 	/* Emergency calls potentially select a different set of MSCs, so to not mess up the normal round-robin
 	 * behavior, emergency calls need a separate round-robin counter. */
 	uint8_t mscs_round_robin_next_emerg_nr;
+	/* How to pick an MSC for new subscribers, see enum mscpool_selection */
+	enum mscpool_selection mscpool_selection;
 
 	/* rf ctl related bits */
 	int mid_call_timeout;
@@ -1721,21 +1955,47 @@ struct gsm_network {
 
 	/* Timer for periodic channel load measurements to maintain each BTS's T3122. */
 	struct osmo_timer_list t3122_chan_load_timer;
+	/* Incremented on each run of t3122_chan_load_timer, tells when cached per-BTS state is outdated. */
+	unsigned int chan_load_sample_gen;
+	/* Sum of chan_load_last of all BTS, kept up to date as the BTS's change */
+	struct load_counter chan_load_last[_GSM_PCHAN_MAX];
 
 	struct {
 		struct mgcp_client_conf *conf;
 		struct mgcp_client *client;
 		struct osmo_tdef *tdefs;
+		/* List of struct mgw_pool_member, new call endpoints are spread across these. The first
+		 * member uses conf and client above. */
+		struct llist_head pool;
 	} mgw;
 
+	/* Subscriber connections with an LCLS Global Call Reference, hashed by the GCR; to find the other
+	 * call leg of a conn without scanning all subscr_conns. See lcls_set_gcr(). */
+	struct llist_head lcls_gcr_hash[LCLS_GCR_HASH_BUCKETS];
+
 	/* Remote BSS Cell Identifier Lists */
 	struct neighbor_ident_list *neighbor_bss_cells;
 
 	/* Don't refuse to start with mutually exclusive codec settings */
 	bool allow_unusable_timeslots;
 
+	/* Request the MSC side MGW CI concurrently with the lchan activation during Assignment, instead of
+	 * after the lchan is established. */
+	bool assignment_mgw_pipelining;
+
+	/* Ring buffer of the most recent Assignment durations in milliseconds, and the same samples in
+	 * ascending order for the percentile stats */
+	struct {
+		uint32_t ms[ASSIGNMENT_LATENCY_SAMPLES];
+		uint32_t sorted[ASSIGNMENT_LATENCY_SAMPLES];
+		unsigned int next;
+		unsigned int count;
+	} assignment_latency;
+
 	uint8_t nri_bitlen;
 	struct osmo_nri_ranges *null_nri_ranges;
+	/* NRI value to MSC mapping derived from the NRI ranges above, see nri_lookup() */
+	struct nri_lookup_table nri_lookup;
 };
 
 struct gsm_audio_support {
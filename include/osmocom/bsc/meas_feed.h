@@ -1,9 +1,12 @@
 #pragma once
 
 #include <stdint.h>
+#include <stddef.h>
 
 #include <osmocom/bsc/meas_rep.h>
 
+struct msgb;
+
 struct meas_feed_hdr {
 	uint8_t msg_type;
 	uint8_t reserved;
@@ -34,10 +37,32 @@ enum meas_feed_msgtype {
 	MEAS_FEED_MEAS		= 0,
 };
 
+/* Version 1 is struct meas_feed_meas in the BSC's host layout, including the raw struct gsm_meas_rep. */
 #define MEAS_FEED_VERSION	1
 
+/* Version 2 is a packed, fixed-width encoding in network byte order that is independent of the BSC's ABI:
+ *
+ *   u8 msg_type, u8 reserved, u16 version (big endian, so that v1 readers reject it)
+ *   u8 lchan_type, pchan_type, bts_nr, trx_nr, ts_nr, ss_nr
+ *   u8 nr, flags
+ *   u8 ul full rxlev, full rxqual, sub rxlev, sub rxqual
+ *   u8 dl full rxlev, full rxqual, sub rxlev, sub rxqual
+ *   u8 bs_power, s16 ms_timing_offset, s8 ms_l1 pwr, u8 ms_l1 ta
+ *   u8 num_cell
+ *   imsi, name, scenario: each u8 length followed by as many characters, no NUL
+ *   num_cell times: u8 rxlev, u8 bsic, u8 neigh_idx, u16 arfcn
+ */
+#define MEAS_FEED_VERSION_2	2
+
+#define MEAS_FEED_V2_MAX_LEN	(4 + 6 + 2 + 8 + 5 + 1 + 3 + 15 + 31 + 31 + 6 * 5)
+
+int meas_feed_meas_encode_v2(struct msgb *msg, const struct meas_feed_meas *mfm);
+int meas_feed_meas_decode(struct meas_feed_meas *mfm, const uint8_t *data, size_t len);
+
 int meas_feed_cfg_set(const char *dst_host, uint16_t dst_port);
 void meas_feed_scenario_set(const char *name);
 
 void meas_feed_cfg_get(char **host, uint16_t *port);
 const char *meas_feed_scenario_get(void);
+void meas_feed_version_set(uint16_t version);
+uint16_t meas_feed_version_get(void);
@@ -51,6 +51,21 @@ struct gsm_meas_rep {
 	struct gsm_meas_rep_cell cell[6];
 };
 
+/* IEs of an RSL MEASUREMENT RESULT (3GPP TS 48.058 8.4.8) following the Channel Number, NULL when absent */
+struct rsl_meas_res_ies {
+	const uint8_t *meas_res_nr;
+	const uint8_t *uplink_meas;
+	uint8_t uplink_meas_len;
+	const uint8_t *bs_power;
+	/* always 2 bytes */
+	const uint8_t *l1_info;
+	const uint8_t *l3_info;
+	uint16_t l3_info_len;
+	const uint8_t *ms_timing_offset;
+};
+
+int rsl_meas_res_ies_parse(struct rsl_meas_res_ies *ies, const uint8_t *buf, unsigned int len);
+
 /* obtain an average over the last 'num' fields in the meas reps */
 int get_meas_rep_avg(const struct gsm_lchan *lchan,
 		     enum meas_rep_field field, unsigned int num);
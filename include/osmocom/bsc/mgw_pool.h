@@ -0,0 +1,96 @@
+/* Pool of MGCP clients: spread new call endpoints across several MGWs */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include <osmocom/core/linuxlist.h>
+
+struct vty;
+struct gsm_network;
+struct mgcp_client;
+struct mgcp_client_conf;
+struct rate_ctr_group;
+struct osmo_stat_item_group;
+
+/* Member 0 is the MGW configured by the plain 'mgw remote-ip' etc. commands, additional members are numbered up to
+ * this. */
+#define MGW_POOL_MEMBER_NR_MAX 31
+
+/* After this many consecutive CRCX failures or timeouts, skip an MGW for new calls... */
+#define MGW_POOL_FAIL_THRESHOLD 3
+/* ...during this many seconds, then try it again. */
+#define MGW_POOL_BLOCK_TIME 30
+
+enum mgw_pool_ctr {
+	MGW_CTR_ENDPOINT_ALLOCATED,
+	MGW_CTR_CRCX_SUCCESS,
+	MGW_CTR_CRCX_FAILURE,
+	MGW_CTR_BLOCKED,
+};
+
+enum mgw_pool_stat {
+	MGW_STAT_ENDPOINTS,
+	MGW_STAT_PENDING,
+	MGW_STAT_LATENCY,
+	MGW_STAT_HEALTHY,
+};
+
+enum mgw_pool_crcx_result {
+	MGW_POOL_CRCX_SUCCESS,
+	MGW_POOL_CRCX_FAILURE,
+	/* No response was awaited after all, e.g. the lchan was released; affects neither latency nor health. */
+	MGW_POOL_CRCX_ABORTED,
+};
+
+struct mgw_pool_member {
+	struct llist_head entry;
+	struct gsm_network *net;
+	unsigned int nr;
+
+	struct mgcp_client_conf *conf;
+	/* Whether conf->local_addr is a copy of the one of member 0, not configured for this member */
+	bool local_addr_default;
+	/* NULL until mgw_pool_connect() */
+	struct mgcp_client *client;
+
+	/* Number of endpoints currently allocated on this MGW. */
+	unsigned int endpoints;
+	/* Number of CRCX transactions waiting for a response from this MGW. */
+	unsigned int pending;
+	/* Moving average of the CRCX response time in microseconds, 0 if not known yet. */
+	uint32_t latency_us;
+
+	unsigned int consecutive_failures;
+	/* If set and in the future, do not pick this MGW for new calls. */
+	struct timespec blocked_until;
+
+	struct rate_ctr_group *ctrs;
+	struct osmo_stat_item_group *statg;
+};
+
+struct mgw_pool_member *mgw_pool_member_find(struct gsm_network *net, unsigned int nr);
+struct mgw_pool_member *mgw_pool_member_alloc(struct gsm_network *net, unsigned int nr,
+					      struct mgcp_client_conf *conf);
+int mgw_pool_member_free(struct mgw_pool_member *member);
+
+int mgw_pool_member_set_remote_addr(struct mgw_pool_member *member, const char *addr);
+int mgw_pool_member_set_remote_port(struct mgw_pool_member *member, int port);
+int mgw_pool_member_set_local_addr(struct mgw_pool_member *member, const char *addr);
+int mgw_pool_member_set_local_port(struct mgw_pool_member *member, int port);
+
+int mgw_pool_connect(struct gsm_network *net);
+
+struct mgw_pool_member *mgw_pool_pick(struct gsm_network *net);
+bool mgw_pool_member_healthy(const struct mgw_pool_member *member);
+
+void mgw_pool_member_endpoint_get(struct mgw_pool_member *member);
+void mgw_pool_member_endpoint_put(struct mgw_pool_member *member);
+
+void mgw_pool_member_crcx_sent(struct mgw_pool_member *member);
+void mgw_pool_member_crcx_result(struct mgw_pool_member *member, const struct timespec *sent,
+				 enum mgw_pool_crcx_result result);
+
+void mgw_pool_config_write(struct vty *vty, const char *indent);
+void mgw_pool_vty_show(struct vty *vty, struct gsm_network *net);
@@ -0,0 +1,29 @@
+/* Direct NRI value to MSC lookup table, for MSC pooling */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+struct gsm_network;
+struct bsc_msc_data;
+
+struct nri_lookup_entry {
+	/* First MSC in net->mscs whose NRI ranges contain this NRI value, or NULL if none. */
+	struct bsc_msc_data *msc;
+	/* True if the NRI ranges of more than one MSC contain this NRI value. */
+	bool overlap;
+	/* True if this NRI value is configured as NULL-NRI. */
+	bool null_nri;
+};
+
+/* One entry per possible NRI value of the current net->nri_bitlen, built on demand from the NRI ranges of
+ * net->mscs and net->null_nri_ranges. */
+struct nri_lookup_table {
+	struct nri_lookup_entry *entries;
+	unsigned int num_entries;
+	uint8_t bitlen;
+	bool valid;
+};
+
+void nri_lookup_invalidate(struct gsm_network *net);
+const struct nri_lookup_entry *nri_lookup(struct gsm_network *net, int16_t nri_v);
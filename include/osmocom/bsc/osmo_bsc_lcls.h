@@ -47,6 +47,11 @@ static inline const char *bsc_lcls_mode_name(enum bsc_lcls_mode m)
 
 enum gsm0808_lcls_status lcls_get_status(const struct gsm_subscriber_connection *conn);
 
+void lcls_set_gcr(struct gsm_subscriber_connection *conn, const uint8_t *gcr, uint8_t gcr_len);
+void lcls_clear_gcr(struct gsm_subscriber_connection *conn);
+struct gsm_subscriber_connection *
+lcls_find_conn_with_same_gcr(const struct gsm_subscriber_connection *conn_local);
+
 void lcls_update_config(struct gsm_subscriber_connection *conn,
 			const uint8_t *config, const uint8_t *control);
 
@@ -30,6 +30,9 @@ enum bsc_con osmo_bsc_sigtran_new_conn(struct gsm_subscriber_connection *conn, s
 /* Open a new connection oriented sigtran connection */
 int osmo_bsc_sigtran_open_conn(struct gsm_subscriber_connection *conn, struct msgb *msg);
 
+/* Change the SCCP state of a connection and account for it in the load of its MSC */
+void osmo_bsc_sigtran_set_conn_state(struct gsm_subscriber_connection *conn, enum subscr_sccp_state state);
+
 /* Send data to MSC */
 int osmo_bsc_sigtran_send(struct gsm_subscriber_connection *conn, struct msgb *msg);
 
@@ -28,6 +28,7 @@
 
 #include <osmocom/bsc/gsm_data.h>
 #include <osmocom/bsc/bsc_subscriber.h>
+#include <osmocom/bsc/timer_wheel.h>
 
 struct bsc_msc_data;
 
@@ -45,8 +46,12 @@ struct gsm_paging_request {
 	/* what kind of channel type do we ask the MS to establish */
 	int chan_type;
 
+	/* paging group of the subscriber, and entry in the BTS's queue for it */
+	unsigned int group;
+	struct llist_head group_entry;
+
 	/* Timer 3113: how long do we try to page? */
-	struct osmo_timer_list T3113;
+	struct timer_wheel_entry T3113;
 
 	/* How often did we ask the BTS to page? */
 	int attempts;
@@ -2,14 +2,29 @@
 #define _PCU_IF_H
 
 #include <osmocom/gsm/l1sap.h>
+#include <osmocom/bsc/pcuif_proto.h>
 
 extern int pcu_direct;
 
+/* Maximum number of messages waiting to be sent to the PCU, newer messages
+ * are dropped (and counted) once this depth is reached */
+#define PCU_SOCK_UPQUEUE_MAX_LEN	1024
+/* Maximum number of messages handed to the kernel in one sendmmsg() call */
+#define PCU_SOCK_TX_BATCH		32
+
+/* One PCU socket may be shared by several BTS configured with the same
+ * pcu-socket path; messages are demultiplexed by their bts_nr. */
 struct pcu_sock_state {
 	struct gsm_network *net;
+	char *path;			/* file system path of the listen socket */
+	unsigned int use_count;		/* number of BTS using this socket */
 	struct osmo_fd listen_bfd;	/* fd for listen socket */
 	struct osmo_fd conn_bfd;	/* fd for connection to lcr */
 	struct llist_head upqueue;	/* queue for sending messages */
+	unsigned int upqueue_len;	/* number of messages in upqueue */
+	unsigned int upqueue_max_seen;	/* high-water mark of upqueue_len */
+	unsigned long long upqueue_dropped; /* messages dropped on full upqueue */
+	struct gsm_pcu_if rx_buf;	/* receive buffer, re-used for each read */
 };
 
 /* PCU relevant information has changed; Inform PCU (if connected) */
@@ -0,0 +1,75 @@
+/* Coarse-grained hierarchical timer wheel for large numbers of timers */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#include <osmocom/core/linuxlist.h>
+#include <osmocom/core/timer.h>
+
+/*!
+ * Each osmo_timer sits in libosmocore's rb-tree, so that starting, stopping and expiring one costs O(log n). For timers
+ * that exist per subscriber, like T3113 for each paging request, a burst of hundreds of thousands of them makes that
+ * add up on the main loop. A timer wheel keeps such timers in per-tick lists instead: starting and stopping one is
+ * O(1), and all timers of a tick expire together from a single osmo_timer. The price is a resolution of one tick,
+ * timers never expire early but up to two ticks late.
+ *
+ * The first level has one slot per tick for the next TIMER_WHEEL_L0_SLOTS ticks; the second level has one slot per
+ * TIMER_WHEEL_L0_SLOTS ticks, and its entries move down to the first level as their time comes closer. Timers further
+ * out than the second level reaches are parked in its last slot and sorted again when that comes up.
+ */
+
+#define TIMER_WHEEL_L0_BITS 8
+#define TIMER_WHEEL_L0_SLOTS (1 << TIMER_WHEEL_L0_BITS)
+#define TIMER_WHEEL_L1_BITS 6
+#define TIMER_WHEEL_L1_SLOTS (1 << TIMER_WHEEL_L1_BITS)
+
+struct timer_wheel;
+
+struct timer_wheel_entry {
+	/* entry in a slot of the wheel, empty when not pending */
+	struct llist_head list;
+	struct timer_wheel *wheel;
+	/* tick at which to expire */
+	uint32_t expires;
+	void (*cb)(void *data);
+	void *data;
+};
+
+struct timer_wheel {
+	/* length of a tick */
+	unsigned int tick_ms;
+	/* CLOCK_MONOTONIC time of tick 0 */
+	struct timespec base;
+	/* the last tick that was processed */
+	uint32_t now;
+	/* number of pending entries */
+	unsigned int count;
+	/* runs once per tick, while there are pending entries */
+	struct osmo_timer_list timer;
+	struct llist_head l0[TIMER_WHEEL_L0_SLOTS];
+	struct llist_head l1[TIMER_WHEEL_L1_SLOTS];
+};
+
+void timer_wheel_init(struct timer_wheel *wheel, unsigned int tick_ms);
+void timer_wheel_entry_setup(struct timer_wheel_entry *entry, void (*cb)(void *data), void *data);
+void timer_wheel_schedule(struct timer_wheel *wheel, struct timer_wheel_entry *entry, unsigned int ms);
+void timer_wheel_del(struct timer_wheel_entry *entry);
+bool timer_wheel_pending(const struct timer_wheel_entry *entry);
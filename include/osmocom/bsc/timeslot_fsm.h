@@ -51,3 +51,8 @@ bool ts_is_capable_of_lchant(struct gsm_bts_trx_ts *ts, enum gsm_chan_t type);
 bool ts_is_lchan_waiting_for_pchan(struct gsm_bts_trx_ts *ts, enum gsm_phys_chan_config *target_pchan);
 bool ts_is_pchan_switching(struct gsm_bts_trx_ts *ts, enum gsm_phys_chan_config *target_pchan);
 bool ts_usable_as_pchan(struct gsm_bts_trx_ts *ts, enum gsm_phys_chan_config as_pchan);
+bool ts_is_pdch_mode(const struct gsm_bts_trx_ts *ts);
+
+unsigned int ts_dyn_reserve_count(struct gsm_bts *bts, const struct gsm_bts_trx_ts *except);
+void ts_dyn_reserve_update(struct gsm_bts *bts);
+void ts_dyn_reserve_demand(struct gsm_bts *bts);
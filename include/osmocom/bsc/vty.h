@@ -1,6 +1,10 @@
 #ifndef OPENBSC_VTY_H
 #define OPENBSC_VTY_H
 
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <osmocom/core/linuxlist.h>
 #include <osmocom/vty/vty.h>
 #include <osmocom/vty/buffer.h>
 #include <osmocom/vty/command.h>
@@ -33,4 +37,17 @@ int bsc_vty_init_extra(void);
 
 struct gsm_network *gsmnet_from_vty(struct vty *vty);
 
+/* Emit one bounded part of a show command's output and advance the cursor. Return true when done. */
+typedef bool (*vty_stream_step_cb)(struct vty *vty, void *cursor);
+int vty_stream_start(struct vty *vty, vty_stream_step_cb step, const void *cursor, size_t cursor_size);
+
+/* Position of a vty_stream step in an llist: the entry to dump next, or head when done. */
+struct vty_stream_llist_pos {
+	struct llist_head *head;
+	struct llist_head *next;
+};
+int vty_stream_start_llist(struct vty *vty, vty_stream_step_cb step, const void *cursor, size_t cursor_size,
+			   size_t llist_pos_offset);
+void vty_stream_llist_del(struct llist_head *entry);
+
 #endif
@@ -68,6 +68,7 @@ static char *unit_id;
 static uint16_t nv_flags;
 static uint16_t nv_mask;
 static char *software = NULL;
+static uint8_t sw_window_size = 19;
 static int sw_load_state = 0;
 static int oml_state = 0;
 static int dump_files = 0;
@@ -349,6 +350,7 @@ static int swload_cbfn(unsigned int hook, unsigned int event, struct msgb *_msg,
 {
 	struct msgb *msg;
 	struct gsm_bts_trx *trx;
+	struct abis_nm_sw_load_progress progress;
 
 	if (hook != GSM_HOOK_NM_SWLOAD)
 		return 0;
@@ -366,6 +368,10 @@ static int swload_cbfn(unsigned int hook, unsigned int event, struct msgb *_msg,
 		break;
 	case NM_MT_LOAD_END_ACK:
 		fprintf(stderr, "LOAD END ACK...");
+		if (!quiet && abis_nm_software_load_progress(trx->bts, &progress) == 0)
+			printf("Software Download: %zu bytes in %u segments, %u windows of %u, %lu ms, %lu bytes/s\n",
+			       progress.bytes_sent, progress.segments_sent, progress.windows_acked,
+			       progress.window_size, progress.duration_ms, progress.bytes_per_sec);
 		/* now make it the default */
 		sw_load_state = 1;
 
@@ -652,7 +658,7 @@ static int nm_state_event(int evt, uint8_t obj_class, void *obj,
 			int rc;
 			if (!quiet)
 				printf("Attempting software upload with '%s'\n", software);
-			rc = abis_nm_software_load(trx->bts, trx->nr, software, 19, 0, swload_cbfn, trx);
+			rc = abis_nm_software_load(trx->bts, trx->nr, software, sw_window_size, 0, swload_cbfn, trx);
 			if (rc < 0) {
 				fprintf(stderr, "Failed to start software load\n");
 				exit(-3);
@@ -889,6 +895,7 @@ static void print_help(void)
 	printf("  -L --Listen TEST_NAME\t\tPerform specified test\n");
 	printf("  -s --stream-id ID\t\tSet the IPA Stream Identifier for OML\n");
 	printf("  -d --software FIRMWARE\tDownload firmware into BTS\n");
+	printf("  -W --window-size NUM\t\tSegments per Software Load window (default 19)\n");
 	printf("\n");
 	printf("Miscellaneous commands:\n");
 	printf("  -h --help\t\t\tthis text\n");
@@ -969,6 +976,7 @@ int main(int argc, char **argv)
 			{ "Listen", 1, 0, 'L' },
 			{ "stream-id", 1, 0, 's' },
 			{ "software", 1, 0, 'd' },
+			{ "window-size", 1, 0, 'W' },
 			{ "firmware", 1, 0, 'f' },
 			{ "write-firmware", 0, 0, 'w' },
 			{ "disable-color", 0, 0, 'c'},
@@ -977,7 +985,7 @@ int main(int argc, char **argv)
 			{ 0, 0, 0, 0 },
 		};
 
-		c = getopt_long(argc, argv, "Gu:o:i:g:rn:S:U:l:L:hs:d:f:wcpqH", long_options,
+		c = getopt_long(argc, argv, "Gu:o:i:g:rn:S:U:l:L:hs:d:W:f:wcpqH", long_options,
 				&option_index);
 
 		if (c == -1)
@@ -1047,6 +1055,14 @@ int main(int argc, char **argv)
 			if (find_sw_load_params(optarg) != 0)
 				exit(0);
 			break;
+		case 'W':
+			ul = strtoul(optarg, NULL, 10);
+			if (ul < 1 || ul > 255) {
+				fprintf(stderr, "The window size must be within 1..255\n");
+				exit(2);
+			}
+			sw_window_size = ul;
+			break;
 		case 'f':
 			firmware_analysis = optarg;
 			break;
@@ -30,6 +30,7 @@
 #include <time.h>
 #include <limits.h>
 #include <inttypes.h>
+#include <string.h>
 
 #include <sys/stat.h>
 #include <netinet/in.h>
@@ -44,6 +45,7 @@
 #include <osmocom/core/talloc.h>
 #include <osmocom/core/utils.h>
 #include <osmocom/bsc/abis_nm.h>
+#include <osmocom/bsc/bts_bringup.h>
 #include <osmocom/bsc/misdn.h>
 #include <osmocom/bsc/signal.h>
 #include <osmocom/abis/e1_input.h>
@@ -168,14 +170,257 @@ int _abis_nm_sendmsg(struct msgb *msg)
 	return abis_sendmsg(msg);
 }
 
+/*
+ * The ip.access OML implementations handle each managed object (MO) by itself, so instead of waiting for the
+ * response to each message, up to ABIS_NM_MAX_IN_FLIGHT messages for distinct MOs go out at a time. Messages for the
+ * same MO keep their order and still wait for the response to the previous one. Other BTS models keep waiting for
+ * each response.
+ */
+static bool abis_nm_pipelined(const struct gsm_bts *bts)
+{
+	return is_ipaccess_bts(bts);
+}
+
+/* Return the FOM header of an OML message from msg->data on, also when wrapped in an ip.access manufacturer
+ * specific header, or NULL for any other message. */
+static const struct abis_om_fom_hdr *abis_nm_oh_foh(const struct abis_om_hdr *oh, unsigned int len)
+{
+	unsigned int offset;
+
+	if (len < sizeof(*oh))
+		return NULL;
+
+	switch (oh->mdisc) {
+	case ABIS_OM_MDISC_FOM:
+		offset = 0;
+		break;
+	case ABIS_OM_MDISC_MANUF:
+		if (len < sizeof(*oh) + 1)
+			return NULL;
+		offset = 1 + oh->data[0];
+		break;
+	default:
+		return NULL;
+	}
+
+	if (len < sizeof(*oh) + offset + sizeof(struct abis_om_fom_hdr))
+		return NULL;
+	return (const struct abis_om_fom_hdr *) (oh->data + offset);
+}
+
+static bool abis_nm_same_mo(const struct abis_om_fom_hdr *a, const struct abis_om_fom_hdr *b)
+{
+	return a->obj_class == b->obj_class && !memcmp(&a->obj_inst, &b->obj_inst, sizeof(a->obj_inst));
+}
+
+static bool abis_nm_mo_in_flight(const struct gsm_bts *bts, const struct abis_om_fom_hdr *foh)
+{
+	int i;
+
+	for (i = 0; i < bts->abis_nm_pend; i++) {
+		if (bts->abis_nm_in_flight[i].has_mo
+		    && bts->abis_nm_in_flight[i].obj_class == foh->obj_class
+		    && !memcmp(&bts->abis_nm_in_flight[i].obj_inst, &foh->obj_inst, sizeof(foh->obj_inst)))
+			return true;
+	}
+	return false;
+}
+
+/* Whether a message queued ahead of msg is for the same MO */
+static bool abis_nm_mo_queued_before(const struct gsm_bts *bts, const struct msgb *msg,
+				     const struct abis_om_fom_hdr *foh)
+{
+	const struct msgb *prev;
+
+	llist_for_each_entry(prev, &bts->abis_queue, list) {
+		const struct abis_om_fom_hdr *prev_foh;
+		if (prev == msg)
+			break;
+		prev_foh = abis_nm_oh_foh((const struct abis_om_hdr *) prev->data, msgb_length(prev));
+		if (prev_foh && abis_nm_same_mo(prev_foh, foh))
+			return true;
+	}
+	return false;
+}
+
+/* Remember a message sent without waiting for its response, overwriting the oldest one */
+static void abis_nm_direct_add(struct gsm_bts *bts, const struct abis_om_fom_hdr *foh)
+{
+	unsigned int i = bts->abis_nm_direct_next++ % ARRAY_SIZE(bts->abis_nm_direct);
+
+	bts->abis_nm_direct[i].msg_type = foh->msg_type;
+	bts->abis_nm_direct[i].obj_class = foh->obj_class;
+	bts->abis_nm_direct[i].obj_inst = foh->obj_inst;
+}
+
+static void abis_nm_tx_queued(struct gsm_bts *bts, struct msgb *msg)
+{
+	if (bts->oml_bringup.running)
+		bts->oml_bringup.msgs++;
+	_abis_nm_sendmsg(msg);
+}
+
+/* Whether foh addresses the BTS as a whole or its C0 */
+static bool abis_nm_foh_is_c0(const struct abis_om_fom_hdr *foh)
+{
+	return foh->obj_inst.trx_nr == 0 || foh->obj_inst.trx_nr == 0xff;
+}
+
+static void abis_nm_queue_fill_window_pass(struct gsm_bts *bts, bool c0_only)
+{
+	struct msgb *msg, *msg2;
+
+	llist_for_each_entry_safe(msg, msg2, &bts->abis_queue, list) {
+		const struct abis_om_fom_hdr *foh;
+
+		if (bts->abis_nm_pend >= ABIS_NM_MAX_IN_FLIGHT)
+			break;
+
+		foh = abis_nm_oh_foh((const struct abis_om_hdr *) msg->data, msgb_length(msg));
+		if (!foh) {
+			/* Without a MO to go by, wait for everything before it */
+			if (bts->abis_nm_pend || &msg->list != bts->abis_queue.next)
+				break;
+		} else if ((c0_only && !abis_nm_foh_is_c0(foh))
+			   || abis_nm_mo_in_flight(bts, foh) || abis_nm_mo_queued_before(bts, msg, foh))
+			continue;
+
+		llist_del(&msg->list);
+		if (OBSC_NM_W_ACK_CB(msg)) {
+			bts->abis_nm_in_flight[bts->abis_nm_pend].has_mo = !!foh;
+			if (foh) {
+				bts->abis_nm_in_flight[bts->abis_nm_pend].obj_class = foh->obj_class;
+				bts->abis_nm_in_flight[bts->abis_nm_pend].obj_inst = foh->obj_inst;
+			}
+			bts->abis_nm_pend++;
+			bts->oml_bringup.max_in_flight = OSMO_MAX(bts->oml_bringup.max_in_flight, bts->abis_nm_pend);
+		} else if (foh) {
+			abis_nm_direct_add(bts, foh);
+		}
+		abis_nm_tx_queued(bts, msg);
+	}
+}
+
+/* Send all queued messages whose MO has no response outstanding, as far as the window allows. Messages for the C0
+ * and the BTS as a whole go first, so that the cell gets on air before the other TRX are configured. */
+static void abis_nm_queue_fill_window(struct gsm_bts *bts)
+{
+	int pass;
+
+	if (!bts_bringup_admitted(bts))
+		return;
+
+	for (pass = 0; pass < 2; pass++)
+		abis_nm_queue_fill_window_pass(bts, pass == 0);
+}
+
+/* Whether the BTS answers for inst to a message sent to req, which may address a wildcard (0xff) instance */
+static bool abis_nm_inst_answers(const struct abis_om_obj_inst *req, const struct abis_om_obj_inst *inst)
+{
+	return (req->bts_nr == 0xff || req->bts_nr == inst->bts_nr)
+		&& (req->trx_nr == 0xff || req->trx_nr == inst->trx_nr)
+		&& (req->ts_nr == 0xff || req->ts_nr == inst->ts_nr);
+}
+
+/* Return the index of the message in flight that a response for the MO in foh answers, or -1 if there is none.
+ * A response without FOM header answers the oldest message without one. */
+static int abis_nm_in_flight_find(const struct gsm_bts *bts, const struct abis_om_fom_hdr *foh)
+{
+	int i;
+
+	for (i = 0; i < bts->abis_nm_pend; i++) {
+		if (!foh) {
+			if (!bts->abis_nm_in_flight[i].has_mo)
+				return i;
+		} else if (bts->abis_nm_in_flight[i].has_mo
+			   && bts->abis_nm_in_flight[i].obj_class == foh->obj_class
+			   && abis_nm_inst_answers(&bts->abis_nm_in_flight[i].obj_inst, &foh->obj_inst))
+			return i;
+	}
+	return -1;
+}
+
+/* Return the index of the recent message sent without waiting for its response that foh answers, or -1 if there is
+ * none. TS 12.21 numbers the ACK and NACK of a message right after it. */
+static int abis_nm_direct_find(const struct gsm_bts *bts, const struct abis_om_fom_hdr *foh)
+{
+	int i;
+
+	if (!foh)
+		return -1;
+
+	for (i = 0; i < ARRAY_SIZE(bts->abis_nm_direct); i++) {
+		uint8_t req = bts->abis_nm_direct[i].msg_type;
+		if (req && (foh->msg_type == req + 1 || foh->msg_type == req + 2)
+		    && bts->abis_nm_direct[i].obj_class == foh->obj_class
+		    && abis_nm_inst_answers(&bts->abis_nm_direct[i].obj_inst, &foh->obj_inst))
+			return i;
+	}
+	return -1;
+}
+
+/* The BTS answered for the MO in foh: allow the next message for that MO. */
+static void abis_nm_in_flight_release(struct gsm_bts *bts, const struct abis_om_fom_hdr *foh)
+{
+	int i;
+
+	/* A request of the BTS itself answers nothing */
+	if (foh && foh->msg_type == NM_MT_SW_ACT_REQ)
+		return;
+
+	i = abis_nm_in_flight_find(bts, foh);
+	if (i < 0) {
+		/* It answers a message that did not wait for it, and holds back nothing */
+		i = abis_nm_direct_find(bts, foh);
+		if (i >= 0) {
+			bts->abis_nm_direct[i].msg_type = 0;
+			return;
+		}
+		/* Releasing any other message would send the next one for its MO before the BTS is done */
+		if (foh)
+			LOGPFOH(DNM, LOGL_ERROR, foh, "%s matches no OML message in flight, ignoring\n",
+				get_value_string(abis_nm_msgtype_names, foh->msg_type));
+		else
+			LOG_BTS(bts, DNM, LOGL_ERROR, "OML response matches no message in flight, ignoring\n");
+		return;
+	}
+
+	memmove(&bts->abis_nm_in_flight[i], &bts->abis_nm_in_flight[i + 1],
+		(bts->abis_nm_pend - i - 1) * sizeof(bts->abis_nm_in_flight[0]));
+	bts->abis_nm_pend--;
+}
+
+/* For BTS models with several messages in flight, a response has to answer one of them, or a message sent without
+ * waiting for its response. Process no other, e.g. a late response from before the OML link was re-established. */
+static bool abis_nm_response_expected(const struct gsm_bts *bts, const struct abis_om_fom_hdr *foh)
+{
+	if (!abis_nm_pipelined(bts) || abis_nm_in_flight_find(bts, foh) >= 0 || abis_nm_direct_find(bts, foh) >= 0)
+		return true;
+
+	if (foh)
+		LOGPFOH(DNM, LOGL_ERROR, foh, "%s matches no OML message in flight, dropping\n",
+			get_value_string(abis_nm_msgtype_names, foh->msg_type));
+	else
+		LOG_BTS(bts, DNM, LOGL_ERROR, "OML response matches no message in flight, dropping\n");
+	return false;
+}
+
 /* Send a OML NM Message from BSC to BTS */
 static int abis_nm_queue_msg(struct gsm_bts *bts, struct msgb *msg)
 {
 	msg->dst = bts->oml_link;
 
+	if (abis_nm_pipelined(bts)) {
+		msgb_enqueue(&bts->abis_queue, msg);
+		abis_nm_queue_fill_window(bts);
+		return 0;
+	}
+
 	/* queue OML messages */
-	if (llist_empty(&bts->abis_queue) && !bts->abis_nm_pend) {
+	if (llist_empty(&bts->abis_queue) && !bts->abis_nm_pend && bts_bringup_admitted(bts)) {
 		bts->abis_nm_pend = OBSC_NM_W_ACK_CB(msg);
+		if (bts->oml_bringup.running)
+			bts->oml_bringup.msgs++;
 		return _abis_nm_sendmsg(msg);
 	} else {
 		msgb_enqueue(&bts->abis_queue, msg);
@@ -861,15 +1106,27 @@ char *get_model_oml_status(const struct gsm_bts *bts)
 	return "unknown";
 }
 
-void abis_nm_queue_send_next(struct gsm_bts *bts)
+/* A response arrived for the MO in foh, if known: send what may follow it. */
+static void abis_nm_queue_send_next_foh(struct gsm_bts *bts, const struct abis_om_fom_hdr *foh)
 {
 	int wait = 0;
 	struct msgb *msg;
+
+	if (abis_nm_pipelined(bts)) {
+		abis_nm_in_flight_release(bts, foh);
+		abis_nm_queue_fill_window(bts);
+		return;
+	}
+
+	/* wait for the bring-up scheduler, see abis_nm_queue_resume() */
+	if (!bts_bringup_admitted(bts))
+		return;
+
 	/* the queue is empty */
 	while (!llist_empty(&bts->abis_queue)) {
 		msg = msgb_dequeue(&bts->abis_queue);
 		wait = OBSC_NM_W_ACK_CB(msg);
-		_abis_nm_sendmsg(msg);
+		abis_nm_tx_queued(bts, msg);
 
 		if (wait)
 			break;
@@ -878,6 +1135,80 @@ void abis_nm_queue_send_next(struct gsm_bts *bts)
 	bts->abis_nm_pend = wait;
 }
 
+void abis_nm_queue_send_next(struct gsm_bts *bts)
+{
+	abis_nm_queue_send_next_foh(bts, NULL);
+}
+
+/*! Send the OML messages queued while bts waited for its turn to be configured. */
+void abis_nm_queue_resume(struct gsm_bts *bts)
+{
+	if (abis_nm_pipelined(bts))
+		abis_nm_queue_fill_window(bts);
+	else if (!bts->abis_nm_pend)
+		abis_nm_queue_send_next(bts);
+}
+
+/*! The OML link of bts came up: start timing its bring-up. */
+void abis_nm_bringup_start(struct gsm_bts *bts)
+{
+	bts->oml_bringup.running = true;
+	bts->oml_bringup.msgs = 0;
+	bts->oml_bringup.max_in_flight = 0;
+	osmo_clock_gettime(CLOCK_MONOTONIC, &bts->oml_bringup.start);
+}
+
+/* A TRX locked by the configuration or by the operator, or not installed, does not come up */
+static bool abis_nm_bringup_skipped(const struct gsm_nm_state *s)
+{
+	return s->administrative == NM_STATE_LOCKED || s->availability == NM_AVSTATE_NOT_INSTALLED;
+}
+
+/*! The bring-up of bts is complete: stop timing it and let the next BTS proceed. */
+void abis_nm_bringup_done(struct gsm_bts *bts)
+{
+	struct timespec now;
+
+	if (!bts->oml_bringup.running)
+		return;
+
+	osmo_clock_gettime(CLOCK_MONOTONIC, &now);
+	bts->oml_bringup.running = false;
+	bts->oml_bringup.duration_ms = (now.tv_sec - bts->oml_bringup.start.tv_sec) * 1000LL
+		+ (now.tv_nsec - bts->oml_bringup.start.tv_nsec) / 1000000;
+	osmo_stat_item_set(bts->bts_statg->items[BTS_STAT_OML_BRINGUP_TIME], bts->oml_bringup.duration_ms);
+	osmo_stat_item_set(bts->bts_statg->items[BTS_STAT_OML_BRINGUP_MSGS], bts->oml_bringup.msgs);
+	LOG_BTS(bts, DNM, LOGL_NOTICE, "Bring-up took %llu ms, %u OML messages, up to %u in flight\n",
+		bts->oml_bringup.duration_ms, bts->oml_bringup.msgs, bts->oml_bringup.max_in_flight);
+	bts_bringup_done(bts);
+}
+
+/*! Stop timing the bring-up of bts once all its TRX and timeslots in use are running. */
+void abis_nm_bringup_check(struct gsm_bts *bts)
+{
+	struct gsm_bts_trx *trx;
+	int i;
+
+	if (!bts->oml_bringup.running)
+		return;
+
+	llist_for_each_entry(trx, &bts->trx_list, list) {
+		if (abis_nm_bringup_skipped(&trx->mo.nm_state))
+			continue;
+		if (!trx->rsl_link || !trx_is_usable(trx))
+			return;
+		for (i = 0; i < ARRAY_SIZE(trx->ts); i++) {
+			if (trx->ts[i].pchan_from_config == GSM_PCHAN_NONE
+			    || trx->ts[i].mo.nm_state.availability == NM_AVSTATE_NOT_INSTALLED)
+				continue;
+			if (!nm_is_running(&trx->ts[i].mo.nm_state))
+				return;
+		}
+	}
+
+	abis_nm_bringup_done(bts);
+}
+
 /* Receive a OML NM Message from BTS */
 static int abis_nm_rcvmsg_fom(struct msgb *mb)
 {
@@ -890,12 +1221,18 @@ static int abis_nm_rcvmsg_fom(struct msgb *mb)
 	int ret = 0;
 
 	/* check for unsolicited message */
-	if (is_report(mt))
-		return abis_nm_rcvmsg_report(mb, bts);
+	if (is_report(mt)) {
+		ret = abis_nm_rcvmsg_report(mb, bts);
+		abis_nm_bringup_check(bts);
+		return ret;
+	}
 
 	if (is_in_arr(mt, abis_nm_sw_load_msgs, ARRAY_SIZE(abis_nm_sw_load_msgs)))
 		return abis_nm_rcvmsg_sw(mb);
 
+	if (mt != NM_MT_SW_ACT_REQ && !abis_nm_response_expected(bts, foh))
+		return 0;
+
 	if (is_in_arr(mt, abis_nm_nacks, ARRAY_SIZE(abis_nm_nacks))) {
 		struct nm_nack_signal_data nack_data;
 		struct tlv_parsed tp;
@@ -913,7 +1250,7 @@ static int abis_nm_rcvmsg_fom(struct msgb *mb)
 		nack_data.mt = mt;
 		nack_data.bts = bts;
 		osmo_signal_dispatch(SS_NM, S_NM_NACK, &nack_data);
-		abis_nm_queue_send_next(bts);
+		abis_nm_queue_send_next_foh(bts, foh);
 		return 0;
 	}
 #if 0
@@ -974,7 +1311,8 @@ static int abis_nm_rcvmsg_fom(struct msgb *mb)
 			get_value_string(abis_nm_msgtype_names, mt));
 	}
 
-	abis_nm_queue_send_next(bts);
+	abis_nm_queue_send_next_foh(bts, foh);
+	abis_nm_bringup_check(bts);
 	return ret;
 }
 
@@ -982,6 +1320,7 @@ static int abis_nm_rx_ipacc(struct msgb *mb);
 
 static int abis_nm_rcvmsg_manuf(struct msgb *mb)
 {
+	const struct abis_om_fom_hdr *foh;
 	int rc;
 	struct e1inp_sign_link *sign_link = mb->dst;
 	int bts_type = sign_link->trx->bts->type;
@@ -989,8 +1328,11 @@ static int abis_nm_rcvmsg_manuf(struct msgb *mb)
 	switch (bts_type) {
 	case GSM_BTS_TYPE_NANOBTS:
 	case GSM_BTS_TYPE_OSMOBTS:
+		foh = abis_nm_oh_foh(msgb_l2(mb), msgb_l2len(mb));
+		if (!abis_nm_response_expected(sign_link->trx->bts, foh))
+			return 0;
 		rc = abis_nm_rx_ipacc(mb);
-		abis_nm_queue_send_next(sign_link->trx->bts);
+		abis_nm_queue_send_next_foh(sign_link->trx->bts, foh);
 		break;
 	default:
 		LOGP(DNM, LOGL_ERROR, "don't know how to parse OML for this "
@@ -1099,6 +1441,8 @@ enum sw_state {
 	SW_STATE_ERROR,
 };
 
+static LLIST_HEAD(sw_images);
+
 struct abis_nm_sw {
 	struct gsm_bts *bts;
 	int trx_nr;
@@ -1119,13 +1463,155 @@ struct abis_nm_sw {
 	uint8_t window_size;
 	uint8_t seg_in_window;
 
-	int fd;
-	FILE *stream;
+	struct abis_nm_sw_image *image;
+	/* offset in image->data of the next segment to send, and the size of the image */
+	size_t offset;
+	size_t len;
 	enum sw_state state;
 	int last_seg;
+
+	struct {
+		unsigned int segments_sent;
+		unsigned int windows_acked;
+		struct timespec start;
+		struct timespec end;
+	} stats;
 };
 
-static struct abis_nm_sw g_sw;
+/* Read all of fd into buf; the file may have been truncated since its fstat() */
+static int sw_image_read(int fd, uint8_t *buf, size_t len)
+{
+	size_t done = 0;
+
+	while (done < len) {
+		ssize_t rc = read(fd, buf + done, len - done);
+		if (rc < 0 && errno == EINTR)
+			continue;
+		if (rc < 0)
+			return -errno;
+		if (rc == 0)
+			return -EIO;
+		done += rc;
+	}
+	return 0;
+}
+
+/* Return the cached image of the file described by st, if its dev, inode, size and ctime match. Any write to the
+ * file, and also a touch or a copy that preserves the mtime, changes its ctime. */
+static struct abis_nm_sw_image *sw_image_find(const struct stat *st)
+{
+	struct abis_nm_sw_image *img;
+
+	llist_for_each_entry(img, &sw_images, entry) {
+		if (img->dev == st->st_dev && img->ino == st->st_ino && img->len == st->st_size
+		    && img->ctime.tv_sec == st->st_ctim.tv_sec && img->ctime.tv_nsec == st->st_ctim.tv_nsec)
+			return img;
+	}
+	return NULL;
+}
+
+/*! Return the software image file fname, read into memory once and shared by all Software Load sessions sending
+ * it. The file is not accessed anymore after this, so it may be replaced or truncated during a Software Load.
+ * \returns the image, to be released by abis_nm_sw_image_put(), or NULL on error. */
+struct abis_nm_sw_image *abis_nm_sw_image_get(const char *fname)
+{
+	struct abis_nm_sw_image *img;
+	struct abis_nm_sw_image *cached;
+	struct stat st;
+	uint8_t *data;
+	int fd;
+	int rc;
+
+	fd = open(fname, O_RDONLY);
+	if (fd < 0) {
+		LOGP(DNM, LOGL_ERROR, "Cannot open software file %s: %s\n", fname, strerror(errno));
+		return NULL;
+	}
+
+	if (fstat(fd, &st) < 0 || st.st_size <= 0) {
+		LOGP(DNM, LOGL_ERROR, "Cannot use software file %s: empty or not accessible\n", fname);
+		close(fd);
+		return NULL;
+	}
+
+	/* The file system may only store whole seconds of the ctime. If the file was changed in the same second
+	 * that the cached image was read in, it may have been changed again since without a new ctime. Only trust
+	 * the cached image for a ctime from before that second, otherwise read the file and compare. */
+	cached = sw_image_find(&st);
+	if (cached && st.st_ctim.tv_sec < cached->read_time) {
+		close(fd);
+		cached->use_count++;
+		return cached;
+	}
+
+	img = talloc_zero(tall_bsc_ctx, struct abis_nm_sw_image);
+	OSMO_ASSERT(img);
+	data = talloc_size(img, st.st_size);
+	OSMO_ASSERT(data);
+	rc = sw_image_read(fd, data, st.st_size);
+	close(fd);
+	if (rc < 0) {
+		LOGP(DNM, LOGL_ERROR, "Cannot read software file %s: %s\n", fname,
+		     rc == -EIO ? "file shorter than expected" : strerror(-rc));
+		talloc_free(img);
+		return NULL;
+	}
+
+	if (cached) {
+		if (!memcmp(cached->data, data, st.st_size)) {
+			talloc_free(img);
+			cached->use_count++;
+			return cached;
+		}
+		/* Changed within the same ctime: never hand out the stale image again */
+		llist_del_init(&cached->entry);
+	}
+
+	img->dev = st.st_dev;
+	img->ino = st.st_ino;
+	img->ctime = st.st_ctim;
+	img->read_time = time(NULL);
+	img->data = data;
+	img->len = st.st_size;
+	img->use_count = 1;
+	llist_add_tail(&img->entry, &sw_images);
+	return img;
+}
+
+void abis_nm_sw_image_put(struct abis_nm_sw_image *img)
+{
+	OSMO_ASSERT(img->use_count > 0);
+	if (--img->use_count)
+		return;
+	llist_del(&img->entry);
+	talloc_free(img);
+}
+
+static void sw_close_file(struct abis_nm_sw *sw);
+
+static int sw_session_destructor(struct abis_nm_sw *sw)
+{
+	sw_close_file(sw);
+	sw->bts->sw_load = NULL;
+	return 0;
+}
+
+/* Return the Software Load session of a BTS, allocating it on first use */
+static struct abis_nm_sw *sw_session(struct gsm_bts *bts)
+{
+	struct abis_nm_sw *sw = bts->sw_load;
+
+	if (sw)
+		return sw;
+
+	sw = talloc_zero(bts, struct abis_nm_sw);
+	OSMO_ASSERT(sw);
+	sw->bts = bts;
+	sw->state = SW_STATE_NONE;
+	talloc_set_destructor(sw, sw_session_destructor);
+	bts->sw_load = sw;
+	return sw;
+}
 
 static void sw_add_file_id_and_ver(struct abis_nm_sw *sw, struct msgb *msg)
 {
@@ -1161,87 +1647,83 @@ static int sw_load_init(struct abis_nm_sw *sw)
 	return abis_nm_sendmsg(sw->bts, msg);
 }
 
-static int is_last_line(FILE *stream)
+/* Length of the text line starting at 'offset' in the image, including its newline, at most 'max_len' */
+static size_t sw_line_len(const struct abis_nm_sw *sw, size_t offset, size_t max_len)
 {
-	char next_seg_buf[256];
-	long pos;
+	const uint8_t *nl;
+	size_t remain = sw->image->len - offset;
 
-	/* check if we're sending the last line */
-	pos = ftell(stream);
-
-	/* Did ftell fail? Then we are at the end for sure */
-	if (pos < 0)
-		return 1;
-
-	if (!fgets(next_seg_buf, sizeof(next_seg_buf)-2, stream)) {
-		int rc = fseek(stream, pos, SEEK_SET);
-		if (rc < 0)
-			return rc;
-		return 1;
-	}
-
-	fseek(stream, pos, SEEK_SET);
-	return 0;
+	if (remain > max_len)
+		remain = max_len;
+	nl = memchr(sw->image->data + offset, '\n', remain);
+	return nl ? nl - (sw->image->data + offset) + 1 : remain;
 }
 
 /* 6.2.2 / 8.3.2 Load Data Segment */
 static int sw_load_segment(struct abis_nm_sw *sw)
 {
 	struct abis_om_hdr *oh;
-	struct msgb *msg = nm_msgb_alloc();
+	struct msgb *msg;
 	char seg_buf[256];
 	char *line_buf = seg_buf+2;
 	unsigned char *tlv;
+	size_t seg_len;
 	int len;
 
-	oh = (struct abis_om_hdr *) msgb_put(msg, ABIS_OM_FOM_HDR_SIZE);
-
 	switch (sw->bts->type) {
 	case GSM_BTS_TYPE_BS11:
-		if (fgets(line_buf, sizeof(seg_buf)-2, sw->stream) == NULL) {
-			perror("fgets reading segment");
+		if (sw->offset >= sw->image->len) {
+			LOGP(DNM, LOGL_ERROR, "BTS %u: reading segment beyond the end of the software file\n",
+			     sw->bts->nr);
 			return -EINVAL;
 		}
+		msg = nm_msgb_alloc();
+		oh = (struct abis_om_hdr *) msgb_put(msg, ABIS_OM_FOM_HDR_SIZE);
+
+		seg_len = sw_line_len(sw, sw->offset, sizeof(seg_buf) - 3);
+		memcpy(line_buf, sw->image->data + sw->offset, seg_len);
+		line_buf[seg_len] = '\0';
+		sw->offset += seg_len;
 		seg_buf[0] = 0x00;
 
 		/* check if we're sending the last line */
-		sw->last_seg = is_last_line(sw->stream);
+		sw->last_seg = (sw->offset >= sw->image->len);
 		if (sw->last_seg)
 			seg_buf[1] = 0;
 		else
 			seg_buf[1] = 1 + sw->seg_in_window++;
 
-		len = strlen(line_buf) + 2;
+		len = seg_len + 2;
 		tlv = msgb_put(msg, TLV_GROSS_LEN(len));
 		tlv_put(tlv, NM_ATT_BS11_FILE_DATA, len, (uint8_t *)seg_buf);
 		/* BS11 wants CR + LF in excess of the TLV length !?! */
 		tlv[1] -= 2;
-
-		/* we only now know the exact length for the OM hdr */
-		len = strlen(line_buf)+2;
 		break;
-	case GSM_BTS_TYPE_NANOBTS: {
-		osmo_static_assert(sizeof(seg_buf) >= IPACC_SEGMENT_SIZE, buffer_big_enough);
-		len = read(sw->fd, &seg_buf, IPACC_SEGMENT_SIZE);
-		if (len < 0) {
-			perror("read failed");
-			return -EINVAL;
-		}
-
-		if (len != IPACC_SEGMENT_SIZE)
+	case GSM_BTS_TYPE_NANOBTS:
+		msg = nm_msgb_alloc();
+		oh = (struct abis_om_hdr *) msgb_put(msg, ABIS_OM_FOM_HDR_SIZE);
+
+		/* Segments go out straight from the shared mapping. A short (possibly empty) segment marks the
+		 * end of the file, like a short read() would. */
+		seg_len = sw->image->len - sw->offset;
+		if (seg_len > IPACC_SEGMENT_SIZE)
+			seg_len = IPACC_SEGMENT_SIZE;
+		if (seg_len != IPACC_SEGMENT_SIZE)
 			sw->last_seg = 1;
 
 		++sw->seg_in_window;
-		msgb_tl16v_put(msg, NM_ATT_IPACC_FILE_DATA, len, (const uint8_t *) seg_buf);
-		len += 3;
+		msgb_tl16v_put(msg, NM_ATT_IPACC_FILE_DATA, seg_len, sw->image->data + sw->offset);
+		sw->offset += seg_len;
+		len = seg_len + 3;
 		break;
-	}
 	default:
 		LOGP(DNM, LOGL_ERROR, "sw_load_segment needs implementation for the BTS.\n");
 		/* FIXME: Other BTS types */
 		return -1;
 	}
 
+	sw->stats.segments_sent++;
+
 	fill_om_fom_hdr(oh, len, NM_MT_LOAD_SEG, sw->obj_class,
 			sw->obj_instance[0], sw->obj_instance[1],
 			sw->obj_instance[2]);
@@ -1295,14 +1777,12 @@ struct sdp_firmware {
 static int parse_sdp_header(struct abis_nm_sw *sw)
 {
 	struct sdp_firmware firmware_header;
-	int rc;
-	struct stat stat;
 
-	rc = read(sw->fd, &firmware_header, sizeof(firmware_header));
-	if (rc != sizeof(firmware_header)) {
+	if (sw->image->len < sizeof(firmware_header)) {
 		LOGP(DNM, LOGL_ERROR, "Could not read SDP file header.\n");
 		return -1;
 	}
+	memcpy(&firmware_header, sw->image->data, sizeof(firmware_header));
 
 	if (strncmp(firmware_header.magic, " SDP", 4) != 0) {
 		LOGP(DNM, LOGL_ERROR, "The magic number1 is wrong.\n");
@@ -1317,19 +1797,11 @@ static int parse_sdp_header(struct abis_nm_sw *sw)
 		return -1;
 	}
 
-
-	if (fstat(sw->fd, &stat) == -1) {
-		LOGP(DNM, LOGL_ERROR, "Could not stat the file.\n");
-		return -1;
-	}
-
-	if (ntohl(firmware_header.file_length) != stat.st_size) {
+	if (ntohl(firmware_header.file_length) != sw->image->len) {
 		LOGP(DNM, LOGL_ERROR, "The filesizes do not match.\n");
 		return -1;
 	}
 
-	/* go back to the start as we checked the whole filesize.. */
-	lseek(sw->fd, 0l, SEEK_SET);
 	LOGP(DNM, LOGL_NOTICE, "The ipaccess SDP header is not fully understood."
 			       " There might be checksums in the file that are not"
 			       " verified and incomplete firmware might be flashed."
@@ -1340,40 +1812,43 @@ static int parse_sdp_header(struct abis_nm_sw *sw)
 
 static int sw_open_file(struct abis_nm_sw *sw, const char *fname)
 {
+	char header_line[256];
 	char file_id[12+1];
 	char file_version[80+1];
+	size_t line_len;
 	int rc;
 
-	sw->fd = open(fname, O_RDONLY);
-	if (sw->fd < 0)
-		return sw->fd;
+	sw->image = abis_nm_sw_image_get(fname);
+	if (!sw->image)
+		return -EIO;
+	sw->offset = 0;
+	sw->len = sw->image->len;
+	sw->last_seg = 0;
 
 	switch (sw->bts->type) {
 	case GSM_BTS_TYPE_BS11:
-		sw->stream = fdopen(sw->fd, "r");
-		if (!sw->stream) {
-			perror("fdopen");
-			return -1;
-		}
 		/* read first line and parse file ID and VERSION */
-		rc = fscanf(sw->stream, "@(#)%12s:%80s\r\n",
+		line_len = sw_line_len(sw, 0, sizeof(header_line) - 1);
+		memcpy(header_line, sw->image->data, line_len);
+		header_line[line_len] = '\0';
+		rc = sscanf(header_line, "@(#)%12s:%80s\r\n",
 			    file_id, file_version);
 		if (rc != 2) {
-			perror("parsing header line of software file");
+			LOGP(DNM, LOGL_ERROR, "Error parsing header line of software file %s\n", fname);
+			sw_close_file(sw);
 			return -1;
 		}
 		strcpy((char *)sw->file_id, file_id);
 		sw->file_id_len = strlen(file_id);
 		strcpy((char *)sw->file_version, file_version);
 		sw->file_version_len = strlen(file_version);
-		/* rewind to start of file */
-		rewind(sw->stream);
 		break;
 	case GSM_BTS_TYPE_NANOBTS:
 		/* TODO: extract that from the filename or content */
 		rc = parse_sdp_header(sw);
 		if (rc < 0) {
 			fprintf(stderr, "Could not parse the ipaccess SDP header\n");
+			sw_close_file(sw);
 			return -1;
 		}
 
@@ -1384,7 +1859,7 @@ static int sw_open_file(struct abis_nm_sw *sw, const char *fname)
 		break;
 	default:
 		/* We don't know how to treat them yet */
-		close(sw->fd);
+		sw_close_file(sw);
 		return -EINVAL;
 	}
 
@@ -1393,14 +1868,10 @@ static int sw_open_file(struct abis_nm_sw *sw, const char *fname)
 
 static void sw_close_file(struct abis_nm_sw *sw)
 {
-	switch (sw->bts->type) {
-	case GSM_BTS_TYPE_BS11:
-		fclose(sw->stream);
-		break;
-	default:
-		close(sw->fd);
-		break;
-	}
+	if (!sw->image)
+		return;
+	abis_nm_sw_image_put(sw->image);
+	sw->image = NULL;
 }
 
 /* Fill the window */
@@ -1424,7 +1895,7 @@ static int abis_nm_rcvmsg_sw(struct msgb *mb)
 	struct abis_om_fom_hdr *foh = msgb_l3(mb);
 	struct e1inp_sign_link *sign_link = mb->dst;
 	int rc = -1;
-	struct abis_nm_sw *sw = &g_sw;
+	struct abis_nm_sw *sw = sw_session(sign_link->trx->bts);
 	enum sw_state old_state = sw->state;
 
 	//DEBUGP(DNM, "state %u, NM MT 0x%02x\n", sw->state, foh->msg_type);
@@ -1440,7 +1911,7 @@ static int abis_nm_rcvmsg_sw(struct msgb *mb)
 					 sw->cb_data, NULL);
 			rc = sw_fill_window(sw);
 			sw->state = SW_STATE_WAIT_SEGACK;
-			abis_nm_queue_send_next(sign_link->trx->bts);
+			abis_nm_queue_send_next_foh(sign_link->trx->bts, foh);
 			break;
 		case NM_MT_LOAD_INIT_NACK:
 			if (sw->forced) {
@@ -1460,13 +1931,14 @@ static int abis_nm_rcvmsg_sw(struct msgb *mb)
 						 sw->cb_data, NULL);
 				sw->state = SW_STATE_ERROR;
 			}
-			abis_nm_queue_send_next(sign_link->trx->bts);
+			abis_nm_queue_send_next_foh(sign_link->trx->bts, foh);
 			break;
 		}
 		break;
 	case SW_STATE_WAIT_SEGACK:
 		switch (foh->msg_type) {
 		case NM_MT_LOAD_SEG_ACK:
+			sw->stats.windows_acked++;
 			if (sw->cbfn)
 				sw->cbfn(GSM_HOOK_NM_SWLOAD,
 					 NM_MT_LOAD_SEG_ACK, mb,
@@ -1481,7 +1953,7 @@ static int abis_nm_rcvmsg_sw(struct msgb *mb)
 				sw->state = SW_STATE_WAIT_ENDACK;
 				rc = sw_load_end(sw);
 			}
-			abis_nm_queue_send_next(sign_link->trx->bts);
+			abis_nm_queue_send_next_foh(sign_link->trx->bts, foh);
 			break;
 		case NM_MT_LOAD_ABORT:
 			if (sw->cbfn)
@@ -1495,6 +1967,7 @@ static int abis_nm_rcvmsg_sw(struct msgb *mb)
 		switch (foh->msg_type) {
 		case NM_MT_LOAD_END_ACK:
 			sw_close_file(sw);
+			osmo_clock_gettime(CLOCK_MONOTONIC, &sw->stats.end);
 			DEBUGPFOH(DNM, foh, "Software Load End (BTS %u)\n", sw->bts->nr);
 			sw->state = SW_STATE_NONE;
 			if (sw->cbfn)
@@ -1502,9 +1975,10 @@ static int abis_nm_rcvmsg_sw(struct msgb *mb)
 					 NM_MT_LOAD_END_ACK, mb,
 					 sw->cb_data, NULL);
 			rc = 0;
-			abis_nm_queue_send_next(sign_link->trx->bts);
+			abis_nm_queue_send_next_foh(sign_link->trx->bts, foh);
 			break;
 		case NM_MT_LOAD_END_NACK:
+			osmo_clock_gettime(CLOCK_MONOTONIC, &sw->stats.end);
 			if (sw->forced) {
 				DEBUGPFOH(DNM, foh, "FORCED: Ignoring Software Load End NACK\n");
 				sw->state = SW_STATE_NONE;
@@ -1521,7 +1995,7 @@ static int abis_nm_rcvmsg_sw(struct msgb *mb)
 						 NM_MT_LOAD_END_NACK, mb,
 						 sw->cb_data, NULL);
 			}
-			abis_nm_queue_send_next(sign_link->trx->bts);
+			abis_nm_queue_send_next_foh(sign_link->trx->bts, foh);
 			break;
 		}
 		break;
@@ -1536,7 +2010,7 @@ static int abis_nm_rcvmsg_sw(struct msgb *mb)
 				sw->cbfn(GSM_HOOK_NM_SWLOAD,
 					 NM_MT_ACTIVATE_SW_ACK, mb,
 					 sw->cb_data, NULL);
-			abis_nm_queue_send_next(sign_link->trx->bts);
+			abis_nm_queue_send_next_foh(sign_link->trx->bts, foh);
 			break;
 		case NM_MT_ACTIVATE_SW_NACK:
 			LOGPFOH(DNM, LOGL_ERROR, foh, "Activate Software NACK\n");
@@ -1546,7 +2020,7 @@ static int abis_nm_rcvmsg_sw(struct msgb *mb)
 				sw->cbfn(GSM_HOOK_NM_SWLOAD,
 					 NM_MT_ACTIVATE_SW_NACK, mb,
 					 sw->cb_data, NULL);
-			abis_nm_queue_send_next(sign_link->trx->bts);
+			abis_nm_queue_send_next_foh(sign_link->trx->bts, foh);
 			break;
 		}
 		break;
@@ -1565,23 +2039,30 @@ static int abis_nm_rcvmsg_sw(struct msgb *mb)
 		LOGPFOH(DNM, LOGL_ERROR, foh, "unexpected NM MT 0x%02x in state %u -> %u\n",
 			foh->msg_type, old_state, sw->state);
 
+	/* Once the session is done, no longer hold on to the shared image */
+	if (sw->state == SW_STATE_NONE || sw->state == SW_STATE_ERROR)
+		sw_close_file(sw);
+
 	return rc;
 }
 
-/* Load the specified software into the BTS */
+/* Load the specified software into the BTS. Each BTS has its own session, so that several BTS may be
+ * loaded at the same time; sessions sending the same file share one read-only mapping of it. */
 int abis_nm_software_load(struct gsm_bts *bts, int trx_nr, const char *fname,
 			  uint8_t win_size, int forced,
 			  gsm_cbfn *cbfn, void *cb_data)
 {
-	struct abis_nm_sw *sw = &g_sw;
+	struct abis_nm_sw *sw = sw_session(bts);
 	int rc;
 
-	DEBUGP(DNM, "Software Load (BTS %u, File \"%s\")\n", bts->nr, fname);
+	DEBUGP(DNM, "Software Load (BTS %u, File \"%s\", window size %u)\n", bts->nr, fname, win_size);
 
-	if (sw->state != SW_STATE_NONE)
+	if (sw->state != SW_STATE_NONE && sw->state != SW_STATE_ERROR)
 		return -EBUSY;
 
-	sw->bts = bts;
+	if (!win_size)
+		return -EINVAL;
+
 	sw->trx_nr = trx_nr;
 
 	switch (bts->type) {
@@ -1604,10 +2085,12 @@ int abis_nm_software_load(struct gsm_bts *bts, int trx_nr, const char *fname,
 		break;
 	}
 	sw->window_size = win_size;
+	sw->seg_in_window = 0;
 	sw->state = SW_STATE_WAIT_INITACK;
 	sw->cbfn = cbfn;
 	sw->cb_data = cb_data;
 	sw->forced = forced;
+	memset(&sw->stats, 0, sizeof(sw->stats));
 
 	rc = sw_open_file(sw, fname);
 	if (rc < 0) {
@@ -1615,41 +2098,60 @@ int abis_nm_software_load(struct gsm_bts *bts, int trx_nr, const char *fname,
 		return rc;
 	}
 
+	osmo_clock_gettime(CLOCK_MONOTONIC, &sw->stats.start);
 	return sw_load_init(sw);
 }
 
 int abis_nm_software_load_status(struct gsm_bts *bts)
 {
-	struct abis_nm_sw *sw = &g_sw;
-	struct stat st;
-	int rc, percent;
+	struct abis_nm_sw *sw = bts->sw_load;
 
-	rc = fstat(sw->fd, &st);
-	if (rc < 0) {
-		perror("ERROR during stat");
-		return rc;
-	}
+	if (!sw || !sw->len)
+		return -EINVAL;
+
+	return (sw->offset * 100) / sw->len;
+}
+
+int abis_nm_software_load_progress(struct gsm_bts *bts, struct abis_nm_sw_load_progress *progress)
+{
+	struct abis_nm_sw *sw = bts->sw_load;
+	struct timespec now;
+
+	if (!sw || !sw->len)
+		return -EINVAL;
 
-	if (sw->stream)
-		percent = (ftell(sw->stream) * 100) / st.st_size;
+	if (sw->state == SW_STATE_WAIT_INITACK || sw->state == SW_STATE_WAIT_SEGACK
+	    || sw->state == SW_STATE_WAIT_ENDACK)
+		osmo_clock_gettime(CLOCK_MONOTONIC, &now);
 	else
-		percent = (lseek(sw->fd, 0, SEEK_CUR) * 100) / st.st_size;
-	return percent;
+		now = sw->stats.end;
+
+	*progress = (struct abis_nm_sw_load_progress){
+		.bytes_sent = sw->offset,
+		.bytes_total = sw->len,
+		.segments_sent = sw->stats.segments_sent,
+		.windows_acked = sw->stats.windows_acked,
+		.window_size = sw->window_size,
+		.duration_ms = (now.tv_sec - sw->stats.start.tv_sec) * 1000
+			       + (now.tv_nsec - sw->stats.start.tv_nsec) / 1000000,
+	};
+	if (progress->duration_ms)
+		progress->bytes_per_sec = (unsigned long long)progress->bytes_sent * 1000 / progress->duration_ms;
+	return 0;
 }
 
 /* Activate the specified software into the BTS */
 int abis_nm_software_activate(struct gsm_bts *bts, const char *fname,
 			      gsm_cbfn *cbfn, void *cb_data)
 {
-	struct abis_nm_sw *sw = &g_sw;
+	struct abis_nm_sw *sw = sw_session(bts);
 	int rc;
 
 	DEBUGP(DNM, "Activating Software (BTS %u, File \"%s\")\n", bts->nr, fname);
 
-	if (sw->state != SW_STATE_NONE)
+	if (sw->state != SW_STATE_NONE && sw->state != SW_STATE_ERROR)
 		return -EBUSY;
 
-	sw->bts = bts;
 	sw->obj_class = NM_OC_SITE_MANAGER;
 	sw->obj_instance[0] = 0xff;
 	sw->obj_instance[1] = 0xff;
@@ -3140,4 +3642,6 @@ void abis_nm_clear_queue(struct gsm_bts *bts)
 	}
 
 	bts->abis_nm_pend = 0;
+	memset(bts->abis_nm_direct, 0, sizeof(bts->abis_nm_direct));
+	bts->oml_bringup.running = false;
 }
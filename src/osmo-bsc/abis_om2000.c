@@ -2444,6 +2444,10 @@ static void om2k_bts_s_wait_trx(struct osmo_fsm_inst *fi, uint32_t event, void *
 
 static void om2k_bts_s_done_onenter(struct osmo_fsm_inst *fi, uint32_t prev_state)
 {
+	struct om2k_bts_fsm_priv *obfp = fi->priv;
+
+	/* All MOs are enabled; the 12.21 states that abis_nm_bringup_check() goes by do not apply to OM2000 */
+	abis_nm_bringup_done(obfp->bts);
 	osmo_fsm_inst_term(fi, OSMO_FSM_TERM_REGULAR, NULL);
 }
 
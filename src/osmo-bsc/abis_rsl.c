@@ -47,6 +47,7 @@
 #include <osmocom/bsc/gsm_08_08.h>
 #include <osmocom/netif/rtp.h>
 #include <osmocom/core/tdef.h>
+#include <osmocom/core/timer.h>
 #include <osmocom/bsc/bsc_subscr_conn_fsm.h>
 #include <osmocom/bsc/timeslot_fsm.h>
 #include <osmocom/bsc/lchan_select.h>
@@ -941,6 +942,10 @@ static void print_meas_rep(struct gsm_lchan *lchan, struct gsm_meas_rep *mr)
 	const char *name = "";
 	struct bsc_subscr *bsub = NULL;
 
+	/* Called for every measurement report, skip the below when it would not log anything */
+	if (!LOG_ENABLED(DMEAS, LOGL_DEBUG))
+		return;
+
 	if (lchan && lchan->conn) {
 		bsub = lchan->conn->bsub;
 		if (bsub) {
@@ -992,13 +997,17 @@ static void print_meas_rep(struct gsm_lchan *lchan, struct gsm_meas_rep *mr)
 
 static struct gsm_meas_rep *lchan_next_meas_rep(struct gsm_lchan *lchan)
 {
+	struct gsm_lchan_meas *meas = lchan_meas_get(lchan);
 	struct gsm_meas_rep *meas_rep;
 
-	meas_rep = &lchan->meas_rep[lchan->meas_rep_idx];
+	if (!meas)
+		return NULL;
+
+	meas_rep = &meas->meas_rep[meas->meas_rep_idx];
 	memset(meas_rep, 0, sizeof(*meas_rep));
 	meas_rep->lchan = lchan;
-	lchan->meas_rep_idx = (lchan->meas_rep_idx + 1)
-					% ARRAY_SIZE(lchan->meas_rep);
+	meas->meas_rep_idx = (meas->meas_rep_idx + 1)
+					% ARRAY_SIZE(meas->meas_rep);
 
 	return meas_rep;
 }
@@ -1006,8 +1015,8 @@ static struct gsm_meas_rep *lchan_next_meas_rep(struct gsm_lchan *lchan)
 static int rsl_rx_meas_res(struct msgb *msg)
 {
 	struct abis_rsl_dchan_hdr *dh = msgb_l2(msg);
-	struct tlv_parsed tp;
-	struct gsm_meas_rep *mr = lchan_next_meas_rep(msg->lchan);
+	struct rsl_meas_res_ies ies;
+	struct gsm_meas_rep *mr;
 	uint8_t len;
 	const uint8_t *val;
 	int rc;
@@ -1017,24 +1026,21 @@ static int rsl_rx_meas_res(struct msgb *msg)
 		return 0;
 	}
 
-	memset(mr, 0, sizeof(*mr));
-	mr->lchan = msg->lchan;
-
-	rsl_tlv_parse(&tp, dh->data, msgb_l2len(msg)-sizeof(*dh));
+	mr = lchan_next_meas_rep(msg->lchan);
+	if (!mr)
+		return -ENOMEM;
 
-	if (!TLVP_PRESENT(&tp, RSL_IE_MEAS_RES_NR) ||
-	    !TLVP_PRESENT(&tp, RSL_IE_UPLINK_MEAS) ||
-	    !TLVP_PRESENT(&tp, RSL_IE_BS_POWER)) {
+	if (rsl_meas_res_ies_parse(&ies, dh->data, msgb_l2len(msg)-sizeof(*dh)) < 0) {
 		LOGP(DRSL, LOGL_ERROR, "%s Measurement Report lacks mandatory IEs\n",
 		     gsm_lchan_name(mr->lchan));
 		return -EIO;
 	}
 
 	/* Mandatory Parts */
-	mr->nr = *TLVP_VAL(&tp, RSL_IE_MEAS_RES_NR);
+	mr->nr = *ies.meas_res_nr;
 
-	len = TLVP_LEN(&tp, RSL_IE_UPLINK_MEAS);
-	val = TLVP_VAL(&tp, RSL_IE_UPLINK_MEAS);
+	len = ies.uplink_meas_len;
+	val = ies.uplink_meas;
 	if (len >= 3) {
 		if (val[0] & 0x40)
 			mr->flags |= MEAS_REP_F_DL_DTX;
@@ -1044,19 +1050,19 @@ static int rsl_rx_meas_res(struct msgb *msg)
 		mr->ul.sub.rx_qual = val[2] & 0x7;
 	}
 
-	mr->bs_power = *TLVP_VAL(&tp, RSL_IE_BS_POWER);
+	mr->bs_power = *ies.bs_power;
 
 	/* Optional Parts */
-	if (TLVP_PRESENT(&tp, RSL_IE_MS_TIMING_OFFSET)) {
+	if (ies.ms_timing_offset) {
 		/* According to 3GPP TS 48.058 § MS Timing Offset = Timing Offset field - 63 */
-		mr->ms_timing_offset = *TLVP_VAL(&tp, RSL_IE_MS_TIMING_OFFSET) - 63;
+		mr->ms_timing_offset = *ies.ms_timing_offset - 63;
 		mr->flags |= MEAS_REP_F_MS_TO;
 	}
 
-	if (TLVP_PRESENT(&tp, RSL_IE_L1_INFO)) {
+	if (ies.l1_info) {
 		struct e1inp_sign_link *sign_link = msg->dst;
 
-		val = TLVP_VAL(&tp, RSL_IE_L1_INFO);
+		val = ies.l1_info;
 		mr->flags |= MEAS_REP_F_MS_L1;
 		mr->ms_l1.pwr = ms_pwr_dbm(sign_link->trx->bts->band, val[0] >> 3);
 		if (val[0] & 0x04)
@@ -1069,17 +1075,17 @@ static int rsl_rx_meas_res(struct msgb *msg)
 		/* store TA for next assignment/handover */
 		mr->lchan->rqd_ta = mr->ms_l1.ta;
 	}
-	if (TLVP_PRESENT(&tp, RSL_IE_L3_INFO)) {
-		msg->l3h = (uint8_t *) TLVP_VAL(&tp, RSL_IE_L3_INFO);
+	if (ies.l3_info) {
+		msg->l3h = (uint8_t *) ies.l3_info;
 		rc = gsm48_parse_meas_rep(mr, msg);
 		if (rc < 0)
 			return rc;
 	}
 
-	mr->lchan->meas_rep_count++;
-	mr->lchan->meas_rep_last_seen_nr = mr->nr;
+	mr->lchan->meas->meas_rep_count++;
+	mr->lchan->meas->meas_rep_last_seen_nr = mr->nr;
 	LOGP(DRSL, LOGL_DEBUG, "%s: meas_rep_count++=%d meas_rep_last_seen_nr=%u\n",
-	     gsm_lchan_name(mr->lchan), mr->lchan->meas_rep_count, mr->lchan->meas_rep_last_seen_nr);
+	     gsm_lchan_name(mr->lchan), mr->lchan->meas->meas_rep_count, mr->lchan->meas->meas_rep_last_seen_nr);
 
 	print_meas_rep(msg->lchan, mr);
 
@@ -1273,13 +1279,41 @@ static int abis_rsl_rx_trx(struct msgb *msg)
 	return rc;
 }
 
-/* Format an IMM ASS REJ according to 04.08 Chapter 9.1.20 */
-static int rsl_send_imm_ass_rej(struct gsm_bts *bts,
-				struct gsm48_req_ref *rqd_ref,
-				uint8_t wait_ind)
+/*
+ * AGCH scheduling: Immediate Assignments and Rejects for MS on the RACH are held back for up to X993102, so that two
+ * Immediate Assignments go out as one IMMEDIATE ASSIGNMENT EXTENDED and up to four rejected MS share one IMMEDIATE
+ * ASSIGNMENT REJECT. Under a RACH burst, this saves AGCH capacity, which then tends to run out before the SDCCH.
+ */
+
+/* IMMEDIATE ASSIGNMENT EXTENDED, 3GPP TS 44.018 9.1.19 */
+struct imm_ass_ext {
+	uint8_t l2_plen;
+	uint8_t proto_discr;
+	uint8_t msg_type;
+	uint8_t page_mode;
+	struct gsm48_chan_desc chan_desc1;
+	struct gsm48_req_ref req_ref1;
+	uint8_t timing_advance1;
+	struct gsm48_chan_desc chan_desc2;
+	struct gsm48_req_ref req_ref2;
+	uint8_t timing_advance2;
+	uint8_t mob_alloc_len;
+	uint8_t mob_alloc[0];
+} __attribute__ ((packed));
+
+/* Format an IMM ASS REJ according to 04.08 Chapter 9.1.20 for all pending rejects */
+static int agch_tx_imm_ass_rej(struct gsm_bts *bts)
 {
 	uint8_t buf[GSM_MACBLOCK_LEN];
 	struct gsm48_imm_ass_rej *iar = (struct gsm48_imm_ass_rej *)buf;
+	struct gsm48_req_ref *req_refs[] = { &iar->req_ref1, &iar->req_ref2, &iar->req_ref3, &iar->req_ref4 };
+	uint8_t *wait_inds[] = { &iar->wait_ind1, &iar->wait_ind2, &iar->wait_ind3, &iar->wait_ind4 };
+	unsigned int num = bts->agch.rej_num;
+	int i, rc;
+
+	if (!num)
+		return 0;
+	bts->agch.rej_num = 0;
 
 	/* create IMMEDIATE ASSIGN REJECT 04.08 message */
 	memset(iar, 0, sizeof(*iar));
@@ -1288,36 +1322,183 @@ static int rsl_send_imm_ass_rej(struct gsm_bts *bts,
 	iar->page_mode = GSM48_PM_SAME;
 
 	/*
-	 * Set all request references and wait indications to the same value.
 	 * 3GPP TS 44.018 v4.5.0 release 4 (section 9.1.20.2) requires that
-	 * we duplicate reference and wait indication to fill the message.
-	 * The BTS will aggregate up to 4 of our ASS REJ messages if possible.
+	 * we duplicate reference and wait indication to fill the message,
+	 * so repeat the last one if there are less than 4 MS to reject.
 	 */
-	memcpy(&iar->req_ref1, rqd_ref, sizeof(iar->req_ref1));
-	iar->wait_ind1 = wait_ind;
-	memcpy(&iar->req_ref2, rqd_ref, sizeof(iar->req_ref2));
-	iar->wait_ind2 = wait_ind;
-	memcpy(&iar->req_ref3, rqd_ref, sizeof(iar->req_ref3));
-	iar->wait_ind3 = wait_ind;
-	memcpy(&iar->req_ref4, rqd_ref, sizeof(iar->req_ref4));
-	iar->wait_ind4 = wait_ind;
+	for (i = 0; i < ARRAY_SIZE(req_refs); i++) {
+		*req_refs[i] = bts->agch.rej[OSMO_MIN(i, num - 1)].ref;
+		*wait_inds[i] = bts->agch.rej[OSMO_MIN(i, num - 1)].wait_ind;
+	}
 
 	/* we need to subtract 1 byte from sizeof(*iar) since ia includes the l2_plen field */
 	iar->l2_plen = GSM48_LEN2PLEN((sizeof(*iar)-1));
 
-	return rsl_imm_assign_cmd(bts, sizeof(*iar), (uint8_t *) iar);
+	rc = rsl_imm_assign_cmd(bts, sizeof(*iar), (uint8_t *) iar);
+	if (rc)
+		rate_ctr_inc(&bts->bts_ctrs->ctr[BTS_CTR_AGCH_SEND_FAILED]);
+	else if (num > 1)
+		rate_ctr_add(&bts->bts_ctrs->ctr[BTS_CTR_AGCH_BLOCKS_SAVED], num - 1);
+	return rc;
+}
+
+/* The IMMEDIATE ASSIGNMENT held back for lchan failed to be sent. Fail the lchan, unless it was released meanwhile
+ * or serves another MS by now. */
+static void agch_imm_ass_failed(struct gsm_lchan *lchan, const struct gsm48_req_ref *ref, int rc)
+{
+	if (!lchan || !lchan_state_is(lchan, LCHAN_ST_WAIT_RLL_RTP_ESTABLISH)
+	    || !lchan->rqd_ref || memcmp(lchan->rqd_ref, ref, sizeof(*ref)))
+		return;
+	osmo_fsm_inst_dispatch(lchan->fi, LCHAN_EV_IMM_ASS_FAILED, &rc);
 }
 
-int rsl_tx_imm_ass_rej(struct gsm_bts *bts, struct gsm48_req_ref *rqd_ref)
+/* Send the pending IMMEDIATE ASSIGNMENT by itself */
+static int agch_tx_imm_ass(struct gsm_bts *bts)
+{
+	int rc;
+
+	if (!bts->agch.ass_len)
+		return 0;
+
+	rc = rsl_imm_assign_cmd(bts, bts->agch.ass_len, bts->agch.ass);
+	bts->agch.ass_len = 0;
+	if (rc)
+		rate_ctr_inc(&bts->bts_ctrs->ctr[BTS_CTR_AGCH_SEND_FAILED]);
+	else
+		rate_ctr_inc(&bts->bts_ctrs->ctr[BTS_CTR_CHREQ_SUCCESSFUL]);
+	return rc;
+}
+
+/* Both MS of an IMMEDIATE ASSIGNMENT EXTENDED share the Mobile Allocation, which may be 4 octets long at most
+ * (3GPP TS 44.018 9.1.19), to fit the message in one AGCH block. */
+#define IMM_ASS_EXT_MA_MAX_LEN (GSM_MACBLOCK_LEN - sizeof(struct imm_ass_ext))
+osmo_static_assert(IMM_ASS_EXT_MA_MAX_LEN == 4, imm_ass_ext_size);
+
+static bool agch_imm_ass_ext_possible(const struct gsm48_imm_ass *ia1, const struct gsm48_imm_ass *ia2)
+{
+	return ia1->mob_alloc_len <= IMM_ASS_EXT_MA_MAX_LEN
+		&& ia1->mob_alloc_len == ia2->mob_alloc_len
+		&& !memcmp(ia1->mob_alloc, ia2->mob_alloc, ia1->mob_alloc_len);
+}
+
+/* Send the pending IMMEDIATE ASSIGNMENT together with ia2 */
+static int agch_tx_imm_ass_ext(struct gsm_bts *bts, const struct gsm48_imm_ass *ia2)
+{
+	const struct gsm48_imm_ass *ia1 = (const struct gsm48_imm_ass *) bts->agch.ass;
+	uint8_t buf[GSM_MACBLOCK_LEN];
+	struct imm_ass_ext *iae = (struct imm_ass_ext *) buf;
+	int rc;
+
+	memset(iae, 0, sizeof(*iae));
+	iae->proto_discr = GSM48_PDISC_RR;
+	iae->msg_type = GSM48_MT_RR_IMM_ASS_EXT;
+	iae->page_mode = GSM48_PM_SAME;
+	iae->chan_desc1 = ia1->chan_desc;
+	iae->req_ref1 = ia1->req_ref;
+	iae->timing_advance1 = ia1->timing_advance;
+	iae->chan_desc2 = ia2->chan_desc;
+	iae->req_ref2 = ia2->req_ref;
+	iae->timing_advance2 = ia2->timing_advance;
+	iae->mob_alloc_len = ia1->mob_alloc_len;
+	memcpy(iae->mob_alloc, ia1->mob_alloc, iae->mob_alloc_len);
+	/* we need to subtract 1 byte from sizeof(*iae) since it includes the l2_plen field */
+	iae->l2_plen = GSM48_LEN2PLEN((sizeof(*iae)-1) + iae->mob_alloc_len);
+
+	bts->agch.ass_len = 0;
+	rc = rsl_imm_assign_cmd(bts, sizeof(*iae) + iae->mob_alloc_len, buf);
+	if (rc) {
+		rate_ctr_inc(&bts->bts_ctrs->ctr[BTS_CTR_AGCH_SEND_FAILED]);
+		/* The caller fails the lchan of ia2 */
+		agch_imm_ass_failed(bts->agch.ass_lchan, &iae->req_ref1, rc);
+	} else {
+		rate_ctr_add(&bts->bts_ctrs->ctr[BTS_CTR_CHREQ_SUCCESSFUL], 2);
+		rate_ctr_inc(&bts->bts_ctrs->ctr[BTS_CTR_AGCH_IMM_ASS_EXT]);
+		rate_ctr_inc(&bts->bts_ctrs->ctr[BTS_CTR_AGCH_BLOCKS_SAVED]);
+	}
+	return rc;
+}
+
+/* Send the held back IMMEDIATE ASSIGNMENT by itself, and fail its lchan if that does not work */
+static void agch_flush_imm_ass(struct gsm_bts *bts)
+{
+	struct gsm48_req_ref ref;
+	int rc;
+
+	if (!bts->agch.ass_len)
+		return;
+
+	ref = ((struct gsm48_imm_ass *) bts->agch.ass)->req_ref;
+	rc = agch_tx_imm_ass(bts);
+	if (!rc)
+		return;
+	LOG_BTS(bts, DRSL, LOGL_ERROR, "Failed to send pending Immediate Assignment (rc=%d)\n", rc);
+	agch_imm_ass_failed(bts->agch.ass_lchan, &ref, rc);
+}
+
+static void agch_timer_cb(void *data)
 {
-	uint8_t wait_ind;
-	wait_ind = bts->T3122;
+	struct gsm_bts *bts = data;
+	int rc;
+
+	/* The RSL link went down meanwhile; the MS will retry on the RACH */
+	if (!bts->c0->rsl_link) {
+		bts->agch.rej_num = 0;
+		bts->agch.ass_len = 0;
+		return;
+	}
+
+	agch_flush_imm_ass(bts);
+	rc = agch_tx_imm_ass_rej(bts);
+	if (rc)
+		LOG_BTS(bts, DRSL, LOGL_ERROR, "Failed to send pending Immediate Assignment Reject (rc=%d)\n", rc);
+}
+
+static void agch_schedule(struct gsm_bts *bts)
+{
+	unsigned long window_ms;
+
+	if (osmo_timer_pending(&bts->agch.timer))
+		return;
+
+	window_ms = osmo_tdef_get(bts->network->T_defs, -993102, OSMO_TDEF_MS, -1);
+	osmo_timer_setup(&bts->agch.timer, agch_timer_cb, bts);
+	osmo_timer_schedule(&bts->agch.timer, window_ms / 1000, (window_ms % 1000) * 1000);
+}
+
+/* Most CHAN RQD waiting for admission per BTS. Beyond that, the lowest priority ones get rejected right away. */
+#define CHAN_RQD_QUEUE_MAX 32
+/* Most CHAN RQD served per BTS and main loop iteration */
+#define CHAN_RQD_BATCH 16
+
+/* Wait indication for rejected MS: T3122 as maintained from the channel load. The admission queue drains within a
+ * few main loop iterations, far below the one second resolution of the wait indication, so its depth does not
+ * count. */
+static uint8_t chan_rqd_wait_ind(struct gsm_bts *bts)
+{
+	unsigned int wait_ind = bts->T3122;
+
 	if (!wait_ind)
 		wait_ind = osmo_tdef_get(bts->network->T_defs, 3122, OSMO_TDEF_S, -1);
 	if (!wait_ind)
 		wait_ind = GSM_T3122_DEFAULT;
-	/* The BTS will gather multiple CHAN RQD and reject up to 4 MS at the same time. */
-	return rsl_send_imm_ass_rej(bts, rqd_ref, wait_ind);
+
+	return OSMO_MIN(wait_ind, 255);
+}
+
+/* Reject the MS right away if nothing went to the AGCH within X993102. Otherwise, hold it back to reject up to four
+ * MS with one IMMEDIATE ASSIGNMENT REJECT. */
+int rsl_tx_imm_ass_rej(struct gsm_bts *bts, struct gsm48_req_ref *rqd_ref)
+{
+	bool idle = !osmo_timer_pending(&bts->agch.timer);
+
+	bts->agch.rej[bts->agch.rej_num].ref = *rqd_ref;
+	bts->agch.rej[bts->agch.rej_num].wait_ind = chan_rqd_wait_ind(bts);
+	bts->agch.rej_num++;
+
+	agch_schedule(bts);
+	if (idle || bts->agch.rej_num == ARRAY_SIZE(bts->agch.rej))
+		return agch_tx_imm_ass_rej(bts);
+	return 0;
 }
 
 /* Handle packet channel rach requests */
@@ -1353,17 +1534,233 @@ static int rsl_rx_pchan_rqd(struct msgb *msg, struct gsm_bts *bts)
 			       GSM_L1_BURST_TYPE_ACCESS_0);
 }
 
+/* A CHAN RQD waiting in bts->chan_rqd.queue */
+struct chan_rqd {
+	struct llist_head entry;
+	struct gsm48_req_ref ref;
+	uint8_t ta;
+	enum gsm_chreq_reason_t reason;
+	struct timespec received;
+};
+
+/* Lower values are served first: emergency calls, then answers to paging, which the network waits for, then
+ * originating calls, then the rest. */
+static int chan_rqd_prio(enum gsm_chreq_reason_t reason)
+{
+	switch (reason) {
+	case GSM_CHREQ_REASON_EMERG:
+		return 0;
+	case GSM_CHREQ_REASON_PAG:
+		return 1;
+	case GSM_CHREQ_REASON_CALL:
+		return 2;
+	default:
+		return 3;
+	}
+}
+
+static unsigned long long timespec_diff_ms(const struct timespec *later, const struct timespec *earlier)
+{
+	return (later->tv_sec - earlier->tv_sec) * 1000LL + (later->tv_nsec - earlier->tv_nsec) / 1000000;
+}
+
+/* Whether the same RACH burst is already waiting or was served within the dedup window, as happens when several
+ * TRX of a BTS decode it. The request reference includes the frame number, so a retry of the MS is no duplicate. */
+static bool chan_rqd_is_dup(struct gsm_bts *bts, const struct gsm48_req_ref *ref, const struct timespec *now,
+			    unsigned long long window_ms)
+{
+	struct chan_rqd *rqd;
+	int i;
+
+	llist_for_each_entry(rqd, &bts->chan_rqd.queue, entry) {
+		if (!memcmp(&rqd->ref, ref, sizeof(*ref)))
+			return true;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(bts->chan_rqd.recent); i++) {
+		if (!memcmp(&bts->chan_rqd.recent[i], ref, sizeof(*ref))
+		    && timespec_diff_ms(now, &bts->chan_rqd.recent_time[i]) <= window_ms)
+			return true;
+	}
+	return false;
+}
+
+static void chan_rqd_remember(struct gsm_bts *bts, const struct chan_rqd *rqd)
+{
+	unsigned int i = bts->chan_rqd.recent_idx++ % ARRAY_SIZE(bts->chan_rqd.recent);
+
+	bts->chan_rqd.recent[i] = rqd->ref;
+	bts->chan_rqd.recent_time[i] = rqd->received;
+}
+
+/*
+ * Check availability / allocate channel
+ *
+ * - First try to allocate SDCCH.
+ * - If SDCCH is not available, try a TCH/H (less bandwidth).
+ * - If there is still no channel available, try a TCH/F.
+ */
+static struct gsm_lchan *chan_rqd_select_lchan(struct gsm_bts *bts, const struct chan_rqd *rqd)
+{
+	struct gsm_lchan *lchan;
+
+	lchan = lchan_select_by_type(bts, GSM_LCHAN_SDCCH);
+	if (!lchan) {
+		LOG_BTS(bts, DRSL, LOGL_NOTICE, "CHAN RQD: no resources for %s 0x%x, retrying with %s\n",
+			gsm_lchant_name(GSM_LCHAN_SDCCH), rqd->ref.ra, gsm_lchant_name(GSM_LCHAN_TCH_H));
+		lchan = lchan_select_by_type(bts, GSM_LCHAN_TCH_H);
+	}
+	if (!lchan) {
+		LOG_BTS(bts, DRSL, LOGL_NOTICE, "CHAN RQD: no resources for %s 0x%x, retrying with %s\n",
+			gsm_lchant_name(GSM_LCHAN_SDCCH), rqd->ref.ra, gsm_lchant_name(GSM_LCHAN_TCH_F));
+		lchan = lchan_select_by_type(bts, GSM_LCHAN_TCH_F);
+	}
+	return lchan;
+}
+
+static void chan_rqd_admit(struct gsm_bts *bts, const struct chan_rqd *rqd, struct gsm_lchan *lchan)
+{
+	struct lchan_activate_info info;
+
+	/* save the RACH data as we need it after the CHAN ACT ACK */
+	lchan->rqd_ref = talloc_zero(bts, struct gsm48_req_ref);
+	OSMO_ASSERT(lchan->rqd_ref);
+
+	*(lchan->rqd_ref) = rqd->ref;
+	lchan->rqd_ta = rqd->ta;
+
+	LOG_LCHAN(lchan, LOGL_DEBUG, "MS: Channel Request: reason=%s ra=0x%02x ta=%d\n",
+		  gsm_chreq_name(rqd->reason), rqd->ref.ra, rqd->ta);
+	info = (struct lchan_activate_info){
+		.activ_for = FOR_MS_CHANNEL_REQUEST,
+		.chan_mode = GSM48_CMODE_SIGN,
+	};
+
+	lchan_activate(lchan, &info);
+}
+
+/* Activate an lchan for rqd, or reject the MS. Skip the allocation if no_channel, i.e. if it already failed for an
+ * earlier CHAN RQD of the same batch. Return true if the MS was rejected for lack of a channel. */
+static bool chan_rqd_serve(struct gsm_bts *bts, struct chan_rqd *rqd, bool no_channel)
+{
+	struct gsm_lchan *lchan = NULL;
+
+	if (!no_channel)
+		lchan = chan_rqd_select_lchan(bts, rqd);
+
+	if (!lchan) {
+		LOG_BTS(bts, DRSL, LOGL_NOTICE, "CHAN RQD: no resources for %s 0x%x\n",
+			gsm_lchant_name(get_ctype_by_chreq(bts->network, rqd->ref.ra)), rqd->ref.ra);
+		rate_ctr_inc(&bts->bts_ctrs->ctr[BTS_CTR_CHREQ_NO_CHANNEL]);
+		rsl_tx_imm_ass_rej(bts, &rqd->ref);
+		return true;
+	}
+
+	chan_rqd_admit(bts, rqd, lchan);
+	return false;
+}
+
+static void chan_rqd_queue_cb(void *data);
+
+/* Run chan_rqd_queue_cb() in the next main loop iteration */
+static void chan_rqd_schedule(struct gsm_bts *bts)
+{
+	if (osmo_timer_pending(&bts->chan_rqd.timer))
+		return;
+	osmo_timer_setup(&bts->chan_rqd.timer, chan_rqd_queue_cb, bts);
+	osmo_timer_schedule(&bts->chan_rqd.timer, 0, 0);
+}
+
+/* Serve the CHAN RQD received since the last main loop iteration, highest priority first. */
+static void chan_rqd_queue_cb(void *data)
+{
+	struct gsm_bts *bts = data;
+	unsigned long long max_age_ms = osmo_tdef_get(bts->network->T_defs, -993101, OSMO_TDEF_MS, -1);
+	bool no_channel = false;
+	struct timespec now;
+	int i;
+
+	osmo_clock_gettime(CLOCK_MONOTONIC, &now);
+
+	for (i = 0; i < CHAN_RQD_BATCH && !llist_empty(&bts->chan_rqd.queue); i++) {
+		struct chan_rqd *rqd = llist_first_entry(&bts->chan_rqd.queue, struct chan_rqd, entry);
+
+		llist_del(&rqd->entry);
+		bts->chan_rqd.queue_len--;
+		chan_rqd_remember(bts, rqd);
+
+		/* The MS has sent another RACH burst by now, which is queued by itself */
+		if (timespec_diff_ms(&now, &rqd->received) > max_age_ms) {
+			LOG_BTS(bts, DRSL, LOGL_INFO, "CHAN RQD: dropping request for ra=0x%02x after %llu ms in queue\n",
+				rqd->ref.ra, timespec_diff_ms(&now, &rqd->received));
+			rate_ctr_inc(&bts->bts_ctrs->ctr[BTS_CTR_CHREQ_EXPIRED]);
+			talloc_free(rqd);
+			continue;
+		}
+
+		/* Once the allocation failed, it fails for the rest of this batch as well */
+		if (chan_rqd_serve(bts, rqd, no_channel))
+			no_channel = true;
+
+		talloc_free(rqd);
+	}
+
+	osmo_stat_item_set(bts->bts_statg->items[BTS_STAT_CHREQ_QUEUE_LENGTH], bts->chan_rqd.queue_len);
+
+	if (!llist_empty(&bts->chan_rqd.queue))
+		chan_rqd_schedule(bts);
+}
+
+/* Insert rqd by priority, behind all others of the same or a higher priority. If the queue is full, reject whichever
+ * of rqd and the last entry has the lower priority. */
+static void chan_rqd_enqueue(struct gsm_bts *bts, struct chan_rqd *rqd)
+{
+	int prio = chan_rqd_prio(rqd->reason);
+	struct chan_rqd *pos;
+	struct chan_rqd *shed = NULL;
+
+	if (bts->chan_rqd.queue_len >= CHAN_RQD_QUEUE_MAX) {
+		struct chan_rqd *last = llist_last_entry(&bts->chan_rqd.queue, struct chan_rqd, entry);
+		if (chan_rqd_prio(last->reason) <= prio) {
+			shed = rqd;
+		} else {
+			llist_del(&last->entry);
+			bts->chan_rqd.queue_len--;
+			shed = last;
+		}
+		LOG_BTS(bts, DRSL, LOGL_NOTICE, "CHAN RQD: admission queue full, rejecting %s request ra=0x%02x\n",
+			gsm_chreq_name(shed->reason), shed->ref.ra);
+		rate_ctr_inc(&bts->bts_ctrs->ctr[BTS_CTR_CHREQ_SHED]);
+		rsl_tx_imm_ass_rej(bts, &shed->ref);
+		talloc_free(shed);
+		if (shed == rqd)
+			return;
+	}
+
+	llist_for_each_entry_reverse(pos, &bts->chan_rqd.queue, entry) {
+		if (chan_rqd_prio(pos->reason) <= prio)
+			break;
+	}
+	/* pos is the last entry not to be overtaken, or the list head itself */
+	if (&pos->entry != bts->chan_rqd.queue.prev)
+		rate_ctr_inc(&bts->bts_ctrs->ctr[BTS_CTR_CHREQ_PRIORITIZED]);
+	llist_add(&rqd->entry, &pos->entry);
+	bts->chan_rqd.queue_len++;
+	osmo_stat_item_set(bts->bts_statg->items[BTS_STAT_CHREQ_QUEUE_LENGTH], bts->chan_rqd.queue_len);
+
+	chan_rqd_schedule(bts);
+}
+
 /* MS has requested a channel on the RACH */
 static int rsl_rx_chan_rqd(struct msgb *msg)
 {
-	struct lchan_activate_info info;
 	struct e1inp_sign_link *sign_link = msg->dst;
 	struct gsm_bts *bts = sign_link->trx->bts;
 	struct abis_rsl_dchan_hdr *rqd_hdr = msgb_l2(msg);
 	struct gsm48_req_ref *rqd_ref;
-	enum gsm_chan_t lctype;
 	enum gsm_chreq_reason_t chreq_reason;
-	struct gsm_lchan *lchan;
+	struct chan_rqd *rqd;
+	struct timespec now;
 	uint8_t rqd_ta;
 
 	/* parse request reference to be used in immediate assign */
@@ -1386,56 +1783,41 @@ static int rsl_rx_chan_rqd(struct msgb *msg)
 	if (chreq_reason == GSM_CHREQ_REASON_PDCH)
 		return rsl_rx_pchan_rqd(msg, bts);
 
-	/* determine channel type (SDCCH/TCH_F/TCH_H) based on
-	 * request reference RA */
-	lctype = get_ctype_by_chreq(bts->network, rqd_ref->ra);
-
 	rate_ctr_inc(&bts->bts_ctrs->ctr[BTS_CTR_CHREQ_TOTAL]);
 
-	/* check availability / allocate channel
-	 *
-	 * - First try to allocate SDCCH.
-	 * - If SDCCH is not available, try a TCH/H (less bandwidth).
-	 * - If there is still no channel available, try a TCH/F.
-	 *
-	 */
-	lchan = lchan_select_by_type(bts, GSM_LCHAN_SDCCH);
-	if (!lchan) {
-		LOG_BTS(bts, DRSL, LOGL_NOTICE, "CHAN RQD: no resources for %s 0x%x, retrying with %s\n",
-			gsm_lchant_name(GSM_LCHAN_SDCCH), rqd_ref->ra, gsm_lchant_name(GSM_LCHAN_TCH_H));
-		lchan = lchan_select_by_type(bts, GSM_LCHAN_TCH_H);
-	}
-	if (!lchan) {
-		LOG_BTS(bts, DRSL, LOGL_NOTICE, "CHAN RQD: no resources for %s 0x%x, retrying with %s\n",
-			gsm_lchant_name(GSM_LCHAN_SDCCH), rqd_ref->ra, gsm_lchant_name(GSM_LCHAN_TCH_F));
-		lchan = lchan_select_by_type(bts, GSM_LCHAN_TCH_F);
-	}
-	if (!lchan) {
-		LOG_BTS(bts, DRSL, LOGL_NOTICE, "CHAN RQD: no resources for %s 0x%x\n",
-			gsm_lchant_name(lctype), rqd_ref->ra);
-		rate_ctr_inc(&bts->bts_ctrs->ctr[BTS_CTR_CHREQ_NO_CHANNEL]);
-		rsl_tx_imm_ass_rej(bts, rqd_ref);
+	osmo_clock_gettime(CLOCK_MONOTONIC, &now);
+	if (chan_rqd_is_dup(bts, rqd_ref, &now, osmo_tdef_get(bts->network->T_defs, -993101, OSMO_TDEF_MS, -1))) {
+		LOG_BTS(bts, DRSL, LOGL_INFO, "CHAN RQD: dropping duplicate of ra=0x%02x\n", rqd_ref->ra);
+		rate_ctr_inc(&bts->bts_ctrs->ctr[BTS_CTR_CHREQ_DUPLICATE]);
 		return 0;
 	}
 
-	/* save the RACH data as we need it after the CHAN ACT ACK */
-	lchan->rqd_ref = talloc_zero(bts, struct gsm48_req_ref);
-	OSMO_ASSERT(lchan->rqd_ref);
-
-	*(lchan->rqd_ref) = *rqd_ref;
-	lchan->rqd_ta = rqd_ta;
-
-	LOG_LCHAN(lchan, LOGL_DEBUG, "MS: Channel Request: reason=%s ra=0x%02x ta=%d\n",
-		  gsm_chreq_name(chreq_reason), rqd_ref->ra, rqd_ta);
-	info = (struct lchan_activate_info){
-		.activ_for = FOR_MS_CHANNEL_REQUEST,
-		.chan_mode = GSM48_CMODE_SIGN,
+	rqd = talloc_zero(bts, struct chan_rqd);
+	OSMO_ASSERT(rqd);
+	*rqd = (struct chan_rqd){
+		.ref = *rqd_ref,
+		.ta = rqd_ta,
+		.reason = chreq_reason,
+		.received = now,
 	};
 
-	lchan_activate(lchan, &info);
+	/* The first CHAN RQD of a main loop iteration is served right away. Those that follow within the same
+	 * iteration are queued and served at once in chan_rqd_queue_cb(), so that a burst is served by priority. */
+	if (llist_empty(&bts->chan_rqd.queue) && !osmo_timer_pending(&bts->chan_rqd.timer)) {
+		chan_rqd_remember(bts, rqd);
+		chan_rqd_serve(bts, rqd, false);
+		talloc_free(rqd);
+		chan_rqd_schedule(bts);
+		return 0;
+	}
+
+	chan_rqd_enqueue(bts, rqd);
 	return 0;
 }
 
+/* Send the Immediate Assignment right away if nothing went to the AGCH within X993102. Otherwise, hold it back to
+ * send it together with the next one, and return 0; if it then fails to be sent, the lchan gets
+ * LCHAN_EV_IMM_ASS_FAILED. */
 int rsl_tx_imm_assignment(struct gsm_lchan *lchan)
 {
 	int rc;
@@ -1463,13 +1845,23 @@ int rsl_tx_imm_assignment(struct gsm_lchan *lchan)
 	/* we need to subtract 1 byte from sizeof(*ia) since ia includes the l2_plen field */
 	ia->l2_plen = GSM48_LEN2PLEN((sizeof(*ia)-1) + ia->mob_alloc_len);
 
-	/* send IMMEDIATE ASSIGN CMD on RSL to BTS (to send on CCCH to MS) */
-	rc = rsl_imm_assign_cmd(bts, sizeof(*ia)+ia->mob_alloc_len, (uint8_t *) ia);
+	/* send IMMEDIATE ASSIGN CMD on RSL to BTS (to send on CCCH to MS), together with the next one if that follows
+	 * within X993102 */
+	if (bts->agch.ass_len) {
+		if (agch_imm_ass_ext_possible((struct gsm48_imm_ass *) bts->agch.ass, ia))
+			return agch_tx_imm_ass_ext(bts, ia);
+		agch_flush_imm_ass(bts);
+	}
 
-	if (!rc)
-		rate_ctr_inc(&bts->bts_ctrs->ctr[BTS_CTR_CHREQ_SUCCESSFUL]);
+	bts->agch.ass_len = sizeof(*ia) + ia->mob_alloc_len;
+	memcpy(bts->agch.ass, ia, bts->agch.ass_len);
+	bts->agch.ass_lchan = lchan;
+	if (osmo_timer_pending(&bts->agch.timer))
+		return 0;
 
-	return rc;
+	/* The AGCH is idle: send it now, and hold back those that follow within X993102 */
+	agch_schedule(bts);
+	return agch_tx_imm_ass(bts);
 }
 
 /* current load on the CCCH */
@@ -20,6 +20,10 @@
  *
  */
 
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
 #include <osmocom/core/tdef.h>
 #include <osmocom/gsm/gsm0808.h>
 
@@ -221,6 +225,65 @@ static void send_assignment_complete(struct gsm_subscriber_connection *conn)
 	}
 }
 
+/* Return the index of the first element in sorted[0..n-1] that is not less than val. */
+static unsigned int latency_lower_bound(const uint32_t *sorted, unsigned int n, uint32_t val)
+{
+	unsigned int lo = 0, hi = n;
+	while (lo < hi) {
+		unsigned int mid = lo + (hi - lo) / 2;
+		if (sorted[mid] < val)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/* Add the duration of this Assignment to the recent samples and update the latency percentile stats. The
+ * samples are kept sorted alongside the ring buffer: drop the evicted sample and insert the new one, instead of
+ * sorting all samples on each Assignment. */
+static void assignment_latency_update(struct gsm_subscriber_connection *conn)
+{
+	struct gsm_network *net = conn->network;
+	uint32_t *sorted = net->assignment_latency.sorted;
+	struct timespec now;
+	int64_t ms;
+	unsigned int n;
+	unsigned int i;
+
+	osmo_clock_gettime(CLOCK_MONOTONIC, &now);
+	ms = (int64_t)(now.tv_sec - conn->assignment.start_time.tv_sec) * 1000
+	     + (now.tv_nsec - conn->assignment.start_time.tv_nsec) / 1000000;
+	if (ms < 0)
+		ms = 0;
+	if (ms > UINT32_MAX)
+		ms = UINT32_MAX;
+
+	n = net->assignment_latency.count;
+	if (n == ASSIGNMENT_LATENCY_SAMPLES) {
+		/* The ring buffer is full, the sample at 'next' gets overwritten */
+		i = latency_lower_bound(sorted, n, net->assignment_latency.ms[net->assignment_latency.next]);
+		memmove(&sorted[i], &sorted[i + 1], (n - i - 1) * sizeof(sorted[0]));
+		n--;
+	}
+
+	i = latency_lower_bound(sorted, n, ms);
+	memmove(&sorted[i + 1], &sorted[i], (n - i) * sizeof(sorted[0]));
+	sorted[i] = ms;
+	n++;
+
+	net->assignment_latency.ms[net->assignment_latency.next] = ms;
+	net->assignment_latency.next = (net->assignment_latency.next + 1) % ASSIGNMENT_LATENCY_SAMPLES;
+	net->assignment_latency.count = n;
+
+	osmo_stat_item_set(net->bsc_statg->items[BSC_STAT_ASSIGNMENT_LATENCY_P50], sorted[(n - 1) * 50 / 100]);
+	osmo_stat_item_set(net->bsc_statg->items[BSC_STAT_ASSIGNMENT_LATENCY_P90], sorted[(n - 1) * 90 / 100]);
+	osmo_stat_item_set(net->bsc_statg->items[BSC_STAT_ASSIGNMENT_LATENCY_P99], sorted[(n - 1) * 99 / 100]);
+
+	LOG_ASSIGNMENT(conn, LOGL_DEBUG, "Assignment took %" PRId64 " ms%s\n", ms,
+		       conn->assignment.msc_mgw_requested ? " (pipelined MGW setup)" : "");
+}
+
 static void assignment_success(struct gsm_subscriber_connection *conn)
 {
 	/* Take on the new lchan */
@@ -251,6 +314,7 @@ static void assignment_success(struct gsm_subscriber_connection *conn)
 	conn->user_plane.msc_assigned_rtp_port = conn->assignment.req.msc_rtp_port;
 
 	LOG_ASSIGNMENT(conn, LOGL_DEBUG, "Assignment successful\n");
+	assignment_latency_update(conn);
 	osmo_fsm_inst_term(conn->assignment.fi, OSMO_FSM_TERM_REGULAR, 0);
 
 	assignment_count_result(CTR_ASSIGNMENT_COMPLETED);
@@ -412,6 +476,40 @@ static bool reuse_existing_lchan(struct gsm_subscriber_connection *conn)
 	return true;
 }
 
+/* In pipelined mode, create the MSC side CI right away, concurrently with the lchan activation and the BTS
+ * side RTP setup, instead of after the lchan is established. Only do so for a fresh CRCX: modifying an
+ * existing MSC side CI would affect the old lchan if the Assignment fails. On failure, assignment_reset()
+ * releases the new lchan (which rolls back its RTP stream) and DLCXes created_ci_for_msc. */
+static void assignment_connect_msc_mgw_early(struct gsm_subscriber_connection *conn)
+{
+	struct osmo_fsm_inst *fi = conn->assignment.fi;
+
+	if (!conn->assignment.requires_voice_stream
+	    || !gscon_is_aoip(conn)
+	    || conn->user_plane.mgw_endpoint_ci_msc)
+		return;
+
+	LOG_ASSIGNMENT(conn, LOGL_DEBUG,
+		       "Pipelined: connecting MGW endpoint to the MSC's RTP port %s:%u during lchan activation\n",
+		       conn->assignment.req.msc_rtp_addr,
+		       conn->assignment.req.msc_rtp_port);
+
+	conn->assignment.msc_mgw_requested = true;
+	if (!gscon_connect_mgw_to_msc(conn,
+				      conn->assignment.new_lchan,
+				      conn->assignment.req.msc_rtp_addr,
+				      conn->assignment.req.msc_rtp_port,
+				      fi,
+				      ASSIGNMENT_EV_MSC_MGW_OK,
+				      ASSIGNMENT_EV_MSC_MGW_FAIL,
+				      NULL,
+				      &conn->assignment.created_ci_for_msc)) {
+		assignment_fail(GSM0808_CAUSE_EQUIPMENT_FAILURE,
+				"Unable to connect MGW endpoint to the MSC side");
+		return;
+	}
+}
+
 void assignment_fsm_start(struct gsm_subscriber_connection *conn, struct gsm_bts *bts,
 			  struct assignment_request *req)
 {
@@ -439,6 +537,7 @@ void assignment_fsm_start(struct gsm_subscriber_connection *conn, struct gsm_bts
 	/* Create a copy of the request data and use that copy from now on. */
 	conn->assignment.req = *req;
 	req = &conn->assignment.req;
+	osmo_clock_gettime(CLOCK_MONOTONIC, &conn->assignment.start_time);
 
 	/* Check if we need a voice stream. If yes, set the appropriate struct
 	 * members in conn */
@@ -511,6 +610,13 @@ void assignment_fsm_start(struct gsm_subscriber_connection *conn, struct gsm_bts
 		.re_use_mgw_endpoint_from_lchan = conn->lchan,
 	};
 	lchan_activate(conn->assignment.new_lchan, &info);
+
+	/* The lchan activation may have failed right away, terminating this fi. */
+	if (!conn->assignment.fi)
+		return;
+
+	if (conn->network->assignment_mgw_pipelining)
+		assignment_connect_msc_mgw_early(conn);
 }
 
 static void assignment_fsm_wait_lchan(struct osmo_fsm_inst *fi, uint32_t event, void *data)
@@ -611,12 +717,24 @@ static void assignment_fsm_post_lchan_established(struct osmo_fsm_inst *fi)
 		assignment_success(conn);
 }
 
+static void assignment_fsm_wait_mgw_endpoint_to_msc(struct osmo_fsm_inst *fi, uint32_t event, void *data);
+
 static void assignment_fsm_wait_mgw_endpoint_to_msc_onenter(struct osmo_fsm_inst *fi, uint32_t prev_state)
 {
 	struct gsm_subscriber_connection *conn = assignment_fi_conn(fi);
 
 	OSMO_ASSERT(conn->assignment.requires_voice_stream);
 
+	/* Pipelined mode: the MSC side CI was already requested in assignment_fsm_start(). */
+	if (conn->assignment.msc_mgw_requested) {
+		if (conn->assignment.msc_mgw_ready) {
+			LOG_ASSIGNMENT(conn, LOGL_DEBUG, "MGW endpoint to the MSC was set up in parallel, no need to wait\n");
+			assignment_fsm_wait_mgw_endpoint_to_msc(fi, ASSIGNMENT_EV_MSC_MGW_OK, NULL);
+		} else
+			LOG_ASSIGNMENT(conn, LOGL_DEBUG, "Still waiting for MGW endpoint to the MSC\n");
+		return;
+	}
+
 	LOG_ASSIGNMENT(conn, LOGL_DEBUG,
 		       "Connecting MGW endpoint to the MSC's RTP port: %s:%u\n",
 		       conn->assignment.req.msc_rtp_addr,
@@ -710,11 +828,9 @@ static const struct osmo_fsm_state assignment_fsm_states[] = {
 	[ASSIGNMENT_ST_WAIT_MGW_ENDPOINT_TO_MSC] = {
 		.name = "WAIT_MGW_ENDPOINT_TO_MSC",
 		.onenter = assignment_fsm_wait_mgw_endpoint_to_msc_onenter,
+		/* ASSIGNMENT_EV_MSC_MGW_OK and _FAIL are allstate events, to also receive them early in
+		 * pipelined mode; they get passed on to assignment_fsm_wait_mgw_endpoint_to_msc(). */
 		.action = assignment_fsm_wait_mgw_endpoint_to_msc,
-		.in_event_mask = 0
-			| S(ASSIGNMENT_EV_MSC_MGW_OK)
-			| S(ASSIGNMENT_EV_MSC_MGW_FAIL)
-			,
 	},
 };
 
@@ -748,6 +864,22 @@ void assignment_fsm_allstate_action(struct osmo_fsm_inst *fi, uint32_t event, vo
 				gsm_lchan_name(conn->assignment.new_lchan));
 		return;
 
+	case ASSIGNMENT_EV_MSC_MGW_OK:
+	case ASSIGNMENT_EV_MSC_MGW_FAIL:
+		if (fi->state == ASSIGNMENT_ST_WAIT_MGW_ENDPOINT_TO_MSC) {
+			assignment_fsm_wait_mgw_endpoint_to_msc(fi, event, data);
+			return;
+		}
+		/* Pipelined mode: the MGW responded before the lchan is established. */
+		if (event == ASSIGNMENT_EV_MSC_MGW_OK) {
+			LOG_ASSIGNMENT(conn, LOGL_DEBUG, "MGW endpoint to the MSC is ready, lchan is not yet\n");
+			conn->assignment.msc_mgw_ready = true;
+			return;
+		}
+		assignment_fail(GSM0808_CAUSE_EQUIPMENT_FAILURE,
+				"Unable to connect MGW endpoint to the MSC side");
+		return;
+
 	default:
 		return;
 	}
@@ -778,6 +910,8 @@ static struct osmo_fsm assignment_fsm = {
 	.allstate_event_mask = 0
 		| S(ASSIGNMENT_EV_CONN_RELEASING)
 		| S(ASSIGNMENT_EV_LCHAN_ERROR)
+		| S(ASSIGNMENT_EV_MSC_MGW_OK)
+		| S(ASSIGNMENT_EV_MSC_MGW_FAIL)
 		,
 	.timer_cb = assignment_fsm_timer_cb,
 	.cleanup = assignment_fsm_cleanup,
@@ -20,6 +20,8 @@
  */
 #include <errno.h>
 #include <time.h>
+#include <string.h>
+#include <inttypes.h>
 
 #include <osmocom/ctrl/control_cmd.h>
 #include <osmocom/gsm/gsm48.h>
@@ -343,6 +345,113 @@ static int get_bts_rf_state(struct ctrl_cmd *cmd, void *data)
 }
 CTRL_CMD_DEFINE_RO(bts_rf_state, "rf_state");
 
+/* Compose the bts-snapshot record of one BTS: fields are comma separated key=value pairs, the channel load is
+ * given per pchan type as used/total. The channel load is taken from the last periodic sample, so that a poller
+ * does not cause a walk across all lchans; the record is cached and rebuilt at most once per sample interval. */
+static const char *bts_snapshot(struct gsm_bts *bts)
+{
+	struct gsm_network *net = bts->network;
+	const struct rate_ctr *ctrs = bts->bts_ctrs->ctr;
+	unsigned long long uptime = 0;
+	char *s;
+	int i;
+
+	if (bts->ctrl_snapshot && bts->ctrl_snapshot_gen == net->chan_load_sample_gen)
+		return bts->ctrl_snapshot;
+
+	/* bts_uptime() logs an error for a BTS without OML link, which is normal in a snapshot of all BTS */
+	if (bts->oml_link)
+		uptime = bts_uptime(bts);
+
+	s = talloc_asprintf(bts, "bts=%u,oml=%s,uptime=%llu,oper=%s,admin=%s,policy=%s,gprs=%s,load_avg=%u,t3122=%u"
+			    ",chreq_total=%"PRIu64",chreq_no_channel=%"PRIu64
+			    ",paging_attempted=%"PRIu64",paging_expired=%"PRIu64
+			    ",assignment_attempted=%"PRIu64",assignment_completed=%"PRIu64,
+			    bts->nr, get_model_oml_status(bts), uptime,
+			    osmo_bsc_rf_get_opstate_name(osmo_bsc_rf_get_opstate_by_bts(bts)),
+			    osmo_bsc_rf_get_adminstate_name(osmo_bsc_rf_get_adminstate_by_bts(bts)),
+			    osmo_bsc_rf_get_policy_name(osmo_bsc_rf_get_policy_by_bts(bts)),
+			    bts_gprs_mode_name(bts->gprs.mode), bts->chan_load_avg, bts->T3122,
+			    ctrs[BTS_CTR_CHREQ_TOTAL].current, ctrs[BTS_CTR_CHREQ_NO_CHANNEL].current,
+			    ctrs[BTS_CTR_PAGING_ATTEMPTED].current, ctrs[BTS_CTR_PAGING_EXPIRED].current,
+			    ctrs[BTS_CTR_ASSIGNMENT_ATTEMPTED].current, ctrs[BTS_CTR_ASSIGNMENT_COMPLETED].current);
+
+	for (i = 0; s && i < ARRAY_SIZE(bts->chan_load_last); i++) {
+		const struct load_counter *lc = &bts->chan_load_last[i];
+
+		/* Same as channel-load, skip what can never have user load */
+		if (i == GSM_PCHAN_NONE || i == GSM_PCHAN_CCCH || i == GSM_PCHAN_PDCH || i == GSM_PCHAN_UNKNOWN)
+			continue;
+		if (!lc->total)
+			continue;
+		s = talloc_asprintf_append(s, ",%s=%u/%u", gsm_pchan_name(i), lc->used, lc->total);
+	}
+
+	if (!s)
+		return NULL;
+
+	talloc_free(bts->ctrl_snapshot);
+	bts->ctrl_snapshot = s;
+	bts->ctrl_snapshot_gen = net->chan_load_sample_gen;
+	return s;
+}
+
+static int get_bts_snapshot(struct ctrl_cmd *cmd, void *data)
+{
+	const char *s = bts_snapshot(cmd->node);
+
+	cmd->reply = s ? talloc_strdup(cmd, s) : NULL;
+	if (!cmd->reply) {
+		cmd->reply = "OOM";
+		return CTRL_CMD_ERROR;
+	}
+
+	return CTRL_CMD_REPLY;
+}
+CTRL_CMD_DEFINE_RO(bts_snapshot, "bts-snapshot");
+
+/* The records of all BTS, separated by ';'. The reply is sized up front, so that it costs a single copy of each
+ * record regardless of the number of BTS. */
+static int get_net_bts_snapshot(struct ctrl_cmd *cmd, void *data)
+{
+	struct gsm_network *net = cmd->node;
+	const char *recs[net->num_bts ? : 1];
+	struct gsm_bts *bts;
+	size_t len = 0, n = 0, i;
+	char *pos;
+
+	llist_for_each_entry(bts, &net->bts_list, list) {
+		if (n >= ARRAY_SIZE(recs))
+			break;
+		recs[n] = bts_snapshot(bts);
+		if (!recs[n])
+			goto oom;
+		len += strlen(recs[n]) + 1;
+		n++;
+	}
+
+	cmd->reply = talloc_size(cmd, len + 1);
+	if (!cmd->reply)
+		goto oom;
+
+	pos = cmd->reply;
+	for (i = 0; i < n; i++) {
+		size_t l = strlen(recs[i]);
+		if (i)
+			*pos++ = ';';
+		memcpy(pos, recs[i], l);
+		pos += l;
+	}
+	*pos = '\0';
+
+	return CTRL_CMD_REPLY;
+
+oom:
+	cmd->reply = "OOM";
+	return CTRL_CMD_ERROR;
+}
+CTRL_CMD_DEFINE_RO(net_bts_snapshot, "bts-snapshot");
+
 static int get_net_rf_lock(struct ctrl_cmd *cmd, void *data)
 {
 	struct gsm_network *net = cmd->node;
@@ -482,6 +591,7 @@ int bsc_base_ctrl_cmds_install(void)
 	rc |= ctrl_cmd_install(CTRL_NODE_ROOT, &cmd_net_mcc_mnc_apply);
 	rc |= ctrl_cmd_install(CTRL_NODE_ROOT, &cmd_net_rf_lock);
 	rc |= ctrl_cmd_install(CTRL_NODE_ROOT, &cmd_net_bts_num);
+	rc |= ctrl_cmd_install(CTRL_NODE_ROOT, &cmd_net_bts_snapshot);
 
 	rc |= ctrl_cmd_install(CTRL_NODE_BTS, &cmd_bts_lac);
 	rc |= ctrl_cmd_install(CTRL_NODE_BTS, &cmd_bts_ci);
@@ -492,6 +602,7 @@ int bsc_base_ctrl_cmds_install(void)
 	rc |= ctrl_cmd_install(CTRL_NODE_BTS, &cmd_bts_oml_up);
 	rc |= ctrl_cmd_install(CTRL_NODE_BTS, &cmd_bts_gprs_mode);
 	rc |= ctrl_cmd_install(CTRL_NODE_BTS, &cmd_bts_rf_state);
+	rc |= ctrl_cmd_install(CTRL_NODE_BTS, &cmd_bts_snapshot);
 
 	rc |= ctrl_cmd_install(CTRL_NODE_TRX, &cmd_trx_max_power);
 	rc |= ctrl_cmd_install(CTRL_NODE_TRX, &cmd_trx_arfcn);
@@ -38,6 +38,7 @@
 #include <osmocom/bsc/neighbor_ident.h>
 
 #include <osmocom/bsc/smscb.h>
+#include <osmocom/bsc/bts_snapshot.h>
 #include <osmocom/gsm/protocol/gsm_48_049.h>
 
 #include <time.h>
@@ -45,7 +46,20 @@
 #include <stdbool.h>
 
 static const struct osmo_stat_item_desc bsc_stat_desc[] = {
-	{ "num_bts:total", "Number of configured BTS for this BSC", "", 16, 0 },
+	[BSC_STAT_NUM_BTS_TOTAL] = { "num_bts:total", "Number of configured BTS for this BSC", "", 16, 0 },
+	[BSC_STAT_ASSIGNMENT_LATENCY_P50] = { "assignment:latency:p50",
+		"Median time from BSSMAP Assignment Request to Assignment Complete", "ms", 16, 0 },
+	[BSC_STAT_ASSIGNMENT_LATENCY_P90] = { "assignment:latency:p90",
+		"90th percentile of time from BSSMAP Assignment Request to Assignment Complete", "ms", 16, 0 },
+	[BSC_STAT_ASSIGNMENT_LATENCY_P99] = { "assignment:latency:p99",
+		"99th percentile of time from BSSMAP Assignment Request to Assignment Complete", "ms", 16, 0 },
+	[BSC_STAT_BTS_BRINGUP_WAITING] = { "bts_bringup:waiting",
+		"BTS with OML up waiting for their turn to be configured", "", 16, 0 },
+	[BSC_STAT_BTS_BRINGUP_ACTIVE] = { "bts_bringup:active", "BTS being configured", "", 16, 0 },
+	[BSC_STAT_CHAN_TCH_USED] = { "chan:tch:used", "Number of TCH channels used on all BTS", "", 16, 0 },
+	[BSC_STAT_CHAN_TCH_TOTAL] = { "chan:tch:total", "Number of TCH channels on all BTS", "", 16, 0 },
+	[BSC_STAT_CHAN_SDCCH_USED] = { "chan:sdcch:used", "Number of SDCCH channels used on all BTS", "", 16, 0 },
+	[BSC_STAT_CHAN_SDCCH_TOTAL] = { "chan:sdcch:total", "Number of SDCCH channels on all BTS", "", 16, 0 },
 };
 
 static const struct osmo_stat_item_group_desc bsc_statg_desc = {
@@ -129,6 +143,8 @@ int gsm_bts_trx_set_system_infos(struct gsm_bts_trx *trx)
 	struct gsm_bts *bts = trx->bts;
 	uint8_t gen_si[_MAX_SYSINFO_TYPE], n_si = 0, n;
 	int si_len[_MAX_SYSINFO_TYPE];
+	uint32_t si_gen = 0;
+	bool generate;
 
 	bts->si_common.cell_sel_par.ms_txpwr_max_ccch =
 			ms_pwr_ctl_lvl(bts->band, bts->ms_max_power);
@@ -160,12 +176,21 @@ int gsm_bts_trx_set_system_infos(struct gsm_bts_trx *trx)
 	gen_si[n_si++] = SYSINFO_TYPE_5ter;
 	gen_si[n_si++] = SYSINFO_TYPE_6;
 
-	/* Second, we generate the selected SI via RSL */
+	/* Second, we generate the selected SI via RSL, unless the warm start snapshot has them */
+
+	for (n = 0; n < n_si; n++) {
+		i = gen_si[n];
+		if (!(bts->si_mode_static & (1 << i)))
+			si_gen |= (1 << i);
+	}
+	generate = !bts_snapshot_restore_si(bts, si_gen, si_len);
 
 	for (n = 0; n < n_si; n++) {
 		i = gen_si[n];
 		/* Only generate SI if this SI is not in "static" (user-defined) mode */
 		if (!(bts->si_mode_static & (1 << i))) {
+			if (!generate)
+				continue;
 			/* Set SI as being valid. gsm_generate_si() might unset
 			 * it, if SI is not required. */
 			bts->si_valid |= (1 << i);
@@ -184,6 +209,9 @@ int gsm_bts_trx_set_system_infos(struct gsm_bts_trx *trx)
 		}
 	}
 
+	if (generate)
+		bts_snapshot_store_si(bts, si_gen, si_len);
+
 	/* Third, we send the selected SI via RSL */
 
 	for (n = 0; n < n_si; n++) {
@@ -220,6 +248,9 @@ int gsm_bts_set_system_infos(struct gsm_bts *bts)
 {
 	struct gsm_bts_trx *trx;
 
+	/* A change at runtime: from now on, the SI of this BTS no longer come from or go to the warm start snapshot */
+	bts->warm_start_done = true;
+
 	/* Generate a new ID */
 	bts->bcch_change_mark += 1;
 	bts->bcch_change_mark %= 0x7;
@@ -245,6 +276,8 @@ static void update_t3122_chan_load_timer(void *data)
 
 	llist_for_each_entry(bts, &net->bts_list, list)
 		bts_update_t3122_chan_load(bts);
+	network_chan_load_publish(net);
+	net->chan_load_sample_gen++;
 
 	/* Keep this timer ticking. */
 	osmo_timer_schedule(&net->t3122_chan_load_timer, T3122_CHAN_LOAD_SAMPLE_INTERVAL, 0);
@@ -37,12 +37,14 @@
 #include <osmocom/bsc/bsc_subscr_conn_fsm.h>
 #include <osmocom/bsc/osmo_bsc.h>
 #include <osmocom/bsc/penalty_timers.h>
+#include <osmocom/bsc/mgw_pool.h>
 #include <osmocom/bsc/bsc_rll.h>
 #include <osmocom/bsc/abis_rsl.h>
 #include <osmocom/core/tdef.h>
 #include <osmocom/bsc/gsm_04_08_rr.h>
 #include <osmocom/bsc/assignment_fsm.h>
 #include <osmocom/bsc/codec_pref.h>
+#include <osmocom/bsc/vty.h>
 #include <osmocom/mgcp_client/mgcp_client_endpoint_fsm.h>
 #include <osmocom/core/byteswap.h>
 
@@ -241,7 +243,7 @@ static void handle_bssap_n_connect(struct osmo_fsm_inst *fi, struct osmo_scu_pri
 				       &scu_prim->u.connect.called_addr, NULL, 0);
 
 		/* Make sure the conn FSM will osmo_sccp_tx_disconn() on term */
-		conn->sccp.state = SUBSCR_SCCP_ST_CONNECTED;
+		osmo_bsc_sigtran_set_conn_state(conn, SUBSCR_SCCP_ST_CONNECTED);
 
 		/* Inter-BSC MT Handover Request, another BSS is handovering to us. */
 		handover_start_inter_bsc_in(conn, msg);
@@ -488,13 +490,22 @@ struct osmo_mgcpc_ep *gscon_ensure_mgw_endpoint(struct gsm_subscriber_connection
 			 msc_assigned_cic, osmo_mgcpc_ep_name(conn->user_plane.mgw_endpoint));
 
 	} else if (gscon_is_aoip(conn)) {
-		/* use dynamic RTPBRIDGE endpoint allocation in MGW */
+		/* use dynamic RTPBRIDGE endpoint allocation in MGW, on the MGW of the pool that currently
+		 * has the least load */
+		struct mgw_pool_member *member = mgw_pool_pick(conn->network);
+		struct mgcp_client *client = member ? member->client : conn->network->mgw.client;
 		conn->user_plane.mgw_endpoint =
 			osmo_mgcpc_ep_alloc(conn->fi, GSCON_EV_FORGET_MGW_ENDPOINT,
-					    conn->network->mgw.client,
+					    client,
 					    conn->network->mgw.tdefs,
 					    conn->fi->id,
-					    "%s", mgcp_client_rtpbridge_wildcard(conn->network->mgw.client));
+					    "%s", mgcp_client_rtpbridge_wildcard(client));
+		if (conn->user_plane.mgw_endpoint) {
+			conn->user_plane.mgw_pool_member = member;
+			mgw_pool_member_endpoint_get(member);
+			if (member)
+				LOGPFSML(conn->fi, LOGL_DEBUG, "Using MGW %u of the pool\n", member->nr);
+		}
 	} else {
 		LOGPFSML(conn->fi, LOGL_ERROR, "Conn is neither SCCPlite nor AoIP!?\n");
 		return NULL;
@@ -726,6 +737,8 @@ void gscon_forget_lchan(struct gsm_subscriber_connection *conn, struct gsm_lchan
 
 static void gscon_forget_mgw_endpoint(struct gsm_subscriber_connection *conn)
 {
+	mgw_pool_member_endpoint_put(conn->user_plane.mgw_pool_member);
+	conn->user_plane.mgw_pool_member = NULL;
 	conn->user_plane.mgw_endpoint = NULL;
 	conn->user_plane.mgw_endpoint_ci_msc = NULL;
 	conn->ho.created_ci_for_msc = NULL;
@@ -802,12 +815,17 @@ static void gscon_cleanup(struct osmo_fsm_inst *fi, enum osmo_fsm_term_cause cau
 	lchan_forget_conn(conn->assignment.new_lchan);
 	lchan_forget_conn(conn->ho.new_lchan);
 
+	/* The MGW endpoint FSM terminates along with this conn without dispatching
+	 * GSCON_EV_FORGET_MGW_ENDPOINT, release its pool accounting here. */
+	mgw_pool_member_endpoint_put(conn->user_plane.mgw_pool_member);
+	conn->user_plane.mgw_pool_member = NULL;
+
 	if (conn->sccp.state != SUBSCR_SCCP_ST_NONE) {
 		LOGPFSML(fi, LOGL_DEBUG, "Disconnecting SCCP\n");
 		struct bsc_msc_data *msc = conn->sccp.msc;
 		/* FIXME: include a proper cause value / error message? */
 		osmo_sccp_tx_disconn(msc->a.sccp_user, conn->sccp.conn_id, &msc->a.bsc_addr, 0);
-		conn->sccp.state = SUBSCR_SCCP_ST_NONE;
+		osmo_bsc_sigtran_set_conn_state(conn, SUBSCR_SCCP_ST_NONE);
 	}
 
 	if (conn->bsub) {
@@ -816,7 +834,8 @@ static void gscon_cleanup(struct osmo_fsm_inst *fi, enum osmo_fsm_term_cause cau
 		conn->bsub = NULL;
 	}
 
-	llist_del(&conn->entry);
+	lcls_clear_gcr(conn);
+	vty_stream_llist_del(&conn->entry);
 	talloc_free(conn);
 }
 
@@ -908,6 +927,7 @@ struct gsm_subscriber_connection *bsc_subscr_con_allocate(struct gsm_network *ne
 
 	conn->network = net;
 	INIT_LLIST_HEAD(&conn->dtap_queue);
+	INIT_LLIST_HEAD(&conn->lcls.gcr_hash_entry);
 	/* BTW, penalty timers will be initialized on-demand. */
 	conn->sccp.conn_id = -1;
 
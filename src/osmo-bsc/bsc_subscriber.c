@@ -94,6 +94,15 @@ void bsc_subscr_set_imsi(struct bsc_subscr *bsub, const char *imsi)
 	if (!bsub)
 		return;
 	osmo_strlcpy(bsub->imsi, imsi, sizeof(bsub->imsi));
+	bsub->name[0] = '\0';
+}
+
+void bsc_subscr_set_tmsi(struct bsc_subscr *bsub, uint32_t tmsi)
+{
+	if (!bsub)
+		return;
+	bsub->tmsi = tmsi;
+	bsub->name[0] = '\0';
 }
 
 struct bsc_subscr *bsc_subscr_find_or_create_by_imsi(struct llist_head *list,
@@ -120,7 +129,7 @@ struct bsc_subscr *bsc_subscr_find_or_create_by_tmsi(struct llist_head *list,
 	bsub = bsc_subscr_alloc(list);
 	if (!bsub)
 		return NULL;
-	bsub->tmsi = tmsi;
+	bsc_subscr_set_tmsi(bsub, tmsi);
 	return bsc_subscr_get(bsub);
 }
 
@@ -138,16 +147,19 @@ struct bsc_subscr *bsc_subscr_find_or_create_by_mi(struct llist_head *list, cons
 	}
 }
 
+/* Return the subscriber's name for logging. The string is kept in bsub, use bsc_subscr_set_imsi() and
+ * bsc_subscr_set_tmsi() to modify the identity, so that it gets composed anew. */
 const char *bsc_subscr_name(struct bsc_subscr *bsub)
 {
-	static char buf[32];
 	if (!bsub)
 		return "unknown";
-	if (bsub->imsi[0])
-		snprintf(buf, sizeof(buf), "IMSI:%s", bsub->imsi);
-	else
-		snprintf(buf, sizeof(buf), "TMSI:0x%08x", bsub->tmsi);
-	return buf;
+	if (!bsub->name[0]) {
+		if (bsub->imsi[0])
+			snprintf(bsub->name, sizeof(bsub->name), "IMSI:%s", bsub->imsi);
+		else
+			snprintf(bsub->name, sizeof(bsub->name), "TMSI:0x%08x", bsub->tmsi);
+	}
+	return bsub->name;
 }
 
 /* Like bsc_subscr_name() but returns only characters approved by osmo_identifier_valid(), useful for
@@ -73,6 +73,8 @@
 #include <osmocom/bsc/lchan_select.h>
 #include <osmocom/bsc/smscb.h>
 #include <osmocom/bsc/osmo_bsc.h>
+#include <osmocom/bsc/mgw_pool.h>
+#include <osmocom/bsc/bts_snapshot.h>
 #include <osmocom/mgcp_client/mgcp_client_endpoint_fsm.h>
 
 #include <inttypes.h>
@@ -250,6 +252,14 @@ static void net_dump_vty(struct vty *vty, struct gsm_network *net)
 				VTY_NEWLINE);
 	}
 
+	if (net->bts_bringup.num_active || net->bts_bringup.num_waiting)
+		vty_out(vty, "  BTS bring-up: %u being configured, %u waiting%s",
+			net->bts_bringup.num_active, net->bts_bringup.num_waiting, VTY_NEWLINE);
+
+	if (net->warm_start.path)
+		vty_out(vty, "  Warm start snapshot: %s, System Information of %u BTS%s",
+			net->warm_start.path, bts_snapshot_count(net), VTY_NEWLINE);
+
 	network_chan_load(&pl, net);
 	vty_out(vty, "  Current Channel Load:%s", VTY_NEWLINE);
 	dump_pchan_load_vty(vty, "    ", &pl);
@@ -354,6 +364,7 @@ static void bts_dump_vty(struct vty *vty, struct gsm_bts *bts)
 	struct gsm_bts_trx *trx;
 	int ts_hopping_total;
 	int ts_non_hopping_total;
+	unsigned int i, busiest;
 
 	vty_out(vty, "BTS %u is of %s type in band %s, has CI %u LAC %u, "
 		"BSIC %u (NCC=%u, BCC=%u) and %u TRX%s",
@@ -446,6 +457,11 @@ static void bts_dump_vty(struct vty *vty, struct gsm_bts *bts)
 		VTY_NEWLINE);
 	if (bts->pcu_sock_path)
 		vty_out(vty, "  PCU Socket Path: %s%s", bts->pcu_sock_path, VTY_NEWLINE);
+	if (bts->pcu_state)
+		vty_out(vty, "  PCU Socket shared by %u BTS, queue %u/%u (max %u), %llu dropped%s",
+			bts->pcu_state->use_count, bts->pcu_state->upqueue_len,
+			PCU_SOCK_UPQUEUE_MAX_LEN, bts->pcu_state->upqueue_max_seen,
+			bts->pcu_state->upqueue_dropped, VTY_NEWLINE);
 	if (is_ipaccess_bts(bts))
 		vty_out(vty, "  Unit ID: %u/%u/0, OML Stream ID 0x%02x%s",
 			bts->ip_access.site_id, bts->ip_access.bts_id,
@@ -473,6 +489,13 @@ static void bts_dump_vty(struct vty *vty, struct gsm_bts *bts)
 	vty_out(vty, "  Paging: %u pending requests, %u free slots%s",
 		paging_pending_requests_nr(bts),
 		bts->paging.available_slots, VTY_NEWLINE);
+	for (i = 0, busiest = 0; i < PAGING_GROUPS_MAX; i++) {
+		if (bts->paging.group_depth[i] > bts->paging.group_depth[busiest])
+			busiest = i;
+	}
+	if (bts->paging.group_depth[busiest])
+		vty_out(vty, "  Paging: busiest paging group %u with %u pending requests%s",
+			busiest, bts->paging.group_depth[busiest], VTY_NEWLINE);
 	if (is_ipaccess_bts(bts)) {
 		vty_out(vty, "  OML Link: ");
 		e1isl_dump_vty_tcp(vty, bts->oml_link);
@@ -486,6 +509,20 @@ static void bts_dump_vty(struct vty *vty, struct gsm_bts *bts)
 		vty_out(vty, "  E1 Signalling Link:%s", VTY_NEWLINE);
 		e1isl_dump_vty(vty, bts->oml_link);
 	}
+	if (bts->dyn_ts_reserve.num)
+		vty_out(vty, "  Dynamic timeslots ready for TCH: %u, reserve %u%s%s",
+			ts_dyn_reserve_count(bts, NULL), bts->dyn_ts_reserve.num,
+			bts->dyn_ts_reserve.demand ? "" : " (released to PDCH, no recent TCH request)",
+			VTY_NEWLINE);
+	if (bts->bringup.state == BTS_BRINGUP_WAITING)
+		vty_out(vty, "  OML bring-up: waiting for a turn, see 'bts-bringup max-concurrent'%s", VTY_NEWLINE);
+	else if (bts->oml_bringup.running)
+		vty_out(vty, "  OML bring-up: in progress, %u messages sent, %d awaiting response%s",
+			bts->oml_bringup.msgs, bts->abis_nm_pend, VTY_NEWLINE);
+	else if (bts->oml_bringup.duration_ms || bts->oml_bringup.msgs)
+		vty_out(vty, "  OML bring-up: %llu ms, %u messages, up to %u in flight%s",
+			bts->oml_bringup.duration_ms, bts->oml_bringup.msgs, bts->oml_bringup.max_in_flight,
+			VTY_NEWLINE);
 
 	vty_out(vty, "  Neighbor Cells: ");
 	switch (bts->neigh_list_manual_mode) {
@@ -536,6 +573,17 @@ static void bts_dump_vty(struct vty *vty, struct gsm_bts *bts)
 	bts_dump_vty_features(vty, bts);
 }
 
+/* vty_stream step of "show bts", the cursor is the number of the next BTS to dump */
+static bool show_bts_step(struct vty *vty, void *cursor)
+{
+	struct gsm_network *net = gsmnet_from_vty(vty);
+	int *bts_nr = cursor;
+
+	if (*bts_nr < net->num_bts)
+		bts_dump_vty(vty, gsm_bts_num(net, (*bts_nr)++));
+	return *bts_nr >= net->num_bts;
+}
+
 DEFUN(show_bts, show_bts_cmd, "show bts [<0-255>]",
 	SHOW_STR "Display information about a BTS\n"
 		"BTS number\n")
@@ -555,10 +603,8 @@ DEFUN(show_bts, show_bts_cmd, "show bts [<0-255>]",
 		return CMD_SUCCESS;
 	}
 	/* print all BTS's */
-	for (bts_nr = 0; bts_nr < net->num_bts; bts_nr++)
-		bts_dump_vty(vty, gsm_bts_num(net, bts_nr));
-
-	return CMD_SUCCESS;
+	bts_nr = 0;
+	return vty_stream_start(vty, show_bts_step, &bts_nr, sizeof(bts_nr));
 }
 
 DEFUN(show_bts_fail_rep, show_bts_fail_rep_cmd, "show bts <0-255> fail-rep [reset]",
@@ -913,6 +959,10 @@ static void config_write_bts_single(struct vty *vty, struct gsm_bts *bts)
 	vty_out(vty, "  channel allocator %s%s",
 		bts->chan_alloc_reverse ? "descending" : "ascending",
 		VTY_NEWLINE);
+	if (bts->bringup.priority)
+		vty_out(vty, "  bringup-priority %u%s", bts->bringup.priority, VTY_NEWLINE);
+	if (bts->dyn_ts_reserve.num)
+		vty_out(vty, "  dyn-ts-reserve %u%s", bts->dyn_ts_reserve.num, VTY_NEWLINE);
 	vty_out(vty, "  rach tx integer %u%s",
 		bts->si_common.rach_control.tx_integer, VTY_NEWLINE);
 	vty_out(vty, "  rach max transmission %u%s",
@@ -1157,11 +1207,26 @@ static int config_write_net(struct vty *vty)
 		if (strlen(meas_scenario) > 0)
 			vty_out(vty, " meas-feed scenario %s%s",
 				meas_scenario, VTY_NEWLINE);
+		if (meas_feed_version_get() != MEAS_FEED_VERSION)
+			vty_out(vty, " meas-feed version %u%s",
+				meas_feed_version_get(), VTY_NEWLINE);
 	}
 
 	if (gsmnet->allow_unusable_timeslots)
 		vty_out(vty, " allow-unusable-timeslots%s", VTY_NEWLINE);
 
+	if (gsmnet->assignment_mgw_pipelining)
+		vty_out(vty, " assignment mgw-pipelining%s", VTY_NEWLINE);
+
+	if (gsmnet->bts_bringup.max_concurrent)
+		vty_out(vty, " bts-bringup max-concurrent %u%s", gsmnet->bts_bringup.max_concurrent, VTY_NEWLINE);
+
+	if (gsmnet->warm_start.path)
+		vty_out(vty, " warm-start snapshot %s%s", gsmnet->warm_start.path, VTY_NEWLINE);
+
+	if (gsmnet->mscpool_selection == MSCPOOL_SEL_WEIGHTED)
+		vty_out(vty, " mscpool selection weighted%s", VTY_NEWLINE);
+
 	if (gsmnet->nri_bitlen != OSMO_NRI_BITLEN_DEFAULT)
 		vty_out(vty, " nri bitlen %u%s", gsmnet->nri_bitlen, VTY_NEWLINE);
 
@@ -1459,10 +1524,24 @@ DEFUN(show_trx_con,
 	return CMD_SUCCESS;
 }
 
-static void lchan_dump_full_vty(struct vty *vty, struct gsm_lchan *lchan)
+/* The last measurement report on lchan, or an empty one if none was received yet */
+static struct gsm_meas_rep *lchan_last_meas_rep(struct gsm_lchan *lchan)
 {
+	static struct gsm_meas_rep no_meas_rep;
 	int idx;
 
+	if (!lchan->meas) {
+		no_meas_rep = (struct gsm_meas_rep){ .lchan = lchan };
+		return &no_meas_rep;
+	}
+
+	idx = calc_initial_idx(ARRAY_SIZE(lchan->meas->meas_rep),
+			       lchan->meas->meas_rep_idx, 1);
+	return &lchan->meas->meas_rep[idx];
+}
+
+static void lchan_dump_full_vty(struct vty *vty, struct gsm_lchan *lchan)
+{
 	vty_out(vty, "BTS %u, TRX %u, Timeslot %u, Lchan %u: Type %s%s",
 		lchan->ts->trx->bts->nr, lchan->ts->trx->nr, lchan->ts->nr,
 		lchan->nr, gsm_lchant_name(lchan->type), VTY_NEWLINE);
@@ -1505,20 +1584,13 @@ static void lchan_dump_full_vty(struct vty *vty, struct gsm_lchan *lchan)
 	}
 
 	/* we want to report the last measurement report */
-	idx = calc_initial_idx(ARRAY_SIZE(lchan->meas_rep),
-			       lchan->meas_rep_idx, 1);
-	meas_rep_dump_vty(vty, &lchan->meas_rep[idx], "  ");
+	meas_rep_dump_vty(vty, lchan_last_meas_rep(lchan), "  ");
 }
 
 static void lchan_dump_short_vty(struct vty *vty, struct gsm_lchan *lchan)
 {
-	struct gsm_meas_rep *mr;
-	int idx;
-
 	/* we want to report the last measurement report */
-	idx = calc_initial_idx(ARRAY_SIZE(lchan->meas_rep),
-			       lchan->meas_rep_idx, 1);
-	mr =  &lchan->meas_rep[idx];
+	struct gsm_meas_rep *mr = lchan_last_meas_rep(lchan);
 
 	vty_out(vty, "BTS %u, TRX %u, Timeslot %u %s",
 		lchan->ts->trx->bts->nr, lchan->ts->trx->nr, lchan->ts->nr,
@@ -1563,18 +1635,48 @@ static int dump_lchan_trx(struct gsm_bts_trx *trx, struct vty *vty,
 	return CMD_SUCCESS;
 }
 
-static int dump_lchan_bts(struct gsm_bts *bts, struct vty *vty,
-			  void (*dump_cb)(struct vty *, struct gsm_lchan *),
-			  bool all)
-{
+struct lchan_summary_cursor {
+	void (*dump_cb)(struct vty *, struct gsm_lchan *);
+	bool all;
+	int bts_nr;
+	int bts_last;
 	int trx_nr;
+};
+
+/* vty_stream step of "show lchan", dumps one TRX */
+static bool lchan_summary_step(struct vty *vty, void *cursor)
+{
+	struct lchan_summary_cursor *c = cursor;
+	struct gsm_network *net = gsmnet_from_vty(vty);
+	struct gsm_bts *bts;
 
-	for (trx_nr = 0; trx_nr < bts->num_trx; trx_nr++) {
-		struct gsm_bts_trx *trx = gsm_bts_trx_num(bts, trx_nr);
-		dump_lchan_trx(trx, vty, dump_cb, all);
+	if (c->bts_nr > c->bts_last)
+		return true;
+
+	bts = gsm_bts_num(net, c->bts_nr);
+	if (bts && c->trx_nr < bts->num_trx)
+		dump_lchan_trx(gsm_bts_trx_num(bts, c->trx_nr), vty, c->dump_cb, c->all);
+
+	if (!bts || ++c->trx_nr >= bts->num_trx) {
+		c->bts_nr++;
+		c->trx_nr = 0;
 	}
+	return c->bts_nr > c->bts_last;
+}
 
-	return CMD_SUCCESS;
+/* Dump the lchans of BTS first to last, one TRX per vty_stream step */
+static int dump_lchan_bts_range(struct vty *vty, int first, int last,
+				void (*dump_cb)(struct vty *, struct gsm_lchan *),
+				bool all)
+{
+	struct lchan_summary_cursor c = {
+		.dump_cb = dump_cb,
+		.all = all,
+		.bts_nr = first,
+		.bts_last = last,
+	};
+
+	return vty_stream_start(vty, lchan_summary_step, &c, sizeof(c));
 }
 
 static int lchan_summary(struct vty *vty, int argc, const char **argv,
@@ -1599,7 +1701,7 @@ static int lchan_summary(struct vty *vty, int argc, const char **argv,
 		bts = gsm_bts_num(net, bts_nr);
 
 		if (argc == 1)
-			return dump_lchan_bts(bts, vty, dump_cb, all);
+			return dump_lchan_bts_range(vty, bts_nr, bts_nr, dump_cb, all);
 	}
 	if (argc >= 2) {
 		trx_nr = atoi(argv[1]);
@@ -1637,13 +1739,7 @@ static int lchan_summary(struct vty *vty, int argc, const char **argv,
 		return CMD_SUCCESS;
 	}
 
-
-	for (bts_nr = 0; bts_nr < net->num_bts; bts_nr++) {
-		bts = gsm_bts_num(net, bts_nr);
-		dump_lchan_bts(bts, vty, dump_cb, all);
-	}
-
-	return CMD_SUCCESS;
+	return dump_lchan_bts_range(vty, 0, net->num_bts - 1, dump_cb, all);
 }
 
 
@@ -1697,28 +1793,40 @@ static void dump_one_subscr_conn(struct vty *vty, const struct gsm_subscriber_co
 		lchan_dump_full_vty(vty, conn->assignment.new_lchan);
 }
 
+#define SHOW_CONNS_PER_STEP 32
+
+/* vty_stream step of "show conns". Conns freed meanwhile are skipped, see vty_stream_llist_del(). */
+static bool show_subscr_conn_step(struct vty *vty, void *cursor)
+{
+	struct vty_stream_llist_pos *pos = cursor;
+	unsigned int dumped;
+
+	for (dumped = 0; dumped < SHOW_CONNS_PER_STEP && pos->next != pos->head; dumped++) {
+		dump_one_subscr_conn(vty, llist_entry(pos->next, struct gsm_subscriber_connection, entry));
+		pos->next = pos->next->next;
+	}
+	return pos->next == pos->head;
+}
+
 DEFUN(show_subscr_conn,
       show_subscr_conn_cmd,
       "show conns",
       SHOW_STR "Display currently active subscriber connections\n")
 {
-	struct gsm_subscriber_connection *conn;
 	struct gsm_network *net = gsmnet_from_vty(vty);
-	bool no_conns = true;
-	unsigned int count = 0;
+	struct vty_stream_llist_pos pos = {
+		.head = &net->subscr_conns,
+		.next = net->subscr_conns.next,
+	};
 
 	vty_out(vty, "Active subscriber connections: %s", VTY_NEWLINE);
 
-	llist_for_each_entry(conn, &net->subscr_conns, entry) {
-		dump_one_subscr_conn(vty, conn);
-		no_conns = false;
-		count++;
-	}
-
-	if (no_conns)
+	if (llist_empty(&net->subscr_conns)) {
 		vty_out(vty, "None%s", VTY_NEWLINE);
+		return CMD_SUCCESS;
+	}
 
-	return CMD_SUCCESS;
+	return vty_stream_start_llist(vty, show_subscr_conn_step, &pos, sizeof(pos), 0);
 }
 
 static int trigger_ho_or_as(struct vty *vty, struct gsm_lchan *from_lchan, struct gsm_bts *to_bts)
@@ -1965,15 +2073,43 @@ static void paging_dump_vty(struct vty *vty, struct gsm_paging_request *pag)
 	bsc_subscr_dump_vty(vty, pag->bsub);
 }
 
-static void bts_paging_dump_vty(struct vty *vty, struct gsm_bts *bts)
+#define SHOW_PAGING_PER_STEP 32
+
+struct show_paging_cursor {
+	/* position in the pending requests of BTS bts_nr, head is NULL before starting on that BTS */
+	struct vty_stream_llist_pos pos;
+	int bts_nr;
+	int bts_last;
+};
+
+/* vty_stream step of "show paging", dumps up to SHOW_PAGING_PER_STEP requests of one BTS */
+static bool show_paging_step(struct vty *vty, void *cursor)
 {
-	struct gsm_paging_request *pag;
+	struct show_paging_cursor *c = cursor;
+	struct gsm_network *net = gsmnet_from_vty(vty);
+	struct gsm_bts *bts;
+	unsigned int dumped;
 
-	if (!bts->paging.bts)
-		return;
+	if (c->bts_nr > c->bts_last)
+		return true;
+
+	bts = gsm_bts_num(net, c->bts_nr);
+	if (bts && bts->paging.bts) {
+		if (!c->pos.head) {
+			c->pos.head = &bts->paging.pending_requests;
+			c->pos.next = c->pos.head->next;
+		}
+		for (dumped = 0; c->pos.next != c->pos.head; dumped++) {
+			if (dumped == SHOW_PAGING_PER_STEP)
+				return false;
+			paging_dump_vty(vty, llist_entry(c->pos.next, struct gsm_paging_request, entry));
+			c->pos.next = c->pos.next->next;
+		}
+	}
 
-	llist_for_each_entry(pag, &bts->paging.pending_requests, entry)
-		paging_dump_vty(vty, pag);
+	c->bts_nr++;
+	c->pos = (struct vty_stream_llist_pos){};
+	return c->bts_nr > c->bts_last;
 }
 
 DEFUN(show_paging,
@@ -1983,28 +2119,24 @@ DEFUN(show_paging,
 	BTS_NR_STR)
 {
 	struct gsm_network *net = gsmnet_from_vty(vty);
-	struct gsm_bts *bts;
-	int bts_nr;
+	struct show_paging_cursor c = {
+		.bts_nr = 0,
+		.bts_last = net->num_bts - 1,
+	};
 
 	if (argc >= 1) {
 		/* use the BTS number that the user has specified */
-		bts_nr = atoi(argv[0]);
-		if (bts_nr >= net->num_bts) {
+		c.bts_nr = atoi(argv[0]);
+		if (c.bts_nr >= net->num_bts) {
 			vty_out(vty, "%% can't find BTS %s%s", argv[0],
 				VTY_NEWLINE);
 			return CMD_WARNING;
 		}
-		bts = gsm_bts_num(net, bts_nr);
-		bts_paging_dump_vty(vty, bts);
-
-		return CMD_SUCCESS;
-	}
-	for (bts_nr = 0; bts_nr < net->num_bts; bts_nr++) {
-		bts = gsm_bts_num(net, bts_nr);
-		bts_paging_dump_vty(vty, bts);
+		c.bts_last = c.bts_nr;
 	}
 
-	return CMD_SUCCESS;
+	return vty_stream_start_llist(vty, show_paging_step, &c, sizeof(c),
+				      offsetof(struct show_paging_cursor, pos));
 }
 
 DEFUN(show_paging_group,
@@ -2095,6 +2227,7 @@ DEFUN(cfg_net_nri_bitlen,
 {
 	struct gsm_network *gsmnet = gsmnet_from_vty(vty);
 	gsmnet->nri_bitlen = atoi(argv[0]);
+	nri_lookup_invalidate(gsmnet);
 	return CMD_SUCCESS;
 }
 
@@ -2112,6 +2245,7 @@ DEFUN(cfg_net_nri_null_add, cfg_net_nri_null_add_cmd,
 	}
 	if (rc < 0)
 		return CMD_WARNING;
+	nri_lookup_invalidate(bsc_gsmnet);
 	return CMD_SUCCESS;
 }
 
@@ -2129,6 +2263,24 @@ DEFUN(cfg_net_nri_null_del, cfg_net_nri_null_del_cmd,
 	}
 	if (rc < 0)
 		return CMD_WARNING;
+	nri_lookup_invalidate(bsc_gsmnet);
+	return CMD_SUCCESS;
+}
+
+#define MSCPOOL_STR "MSC pooling\n"
+
+DEFUN(cfg_net_mscpool_selection, cfg_net_mscpool_selection_cmd,
+      "mscpool selection (round-robin|weighted)",
+      MSCPOOL_STR
+      "Choose how new subscribers (without a matching NRI) are distributed across the MSC pool\n"
+      "Pick the MSCs one after the other, by MSC number (default)\n"
+      "Pick the MSC with the least SCCP connections and CR to CC latency relative to its 'mscpool weight'\n")
+{
+	struct gsm_network *gsmnet = gsmnet_from_vty(vty);
+	if (!strcmp(argv[0], "weighted"))
+		gsmnet->mscpool_selection = MSCPOOL_SEL_WEIGHTED;
+	else
+		gsmnet->mscpool_selection = MSCPOOL_SEL_ROUND_ROBIN;
 	return CMD_SUCCESS;
 }
 
@@ -2538,6 +2690,28 @@ DEFUN(cfg_bts_challoc, cfg_bts_challoc_cmd,
 	return CMD_SUCCESS;
 }
 
+DEFUN(cfg_bts_bringup_priority, cfg_bts_bringup_priority_cmd,
+      "bringup-priority <0-255>",
+      "Order of configuring this BTS when many BTS connect at once, see 'bts-bringup max-concurrent'\n"
+      "Priority, BTS with higher values are configured first (default 0)\n")
+{
+	struct gsm_bts *bts = vty->index;
+	bts->bringup.priority = atoi(argv[0]);
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_bts_dyn_ts_reserve, cfg_bts_dyn_ts_reserve_cmd,
+      "dyn-ts-reserve <0-64>",
+      "Keep idle dynamic timeslots switched away from PDCH while there is voice demand, so that a TCH"
+      " does not have to wait for PDCH deactivation first\n"
+      "Number of dynamic timeslots, 0 to use all idle dynamic timeslots as PDCH (default)\n")
+{
+	struct gsm_bts *bts = vty->index;
+	bts->dyn_ts_reserve.num = atoi(argv[0]);
+	ts_dyn_reserve_update(bts);
+	return CMD_SUCCESS;
+}
+
 #define RACH_STR "Random Access Control Channel\n"
 
 DEFUN(cfg_bts_rach_tx_integer,
@@ -5370,6 +5544,17 @@ DEFUN(cfg_net_meas_feed_scenario, cfg_net_meas_feed_scenario_cmd,
 	return CMD_SUCCESS;
 }
 
+DEFUN(cfg_net_meas_feed_version, cfg_net_meas_feed_version_cmd,
+	"meas-feed version (1|2)",
+	MEAS_FEED_STR "Set the encoding of the Measurement Report feeds\n"
+	"Version 1: the BSC's in-memory report structure, for older consumers (default)\n"
+	"Version 2: packed, byte order independent encoding that omits absent neighbor cells\n")
+{
+	meas_feed_version_set(atoi(argv[0]));
+
+	return CMD_SUCCESS;
+}
+
 DEFUN(show_timer, show_timer_cmd,
       "show timer " OSMO_TDEF_VTY_ARG_T_OPTIONAL,
       SHOW_STR "Show timers\n"
@@ -5403,6 +5588,67 @@ DEFUN(cfg_net_allow_unusable_timeslots, cfg_net_allow_unusable_timeslots_cmd,
 	return CMD_SUCCESS;
 }
 
+#define ASSIGNMENT_MGW_PIPELINING_STR \
+	"Configure BSSMAP Assignment\n" \
+	"Set up the MSC side MGW connection concurrently with the lchan activation, instead of after the" \
+	" lchan is established. This saves an MGCP round trip for each Assignment.\n"
+
+DEFUN(cfg_net_assignment_mgw_pipelining, cfg_net_assignment_mgw_pipelining_cmd,
+      "assignment mgw-pipelining",
+      ASSIGNMENT_MGW_PIPELINING_STR)
+{
+	struct gsm_network *net = gsmnet_from_vty(vty);
+	net->assignment_mgw_pipelining = true;
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_net_bts_bringup_max_concurrent, cfg_net_bts_bringup_max_concurrent_cmd,
+      "bts-bringup max-concurrent <0-1000>",
+      "Configure the bring-up of BTS after their OML link comes up\n"
+      "Configure at most this many BTS at the same time, so that a mass reconnect does not overload the BSC."
+      " Further BTS wait for their turn by their bringup-priority\n"
+      "Number of BTS, 0 for no limit (default)\n")
+{
+	struct gsm_network *net = gsmnet_from_vty(vty);
+	net->bts_bringup.max_concurrent = atoi(argv[0]);
+	/* A higher limit lets waiting BTS proceed right away */
+	bts_bringup_schedule(net);
+	return CMD_SUCCESS;
+}
+
+#define WARM_START_STR "Configure how the BSC takes up its work after a restart\n"
+#define WARM_START_SNAPSHOT_STR "Keep the System Information generated for each BTS in a file, and use them after a restart" \
+	" for the BTS whose configuration has not changed\n"
+
+DEFUN(cfg_net_warm_start_snapshot, cfg_net_warm_start_snapshot_cmd,
+      "warm-start snapshot PATH",
+      WARM_START_STR WARM_START_SNAPSHOT_STR
+      "File name of the snapshot, written at startup and read at the next start\n")
+{
+	struct gsm_network *net = gsmnet_from_vty(vty);
+	osmo_talloc_replace_string(net, &net->warm_start.path, argv[0]);
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_net_no_warm_start_snapshot, cfg_net_no_warm_start_snapshot_cmd,
+      "no warm-start snapshot",
+      NO_STR WARM_START_STR WARM_START_SNAPSHOT_STR)
+{
+	struct gsm_network *net = gsmnet_from_vty(vty);
+	talloc_free(net->warm_start.path);
+	net->warm_start.path = NULL;
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_net_no_assignment_mgw_pipelining, cfg_net_no_assignment_mgw_pipelining_cmd,
+      "no assignment mgw-pipelining",
+      NO_STR ASSIGNMENT_MGW_PIPELINING_STR)
+{
+	struct gsm_network *net = gsmnet_from_vty(vty);
+	net->assignment_mgw_pipelining = false;
+	return CMD_SUCCESS;
+}
+
 static struct bsc_msc_data *bsc_msc_data(struct vty *vty)
 {
 	return vty->index;
@@ -5530,6 +5776,7 @@ static void write_msc(struct vty *vty, struct bsc_msc_data *msc)
 
 	/* write MGW configuration */
 	mgcp_client_config_write(vty, " ");
+	mgw_pool_config_write(vty, " ");
 
 	if (msc->x_osmo_ign_configured) {
 		if (!msc->x_osmo_ign)
@@ -5547,6 +5794,9 @@ static void write_msc(struct vty *vty, struct bsc_msc_data *msc)
 
 	if (!msc->allow_attach)
 		vty_out(vty, " no allow-attach%s", VTY_NEWLINE);
+
+	if (msc->pool_weight != 1)
+		vty_out(vty, " mscpool weight %u%s", msc->pool_weight, VTY_NEWLINE);
 }
 
 static int config_write_msc(struct vty *vty)
@@ -5923,6 +6173,108 @@ DEFUN(cfg_msc_no_mgw_x_osmo_ign,
 	return CMD_SUCCESS;
 }
 
+#define MGW_POOL_MEMBER_STR \
+	MGCP_CLIENT_MGW_STR \
+	"Configure an additional MGW for the pool of MGWs that new calls are spread across\n" \
+	"MGW number in the pool (0 is the MGW configured by the plain 'mgw' commands)\n"
+
+static struct mgw_pool_member *vty_mgw_pool_member(struct vty *vty, const char *nr_str)
+{
+	unsigned int nr = atoi(nr_str);
+	struct mgw_pool_member *member = mgw_pool_member_find(bsc_gsmnet, nr);
+
+	if (member)
+		return member;
+	if (vty->type != VTY_FILE) {
+		/* The MGCP clients are created at startup, members added later would remain unused */
+		vty_out(vty, "%% MGW pool members can only be added in the config file%s", VTY_NEWLINE);
+		return NULL;
+	}
+	return mgw_pool_member_alloc(bsc_gsmnet, nr, NULL);
+}
+
+static int vty_mgw_pool_member_busy(struct vty *vty, struct mgw_pool_member *member)
+{
+	vty_out(vty, "%% MGW %u is already connected, change its config in the config file and restart%s",
+		member->nr, VTY_NEWLINE);
+	return CMD_WARNING;
+}
+
+DEFUN(cfg_msc_mgw_pool_member_remote_ip,
+      cfg_msc_mgw_pool_member_remote_ip_cmd,
+      "mgw pool-member <1-" OSMO_STRINGIFY_VAL(MGW_POOL_MEMBER_NR_MAX) "> remote-ip A.B.C.D",
+      MGW_POOL_MEMBER_STR
+      "Set the remote IP address of this MGW\n"
+      "Remote IP address\n")
+{
+	struct mgw_pool_member *member = vty_mgw_pool_member(vty, argv[0]);
+	if (!member)
+		return CMD_WARNING;
+	if (mgw_pool_member_set_remote_addr(member, argv[1]))
+		return vty_mgw_pool_member_busy(vty, member);
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_msc_mgw_pool_member_remote_port,
+      cfg_msc_mgw_pool_member_remote_port_cmd,
+      "mgw pool-member <1-" OSMO_STRINGIFY_VAL(MGW_POOL_MEMBER_NR_MAX) "> remote-port <0-65534>",
+      MGW_POOL_MEMBER_STR
+      "Set the remote MGCP port of this MGW\n"
+      "Remote MGCP port\n")
+{
+	struct mgw_pool_member *member = vty_mgw_pool_member(vty, argv[0]);
+	if (!member)
+		return CMD_WARNING;
+	if (mgw_pool_member_set_remote_port(member, atoi(argv[1])))
+		return vty_mgw_pool_member_busy(vty, member);
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_msc_mgw_pool_member_local_ip,
+      cfg_msc_mgw_pool_member_local_ip_cmd,
+      "mgw pool-member <1-" OSMO_STRINGIFY_VAL(MGW_POOL_MEMBER_NR_MAX) "> local-ip A.B.C.D",
+      MGW_POOL_MEMBER_STR
+      "Set the local IP address to send MGCP to this MGW from\n"
+      "Local IP address, by default the one of the plain 'mgw' commands\n")
+{
+	struct mgw_pool_member *member = vty_mgw_pool_member(vty, argv[0]);
+	if (!member)
+		return CMD_WARNING;
+	if (mgw_pool_member_set_local_addr(member, argv[1]))
+		return vty_mgw_pool_member_busy(vty, member);
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_msc_mgw_pool_member_local_port,
+      cfg_msc_mgw_pool_member_local_port_cmd,
+      "mgw pool-member <1-" OSMO_STRINGIFY_VAL(MGW_POOL_MEMBER_NR_MAX) "> local-port <0-65534>",
+      MGW_POOL_MEMBER_STR
+      "Set the local port to send MGCP to this MGW from\n"
+      "Local port, by default an ephemeral one\n")
+{
+	struct mgw_pool_member *member = vty_mgw_pool_member(vty, argv[0]);
+	if (!member)
+		return CMD_WARNING;
+	if (mgw_pool_member_set_local_port(member, atoi(argv[1])))
+		return vty_mgw_pool_member_busy(vty, member);
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_msc_no_mgw_pool_member,
+      cfg_msc_no_mgw_pool_member_cmd,
+      "no mgw pool-member <1-" OSMO_STRINGIFY_VAL(MGW_POOL_MEMBER_NR_MAX) ">",
+      NO_STR MGW_POOL_MEMBER_STR)
+{
+	struct mgw_pool_member *member = mgw_pool_member_find(bsc_gsmnet, atoi(argv[0]));
+	if (!member)
+		return CMD_SUCCESS;
+	if (mgw_pool_member_free(member)) {
+		vty_out(vty, "%% MGW %s is in use and cannot be removed%s", argv[0], VTY_NEWLINE);
+		return CMD_WARNING;
+	}
+	return CMD_SUCCESS;
+}
+
 #define OSMUX_STR "RTP multiplexing\n"
 DEFUN(cfg_msc_osmux,
       cfg_msc_osmux_cmd,
@@ -6009,6 +6361,15 @@ DEFUN(show_mscs,
 	return CMD_SUCCESS;
 }
 
+DEFUN(show_mgw_pool,
+      show_mgw_pool_cmd,
+      "show mgw-pool",
+      SHOW_STR "MGWs that new calls are spread across, with their load and health\n")
+{
+	mgw_pool_vty_show(vty, bsc_gsmnet);
+	return CMD_SUCCESS;
+}
+
 DEFUN(show_pos,
       show_pos_cmd,
       "show position",
@@ -6179,6 +6540,7 @@ DEFUN(cfg_msc_nri_add, cfg_msc_nri_add_cmd,
 	}
 	if (rc < 0)
 		return CMD_WARNING;
+	nri_lookup_invalidate(bsc_gsmnet);
 
 	/* Issue a warning about NRI range overlaps (but still allow them).
 	 * Overlapping ranges will map to whichever MSC comes fist in the bsc_gsmnet->mscs llist,
@@ -6214,6 +6576,19 @@ DEFUN(cfg_msc_nri_del, cfg_msc_nri_del_cmd,
 	}
 	if (rc < 0)
 		return CMD_WARNING;
+	nri_lookup_invalidate(bsc_gsmnet);
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_msc_mscpool_weight, cfg_msc_mscpool_weight_cmd,
+      "mscpool weight <1-1000>",
+      MSCPOOL_STR
+      "Share of new subscribers this MSC receives relative to the other MSCs, for 'mscpool selection weighted'\n"
+      "Relative weight (default: 1)\n")
+{
+	struct bsc_msc_data *msc = bsc_msc_data(vty);
+	msc->pool_weight = atoi(argv[0]);
+	osmo_stat_item_set(msc->msc_statg->items[MSC_STAT_MSCPOOL_WEIGHT], msc->pool_weight);
 	return CMD_SUCCESS;
 }
 
@@ -6292,6 +6667,29 @@ DEFUN(show_nri, show_nri_cmd,
 	return CMD_SUCCESS;
 }
 
+DEFUN(show_nri_lookup, show_nri_lookup_cmd,
+      "show nri lookup <0-32767>",
+      SHOW_STR NRI_STR "Show which MSC an NRI value maps to, for new Complete Layer 3 requests\n"
+      "NRI value\n")
+{
+	int nri_v = atoi(argv[0]);
+	const struct nri_lookup_entry *e = nri_lookup(bsc_gsmnet, nri_v);
+
+	vty_out(vty, "NRI %d (bitlen %u): ", nri_v, bsc_gsmnet->nri_bitlen);
+	if (!e) {
+		vty_out(vty, "%% exceeds the NRI bitlen%s", VTY_NEWLINE);
+		return CMD_WARNING;
+	}
+	if (e->null_nri)
+		vty_out(vty, "NULL-NRI, ");
+	if (!e->msc)
+		vty_out(vty, "no MSC");
+	else
+		vty_out(vty, "msc %d%s", e->msc->nr, e->overlap ? " (overlaps with other MSCs)" : "");
+	vty_out(vty, "%s", VTY_NEWLINE);
+	return CMD_SUCCESS;
+}
+
 /* Hidden since it exists only for use by ttcn3 tests */
 DEFUN_HIDDEN(mscpool_roundrobin_next, mscpool_roundrobin_next_cmd,
 	     "mscpool roundrobin next " MSC_NR_RANGE,
@@ -6347,8 +6745,14 @@ int bsc_vty_init(struct gsm_network *network)
 	install_element(GSMNET_NODE, &cfg_net_dyn_ts_allow_tch_f_cmd);
 	install_element(GSMNET_NODE, &cfg_net_meas_feed_dest_cmd);
 	install_element(GSMNET_NODE, &cfg_net_meas_feed_scenario_cmd);
+	install_element(GSMNET_NODE, &cfg_net_meas_feed_version_cmd);
 	install_element(GSMNET_NODE, &cfg_net_timer_cmd);
 	install_element(GSMNET_NODE, &cfg_net_allow_unusable_timeslots_cmd);
+	install_element(GSMNET_NODE, &cfg_net_assignment_mgw_pipelining_cmd);
+	install_element(GSMNET_NODE, &cfg_net_no_assignment_mgw_pipelining_cmd);
+	install_element(GSMNET_NODE, &cfg_net_bts_bringup_max_concurrent_cmd);
+	install_element(GSMNET_NODE, &cfg_net_warm_start_snapshot_cmd);
+	install_element(GSMNET_NODE, &cfg_net_no_warm_start_snapshot_cmd);
 
 	install_element_ve(&bsc_show_net_cmd);
 	install_element_ve(&show_bts_cmd);
@@ -6378,6 +6782,7 @@ int bsc_vty_init(struct gsm_network *network)
 	install_element(GSMNET_NODE, &cfg_net_neci_cmd);
 	install_element(GSMNET_NODE, &cfg_net_dtx_cmd);
 	install_element(GSMNET_NODE, &cfg_net_pag_any_tch_cmd);
+	install_element(GSMNET_NODE, &cfg_net_mscpool_selection_cmd);
 	install_element(GSMNET_NODE, &cfg_net_nri_bitlen_cmd);
 	install_element(GSMNET_NODE, &cfg_net_nri_null_add_cmd);
 	install_element(GSMNET_NODE, &cfg_net_nri_null_del_cmd);
@@ -6408,6 +6813,8 @@ int bsc_vty_init(struct gsm_network *network)
 	install_element(BTS_NODE, &cfg_bts_oml_e1_cmd);
 	install_element(BTS_NODE, &cfg_bts_oml_e1_tei_cmd);
 	install_element(BTS_NODE, &cfg_bts_challoc_cmd);
+	install_element(BTS_NODE, &cfg_bts_bringup_priority_cmd);
+	install_element(BTS_NODE, &cfg_bts_dyn_ts_reserve_cmd);
 	install_element(BTS_NODE, &cfg_bts_rach_tx_integer_cmd);
 	install_element(BTS_NODE, &cfg_bts_rach_max_trans_cmd);
 	install_element(BTS_NODE, &cfg_bts_chan_desc_att_cmd);
@@ -6599,6 +7006,7 @@ int bsc_vty_init(struct gsm_network *network)
 	install_element(MSC_NODE, &cfg_msc_show_nri_cmd);
 	install_element(MSC_NODE, &cfg_msc_allow_attach_cmd);
 	install_element(MSC_NODE, &cfg_msc_no_allow_attach_cmd);
+	install_element(MSC_NODE, &cfg_msc_mscpool_weight_cmd);
 
 	/* Deprecated: ping time config, kept to support legacy config files. */
 	install_element(MSC_NODE, &cfg_net_msc_no_ping_time_cmd);
@@ -6607,10 +7015,12 @@ int bsc_vty_init(struct gsm_network *network)
 
 	install_element_ve(&show_statistics_cmd);
 	install_element_ve(&show_mscs_cmd);
+	install_element_ve(&show_mgw_pool_cmd);
 	install_element_ve(&show_pos_cmd);
 	install_element_ve(&logging_fltr_imsi_cmd);
 	install_element_ve(&show_subscr_all_cmd);
 	install_element_ve(&show_nri_cmd);
+	install_element_ve(&show_nri_lookup_cmd);
 
 	install_element(ENABLE_NODE, &gen_position_trap_cmd);
 	install_element(ENABLE_NODE, &mscpool_roundrobin_next_cmd);
@@ -6619,6 +7029,11 @@ int bsc_vty_init(struct gsm_network *network)
 
 	mgcp_client_vty_init(network, MSC_NODE, network->mgw.conf);
 	install_element(MSC_NODE, &cfg_msc_mgw_x_osmo_ign_cmd);
+	install_element(MSC_NODE, &cfg_msc_mgw_pool_member_remote_ip_cmd);
+	install_element(MSC_NODE, &cfg_msc_mgw_pool_member_remote_port_cmd);
+	install_element(MSC_NODE, &cfg_msc_mgw_pool_member_local_ip_cmd);
+	install_element(MSC_NODE, &cfg_msc_mgw_pool_member_local_port_cmd);
+	install_element(MSC_NODE, &cfg_msc_no_mgw_pool_member_cmd);
 	install_element(MSC_NODE, &cfg_msc_no_mgw_x_osmo_ign_cmd);
 	install_element(MSC_NODE, &cfg_msc_osmux_cmd);
 
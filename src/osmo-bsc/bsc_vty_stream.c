@@ -0,0 +1,193 @@
+/* Emit the output of large VTY show commands across several main loop iterations */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/utsname.h>
+
+#include <osmocom/core/linuxlist.h>
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/timer.h>
+#include <osmocom/core/utils.h>
+
+#include <osmocom/bsc/vty.h>
+
+/* At most this many steps run per main loop iteration. Each step emits a bounded amount of output, e.g. one BTS or
+ * one TRX worth of lchans, so that a show command on a large network never holds up Abis and A processing. */
+#define VTY_STREAM_STEPS_PER_RUN 8
+
+struct vty_stream {
+	struct llist_head entry;
+	struct vty *vty;
+	vty_stream_step_cb step;
+	struct osmo_timer_list timer;
+	/* offset of a struct vty_stream_llist_pos in the cursor, or -1 */
+	ssize_t llist_pos_offset;
+	/* copy of the caller's cursor, of cursor_size bytes */
+	size_t cursor_size;
+	uint64_t cursor[0];
+};
+
+/* There is at most one stream per VTY session; a new show command replaces an unfinished one. */
+static LLIST_HEAD(vty_streams);
+
+static struct vty_stream *vty_stream_find(struct vty *vty)
+{
+	struct vty_stream *s;
+
+	llist_for_each_entry(s, &vty_streams, entry) {
+		if (s->vty == vty)
+			return s;
+	}
+	return NULL;
+}
+
+static int vty_stream_destructor(struct vty_stream *s)
+{
+	osmo_timer_del(&s->timer);
+	llist_del(&s->entry);
+	s->vty->type = VTY_TERM;
+	return 0;
+}
+
+/* The prompt as libosmovty prints it after a command on a VTY_TERM session */
+static void vty_stream_prompt(struct vty *vty)
+{
+	struct utsname names;
+	const char *hostname = host.app_info->name;
+
+	if (!hostname) {
+		uname(&names);
+		hostname = names.nodename;
+	}
+	vty_out(vty, cmd_prompt(vty->node), hostname);
+}
+
+/* Return true when the cursor has reached the end */
+static bool vty_stream_run(struct vty *vty, vty_stream_step_cb step, void *cursor)
+{
+	int i;
+
+	for (i = 0; i < VTY_STREAM_STEPS_PER_RUN; i++) {
+		if (step(vty, cursor))
+			return true;
+	}
+	return false;
+}
+
+static void vty_stream_timer_cb(void *data)
+{
+	struct vty_stream *s = data;
+	struct vty *vty = s->vty;
+
+	if (!vty_stream_run(vty, s->step, s->cursor)) {
+		osmo_timer_schedule(&s->timer, 0, 0);
+		return;
+	}
+
+	talloc_free(s);
+	vty_stream_prompt(vty);
+}
+
+static int _vty_stream_start(struct vty *vty, vty_stream_step_cb step, const void *cursor, size_t cursor_size,
+			     ssize_t llist_pos_offset)
+{
+	struct vty_stream *s = vty_stream_find(vty);
+	uint64_t local_cursor[(cursor_size + sizeof(uint64_t) - 1) / sizeof(uint64_t)];
+
+	talloc_free(s);
+
+	memcpy(local_cursor, cursor, cursor_size);
+
+	if (vty->type != VTY_TERM) {
+		while (!step(vty, local_cursor));
+		return CMD_SUCCESS;
+	}
+
+	if (vty_stream_run(vty, step, local_cursor))
+		return CMD_SUCCESS;
+
+	/* A child of the session, so that closing the session ends the stream */
+	s = talloc_size(vty, sizeof(*s) + cursor_size);
+	if (!s) {
+		vty_out(vty, "%% Out of memory, output truncated%s", VTY_NEWLINE);
+		return CMD_WARNING;
+	}
+	talloc_set_name_const(s, "struct vty_stream");
+	*s = (struct vty_stream){
+		.vty = vty,
+		.step = step,
+		.llist_pos_offset = llist_pos_offset,
+		.cursor_size = cursor_size,
+	};
+	memcpy(s->cursor, local_cursor, cursor_size);
+	llist_add_tail(&s->entry, &vty_streams);
+	talloc_set_destructor(s, vty_stream_destructor);
+
+	/* libosmovty prints the prompt after a command only on VTY_TERM sessions. Hold it back until the output is
+	 * complete, the destructor switches back. */
+	vty->type = VTY_SHELL_SERV;
+
+	osmo_timer_setup(&s->timer, vty_stream_timer_cb, s);
+	osmo_timer_schedule(&s->timer, 0, 0);
+	return CMD_SUCCESS;
+}
+
+/*! Emit the output of a show command by calling step() until it returns true.
+ * step() emits a bounded part of the output and advances the cursor, which must not point at objects that may go
+ * away meanwhile: use numbers instead, or see vty_stream_start_llist(). The first steps run right away; if the output
+ * is not complete after that, the rest follows in later main loop iterations, and the prompt only after the end of
+ * the output. A further show command on the same session drops the remainder. Config files and other non-terminal
+ * sessions get the complete output synchronously.
+ * \param[in] vty  VTY session to write to.
+ * \param[in] step  Function emitting one part of the output.
+ * \param[in] cursor  Initial cursor, copied if the output continues later.
+ * \param[in] cursor_size  Size of *cursor.
+ * \returns CMD_SUCCESS, or CMD_WARNING when out of memory. */
+int vty_stream_start(struct vty *vty, vty_stream_step_cb step, const void *cursor, size_t cursor_size)
+{
+	return _vty_stream_start(vty, step, cursor, cursor_size, -1);
+}
+
+/*! Like vty_stream_start(), for a cursor that contains a position in an llist. The owner of the list removes entries
+ * with vty_stream_llist_del(), which moves the position on from a removed entry, so that step() can continue from
+ * the entry it left off at, without walking the list from the start each time.
+ * \param[in] llist_pos_offset  Offset of a struct vty_stream_llist_pos in *cursor. */
+int vty_stream_start_llist(struct vty *vty, vty_stream_step_cb step, const void *cursor, size_t cursor_size,
+			   size_t llist_pos_offset)
+{
+	OSMO_ASSERT(llist_pos_offset + sizeof(struct vty_stream_llist_pos) <= cursor_size);
+	return _vty_stream_start(vty, step, cursor, cursor_size, llist_pos_offset);
+}
+
+/*! llist_del() for entries of a list that a vty_stream may walk with vty_stream_start_llist(). */
+void vty_stream_llist_del(struct llist_head *entry)
+{
+	struct vty_stream *s;
+	struct vty_stream_llist_pos *pos;
+
+	llist_for_each_entry(s, &vty_streams, entry) {
+		if (s->llist_pos_offset < 0)
+			continue;
+		pos = (struct vty_stream_llist_pos *)((uint8_t *)s->cursor + s->llist_pos_offset);
+		if (pos->next == entry)
+			pos->next = entry->next;
+	}
+	llist_del(entry);
+}
@@ -0,0 +1,169 @@
+/* Throttled, prioritized bring-up of many BTS connecting at once */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <osmocom/core/linuxlist.h>
+#include <osmocom/core/signal.h>
+#include <osmocom/core/stat_item.h>
+#include <osmocom/core/tdef.h>
+#include <osmocom/core/timer.h>
+
+#include <osmocom/bsc/abis_nm.h>
+#include <osmocom/bsc/bts_bringup.h>
+#include <osmocom/bsc/debug.h>
+#include <osmocom/bsc/gsm_data.h>
+#include <osmocom/bsc/signal.h>
+
+const struct value_string bts_bringup_state_names[] = {
+	{ BTS_BRINGUP_IDLE, "idle" },
+	{ BTS_BRINGUP_WAITING, "waiting" },
+	{ BTS_BRINGUP_ACTIVE, "active" },
+	{}
+};
+
+static void bts_bringup_update_stats(struct gsm_network *net)
+{
+	osmo_stat_item_set(net->bsc_statg->items[BSC_STAT_BTS_BRINGUP_WAITING], net->bts_bringup.num_waiting);
+	osmo_stat_item_set(net->bsc_statg->items[BSC_STAT_BTS_BRINGUP_ACTIVE], net->bts_bringup.num_active);
+}
+
+/* Stop counting bts against max-concurrent */
+static void bts_bringup_release(struct gsm_bts *bts)
+{
+	struct gsm_network *net = bts->network;
+
+	osmo_timer_del(&bts->bringup.timer);
+	bts->bringup.state = BTS_BRINGUP_IDLE;
+	net->bts_bringup.num_active--;
+}
+
+static void bts_bringup_timer_cb(void *data)
+{
+	struct gsm_bts *bts = data;
+
+	LOG_BTS(bts, DNM, LOGL_NOTICE, "Bring-up takes longer than X993103, no longer throttling it\n");
+	rate_ctr_inc(&bts->network->bsc_ctrs->ctr[BSC_CTR_BTS_BRINGUP_TIMEOUT]);
+	bts_bringup_release(bts);
+	bts_bringup_schedule(bts->network);
+}
+
+static void bts_bringup_activate(struct gsm_bts *bts)
+{
+	struct gsm_network *net = bts->network;
+
+	bts->bringup.state = BTS_BRINGUP_ACTIVE;
+	net->bts_bringup.num_active++;
+	osmo_timer_setup(&bts->bringup.timer, bts_bringup_timer_cb, bts);
+	osmo_timer_schedule(&bts->bringup.timer, osmo_tdef_get(net->T_defs, -993103, OSMO_TDEF_S, -1), 0);
+}
+
+static bool bts_bringup_slot_free(const struct gsm_network *net)
+{
+	return !net->bts_bringup.max_concurrent || net->bts_bringup.num_active < net->bts_bringup.max_concurrent;
+}
+
+/*! Let waiting BTS proceed with their configuration as far as max-concurrent allows, highest priority first. */
+void bts_bringup_schedule(struct gsm_network *net)
+{
+	while (!llist_empty(&net->bts_bringup.waiting) && bts_bringup_slot_free(net)) {
+		struct gsm_bts *bts = llist_first_entry(&net->bts_bringup.waiting, struct gsm_bts, bringup.entry);
+
+		llist_del_init(&bts->bringup.entry);
+		net->bts_bringup.num_waiting--;
+		bts_bringup_activate(bts);
+		LOG_BTS(bts, DNM, LOGL_NOTICE, "Bring-up: starting configuration, %u BTS still waiting\n",
+			net->bts_bringup.num_waiting);
+
+		abis_nm_queue_resume(bts);
+		osmo_signal_dispatch(SS_NM, S_NM_BTS_BRINGUP_ADMITTED, bts);
+	}
+	bts_bringup_update_stats(net);
+}
+
+/*! The OML link of bts came up: take its turn for configuration.
+ * \returns true if the configuration may start right away, false if it will be started later by
+ *          S_NM_BTS_BRINGUP_ADMITTED. */
+bool bts_bringup_request(struct gsm_bts *bts)
+{
+	struct gsm_network *net = bts->network;
+	struct gsm_bts *pos;
+
+	switch (bts->bringup.state) {
+	case BTS_BRINGUP_WAITING:
+		return false;
+	case BTS_BRINGUP_ACTIVE:
+		return true;
+	default:
+		break;
+	}
+
+	if (bts_bringup_slot_free(net) && llist_empty(&net->bts_bringup.waiting)) {
+		bts_bringup_activate(bts);
+		bts_bringup_update_stats(net);
+		return true;
+	}
+
+	/* Behind all waiting BTS of the same or a higher priority */
+	llist_for_each_entry(pos, &net->bts_bringup.waiting, bringup.entry) {
+		if (pos->bringup.priority < bts->bringup.priority)
+			break;
+	}
+	llist_add_tail(&bts->bringup.entry, &pos->bringup.entry);
+	bts->bringup.state = BTS_BRINGUP_WAITING;
+	net->bts_bringup.num_waiting++;
+	LOG_BTS(bts, DNM, LOGL_NOTICE, "Bring-up: %u BTS being configured, waiting for a turn (%u waiting)\n",
+		net->bts_bringup.num_active, net->bts_bringup.num_waiting);
+	bts_bringup_update_stats(net);
+	return false;
+}
+
+/*! All TRX and timeslots of bts are running: let the next BTS proceed. */
+void bts_bringup_done(struct gsm_bts *bts)
+{
+	if (bts->bringup.state != BTS_BRINGUP_ACTIVE)
+		return;
+
+	rate_ctr_inc(&bts->network->bsc_ctrs->ctr[BSC_CTR_BTS_BRINGUP_COMPLETED]);
+	bts_bringup_release(bts);
+	bts_bringup_schedule(bts->network);
+}
+
+/*! The OML link of bts went down: give up its turn, or its place in the queue. */
+void bts_bringup_abort(struct gsm_bts *bts)
+{
+	struct gsm_network *net = bts->network;
+
+	switch (bts->bringup.state) {
+	case BTS_BRINGUP_WAITING:
+		llist_del_init(&bts->bringup.entry);
+		bts->bringup.state = BTS_BRINGUP_IDLE;
+		net->bts_bringup.num_waiting--;
+		bts_bringup_update_stats(net);
+		break;
+	case BTS_BRINGUP_ACTIVE:
+		bts_bringup_release(bts);
+		bts_bringup_schedule(net);
+		break;
+	default:
+		break;
+	}
+}
+
+/*! Whether the OML configuration of bts may be sent now. */
+bool bts_bringup_admitted(const struct gsm_bts *bts)
+{
+	return bts->bringup.state != BTS_BRINGUP_WAITING;
+}
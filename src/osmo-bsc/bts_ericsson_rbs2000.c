@@ -129,9 +129,11 @@ static int inp_sig_cb(unsigned int subsys, unsigned int signal,
 		case E1INP_SIGN_OML:
 			if (isd->trx->bts->type != GSM_BTS_TYPE_RBS2000)
 				break;
-			if (isd->tei == isd->trx->bts->oml_tei)
-				bootstrap_om_bts(isd->trx->bts);
-			else
+			if (isd->tei == isd->trx->bts->oml_tei) {
+				/* Otherwise, nm_sig_cb() bootstraps once it is the BTS's turn */
+				if (bts_bringup_request(isd->trx->bts))
+					bootstrap_om_bts(isd->trx->bts);
+			} else
 				bootstrap_om_trx(isd->trx);
 			break;
 		default:
@@ -171,6 +173,20 @@ static int inp_sig_cb(unsigned int subsys, unsigned int signal,
 	return 0;
 }
 
+static int nm_sig_cb(unsigned int subsys, unsigned int signal,
+		     void *handler_data, void *signal_data)
+{
+	struct gsm_bts *bts = signal_data;
+
+	if (subsys != SS_NM || signal != S_NM_BTS_BRINGUP_ADMITTED)
+		return 0;
+	if (bts->type != GSM_BTS_TYPE_RBS2000)
+		return 0;
+
+	bootstrap_om_bts(bts);
+	return 0;
+}
+
 static void config_write_bts(struct vty *vty, struct gsm_bts *bts)
 {
 	abis_om2k_config_write_bts(vty, bts);
@@ -205,6 +221,7 @@ static int bts_model_rbs2k_start(struct gsm_network *net)
 
 	osmo_signal_register_handler(SS_L_INPUT, inp_sig_cb, NULL);
 	osmo_signal_register_handler(SS_L_GLOBAL, gbl_sig_cb, NULL);
+	osmo_signal_register_handler(SS_NM, nm_sig_cb, NULL);
 
 	return 0;
 }
@@ -21,16 +21,132 @@
 
 #include <arpa/inet.h>
 #include <osmocom/core/msgb.h>
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/utils.h>
 #include <osmocom/bsc/gsm_data.h>
 #include <osmocom/bsc/abis_nm.h>
+#include <osmocom/bsc/bts_ipaccess_nanobts_omlattr.h>
+
+/* A nanoBTS gets the same attributes sent each time its OML link comes up. Each encoding is kept along with the
+ * parameters it was made from, and reused for as long as these parameters remain the same. So any configuration
+ * change that feeds into the attributes takes effect, without tracking where it is made. */
+
+/* Largest encoding, the BTS attributes take 57 bytes */
+#define NANOBTS_ATTR_MAX_LEN 96
+/* Largest parameter struct, that of the NSE attributes */
+#define NANOBTS_ATTR_MAX_PARAMS 20
+
+enum nanobts_attr_obj {
+	NANOBTS_ATTR_BTS,
+	NANOBTS_ATTR_NSE,
+	NANOBTS_ATTR_CELL,
+	NANOBTS_ATTR_NSVC,
+	_NANOBTS_ATTR_BTS_NUM,
+};
+
+struct nanobts_attr_cache {
+	uint8_t params[NANOBTS_ATTR_MAX_PARAMS];
+	uint8_t len;
+	uint8_t data[NANOBTS_ATTR_MAX_LEN];
+};
+
+struct nanobts_attr_bts_params {
+	uint8_t conn_fail_crit[2];
+	uint8_t ccch_load_ind_thresh;
+	uint8_t rach_b_thresh;
+	uint8_t rach_ldavg_slots[2];
+	uint8_t air_timer;
+	uint8_t bcch_arfcn[2];
+	uint8_t bsic;
+	uint8_t cgi[7];
+};
+
+struct nanobts_attr_nse_params {
+	uint16_t nsei;
+	uint8_t ns_timer[7];
+	uint8_t bssgp_timer[11];
+};
+
+struct nanobts_attr_cell_params {
+	uint8_t rac;
+	uint16_t bvci;
+	bool egprs;
+} __attribute__((packed));
+
+struct nanobts_attr_nsvc_params {
+	uint16_t nsvci;
+	uint16_t remote_port;
+	uint32_t remote_ip;
+	uint16_t local_port;
+} __attribute__((packed));
+
+struct nanobts_attr_radio_params {
+	uint8_t max_power_red;
+	uint16_t arfcn;
+} __attribute__((packed));
+
+/* The parameters are compared with memcmp(), so none of these structs may hold padding */
+osmo_static_assert(sizeof(struct nanobts_attr_bts_params) <= NANOBTS_ATTR_MAX_PARAMS, bts_params_size);
+osmo_static_assert(sizeof(struct nanobts_attr_nse_params) <= NANOBTS_ATTR_MAX_PARAMS, nse_params_size);
+osmo_static_assert(sizeof(struct nanobts_attr_cell_params) <= NANOBTS_ATTR_MAX_PARAMS, cell_params_size);
+osmo_static_assert(sizeof(struct nanobts_attr_nsvc_params) <= NANOBTS_ATTR_MAX_PARAMS, nsvc_params_size);
+osmo_static_assert(sizeof(struct nanobts_attr_radio_params) <= NANOBTS_ATTR_MAX_PARAMS, radio_params_size);
+
+static struct msgb *nanobts_attr_msgb_alloc(void)
+{
+	return msgb_alloc(1024, "nanobts_attr_bts");
+}
 
+/* Return a copy of the cached encoding if it was made from params, NULL otherwise */
+static struct msgb *nanobts_attr_cache_get(struct nanobts_attr_cache *cache, const void *params, size_t params_len)
+{
+	struct msgb *msgb;
 
-struct msgb *nanobts_attr_bts_get(struct gsm_bts *bts)
+	if (!cache || !cache->len || memcmp(cache->params, params, params_len))
+		return NULL;
+
+	msgb = nanobts_attr_msgb_alloc();
+	memcpy(msgb_put(msgb, cache->len), cache->data, cache->len);
+	return msgb;
+}
+
+static void nanobts_attr_cache_put(struct nanobts_attr_cache *cache, const void *params, size_t params_len,
+				   const struct msgb *msgb)
+{
+	if (!cache)
+		return;
+	if (msgb->len > sizeof(cache->data)) {
+		cache->len = 0;
+		return;
+	}
+	memset(cache->params, 0, sizeof(cache->params));
+	memcpy(cache->params, params, params_len);
+	memcpy(cache->data, msgb->data, msgb->len);
+	cache->len = msgb->len;
+}
+
+static struct nanobts_attr_cache *nanobts_attr_cache_bts(struct gsm_bts *bts, enum nanobts_attr_obj obj)
+{
+	if (!bts->nanobts_attr_cache)
+		bts->nanobts_attr_cache = talloc_zero_array(bts, struct nanobts_attr_cache, _NANOBTS_ATTR_BTS_NUM);
+	if (!bts->nanobts_attr_cache)
+		return NULL;
+	return &bts->nanobts_attr_cache[obj];
+}
+
+static struct nanobts_attr_cache *nanobts_attr_cache_trx(struct gsm_bts_trx *trx)
+{
+	if (!trx->nanobts_attr_cache)
+		trx->nanobts_attr_cache = talloc_zero(trx, struct nanobts_attr_cache);
+	return trx->nanobts_attr_cache;
+}
+
+
+static struct msgb *nanobts_attr_bts_encode(const struct nanobts_attr_bts_params *p)
 {
 	struct msgb *msgb;
 	uint8_t buf[256];
-	int rlt;
-	msgb = msgb_alloc(1024, "nanobts_attr_bts");
+	msgb = nanobts_attr_msgb_alloc();
 
 	memcpy(buf, "\x55\x5b\x61\x67\x6d\x73", 6);
 	msgb_tv_fixed_put(msgb, NM_ATT_INTERF_BOUND, 6, buf);
@@ -38,17 +154,7 @@ struct msgb *nanobts_attr_bts_get(struct gsm_bts *bts)
 	/* interference avg. period in numbers of SACCH multifr */
 	msgb_tv_put(msgb, NM_ATT_INTAVE_PARAM, 0x06);
 
-	rlt = gsm_bts_get_radio_link_timeout(bts);
-	if (rlt == -1) {
-		/* Osmocom extension: Use infinite radio link timeout */
-		buf[0] = 0xFF;
-		buf[1] = 0x00;
-	} else {
-		/* conn fail based on SACCH error rate */
-		buf[0] = 0x01;
-		buf[1] = rlt;
-	}
-	msgb_tl16v_put(msgb, NM_ATT_CONN_FAIL_CRIT, 2, buf);
+	msgb_tl16v_put(msgb, NM_ATT_CONN_FAIL_CRIT, 2, p->conn_fail_crit);
 
 	memcpy(buf, "\x1e\x24\x24\xa8\x34\x21\xa8", 7);
 	msgb_tv_fixed_put(msgb, NM_ATT_T200, 7, buf);
@@ -60,88 +166,138 @@ struct msgb *nanobts_attr_bts_get(struct gsm_bts *bts)
 	msgb_tv_fixed_put(msgb, NM_ATT_OVERL_PERIOD, 3, buf);
 
 	/* percent */
-	msgb_tv_put(msgb, NM_ATT_CCCH_L_T, bts->ccch_load_ind_thresh);
+	msgb_tv_put(msgb, NM_ATT_CCCH_L_T, p->ccch_load_ind_thresh);
 
 	/* seconds */
 	msgb_tv_put(msgb, NM_ATT_CCCH_L_I_P, 1);
 
 	/* busy threshold in - dBm */
-	buf[0] = 90;	/* -90 dBm as default "busy" threshold */
+	msgb_tv_put(msgb, NM_ATT_RACH_B_THRESH, p->rach_b_thresh);
+
+	msgb_tv_fixed_put(msgb, NM_ATT_LDAVG_SLOTS, 2, p->rach_ldavg_slots);
+
+	/* 10 milliseconds */
+	msgb_tv_put(msgb, NM_ATT_BTS_AIR_TIMER, p->air_timer);
+
+	/* 10 retransmissions of physical config */
+	msgb_tv_put(msgb, NM_ATT_NY1, 10);
+
+	msgb_tv_fixed_put(msgb, NM_ATT_BCCH_ARFCN, 2, p->bcch_arfcn);
+
+	msgb_tv_put(msgb, NM_ATT_BSIC, p->bsic);
+
+	msgb_tl16v_put(msgb, NM_ATT_IPACC_CGI, 7, p->cgi);
+
+	return msgb;
+}
+
+struct msgb *nanobts_attr_bts_get(struct gsm_bts *bts)
+{
+	struct nanobts_attr_cache *cache = nanobts_attr_cache_bts(bts, NANOBTS_ATTR_BTS);
+	struct nanobts_attr_bts_params p;
+	struct msgb *msgb;
+	int rlt;
+
+	memset(&p, 0, sizeof(p));
+
+	rlt = gsm_bts_get_radio_link_timeout(bts);
+	if (rlt == -1) {
+		/* Osmocom extension: Use infinite radio link timeout */
+		p.conn_fail_crit[0] = 0xFF;
+		p.conn_fail_crit[1] = 0x00;
+	} else {
+		/* conn fail based on SACCH error rate */
+		p.conn_fail_crit[0] = 0x01;
+		p.conn_fail_crit[1] = rlt;
+	}
+
+	p.ccch_load_ind_thresh = bts->ccch_load_ind_thresh;
+
+	p.rach_b_thresh = 90;	/* -90 dBm as default "busy" threshold */
 	if (bts->rach_b_thresh != -1)
-		buf[0] = bts->rach_b_thresh & 0xff;
-	msgb_tv_put(msgb, NM_ATT_RACH_B_THRESH, buf[0]);
+		p.rach_b_thresh = bts->rach_b_thresh & 0xff;
 
 	/* rach load averaging 1000 slots */
-	buf[0] = 0x03;
-	buf[1] = 0xe8;
+	p.rach_ldavg_slots[0] = 0x03;
+	p.rach_ldavg_slots[1] = 0xe8;
 	if (bts->rach_ldavg_slots != -1) {
-		buf[0] = (bts->rach_ldavg_slots >> 8) & 0x0f;
-		buf[1] = bts->rach_ldavg_slots & 0xff;
+		p.rach_ldavg_slots[0] = (bts->rach_ldavg_slots >> 8) & 0x0f;
+		p.rach_ldavg_slots[1] = bts->rach_ldavg_slots & 0xff;
 	}
-	msgb_tv_fixed_put(msgb, NM_ATT_LDAVG_SLOTS, 2, buf);
 
-	/* 10 milliseconds */
-	msgb_tv_put(msgb, NM_ATT_BTS_AIR_TIMER, osmo_tdef_get(bts->network->T_defs, 3105, OSMO_TDEF_MS, -1));
+	p.air_timer = osmo_tdef_get(bts->network->T_defs, 3105, OSMO_TDEF_MS, -1);
 
-	/* 10 retransmissions of physical config */
-	msgb_tv_put(msgb, NM_ATT_NY1, 10);
+	p.bcch_arfcn[0] = (bts->c0->arfcn >> 8) & 0x0f;
+	p.bcch_arfcn[1] = bts->c0->arfcn & 0xff;
 
-	buf[0] = (bts->c0->arfcn >> 8) & 0x0f;
-	buf[1] = bts->c0->arfcn & 0xff;
-	msgb_tv_fixed_put(msgb, NM_ATT_BCCH_ARFCN, 2, buf);
+	p.bsic = bts->bsic;
 
-	msgb_tv_put(msgb, NM_ATT_BSIC, bts->bsic);
+	abis_nm_ipaccess_cgi(p.cgi, bts);
 
-	abis_nm_ipaccess_cgi(buf, bts);
-	msgb_tl16v_put(msgb, NM_ATT_IPACC_CGI, 7, buf);
+	msgb = nanobts_attr_cache_get(cache, &p, sizeof(p));
+	if (msgb)
+		return msgb;
 
+	msgb = nanobts_attr_bts_encode(&p);
+	nanobts_attr_cache_put(cache, &p, sizeof(p), msgb);
 	return msgb;
 }
 
-struct msgb *nanobts_attr_nse_get(struct gsm_bts *bts)
+static struct msgb *nanobts_attr_nse_encode(const struct nanobts_attr_nse_params *p)
 {
 	struct msgb *msgb;
 	uint8_t buf[256];
-	msgb = msgb_alloc(1024, "nanobts_attr_bts");
+	msgb = nanobts_attr_msgb_alloc();
 
 	/* NSEI 925 */
-	buf[0] = bts->gprs.nse.nsei >> 8;
-	buf[1] = bts->gprs.nse.nsei & 0xff;
+	buf[0] = p->nsei >> 8;
+	buf[1] = p->nsei & 0xff;
 	msgb_tl16v_put(msgb, NM_ATT_IPACC_NSEI, 2, buf);
 
 	/* all timers in seconds */
-	OSMO_ASSERT(ARRAY_SIZE(bts->gprs.nse.timer) < sizeof(buf));
-	memcpy(buf, bts->gprs.nse.timer, ARRAY_SIZE(bts->gprs.nse.timer));
-	msgb_tl16v_put(msgb, NM_ATT_IPACC_NS_CFG, 7, buf);
+	msgb_tl16v_put(msgb, NM_ATT_IPACC_NS_CFG, 7, p->ns_timer);
 
-	/* all timers in seconds */
-	buf[0] = 3;	/* blockimg timer (T1) */
-	buf[1] = 3;	/* blocking retries */
-	buf[2] = 3;	/* unblocking retries */
-	buf[3] = 3;	/* reset timer (T2) */
-	buf[4] = 3;	/* reset retries */
-	buf[5] = 10;	/* suspend timer (T3) in 100ms */
-	buf[6] = 3;	/* suspend retries */
-	buf[7] = 10;	/* resume timer (T4) in 100ms */
-	buf[8] = 3;	/* resume retries */
-	buf[9] = 10;	/* capability update timer (T5) */
-	buf[10] = 3;	/* capability update retries */
-
-	OSMO_ASSERT(ARRAY_SIZE(bts->gprs.cell.timer) < sizeof(buf));
-	memcpy(buf, bts->gprs.cell.timer, ARRAY_SIZE(bts->gprs.cell.timer));
-	msgb_tl16v_put(msgb, NM_ATT_IPACC_BSSGP_CFG, 11, buf);
+	/* all timers in seconds:
+	 * blocking timer (T1), blocking retries, unblocking retries,
+	 * reset timer (T2), reset retries,
+	 * suspend timer (T3) in 100ms, suspend retries,
+	 * resume timer (T4) in 100ms, resume retries,
+	 * capability update timer (T5), capability update retries */
+	msgb_tl16v_put(msgb, NM_ATT_IPACC_BSSGP_CFG, 11, p->bssgp_timer);
 
 	return msgb;
 }
 
-struct msgb *nanobts_attr_cell_get(struct gsm_bts *bts)
+struct msgb *nanobts_attr_nse_get(struct gsm_bts *bts)
+{
+	struct nanobts_attr_cache *cache = nanobts_attr_cache_bts(bts, NANOBTS_ATTR_NSE);
+	struct nanobts_attr_nse_params p;
+	struct msgb *msgb;
+
+	memset(&p, 0, sizeof(p));
+	p.nsei = bts->gprs.nse.nsei;
+	osmo_static_assert(sizeof(p.ns_timer) == sizeof(bts->gprs.nse.timer), ns_timer_size);
+	memcpy(p.ns_timer, bts->gprs.nse.timer, sizeof(p.ns_timer));
+	osmo_static_assert(sizeof(p.bssgp_timer) == sizeof(bts->gprs.cell.timer), bssgp_timer_size);
+	memcpy(p.bssgp_timer, bts->gprs.cell.timer, sizeof(p.bssgp_timer));
+
+	msgb = nanobts_attr_cache_get(cache, &p, sizeof(p));
+	if (msgb)
+		return msgb;
+
+	msgb = nanobts_attr_nse_encode(&p);
+	nanobts_attr_cache_put(cache, &p, sizeof(p), msgb);
+	return msgb;
+}
+
+static struct msgb *nanobts_attr_cell_encode(const struct nanobts_attr_cell_params *p)
 {
 	struct msgb *msgb;
 	uint8_t buf[256];
-	msgb = msgb_alloc(1024, "nanobts_attr_bts");
+	msgb = nanobts_attr_msgb_alloc();
 
 	/* routing area code */
-	buf[0] = bts->gprs.rac;
+	buf[0] = p->rac;
 	msgb_tl16v_put(msgb, NM_ATT_IPACC_RAC, 1, buf);
 
 	buf[0] = 5;	/* repeat time (50ms) */
@@ -149,8 +305,8 @@ struct msgb *nanobts_attr_cell_get(struct gsm_bts *bts)
 	msgb_tl16v_put(msgb, NM_ATT_IPACC_GPRS_PAGING_CFG, 2, buf);
 
 	/* BVCI 925 */
-	buf[0] = bts->gprs.cell.bvci >> 8;
-	buf[1] = bts->gprs.cell.bvci & 0xff;
+	buf[0] = p->bvci >> 8;
+	buf[1] = p->bvci & 0xff;
 	msgb_tl16v_put(msgb, NM_ATT_IPACC_BVCI, 2, buf);
 
 	/* all timers in seconds, unless otherwise stated */
@@ -165,7 +321,7 @@ struct msgb *nanobts_attr_cell_get(struct gsm_bts *bts)
 	buf[8] = 15;	/* RLC CV countdown */
 	msgb_tl16v_put(msgb, NM_ATT_IPACC_RLC_CFG, 9, buf);
 
-	if (bts->gprs.mode == BTS_GPRS_EGPRS) {
+	if (p->egprs) {
 		buf[0] = 0x8f;
 		buf[1] = 0xff;
 	} else {
@@ -191,41 +347,101 @@ struct msgb *nanobts_attr_cell_get(struct gsm_bts *bts)
 	return msgb;
 }
 
-struct msgb *nanobts_attr_nscv_get(struct gsm_bts *bts)
+struct msgb *nanobts_attr_cell_get(struct gsm_bts *bts)
+{
+	struct nanobts_attr_cache *cache = nanobts_attr_cache_bts(bts, NANOBTS_ATTR_CELL);
+	struct nanobts_attr_cell_params p;
+	struct msgb *msgb;
+
+	memset(&p, 0, sizeof(p));
+	p.rac = bts->gprs.rac;
+	p.bvci = bts->gprs.cell.bvci;
+	p.egprs = (bts->gprs.mode == BTS_GPRS_EGPRS);
+
+	msgb = nanobts_attr_cache_get(cache, &p, sizeof(p));
+	if (msgb)
+		return msgb;
+
+	msgb = nanobts_attr_cell_encode(&p);
+	nanobts_attr_cache_put(cache, &p, sizeof(p), msgb);
+	return msgb;
+}
+
+static struct msgb *nanobts_attr_nscv_encode(const struct nanobts_attr_nsvc_params *p)
 {
 	struct msgb *msgb;
 	uint8_t buf[256];
-	msgb = msgb_alloc(1024, "nanobts_attr_bts");
+	msgb = nanobts_attr_msgb_alloc();
 
 	/* 925 */
-	buf[0] = bts->gprs.nsvc[0].nsvci >> 8;
-	buf[1] = bts->gprs.nsvc[0].nsvci & 0xff;
+	buf[0] = p->nsvci >> 8;
+	buf[1] = p->nsvci & 0xff;
 	msgb_tl16v_put(msgb, NM_ATT_IPACC_NSVCI, 2, buf);
 
 	/* remote udp port */
-	osmo_store16be(bts->gprs.nsvc[0].remote_port, &buf[0]);
+	osmo_store16be(p->remote_port, &buf[0]);
 	/* remote ip address */
-	osmo_store32be(bts->gprs.nsvc[0].remote_ip, &buf[2]);
+	osmo_store32be(p->remote_ip, &buf[2]);
 	/* local udp port */
-	osmo_store16be(bts->gprs.nsvc[0].local_port, &buf[6]);
+	osmo_store16be(p->local_port, &buf[6]);
 	msgb_tl16v_put(msgb, NM_ATT_IPACC_NS_LINK_CFG, 8, buf);
 
 	return msgb;
 }
 
-struct msgb *nanobts_attr_radio_get(struct gsm_bts *bts,
-				    struct gsm_bts_trx *trx)
+struct msgb *nanobts_attr_nscv_get(struct gsm_bts *bts)
+{
+	struct nanobts_attr_cache *cache = nanobts_attr_cache_bts(bts, NANOBTS_ATTR_NSVC);
+	struct nanobts_attr_nsvc_params p;
+	struct msgb *msgb;
+
+	memset(&p, 0, sizeof(p));
+	p.nsvci = bts->gprs.nsvc[0].nsvci;
+	p.remote_port = bts->gprs.nsvc[0].remote_port;
+	p.remote_ip = bts->gprs.nsvc[0].remote_ip;
+	p.local_port = bts->gprs.nsvc[0].local_port;
+
+	msgb = nanobts_attr_cache_get(cache, &p, sizeof(p));
+	if (msgb)
+		return msgb;
+
+	msgb = nanobts_attr_nscv_encode(&p);
+	nanobts_attr_cache_put(cache, &p, sizeof(p), msgb);
+	return msgb;
+}
+
+static struct msgb *nanobts_attr_radio_encode(const struct nanobts_attr_radio_params *p)
 {
 	struct msgb *msgb;
 	uint8_t buf[256];
-	msgb = msgb_alloc(1024, "nanobts_attr_bts");
+	msgb = nanobts_attr_msgb_alloc();
 
 	/* number of -2dB reduction steps / Pn */
-	msgb_tv_put(msgb, NM_ATT_RF_MAXPOWR_R, trx->max_power_red / 2);
+	msgb_tv_put(msgb, NM_ATT_RF_MAXPOWR_R, p->max_power_red);
 
-	buf[0] = trx->arfcn >> 8;
-	buf[1] = trx->arfcn & 0xff;
+	buf[0] = p->arfcn >> 8;
+	buf[1] = p->arfcn & 0xff;
 	msgb_tl16v_put(msgb, NM_ATT_ARFCN_LIST, 2, buf);
 
 	return msgb;
 }
+
+struct msgb *nanobts_attr_radio_get(struct gsm_bts *bts,
+				    struct gsm_bts_trx *trx)
+{
+	struct nanobts_attr_cache *cache = nanobts_attr_cache_trx(trx);
+	struct nanobts_attr_radio_params p;
+	struct msgb *msgb;
+
+	memset(&p, 0, sizeof(p));
+	p.max_power_red = trx->max_power_red / 2;
+	p.arfcn = trx->arfcn;
+
+	msgb = nanobts_attr_cache_get(cache, &p, sizeof(p));
+	if (msgb)
+		return msgb;
+
+	msgb = nanobts_attr_radio_encode(&p);
+	nanobts_attr_cache_put(cache, &p, sizeof(p), msgb);
+	return msgb;
+}
@@ -1476,6 +1476,11 @@ static void nokia_abis_nm_queue_send_next(struct gsm_bts *bts)
 {
 	int wait = 0;
 	struct msgb *msg;
+
+	/* wait for the bring-up scheduler, which resumes the queue */
+	if (!bts_bringup_admitted(bts))
+		return;
+
 	/* the queue is empty */
 	while (!llist_empty(&bts->abis_queue)) {
 		msg = msgb_dequeue(&bts->abis_queue);
@@ -0,0 +1,489 @@
+/* Persist the System Information of each BTS across restarts */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* When all BTS come up after a restart, the BSC generates the System Information of each of them from scratch,
+ * including the neighbor lists, which in automatic mode means looking at every other BTS. With 'warm-start snapshot
+ * PATH', the SI generated at startup are written to PATH, keyed by a hash of the parameters they were generated
+ * from. On the next start, a BTS whose configuration is unchanged takes its SI from the snapshot. Once the SI of a
+ * BTS are regenerated at runtime, e.g. for ACC ramping or from the VTY, the snapshot is no longer used for it. */
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <osmocom/core/linuxlist.h>
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/timer.h>
+#include <osmocom/gsm/sysinfo.h>
+
+#include <osmocom/bsc/bts_snapshot.h>
+#include <osmocom/bsc/debug.h>
+#include <osmocom/bsc/gsm_data.h>
+#include <osmocom/bsc/neighbor_ident.h>
+
+#define BTS_SNAPSHOT_MAGIC "OBSCSNAP"
+/* Increment whenever the file layout or what goes into the key changes */
+#define BTS_SNAPSHOT_VERSION 2
+/* Write the file this long after the last change, so that many BTS coming up cause only one write */
+#define BTS_SNAPSHOT_WRITE_DELAY_S 5
+
+struct bts_snapshot_file_hdr {
+	char magic[8];
+	uint32_t version;
+	/* the SI buffers are indexed by enum osmo_sysinfo_type, which may grow with libosmocore */
+	uint32_t max_sysinfo_type;
+	uint32_t num_snapshots;
+} __attribute__((packed));
+
+struct bts_snapshot {
+	struct llist_head entry;
+
+	/* written to the file as is, followed by the valid SI buffers */
+	struct {
+		uint8_t bts_nr;
+		uint64_t key;
+		/* the SI types generated from the configuration, and which of them are valid */
+		uint32_t si_gen;
+		uint32_t si_valid;
+		uint8_t si2q_count;
+		int16_t si_len[_MAX_SYSINFO_TYPE];
+		/* bit vectors computed while generating SI1, SI2 and SI5, also used to decode measurement reports */
+		uint8_t neigh_list[1024/8];
+		uint8_t si5_neigh_list[1024/8];
+		uint8_t cell_alloc[1024/8];
+	} __attribute__((packed)) hdr;
+
+	sysinfo_buf_t si[_MAX_SYSINFO_TYPE];
+	sysinfo_buf_t si2q[SI2Q_MAX_NUM];
+};
+
+static struct bts_snapshot *bts_snapshot_find(const struct gsm_network *net, uint8_t bts_nr)
+{
+	struct bts_snapshot *s;
+
+	llist_for_each_entry(s, &net->warm_start.snapshots, entry) {
+		if (s->hdr.bts_nr == bts_nr)
+			return s;
+	}
+	return NULL;
+}
+
+static uint64_t fnv1a(uint64_t h, const void *data, size_t len)
+{
+	const uint8_t *p = data;
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		h ^= p[i];
+		h *= 0x100000001b3ULL;
+	}
+	return h;
+}
+
+#define FNV1A_FIELD(h, field) fnv1a(h, &(field), sizeof(field))
+
+struct bts_snapshot_key_ni_data {
+	struct gsm_bts *bts;
+	uint64_t h;
+};
+
+static bool bts_snapshot_key_ni_cb(const struct neighbor_ident_key *key, const struct gsm0808_cell_id_list2 *val,
+				   void *cb_data)
+{
+	struct bts_snapshot_key_ni_data *data = cb_data;
+
+	if (key->from_bts == NEIGHBOR_IDENT_KEY_ANY_BTS || key->from_bts == data->bts->nr)
+		data->h = FNV1A_FIELD(data->h, key->arfcn);
+	return true;
+}
+
+/* Hash the fields of bts and its network that system_information.c generates the SI from. This runs twice for
+ * each TRX whose SI are set, so it goes by the fields themselves rather than by the configuration text. Pointers
+ * and padding must stay out of it, the key is compared across restarts. */
+static uint64_t bts_snapshot_key(struct gsm_bts *bts)
+{
+	const struct osmo_earfcn_si2q *e = &bts->si_common.si2quater_neigh_list;
+	struct bts_snapshot_key_ni_data ni_data;
+	uint32_t version = BTS_SNAPSHOT_VERSION;
+	uint64_t h = 0xcbf29ce484222325ULL;
+	struct gsm_bts_trx *trx;
+	struct gsm_bts *cur;
+	struct gsm_bts_ref *neigh;
+	struct gsm_lchan *cbch_lchan;
+	struct gsm48_chan_desc cd;
+	int i;
+
+	h = FNV1A_FIELD(h, version);
+
+	/* the network and the cell */
+	h = FNV1A_FIELD(h, bts->network->plmn.mcc);
+	h = FNV1A_FIELD(h, bts->network->plmn.mnc);
+	h = FNV1A_FIELD(h, bts->network->plmn.mnc_3_digits);
+	h = FNV1A_FIELD(h, bts->location_area_code);
+	h = FNV1A_FIELD(h, bts->cell_identity);
+	h = FNV1A_FIELD(h, bts->type);
+	h = FNV1A_FIELD(h, bts->band);
+	h = FNV1A_FIELD(h, bts->dtxu);
+	h = FNV1A_FIELD(h, bts->early_classmark_allowed);
+	h = FNV1A_FIELD(h, bts->early_classmark_allowed_3g);
+	h = FNV1A_FIELD(h, bts->force_combined_si_set);
+	h = FNV1A_FIELD(h, bts->force_combined_si);
+	h = FNV1A_FIELD(h, bts->bcch_change_mark);
+	h = FNV1A_FIELD(h, bts->gprs.mode);
+	h = FNV1A_FIELD(h, bts->gprs.rac);
+	h = FNV1A_FIELD(h, bts->gprs.net_ctrl_ord);
+	h = FNV1A_FIELD(h, bts->gprs.ctrl_ack_type_use_block);
+	h = FNV1A_FIELD(h, bts->gprs.egprs_pkt_chan_request);
+	h = FNV1A_FIELD(h, bts->_features_data);
+	h = FNV1A_FIELD(h, bts->acc_ramp.acc_ramping_enabled);
+	h = FNV1A_FIELD(h, bts->acc_ramp.barred_accs);
+
+	/* the SI parameters; cell_sel_par includes the MS max power, set before the SI */
+	h = FNV1A_FIELD(h, bts->si_common.rach_control);
+	h = FNV1A_FIELD(h, bts->si_common.ncc_permitted);
+	h = FNV1A_FIELD(h, bts->si_common.cell_sel_par);
+	h = FNV1A_FIELD(h, bts->si_common.cell_ro_sel_par);
+	h = FNV1A_FIELD(h, bts->si_common.cell_options);
+	h = FNV1A_FIELD(h, bts->si_common.chan_desc);
+
+	/* SI2quater: the EARFCN and UARFCN neighbors */
+	h = FNV1A_FIELD(h, e->length);
+	h = FNV1A_FIELD(h, e->prio);
+	h = FNV1A_FIELD(h, e->prio_valid);
+	h = FNV1A_FIELD(h, e->thresh_hi);
+	h = FNV1A_FIELD(h, e->thresh_lo);
+	h = FNV1A_FIELD(h, e->thresh_lo_valid);
+	h = FNV1A_FIELD(h, e->qrxlm);
+	h = FNV1A_FIELD(h, e->qrxlm_valid);
+	h = FNV1A_FIELD(h, bts->si_common.data.earfcn_list);
+	h = FNV1A_FIELD(h, bts->si_common.data.meas_bw_list);
+	h = FNV1A_FIELD(h, bts->si_common.uarfcn_length);
+	h = fnv1a(h, bts->si_common.data.uarfcn_list,
+		  bts->si_common.uarfcn_length * sizeof(bts->si_common.data.uarfcn_list[0]));
+	h = fnv1a(h, bts->si_common.data.scramble_list,
+		  bts->si_common.uarfcn_length * sizeof(bts->si_common.data.scramble_list[0]));
+
+	/* SI1 cell channel description: the ARFCNs of all TRX, including those hopped over */
+	llist_for_each_entry(trx, &bts->trx_list, list) {
+		h = FNV1A_FIELD(h, trx->arfcn);
+		for (i = 0; i < ARRAY_SIZE(trx->ts); i++)
+			h = FNV1A_FIELD(h, trx->ts[i].hopping.arfcns_data);
+	}
+
+	/* SI4 CBCH channel description */
+	cbch_lchan = gsm_bts_get_cbch(bts);
+	if (cbch_lchan) {
+		gsm48_lchan2chan_desc_as_configured(&cd, cbch_lchan);
+		h = FNV1A_FIELD(h, cd);
+	}
+
+	/* SI2 and SI5 neighbor lists: configured as is, or made up of the neighbor ARFCNs */
+	h = FNV1A_FIELD(h, bts->neigh_list_manual_mode);
+	if (bts->neigh_list_manual_mode != NL_MODE_AUTOMATIC) {
+		h = FNV1A_FIELD(h, bts->si_common.data.neigh_list);
+		h = FNV1A_FIELD(h, bts->si_common.data.si5_neigh_list);
+	} else {
+		if (llist_empty(&bts->local_neighbors)) {
+			llist_for_each_entry(cur, &bts->network->bts_list, list) {
+				if (cur != bts)
+					h = FNV1A_FIELD(h, cur->c0->arfcn);
+			}
+		} else {
+			llist_for_each_entry(neigh, &bts->local_neighbors, entry)
+				h = FNV1A_FIELD(h, neigh->bts->c0->arfcn);
+		}
+		ni_data = (struct bts_snapshot_key_ni_data){
+			.bts = bts,
+			.h = h,
+		};
+		neighbor_ident_iter(bts->network->neighbor_bss_cells, bts_snapshot_key_ni_cb, &ni_data);
+		h = ni_data.h;
+	}
+
+	return h;
+}
+
+static int bts_snapshot_write(struct gsm_network *net)
+{
+	struct bts_snapshot_file_hdr fh = {
+		.magic = BTS_SNAPSHOT_MAGIC,
+		.version = BTS_SNAPSHOT_VERSION,
+		.max_sysinfo_type = _MAX_SYSINFO_TYPE,
+		.num_snapshots = llist_count(&net->warm_start.snapshots),
+	};
+	struct bts_snapshot *s;
+	char *tmp_path;
+	FILE *f;
+	int i;
+	int rc = 0;
+
+	tmp_path = talloc_asprintf(net, "%s.new", net->warm_start.path);
+	if (!tmp_path)
+		return -ENOMEM;
+
+	f = fopen(tmp_path, "w");
+	if (!f) {
+		rc = -errno;
+		goto out;
+	}
+
+	if (fwrite(&fh, sizeof(fh), 1, f) != 1)
+		rc = -EIO;
+
+	llist_for_each_entry(s, &net->warm_start.snapshots, entry) {
+		if (rc)
+			break;
+		if (fwrite(&s->hdr, sizeof(s->hdr), 1, f) != 1) {
+			rc = -EIO;
+			break;
+		}
+		for (i = 0; i < _MAX_SYSINFO_TYPE; i++) {
+			if (!(s->hdr.si_gen & s->hdr.si_valid & (1 << i)))
+				continue;
+			if (i == SYSINFO_TYPE_2quater) {
+				if (fwrite(s->si2q, sizeof(sysinfo_buf_t), s->hdr.si2q_count + 1, f)
+				    != s->hdr.si2q_count + 1)
+					rc = -EIO;
+			} else if (fwrite(s->si[i], sizeof(sysinfo_buf_t), 1, f) != 1)
+				rc = -EIO;
+		}
+	}
+
+	if (fclose(f) && !rc)
+		rc = -EIO;
+	if (!rc && rename(tmp_path, net->warm_start.path))
+		rc = -errno;
+	if (rc)
+		unlink(tmp_path);
+out:
+	talloc_free(tmp_path);
+	return rc;
+}
+
+static void bts_snapshot_write_cb(void *data)
+{
+	struct gsm_network *net = data;
+	int rc;
+
+	if (!net->warm_start.path)
+		return;
+
+	rc = bts_snapshot_write(net);
+	if (rc)
+		LOGP(DRR, LOGL_ERROR, "Cannot write the warm start snapshot to %s: %s\n",
+		     net->warm_start.path, strerror(-rc));
+	else
+		LOGP(DRR, LOGL_INFO, "Wrote the System Information of %u BTS to %s\n",
+		     llist_count(&net->warm_start.snapshots), net->warm_start.path);
+}
+
+static int bts_snapshot_read(struct gsm_network *net, FILE *f)
+{
+	struct bts_snapshot_file_hdr fh;
+	struct bts_snapshot *s;
+	unsigned int n;
+	int i;
+
+	if (fread(&fh, sizeof(fh), 1, f) != 1)
+		return -EIO;
+	if (memcmp(fh.magic, BTS_SNAPSHOT_MAGIC, sizeof(fh.magic))
+	    || fh.version != BTS_SNAPSHOT_VERSION
+	    || fh.max_sysinfo_type != _MAX_SYSINFO_TYPE)
+		return -EINVAL;
+
+	for (n = 0; n < fh.num_snapshots; n++) {
+		s = talloc_zero(net, struct bts_snapshot);
+		if (!s)
+			return -ENOMEM;
+		llist_add_tail(&s->entry, &net->warm_start.snapshots);
+
+		if (fread(&s->hdr, sizeof(s->hdr), 1, f) != 1 || s->hdr.si2q_count >= SI2Q_MAX_NUM)
+			return -EIO;
+		for (i = 0; i < _MAX_SYSINFO_TYPE; i++) {
+			if (!(s->hdr.si_gen & s->hdr.si_valid & (1 << i)))
+				continue;
+			if (i == SYSINFO_TYPE_2quater) {
+				if (fread(s->si2q, sizeof(sysinfo_buf_t), s->hdr.si2q_count + 1, f)
+				    != s->hdr.si2q_count + 1)
+					return -EIO;
+			} else if (fread(s->si[i], sizeof(sysinfo_buf_t), 1, f) != 1)
+				return -EIO;
+		}
+	}
+	return 0;
+}
+
+static void bts_snapshot_clear(struct gsm_network *net)
+{
+	struct bts_snapshot *s, *s2;
+
+	llist_for_each_entry_safe(s, s2, &net->warm_start.snapshots, entry) {
+		llist_del(&s->entry);
+		talloc_free(s);
+	}
+}
+
+/*! Read the snapshot of the previous run from the 'warm-start snapshot' file, if configured.
+ * Call after reading the configuration, before the BTS come up.
+ * \returns 0 on success or when there is no snapshot to read, negative errno otherwise. */
+int bts_snapshot_load(struct gsm_network *net)
+{
+	FILE *f;
+	int rc;
+
+	if (!net->warm_start.path)
+		return 0;
+
+	f = fopen(net->warm_start.path, "r");
+	if (!f) {
+		if (errno == ENOENT) {
+			LOGP(DRR, LOGL_NOTICE, "No warm start snapshot in %s yet, generating all System Information\n",
+			     net->warm_start.path);
+			return 0;
+		}
+		rc = -errno;
+		LOGP(DRR, LOGL_ERROR, "Cannot read the warm start snapshot %s: %s\n",
+		     net->warm_start.path, strerror(-rc));
+		return rc;
+	}
+
+	rc = bts_snapshot_read(net, f);
+	fclose(f);
+	if (rc) {
+		LOGP(DRR, LOGL_ERROR, "Ignoring the warm start snapshot %s: %s\n", net->warm_start.path,
+		     rc == -EINVAL ? "written by a different version" : "truncated or unreadable");
+		bts_snapshot_clear(net);
+		return rc;
+	}
+
+	LOGP(DRR, LOGL_NOTICE, "Read the System Information of %u BTS from %s\n",
+	     llist_count(&net->warm_start.snapshots), net->warm_start.path);
+	return 0;
+}
+
+unsigned int bts_snapshot_count(const struct gsm_network *net)
+{
+	return llist_count(&net->warm_start.snapshots);
+}
+
+/*! Take the System Information of bts from the snapshot of the previous run, if its configuration is unchanged.
+ * \param[in] bts  BTS whose SI are about to be generated.
+ * \param[in] si_gen  Bitmask of the SI types to be generated.
+ * \param[out] si_len  Per SI type, the length that gsm_generate_si() would have returned.
+ * \returns true if the SI were taken from the snapshot, false if they need to be generated. */
+bool bts_snapshot_restore_si(struct gsm_bts *bts, uint32_t si_gen, int *si_len)
+{
+	struct gsm_network *net = bts->network;
+	struct bts_snapshot *s;
+	uint64_t key;
+	int i;
+
+	if (!net->warm_start.path || bts->warm_start_done)
+		return false;
+
+	s = bts_snapshot_find(net, bts->nr);
+	if (!s || (si_gen & ~s->hdr.si_gen))
+		return false;
+
+	key = bts_snapshot_key(bts);
+	if (key != s->hdr.key) {
+		LOG_BTS(bts, DRR, LOGL_INFO, "Configuration changed since the warm start snapshot,"
+			" generating System Information\n");
+		rate_ctr_inc(&net->bsc_ctrs->ctr[BSC_CTR_WARM_START_SI_STALE]);
+		return false;
+	}
+
+	for (i = 0; i < _MAX_SYSINFO_TYPE; i++) {
+		if (!(si_gen & (1 << i)))
+			continue;
+		si_len[i] = s->hdr.si_len[i];
+		if (!(s->hdr.si_valid & (1 << i)))
+			continue;
+		bts->si_valid |= (1 << i);
+		if (i == SYSINFO_TYPE_2quater) {
+			memcpy(bts->si_buf[i], s->si2q, sizeof(sysinfo_buf_t) * (s->hdr.si2q_count + 1));
+			bts->si2q_count = s->hdr.si2q_count;
+			bts->si2q_index = 0;
+		} else
+			memcpy(bts->si_buf[i][0], s->si[i], sizeof(sysinfo_buf_t));
+	}
+	memcpy(bts->si_common.data.neigh_list, s->hdr.neigh_list, sizeof(s->hdr.neigh_list));
+	memcpy(bts->si_common.data.si5_neigh_list, s->hdr.si5_neigh_list, sizeof(s->hdr.si5_neigh_list));
+	memcpy(bts->si_common.data.cell_alloc, s->hdr.cell_alloc, sizeof(s->hdr.cell_alloc));
+
+	LOG_BTS(bts, DRR, LOGL_DEBUG, "System Information taken from the warm start snapshot\n");
+	rate_ctr_inc(&net->bsc_ctrs->ctr[BSC_CTR_WARM_START_SI_REUSED]);
+	return true;
+}
+
+/*! Record the System Information just generated for bts in the snapshot for the next run.
+ * \param[in] bts  BTS whose SI were generated.
+ * \param[in] si_gen  Bitmask of the SI types generated.
+ * \param[in] si_len  Per SI type, the length returned by gsm_generate_si(). */
+void bts_snapshot_store_si(struct gsm_bts *bts, uint32_t si_gen, const int *si_len)
+{
+	struct gsm_network *net = bts->network;
+	struct bts_snapshot *s;
+	uint64_t key;
+	int i;
+
+	if (!net->warm_start.path || bts->warm_start_done)
+		return;
+
+	key = bts_snapshot_key(bts);
+
+	s = bts_snapshot_find(net, bts->nr);
+	if (!s) {
+		s = talloc_zero(net, struct bts_snapshot);
+		if (!s)
+			return;
+		s->hdr.bts_nr = bts->nr;
+		llist_add_tail(&s->entry, &net->warm_start.snapshots);
+	}
+
+	/* The C0 TRX adds SI1 to SI4 and SI13 to the SI5 and SI6 of the other TRX, keep them all */
+	if (s->hdr.key != key) {
+		s->hdr.key = key;
+		s->hdr.si_gen = 0;
+	}
+	s->hdr.si_gen |= si_gen;
+
+	for (i = 0; i < _MAX_SYSINFO_TYPE; i++) {
+		if (!(si_gen & (1 << i)))
+			continue;
+		s->hdr.si_len[i] = si_len[i];
+		if (!GSM_BTS_HAS_SI(bts, i)) {
+			s->hdr.si_valid &= ~(1 << i);
+			continue;
+		}
+		s->hdr.si_valid |= (1 << i);
+		if (i == SYSINFO_TYPE_2quater) {
+			memcpy(s->si2q, bts->si_buf[i], sizeof(sysinfo_buf_t) * (bts->si2q_count + 1));
+			s->hdr.si2q_count = bts->si2q_count;
+		} else
+			memcpy(s->si[i], bts->si_buf[i][0], sizeof(sysinfo_buf_t));
+	}
+	memcpy(s->hdr.neigh_list, bts->si_common.data.neigh_list, sizeof(s->hdr.neigh_list));
+	memcpy(s->hdr.si5_neigh_list, bts->si_common.data.si5_neigh_list, sizeof(s->hdr.si5_neigh_list));
+	memcpy(s->hdr.cell_alloc, bts->si_common.data.cell_alloc, sizeof(s->hdr.cell_alloc));
+
+	if (!osmo_timer_pending(&net->warm_start.write_timer)) {
+		osmo_timer_setup(&net->warm_start.write_timer, bts_snapshot_write_cb, net);
+		osmo_timer_schedule(&net->warm_start.write_timer, BTS_SNAPSHOT_WRITE_DELAY_S, 0);
+	}
+}
@@ -117,6 +117,13 @@ void network_chan_load(struct pchan_load *pl, struct gsm_network *net)
 		bts_chan_load(pl, bts);
 }
 
+/* Writing a gauge makes the stats reporter send it again, so skip the ones that keep their value */
+static void stat_item_set_if_changed(struct osmo_stat_item *item, int32_t value)
+{
+	if (osmo_stat_item_get_last(item) != value)
+		osmo_stat_item_set(item, value);
+}
+
 static void chan_load_stat_set(enum gsm_phys_chan_config pchan,
                                struct gsm_bts *bts,
                                struct load_counter *lc)
@@ -128,42 +135,96 @@ static void chan_load_stat_set(enum gsm_phys_chan_config pchan,
 	case GSM_PCHAN_UNKNOWN:
 		break;
 	case GSM_PCHAN_CCCH_SDCCH4:
-		osmo_stat_item_set(bts->bts_statg->items[BTS_STAT_CHAN_CCCH_SDCCH4_USED], lc->used);
-		osmo_stat_item_set(bts->bts_statg->items[BTS_STAT_CHAN_CCCH_SDCCH4_TOTAL], lc->total);
+		stat_item_set_if_changed(bts->bts_statg->items[BTS_STAT_CHAN_CCCH_SDCCH4_USED], lc->used);
+		stat_item_set_if_changed(bts->bts_statg->items[BTS_STAT_CHAN_CCCH_SDCCH4_TOTAL], lc->total);
 		break;
 	case GSM_PCHAN_TCH_F:
-		osmo_stat_item_set(bts->bts_statg->items[BTS_STAT_CHAN_TCH_F_USED], lc->used);
-		osmo_stat_item_set(bts->bts_statg->items[BTS_STAT_CHAN_TCH_F_TOTAL], lc->total);
+		stat_item_set_if_changed(bts->bts_statg->items[BTS_STAT_CHAN_TCH_F_USED], lc->used);
+		stat_item_set_if_changed(bts->bts_statg->items[BTS_STAT_CHAN_TCH_F_TOTAL], lc->total);
 		break;
 	case GSM_PCHAN_TCH_H:
-		osmo_stat_item_set(bts->bts_statg->items[BTS_STAT_CHAN_TCH_H_USED], lc->used);
-		osmo_stat_item_set(bts->bts_statg->items[BTS_STAT_CHAN_TCH_H_TOTAL], lc->total);
+		stat_item_set_if_changed(bts->bts_statg->items[BTS_STAT_CHAN_TCH_H_USED], lc->used);
+		stat_item_set_if_changed(bts->bts_statg->items[BTS_STAT_CHAN_TCH_H_TOTAL], lc->total);
 		break;
 	case GSM_PCHAN_SDCCH8_SACCH8C:
-		osmo_stat_item_set(bts->bts_statg->items[BTS_STAT_CHAN_SDCCH8_USED], lc->used);
-		osmo_stat_item_set(bts->bts_statg->items[BTS_STAT_CHAN_SDCCH8_TOTAL], lc->total);
+		stat_item_set_if_changed(bts->bts_statg->items[BTS_STAT_CHAN_SDCCH8_USED], lc->used);
+		stat_item_set_if_changed(bts->bts_statg->items[BTS_STAT_CHAN_SDCCH8_TOTAL], lc->total);
 		break;
 	case GSM_PCHAN_TCH_F_PDCH:
-		osmo_stat_item_set(bts->bts_statg->items[BTS_STAT_CHAN_TCH_F_PDCH_USED], lc->used);
-		osmo_stat_item_set(bts->bts_statg->items[BTS_STAT_CHAN_TCH_F_PDCH_TOTAL], lc->total);
+		stat_item_set_if_changed(bts->bts_statg->items[BTS_STAT_CHAN_TCH_F_PDCH_USED], lc->used);
+		stat_item_set_if_changed(bts->bts_statg->items[BTS_STAT_CHAN_TCH_F_PDCH_TOTAL], lc->total);
 		break;
 	case GSM_PCHAN_CCCH_SDCCH4_CBCH:
-		osmo_stat_item_set(bts->bts_statg->items[BTS_STAT_CHAN_CCCH_SDCCH4_CBCH_USED], lc->used);
-		osmo_stat_item_set(bts->bts_statg->items[BTS_STAT_CHAN_CCCH_SDCCH4_CBCH_TOTAL], lc->total);
+		stat_item_set_if_changed(bts->bts_statg->items[BTS_STAT_CHAN_CCCH_SDCCH4_CBCH_USED], lc->used);
+		stat_item_set_if_changed(bts->bts_statg->items[BTS_STAT_CHAN_CCCH_SDCCH4_CBCH_TOTAL], lc->total);
 		break;
 	case GSM_PCHAN_SDCCH8_SACCH8C_CBCH:
-		osmo_stat_item_set(bts->bts_statg->items[BTS_STAT_CHAN_SDCCH8_CBCH_USED], lc->used);
-		osmo_stat_item_set(bts->bts_statg->items[BTS_STAT_CHAN_SDCCH8_CBCH_TOTAL], lc->total);
+		stat_item_set_if_changed(bts->bts_statg->items[BTS_STAT_CHAN_SDCCH8_CBCH_USED], lc->used);
+		stat_item_set_if_changed(bts->bts_statg->items[BTS_STAT_CHAN_SDCCH8_CBCH_TOTAL], lc->total);
 		break;
 	case GSM_PCHAN_TCH_F_TCH_H_PDCH:
-		osmo_stat_item_set(bts->bts_statg->items[BTS_STAT_CHAN_TCH_F_TCH_H_PDCH_USED], lc->used);
-		osmo_stat_item_set(bts->bts_statg->items[BTS_STAT_CHAN_TCH_F_TCH_H_PDCH_TOTAL], lc->total);
+		stat_item_set_if_changed(bts->bts_statg->items[BTS_STAT_CHAN_TCH_F_TCH_H_PDCH_USED], lc->used);
+		stat_item_set_if_changed(bts->bts_statg->items[BTS_STAT_CHAN_TCH_F_TCH_H_PDCH_TOTAL], lc->total);
 		break;
 	default:
 		LOG_BTS(bts, DRLL, LOGL_NOTICE, "Unknown channel type %d\n", pchan);
 	}
 }
 
+/* Replace bts->chan_load_last by pchan, export the pchan types whose load changed to the stats gauges, and apply the
+ * difference to the network-wide sum. */
+static void bts_chan_load_publish(struct gsm_bts *bts, const struct load_counter *pchan)
+{
+	struct gsm_network *net = bts->network;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(bts->chan_load_last); i++) {
+		struct load_counter *last = &bts->chan_load_last[i];
+
+		if (pchan[i].used == last->used && pchan[i].total == last->total)
+			continue;
+
+		net->chan_load_last[i].used += pchan[i].used - last->used;
+		net->chan_load_last[i].total += pchan[i].total - last->total;
+		*last = pchan[i];
+		chan_load_stat_set(i, bts, last);
+	}
+}
+
+/*! Export the network-wide channel load, summed up from the samples of all BTS, to the BSC's stats gauges. */
+void network_chan_load_publish(struct gsm_network *net)
+{
+	struct load_counter tch = {}, sdcch = {};
+	struct load_counter *lc;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(net->chan_load_last); i++) {
+		switch (i) {
+		case GSM_PCHAN_TCH_F:
+		case GSM_PCHAN_TCH_H:
+		case GSM_PCHAN_TCH_F_PDCH:
+		case GSM_PCHAN_TCH_F_TCH_H_PDCH:
+			lc = &tch;
+			break;
+		case GSM_PCHAN_CCCH_SDCCH4:
+		case GSM_PCHAN_CCCH_SDCCH4_CBCH:
+		case GSM_PCHAN_SDCCH8_SACCH8C:
+		case GSM_PCHAN_SDCCH8_SACCH8C_CBCH:
+			lc = &sdcch;
+			break;
+		default:
+			continue;
+		}
+		lc->used += net->chan_load_last[i].used;
+		lc->total += net->chan_load_last[i].total;
+	}
+
+	stat_item_set_if_changed(net->bsc_statg->items[BSC_STAT_CHAN_TCH_USED], tch.used);
+	stat_item_set_if_changed(net->bsc_statg->items[BSC_STAT_CHAN_TCH_TOTAL], tch.total);
+	stat_item_set_if_changed(net->bsc_statg->items[BSC_STAT_CHAN_SDCCH_USED], sdcch.used);
+	stat_item_set_if_changed(net->bsc_statg->items[BSC_STAT_CHAN_SDCCH_TOTAL], sdcch.total);
+}
+
 /* Update T3122 wait indicator based on samples of BTS channel load. */
 void
 bts_update_t3122_chan_load(struct gsm_bts *bts)
@@ -179,18 +240,19 @@ bts_update_t3122_chan_load(struct gsm_bts *bts)
 
 	/* Ignore BTS that are not in operation, in order to not flood the log with "bogus channel load"
 	 * messages */
-	if (!trx_is_usable(bts->c0))
+	memset(&pl, 0, sizeof(pl));
+	if (!trx_is_usable(bts->c0)) {
+		bts_chan_load_publish(bts, pl.pchan);
 		return;
+	}
 
 	/* Sum up current load across all channels. */
-	memset(&pl, 0, sizeof(pl));
 	bts_chan_load(&pl, bts);
+	/* Export channel load to stats gauges */
+	bts_chan_load_publish(bts, pl.pchan);
 	for (i = 0; i < ARRAY_SIZE(pl.pchan); i++) {
 		struct load_counter *lc = &pl.pchan[i];
 
-		/* Export channel load to stats gauges */
-		chan_load_stat_set(i, bts, lc);
-
 		/* Ignore samples too large for fixed-point calculations (shouldn't happen). */
 		if (lc->used > UINT16_MAX || lc->total > UINT16_MAX) {
 			LOG_BTS(bts, DRLL, LOGL_NOTICE, "numbers in channel load sample "
@@ -237,7 +299,7 @@ bts_update_t3122_chan_load(struct gsm_bts *bts)
 		(load & 0xffffff00) >> 8, (load & 0xff) / 10);
 	bts->chan_load_avg = ((load & 0xffffff00) >> 8);
 	OSMO_ASSERT(bts->chan_load_avg <= 100);
-	osmo_stat_item_set(bts->bts_statg->items[BTS_STAT_CHAN_LOAD_AVERAGE], bts->chan_load_avg);
+	stat_item_set_if_changed(bts->bts_statg->items[BTS_STAT_CHAN_LOAD_AVERAGE], bts->chan_load_avg);
 
 	/* Calculate new T3122 wait indicator. */
 	wait_ind = ((used / total) * max_wait_ind);
@@ -249,5 +311,5 @@ bts_update_t3122_chan_load(struct gsm_bts *bts)
 
 	LOG_BTS(bts, DRLL, LOGL_DEBUG, "T3122 wait indicator set to %"PRIu64" seconds\n", wait_ind);
 	bts->T3122 = (uint8_t)wait_ind;
-	osmo_stat_item_set(bts->bts_statg->items[BTS_STAT_T3122], wait_ind);
+	stat_item_set_if_changed(bts->bts_statg->items[BTS_STAT_T3122], wait_ind);
 }
@@ -37,6 +37,8 @@
 
 #include <osmocom/bsc/osmo_bsc_sigtran.h>
 
+#include <inttypes.h>
+
 #define LOG_COMPL_L3(pdisc, mtype, loglevel, format, args...) \
 	LOGP(DRSL, loglevel, "%s %s: " format, gsm48_pdisc_name(pdisc), gsm48_pdisc_msgtype_name(pdisc, mtype), ##args)
 
@@ -178,7 +180,8 @@ static bool is_msc_usable(struct bsc_msc_data *msc, bool is_emerg)
  * a) If the subscriber was previously paged from a particular MSC, that MSC shall receive the Paging Response.
  * b) If the message contains an NRI indicating a particular MSC and the MSC is connected, that MSC shall handle this
  *    conn.
- * c) All other cases distribute the messages across connected MSCs in a round-robin fashion.
+ * c) All other cases distribute the messages across connected MSCs in a round-robin fashion, or with
+ *    'mscpool selection weighted', to the MSC with the least load relative to its weight.
  */
 static struct bsc_msc_data *bsc_find_msc(struct gsm_subscriber_connection *conn,
 				   struct msgb *msg)
@@ -192,11 +195,14 @@ static struct bsc_msc_data *bsc_find_msc(struct gsm_subscriber_connection *conn,
 	struct bsc_msc_data *msc_target = NULL;
 	struct bsc_msc_data *msc_round_robin_next = NULL;
 	struct bsc_msc_data *msc_round_robin_first = NULL;
+	struct bsc_msc_data *msc_weighted_best = NULL;
+	uint32_t neutral_latency_us = 0;
 	uint8_t round_robin_next_nr;
 	struct bsc_subscr *subscr;
 	bool is_emerg = false;
 	int16_t nri_v = -1;
 	bool is_null_nri = false;
+	const struct nri_lookup_entry *nri_entry = NULL;
 
 	if (msgb_l3len(msg) < sizeof(*gh)) {
 		LOGP(DRSL, LOGL_ERROR, "There is no GSM48 header here.\n");
@@ -257,17 +263,42 @@ static struct bsc_msc_data *bsc_find_msc(struct gsm_subscriber_connection *conn,
 				"This LU Request indicates a switch from another PLMN. Ignoring the TMSI's NRI.\n");
 			nri_v = -1;
 		} else {
-			is_null_nri = osmo_nri_v_matches_ranges(nri_v, net->null_nri_ranges);
+			nri_entry = nri_lookup(net, nri_v);
+			is_null_nri = nri_entry && nri_entry->null_nri;
 			if (is_null_nri)
 				LOG_NRI(LOGL_DEBUG, "this is a NULL-NRI\n");
 		}
 	}
 
+	/* If exactly one MSC serves this NRI, the lookup table tells which one, without matching the NRI against
+	 * each MSC's ranges below. Only overlapping NRI ranges need the full iteration, to fall back to the next
+	 * matching MSC when the first one is not usable. */
+	if (nri_entry && nri_entry->msc && !nri_entry->overlap) {
+		msc = nri_entry->msc;
+		if (!is_msc_usable(msc, is_emerg)) {
+			LOG_NRI(LOGL_DEBUG, "matches msc %d, but this MSC is currently not connected\n", msc->nr);
+			rate_ctr_inc(&msc->msc_ctrs->ctr[MSC_CTR_MSCPOOL_SUBSCR_ATTACH_LOST]);
+		} else if (is_null_nri) {
+			LOG_NRI(LOGL_DEBUG, "matches msc %d, but this NRI is also configured as NULL-NRI\n", msc->nr);
+		} else {
+			LOG_NRI(LOGL_DEBUG, "matches msc %d\n", msc->nr);
+			rate_ctr_inc(&msc->msc_ctrs->ctr[MSC_CTR_MSCPOOL_SUBSCR_KNOWN]);
+			if (is_emerg) {
+				rate_ctr_inc(&msc->msc_ctrs->ctr[MSC_CTR_MSCPOOL_EMERG_FORWARDED]);
+				rate_ctr_inc(&bsc_gsmnet->bsc_ctrs->ctr[BSC_CTR_MSCPOOL_EMERG_FORWARDED]);
+			}
+			return msc;
+		}
+	}
+
 	/* Iterate MSCs to find one that matches the extracted NRI, and the next round-robin target for the case no NRI
 	 * match is found. */
 	round_robin_next_nr = (is_emerg ? net->mscs_round_robin_next_emerg_nr : net->mscs_round_robin_next_nr);
+	if (net->mscpool_selection == MSCPOOL_SEL_WEIGHTED)
+		neutral_latency_us = osmo_msc_pool_neutral_latency(net);
 	llist_for_each_entry(msc, &net->mscs, entry) {
-		bool nri_matches_msc = (nri_v >= 0 && osmo_nri_v_matches_ranges(nri_v, msc->nri_ranges));
+		bool nri_matches_msc = (nri_entry && nri_entry->overlap
+					&& osmo_nri_v_matches_ranges(nri_v, msc->nri_ranges));
 
 		if (!is_msc_usable(msc, is_emerg)) {
 			if (nri_matches_msc) {
@@ -313,6 +344,9 @@ static struct bsc_msc_data *bsc_find_msc(struct gsm_subscriber_connection *conn,
 		if (msc->nr >= round_robin_next_nr
 		    && (!msc_round_robin_next || msc->nr < msc_round_robin_next->nr))
 			msc_round_robin_next = msc;
+		if (!msc_weighted_best
+		    || osmo_msc_pool_weighted_better(msc, msc_weighted_best, round_robin_next_nr, neutral_latency_us))
+			msc_weighted_best = msc;
 	}
 
 	if (nri_v >= 0 && !is_null_nri)
@@ -321,7 +355,10 @@ static struct bsc_msc_data *bsc_find_msc(struct gsm_subscriber_connection *conn,
 	/* No dedicated MSC found. Choose by round-robin.
 	 * If msc_round_robin_next is NULL, there are either no more MSCs at/after mscs_round_robin_next_nr, or none of
 	 * them are usable -- wrap to the start. */
-	msc_target = msc_round_robin_next ? : msc_round_robin_first;
+	if (net->mscpool_selection == MSCPOOL_SEL_WEIGHTED)
+		msc_target = msc_weighted_best;
+	else
+		msc_target = msc_round_robin_next ? : msc_round_robin_first;
 	if (!msc_target) {
 		LOG_COMPL_L3(pdisc, mtype, LOGL_ERROR, "%s%s: No suitable MSC for this Complete Layer 3 request found\n",
 			     osmo_mobile_identity_to_str_c(OTC_SELECT, &mi), is_emerg ? " FOR EMERGENCY CALL" : "");
@@ -331,8 +368,14 @@ static struct bsc_msc_data *bsc_find_msc(struct gsm_subscriber_connection *conn,
 		return NULL;
 	}
 
-	LOGP(DMSC, LOGL_DEBUG, "New subscriber %s: MSC round-robin selects msc %d\n",
-	     osmo_mobile_identity_to_str_c(OTC_SELECT, &mi), msc_target->nr);
+	if (net->mscpool_selection == MSCPOOL_SEL_WEIGHTED)
+		LOGP(DMSC, LOGL_DEBUG, "New subscriber %s: MSC weighted selection picks msc %d"
+		     " (weight %u, %u pending, %u active, CR-CC %" PRIu32 " us)\n",
+		     osmo_mobile_identity_to_str_c(OTC_SELECT, &mi), msc_target->nr, msc_target->pool_weight,
+		     msc_target->load.pending, msc_target->load.active, msc_target->load.cr_cc_latency_us);
+	else
+		LOGP(DMSC, LOGL_DEBUG, "New subscriber %s: MSC round-robin selects msc %d\n",
+		     osmo_mobile_identity_to_str_c(OTC_SELECT, &mi), msc_target->nr);
 
 	if (is_null_nri)
 		rate_ctr_inc(&msc_target->msc_ctrs->ctr[MSC_CTR_MSCPOOL_SUBSCR_REATTACH]);
@@ -390,6 +390,12 @@ static const struct osmo_stat_item_desc bts_stat_desc[] = {
 							  "Number of lchans in the BORKEN state", "", 16, 0 },
 	[BTS_STAT_TS_BORKEN] =				{ "ts_borken",
 							  "Number of timeslots in the BORKEN state", "", 16, 0 },
+	[BTS_STAT_CHREQ_QUEUE_LENGTH] =			{ "chreq:queue_length",
+							  "Channel requests waiting for admission", "", 16, 0 },
+	[BTS_STAT_OML_BRINGUP_TIME] =			{ "oml:bringup_time",
+							  "Time from OML link up until all TRX and timeslots were running", "ms", 16, 0 },
+	[BTS_STAT_OML_BRINGUP_MSGS] =			{ "oml:bringup_msgs",
+							  "OML messages sent during the last bring-up", "", 16, 0 },
 };
 
 static const struct osmo_stat_item_group_desc bts_statg_desc = {
@@ -699,6 +705,7 @@ struct gsm_bts_trx *gsm_bts_trx_alloc(struct gsm_bts *bts)
 
 	trx->bts = bts;
 	trx->nr = bts->num_trx++;
+	trx->name = talloc_asprintf(trx, "(bts=%d,trx=%d)", bts->nr, trx->nr);
 	trx->mo.nm_state.administrative = NM_STATE_UNLOCKED;
 
 	gsm_mo_init(&trx->mo, bts, NM_OC_RADIO_CARRIER,
@@ -795,8 +802,10 @@ struct gsm_bts *gsm_bts_alloc(struct gsm_network *net, uint8_t bts_num)
 		return NULL;
 
 	bts->nr = bts_num;
+	bts->name = talloc_asprintf(bts, "(bts=%d)", bts->nr);
 	bts->num_trx = 0;
 	INIT_LLIST_HEAD(&bts->trx_list);
+	INIT_LLIST_HEAD(&bts->chan_rqd.queue);
 	bts->network = net;
 
 	bts->ms_max_power = 15;	/* dBm */
@@ -850,6 +859,8 @@ struct gsm_bts *gsm_bts_alloc(struct gsm_network *net, uint8_t bts_num)
 
 	bts->paging.free_chans_need = -1;
 	INIT_LLIST_HEAD(&bts->paging.pending_requests);
+	for (i = 0; i < ARRAY_SIZE(bts->paging.groups); i++)
+		INIT_LLIST_HEAD(&bts->paging.groups[i]);
 
 	bts->features.data = &bts->_features_data[0];
 	bts->features.data_len = sizeof(bts->_features_data);
@@ -895,6 +906,7 @@ struct gsm_bts *gsm_bts_alloc(struct gsm_network *net, uint8_t bts_num)
 	gsm_bts_set_radio_link_timeout(bts, 32); /* Use RADIO LINK TIMEOUT of 32 */
 
 	INIT_LLIST_HEAD(&bts->abis_queue);
+	INIT_LLIST_HEAD(&bts->bringup.entry);
 	INIT_LLIST_HEAD(&bts->loc_list);
 	INIT_LLIST_HEAD(&bts->local_neighbors);
 	INIT_LLIST_HEAD(&bts->oml_fail_rep);
@@ -1013,22 +1025,15 @@ static char ts2str[255];
 char *gsm_bts_name(const struct gsm_bts *bts)
 {
 	if (!bts)
-		snprintf(ts2str, sizeof(ts2str), "(bts=NULL)");
-	else
-		snprintf(ts2str, sizeof(ts2str), "(bts=%d)", bts->nr);
-
-	return ts2str;
+		return "(bts=NULL)";
+	return bts->name;
 }
 
 char *gsm_trx_name(const struct gsm_bts_trx *trx)
 {
 	if (!trx)
-		snprintf(ts2str, sizeof(ts2str), "(trx=NULL)");
-	else
-		snprintf(ts2str, sizeof(ts2str), "(bts=%d,trx=%d)",
-			 trx->bts->nr, trx->nr);
-
-	return ts2str;
+		return "(trx=NULL)";
+	return trx->name;
 }
 
 
@@ -1840,3 +1845,24 @@ bool trx_has_valid_pchan_config(const struct gsm_bts_trx *trx)
 
 	return result;
 }
+
+/*! Return the measurement history of lchan, allocating it on first use.
+ * \returns the history, or NULL if out of memory. */
+struct gsm_lchan_meas *lchan_meas_get(struct gsm_lchan *lchan)
+{
+	if (lchan->meas)
+		return lchan->meas;
+
+	lchan->meas = talloc_zero(lchan->ts->trx, struct gsm_lchan_meas);
+	if (!lchan->meas)
+		return NULL;
+	lchan->meas->meas_rep_last_seen_nr = 255;
+	return lchan->meas;
+}
+
+/*! Drop the measurement history of lchan, when the lchan is released. */
+void lchan_meas_free(struct gsm_lchan *lchan)
+{
+	talloc_free(lchan->meas);
+	lchan->meas = NULL;
+}
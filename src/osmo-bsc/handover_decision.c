@@ -89,15 +89,15 @@ static struct neigh_meas_proc *find_evict_neigh(struct gsm_lchan *lchan)
 	struct neigh_meas_proc *nmp_worst = NULL;
 
 	/* first try to find an empty/unused slot */
-	for (j = 0; j < ARRAY_SIZE(lchan->neigh_meas); j++) {
-		struct neigh_meas_proc *nmp = &lchan->neigh_meas[j];
+	for (j = 0; j < ARRAY_SIZE(lchan->meas->neigh_meas); j++) {
+		struct neigh_meas_proc *nmp = &lchan->meas->neigh_meas[j];
 		if (!nmp->arfcn)
 			return nmp;
 	}
 
 	/* no empty slot found. evict worst neighbor from list */
-	for (j = 0; j < ARRAY_SIZE(lchan->neigh_meas); j++) {
-		struct neigh_meas_proc *nmp = &lchan->neigh_meas[j];
+	for (j = 0; j < ARRAY_SIZE(lchan->meas->neigh_meas); j++) {
+		struct neigh_meas_proc *nmp = &lchan->meas->neigh_meas[j];
 		int avg = neigh_meas_avg(nmp, MAX_WIN_NEIGH_AVG);
 		if (!nmp_worst || avg < worst) {
 			worst = avg;
@@ -114,8 +114,8 @@ static void process_meas_neigh(struct gsm_meas_rep *mr)
 	int i, j, idx;
 
 	/* for each reported cell, try to update global state */
-	for (j = 0; j < ARRAY_SIZE(mr->lchan->neigh_meas); j++) {
-		struct neigh_meas_proc *nmp = &mr->lchan->neigh_meas[j];
+	for (j = 0; j < ARRAY_SIZE(mr->lchan->meas->neigh_meas); j++) {
+		struct neigh_meas_proc *nmp = &mr->lchan->meas->neigh_meas[j];
 		unsigned int idx;
 		int rxlev;
 
@@ -172,8 +172,8 @@ static void attempt_handover(struct gsm_meas_rep *mr)
 	/* find the best cell in this report that is at least RXLEV_HYST
 	 * better than the current serving cell */
 
-	for (i = 0; i < ARRAY_SIZE(mr->lchan->neigh_meas); i++) {
-		struct neigh_meas_proc *nmp = &mr->lchan->neigh_meas[i];
+	for (i = 0; i < ARRAY_SIZE(mr->lchan->meas->neigh_meas); i++) {
+		struct neigh_meas_proc *nmp = &mr->lchan->meas->neigh_meas[i];
 		int avg, better;
 
 		/* skip empty slots */
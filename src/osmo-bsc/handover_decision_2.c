@@ -268,16 +268,16 @@ static struct neigh_meas_proc *find_unused_or_worst_neigh(struct gsm_lchan *lcha
 	int j;
 
 	/* First try to find an empty/unused slot. */
-	for (j = 0; j < ARRAY_SIZE(lchan->neigh_meas); j++) {
-		struct neigh_meas_proc *nmp = &lchan->neigh_meas[j];
+	for (j = 0; j < ARRAY_SIZE(lchan->meas->neigh_meas); j++) {
+		struct neigh_meas_proc *nmp = &lchan->meas->neigh_meas[j];
 		if (!nmp->arfcn)
 			return nmp;
 	}
 
 	/* No empty slot found. Return worst neighbor to be evicted. */
 	worst = 0; /* (overwritten on first loop, but avoid compiler warning) */
-	for (j = 0; j < ARRAY_SIZE(lchan->neigh_meas); j++) {
-		struct neigh_meas_proc *nmp = &lchan->neigh_meas[j];
+	for (j = 0; j < ARRAY_SIZE(lchan->meas->neigh_meas); j++) {
+		struct neigh_meas_proc *nmp = &lchan->meas->neigh_meas[j];
 		int avg = neigh_meas_avg(nmp, MAX_WIN_NEIGH_AVG);
 		if (nmp_worst && avg >= worst)
 			continue;
@@ -294,8 +294,8 @@ static void process_meas_neigh(struct gsm_meas_rep *mr)
 	int i, j, idx;
 
 	/* For each reported cell, try to update measurements we already have from previous reports. */
-	for (j = 0; j < ARRAY_SIZE(mr->lchan->neigh_meas); j++) {
-		struct neigh_meas_proc *nmp = &mr->lchan->neigh_meas[j];
+	for (j = 0; j < ARRAY_SIZE(mr->lchan->meas->neigh_meas); j++) {
+		struct neigh_meas_proc *nmp = &mr->lchan->meas->neigh_meas[j];
 		unsigned int idx;
 		struct gsm_meas_rep_cell *mrc;
 
@@ -893,10 +893,10 @@ static void collect_handover_candidate(struct gsm_lchan *lchan, struct neigh_mea
 		(*neighbors_count)++;
 
 	/* skip if measurement report is old */
-	if (nmp->last_seen_nr != lchan->meas_rep_last_seen_nr) {
+	if (nmp->last_seen_nr != lchan->meas->meas_rep_last_seen_nr) {
 		LOGPHOLCHAN(lchan, LOGL_DEBUG, "neighbor ARFCN %u BSIC %u measurement report is old"
-			    " (nmp->last_seen_nr=%u lchan->meas_rep_last_seen_nr=%u)\n",
-			    nmp->arfcn, nmp->bsic, nmp->last_seen_nr, lchan->meas_rep_last_seen_nr);
+			    " (nmp->last_seen_nr=%u lchan->meas->meas_rep_last_seen_nr=%u)\n",
+			    nmp->arfcn, nmp->bsic, nmp->last_seen_nr, lchan->meas->meas_rep_last_seen_nr);
 		return;
 	}
 
@@ -994,7 +994,7 @@ static void collect_candidates_for_lchan(struct gsm_lchan *lchan,
 	if (av_rxlev < 0) {
 		LOGPHOLCHAN(lchan, LOGL_DEBUG, "Not collecting candidates, not enough measurements"
 			    " (got %d, want %u)\n",
-			    lchan->meas_rep_count, rxlev_avg_win);
+			    lchan->meas ? lchan->meas->meas_rep_count : 0, rxlev_avg_win);
 		return;
 	}
 
@@ -1006,8 +1006,8 @@ static void collect_candidates_for_lchan(struct gsm_lchan *lchan,
 
 	if (handover) {
 		int i;
-		for (i = 0; i < ARRAY_SIZE(lchan->neigh_meas); i++) {
-			collect_handover_candidate(lchan, &lchan->neigh_meas[i],
+		for (i = 0; i < ARRAY_SIZE(lchan->meas->neigh_meas); i++) {
+			collect_handover_candidate(lchan, &lchan->meas->neigh_meas[i],
 						   clist, candidates,
 						   include_weaker_rxlev, av_rxlev, &neighbors_count);
 		}
@@ -1071,7 +1071,7 @@ static int find_alternative_lchan(struct gsm_lchan *lchan, bool include_weaker_r
 	int ahs = (lchan->tch_mode == GSM48_CMODE_SPEECH_AMR
 		   && lchan->type == GSM_LCHAN_TCH_H);
 	int av_rxlev;
-	struct ho_candidate clist[1 + ARRAY_SIZE(lchan->neigh_meas)];
+	struct ho_candidate clist[1 + ARRAY_SIZE(lchan->meas->neigh_meas)];
 	unsigned int candidates = 0;
 	int i;
 	struct ho_candidate *best_cand = NULL;
@@ -1325,7 +1325,7 @@ static void on_measurement_report(struct gsm_meas_rep *mr)
 	}
 
 	/* Max Distance */
-	if (lchan->meas_rep_count > 0
+	if (lchan->meas && lchan->meas->meas_rep_count > 0
 	    && lchan->rqd_ta > ho_get_hodec2_max_distance(bts->ho)) {
 		global_ho_reason = HO_REASON_MAX_DISTANCE;
 		LOGPHOLCHAN(lchan, LOGL_NOTICE, "TA is TOO HIGH: %u > %d\n",
@@ -1425,7 +1425,7 @@ static int bts_resolve_congestion(struct gsm_bts *bts, int tchf_congestion, int
 
 	/* allocate array of all bts */
 	clist = talloc_zero_array(tall_bsc_ctx, struct ho_candidate,
-		bts->num_trx * 8 * 2 * (1 + ARRAY_SIZE(lc->neigh_meas)));
+		bts->num_trx * 8 * 2 * (1 + ARRAY_SIZE(lc->meas->neigh_meas)));
 	if (!clist)
 		return 0;
 
@@ -391,6 +391,7 @@ static void lchan_reset(struct gsm_lchan *lchan)
 		osmo_mgcpc_ep_ci_dlcx(lchan->mgw_endpoint_ci_bts);
 		lchan->mgw_endpoint_ci_bts = NULL;
 	}
+	lchan_meas_free(lchan);
 
 	/* NUL all volatile state */
 	*lchan = (struct gsm_lchan){
@@ -399,8 +400,6 @@ static void lchan_reset(struct gsm_lchan *lchan)
 		.fi = lchan->fi,
 		.name = lchan->name,
 
-		.meas_rep_last_seen_nr = 255,
-
 		.last_error = lchan->last_error,
 	};
 }
@@ -823,6 +822,12 @@ static void lchan_fsm_wait_rll_rtp_establish(struct osmo_fsm_inst *fi, uint32_t
 			   osmo_fsm_inst_state_name(fi));
 		return;
 
+	case LCHAN_EV_IMM_ASS_FAILED:
+		/* The Immediate Assignment was held back for the AGCH, see rsl_tx_imm_assignment() */
+		lchan_fail("Failed to Tx RR Immediate Assignment message (rc=%d %s)\n",
+			   *(int *)data, strerror(-*(int *)data));
+		return;
+
 	default:
 		OSMO_ASSERT(false);
 	}
@@ -1208,6 +1213,7 @@ static const struct osmo_fsm_state lchan_fsm_states[] = {
 			| S(LCHAN_EV_RTP_READY)
 			| S(LCHAN_EV_RTP_ERROR)
 			| S(LCHAN_EV_RTP_RELEASED)
+			| S(LCHAN_EV_IMM_ASS_FAILED)
 			,
 		.out_state_mask = 0
 			| S(LCHAN_ST_UNUSED)
@@ -1317,6 +1323,7 @@ static const struct value_string lchan_fsm_event_names[] = {
 	OSMO_VALUE_STRING(LCHAN_EV_RLL_REL_CONF),
 	OSMO_VALUE_STRING(LCHAN_EV_RSL_RF_CHAN_REL_ACK),
 	OSMO_VALUE_STRING(LCHAN_EV_RLL_ERR_IND),
+	OSMO_VALUE_STRING(LCHAN_EV_IMM_ASS_FAILED),
 	OSMO_VALUE_STRING(LCHAN_EV_CHAN_MODE_MODIF_ACK),
 	OSMO_VALUE_STRING(LCHAN_EV_CHAN_MODE_MODIF_ERROR),
 	{}
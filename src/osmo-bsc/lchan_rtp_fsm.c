@@ -30,6 +30,7 @@
 #include <osmocom/bsc/bsc_subscr_conn_fsm.h>
 #include <osmocom/bsc/abis_rsl.h>
 #include <osmocom/bsc/bsc_msc_data.h>
+#include <osmocom/bsc/mgw_pool.h>
 
 static struct osmo_fsm lchan_rtp_fsm;
 
@@ -132,6 +133,15 @@ struct osmo_mgcpc_ep_ci *lchan_use_mgw_endpoint_ci_bts(struct gsm_lchan *lchan)
 	return NULL;
 }
 
+/* Report the outcome of the CRCX towards the MGW to the MGW pool, if still pending. */
+static void lchan_rtp_mgw_crcx_done(struct gsm_lchan *lchan, enum mgw_pool_crcx_result result)
+{
+	if (!lchan->mgw_crcx.member)
+		return;
+	mgw_pool_member_crcx_result(lchan->mgw_crcx.member, &lchan->mgw_crcx.sent, result);
+	lchan->mgw_crcx.member = NULL;
+}
+
 static void lchan_rtp_fsm_wait_mgw_endpoint_available_onenter(struct osmo_fsm_inst *fi,
 							      uint32_t prev_state)
 {
@@ -163,6 +173,12 @@ static void lchan_rtp_fsm_wait_mgw_endpoint_available_onenter(struct osmo_fsm_in
 	crcx_info.ptime = 20;
 	mgcp_pick_codec(&crcx_info, lchan, true);
 
+	if (lchan->conn && lchan->conn->user_plane.mgw_pool_member) {
+		lchan->mgw_crcx.member = lchan->conn->user_plane.mgw_pool_member;
+		osmo_clock_gettime(CLOCK_MONOTONIC, &lchan->mgw_crcx.sent);
+		mgw_pool_member_crcx_sent(lchan->mgw_crcx.member);
+	}
+
 	osmo_mgcpc_ep_ci_request(lchan->mgw_endpoint_ci_bts, MGCP_VERB_CRCX, &crcx_info,
 				fi, LCHAN_RTP_EV_MGW_ENDPOINT_AVAILABLE, LCHAN_RTP_EV_MGW_ENDPOINT_ERROR,
 				0);
@@ -176,6 +192,7 @@ static void lchan_rtp_fsm_wait_mgw_endpoint_available(struct osmo_fsm_inst *fi,
 	case LCHAN_RTP_EV_MGW_ENDPOINT_AVAILABLE:
 		LOG_LCHAN_RTP(lchan, LOGL_DEBUG, "MGW endpoint: %s\n",
 			      osmo_mgcpc_ep_ci_name(lchan_use_mgw_endpoint_ci_bts(lchan)));
+		lchan_rtp_mgw_crcx_done(lchan, MGW_POOL_CRCX_SUCCESS);
 		lchan_rtp_fsm_state_chg(LCHAN_RTP_ST_WAIT_LCHAN_READY);
 		return;
 
@@ -185,6 +202,7 @@ static void lchan_rtp_fsm_wait_mgw_endpoint_available(struct osmo_fsm_inst *fi,
 		return;
 
 	case LCHAN_RTP_EV_MGW_ENDPOINT_ERROR:
+		lchan_rtp_mgw_crcx_done(lchan, MGW_POOL_CRCX_FAILURE);
 		lchan_rtp_fail("Failure to create MGW endpoint");
 		return;
 
@@ -732,6 +750,7 @@ static const struct value_string lchan_rtp_fsm_event_names[] = {
 int lchan_rtp_fsm_timer_cb(struct osmo_fsm_inst *fi)
 {
 	struct gsm_lchan *lchan = lchan_rtp_fi_lchan(fi);
+	lchan_rtp_mgw_crcx_done(lchan, MGW_POOL_CRCX_FAILURE);
 	lchan->release.in_error = true;
 	lchan->release.rsl_error_cause = RSL_ERR_EQUIPMENT_FAIL;
 	lchan_rtp_fail("Timeout");
@@ -741,6 +760,7 @@ int lchan_rtp_fsm_timer_cb(struct osmo_fsm_inst *fi)
 void lchan_rtp_fsm_cleanup(struct osmo_fsm_inst *fi, enum osmo_fsm_term_cause cause)
 {
 	struct gsm_lchan *lchan = lchan_rtp_fi_lchan(fi);
+	lchan_rtp_mgw_crcx_done(lchan, MGW_POOL_CRCX_ABORTED);
 	if (lchan->mgw_endpoint_ci_bts) {
 		osmo_mgcpc_ep_ci_dlcx(lchan->mgw_endpoint_ci_bts);
 		lchan->mgw_endpoint_ci_bts = NULL;
@@ -759,6 +779,7 @@ void lchan_forget_mgw_endpoint(struct gsm_lchan *lchan)
 {
 	if (!lchan)
 		return;
+	lchan_rtp_mgw_crcx_done(lchan, MGW_POOL_CRCX_ABORTED);
 	lchan->mgw_endpoint_ci_bts = NULL;
 }
 
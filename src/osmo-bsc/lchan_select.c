@@ -31,17 +31,21 @@
 
 static struct gsm_lchan *
 _lc_find_trx(struct gsm_bts_trx *trx, enum gsm_phys_chan_config pchan,
-	     enum gsm_phys_chan_config as_pchan)
+	     enum gsm_phys_chan_config as_pchan, bool skip_pdch)
 {
 	struct gsm_lchan *lchan;
 	struct gsm_bts_trx_ts *ts;
 	int j, start, stop, dir;
+	/* look up the log level once instead of for each timeslot and lchan */
+	bool log_debug = LOG_ENABLED(DRLL, LOGL_DEBUG);
 
-#define LOGPLCHANALLOC(fmt, args...) \
-		LOGP(DRLL, LOGL_DEBUG, "looking for lchan %s%s%s: " fmt, \
-		     gsm_pchan_name(pchan), \
-		     pchan == as_pchan ? "" : " as ", \
-		     pchan == as_pchan ? "" : gsm_pchan_name(as_pchan), ## args)
+#define LOGPLCHANALLOC(fmt, args...) do { \
+		if (log_debug) \
+			LOGP(DRLL, LOGL_DEBUG, "looking for lchan %s%s%s: " fmt, \
+			     gsm_pchan_name(pchan), \
+			     pchan == as_pchan ? "" : " as ", \
+			     pchan == as_pchan ? "" : gsm_pchan_name(as_pchan), ## args); \
+	} while (0)
 
 	if (!trx_is_usable(trx)) {
 		LOGPLCHANALLOC("%s trx not usable\n", gsm_trx_name(trx));
@@ -71,6 +75,12 @@ _lc_find_trx(struct gsm_bts_trx *trx, enum gsm_phys_chan_config pchan,
 				       gsm_pchan_name(pchan));
 			continue;
 		}
+		/* On the first pass over dynamic timeslots, leave those in PDCH mode for later */
+		if (skip_pdch && ts_is_pdch_mode(ts)) {
+			LOGPLCHANALLOC("%s is in PDCH mode, first trying timeslots that are ready\n",
+				       gsm_ts_and_pchan_name(ts));
+			continue;
+		}
 		/* Next, is this timeslot in or can it be switched to the pchan we want to use it for? */
 		if (!ts_usable_as_pchan(ts, as_pchan)) {
 			LOGPLCHANALLOC("%s is not usable as %s\n", gsm_ts_and_pchan_name(ts),
@@ -98,21 +108,21 @@ _lc_find_trx(struct gsm_bts_trx *trx, enum gsm_phys_chan_config pchan,
 }
 
 static struct gsm_lchan *
-_lc_dyn_find_bts(struct gsm_bts *bts, enum gsm_phys_chan_config pchan,
-		 enum gsm_phys_chan_config dyn_as_pchan)
+_lc_find_bts_pass(struct gsm_bts *bts, enum gsm_phys_chan_config pchan,
+		  enum gsm_phys_chan_config dyn_as_pchan, bool skip_pdch)
 {
 	struct gsm_bts_trx *trx;
 	struct gsm_lchan *lc;
 
 	if (bts->chan_alloc_reverse) {
 		llist_for_each_entry_reverse(trx, &bts->trx_list, list) {
-			lc = _lc_find_trx(trx, pchan, dyn_as_pchan);
+			lc = _lc_find_trx(trx, pchan, dyn_as_pchan, skip_pdch);
 			if (lc)
 				return lc;
 		}
 	} else {
 		llist_for_each_entry(trx, &bts->trx_list, list) {
-			lc = _lc_find_trx(trx, pchan, dyn_as_pchan);
+			lc = _lc_find_trx(trx, pchan, dyn_as_pchan, skip_pdch);
 			if (lc)
 				return lc;
 		}
@@ -121,10 +131,26 @@ _lc_dyn_find_bts(struct gsm_bts *bts, enum gsm_phys_chan_config pchan,
 	return NULL;
 }
 
+static struct gsm_lchan *
+_lc_dyn_find_bts(struct gsm_bts *bts, enum gsm_phys_chan_config pchan,
+		 enum gsm_phys_chan_config dyn_as_pchan)
+{
+	struct gsm_lchan *lc;
+
+	/* With a dyn-ts-reserve, prefer the timeslots kept ready for TCH over those that need a PDCH
+	 * deactivation first */
+	if (bts->dyn_ts_reserve.num) {
+		lc = _lc_find_bts_pass(bts, pchan, dyn_as_pchan, true);
+		if (lc)
+			return lc;
+	}
+	return _lc_find_bts_pass(bts, pchan, dyn_as_pchan, false);
+}
+
 static struct gsm_lchan *
 _lc_find_bts(struct gsm_bts *bts, enum gsm_phys_chan_config pchan)
 {
-	return _lc_dyn_find_bts(bts, pchan, pchan);
+	return _lc_find_bts_pass(bts, pchan, pchan, false);
 }
 
 struct gsm_lchan *lchan_select_by_chan_mode(struct gsm_bts *bts,
@@ -194,6 +220,7 @@ struct gsm_lchan *lchan_select_by_type(struct gsm_bts *bts, enum gsm_chan_t type
 			lchan = _lc_find_bts(bts, second_cbch);
 		break;
 	case GSM_LCHAN_TCH_F:
+		ts_dyn_reserve_demand(bts);
 		lchan = _lc_find_bts(bts, GSM_PCHAN_TCH_F);
 		/* If we don't have TCH/F available, try dynamic TCH/F_PDCH */
 		if (!lchan) {
@@ -215,6 +242,7 @@ struct gsm_lchan *lchan_select_by_type(struct gsm_bts *bts, enum gsm_chan_t type
 		}
 		break;
 	case GSM_LCHAN_TCH_H:
+		ts_dyn_reserve_demand(bts);
 		lchan = _lc_find_bts(bts, GSM_PCHAN_TCH_H);
 		/* No dedicated TCH/x available -- try fully dynamic
 		 * TCH/F_TCH/H_PDCH */
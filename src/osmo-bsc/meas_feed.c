@@ -19,19 +19,24 @@
 #include <osmocom/bsc/meas_feed.h>
 #include <osmocom/bsc/vty.h>
 #include <osmocom/bsc/debug.h>
+#include <osmocom/bsc/gsm_data.h>
 
 struct meas_feed_state {
 	struct osmo_wqueue wqueue;
 	char scenario[31+1];
 	char *dst_host;
 	uint16_t dst_port;
+	uint16_t version;
 };
 
-static struct meas_feed_state g_mfs = {};
+static struct meas_feed_state g_mfs = {
+	.version = MEAS_FEED_VERSION,
+};
 
 static int process_meas_rep(struct gsm_meas_rep *mr)
 {
 	struct msgb *msg;
+	struct meas_feed_meas mfm_buf;
 	struct meas_feed_meas *mfm;
 	struct bsc_subscr *bsub;
 
@@ -47,12 +52,13 @@ static int process_meas_rep(struct gsm_meas_rep *mr)
 
 	bsub = mr->lchan->conn->bsub;
 
-	msg = msgb_alloc(sizeof(struct meas_feed_meas), "Meas. Feed");
+	msg = msgb_alloc(OSMO_MAX(sizeof(struct meas_feed_meas), MEAS_FEED_V2_MAX_LEN), "Meas. Feed");
 	if (!msg)
 		return 0;
 
 	/* fill in the header */
-	mfm = (struct meas_feed_meas *) msgb_put(msg, sizeof(*mfm));
+	mfm = &mfm_buf;
+	memset(mfm, 0, sizeof(*mfm));
 	mfm->hdr.msg_type = MEAS_FEED_MEAS;
 	mfm->hdr.version = MEAS_FEED_VERSION;
 
@@ -81,10 +87,23 @@ static int process_meas_rep(struct gsm_meas_rep *mr)
 	mfm->ts_nr = mr->lchan->ts->nr;
 	mfm->ss_nr = mr->lchan->nr;
 
+	/* version 1 ships the host layout as is, version 2 packs only what is present */
+	if (g_mfs.version == MEAS_FEED_VERSION_2) {
+		if (meas_feed_meas_encode_v2(msg, mfm) < 0) {
+			LOGP(DMEAS, LOGL_ERROR, "meas_feed %s: encoding measurement report failed\n",
+			     gsm_lchan_name(mr->lchan));
+			rate_ctr_inc(&bsc_gsmnet->bsc_ctrs->ctr[BSC_CTR_MEAS_FEED_DROPPED]);
+			msgb_free(msg);
+			return 0;
+		}
+	} else
+		memcpy(msgb_put(msg, sizeof(*mfm)), mfm, sizeof(*mfm));
+
 	/* and send it to the socket */
 	if (osmo_wqueue_enqueue(&g_mfs.wqueue, msg) != 0) {
 		LOGP(DMEAS, LOGL_ERROR, "meas_feed %s: sending measurement report failed\n",
 		     gsm_lchan_name(mr->lchan));
+		rate_ctr_inc(&bsc_gsmnet->bsc_ctrs->ctr[BSC_CTR_MEAS_FEED_DROPPED]);
 		msgb_free(msg);
 	} else
 		LOGP(DMEAS, LOGL_DEBUG, "meas_feed %s: sent measurement report\n",
@@ -183,3 +202,13 @@ const char *meas_feed_scenario_get(void)
 {
 	return g_mfs.scenario;
 }
+
+void meas_feed_version_set(uint16_t version)
+{
+	g_mfs.version = version;
+}
+
+uint16_t meas_feed_version_get(void)
+{
+	return g_mfs.version;
+}
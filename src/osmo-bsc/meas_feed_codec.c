@@ -0,0 +1,207 @@
+/* Encoding and decoding of meas_feed messages
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include <osmocom/core/msgb.h>
+#include <osmocom/core/utils.h>
+#include <osmocom/core/bit16gen.h>
+
+#include <osmocom/bsc/meas_feed.h>
+
+static void put_str(struct msgb *msg, const char *str, size_t max_len)
+{
+	size_t len = strnlen(str, max_len);
+
+	msgb_put_u8(msg, len);
+	memcpy(msgb_put(msg, len), str, len);
+}
+
+/* Append mfm to msg in the packed MEAS_FEED_VERSION_2 encoding, which only carries the neighbor cells present.
+ * msg needs MEAS_FEED_V2_MAX_LEN bytes of tailroom. */
+int meas_feed_meas_encode_v2(struct msgb *msg, const struct meas_feed_meas *mfm)
+{
+	const struct gsm_meas_rep *mr = &mfm->mr;
+	int num_cell = OSMO_MAX(0, OSMO_MIN(mr->num_cell, (int)ARRAY_SIZE(mr->cell)));
+	int i;
+
+	if (msgb_tailroom(msg) < MEAS_FEED_V2_MAX_LEN)
+		return -ENOSPC;
+
+	msgb_put_u8(msg, mfm->hdr.msg_type);
+	msgb_put_u8(msg, 0);
+	msgb_put_u16(msg, MEAS_FEED_VERSION_2);
+
+	msgb_put_u8(msg, mfm->lchan_type);
+	msgb_put_u8(msg, mfm->pchan_type);
+	msgb_put_u8(msg, mfm->bts_nr);
+	msgb_put_u8(msg, mfm->trx_nr);
+	msgb_put_u8(msg, mfm->ts_nr);
+	msgb_put_u8(msg, mfm->ss_nr);
+
+	msgb_put_u8(msg, mr->nr);
+	msgb_put_u8(msg, mr->flags);
+	msgb_put_u8(msg, mr->ul.full.rx_lev);
+	msgb_put_u8(msg, mr->ul.full.rx_qual);
+	msgb_put_u8(msg, mr->ul.sub.rx_lev);
+	msgb_put_u8(msg, mr->ul.sub.rx_qual);
+	msgb_put_u8(msg, mr->dl.full.rx_lev);
+	msgb_put_u8(msg, mr->dl.full.rx_qual);
+	msgb_put_u8(msg, mr->dl.sub.rx_lev);
+	msgb_put_u8(msg, mr->dl.sub.rx_qual);
+	msgb_put_u8(msg, mr->bs_power);
+	msgb_put_u16(msg, (uint16_t)mr->ms_timing_offset);
+	msgb_put_u8(msg, (uint8_t)mr->ms_l1.pwr);
+	msgb_put_u8(msg, mr->ms_l1.ta);
+	msgb_put_u8(msg, num_cell);
+
+	put_str(msg, mfm->imsi, sizeof(mfm->imsi) - 1);
+	put_str(msg, mfm->name, sizeof(mfm->name) - 1);
+	put_str(msg, mfm->scenario, sizeof(mfm->scenario) - 1);
+
+	for (i = 0; i < num_cell; i++) {
+		msgb_put_u8(msg, mr->cell[i].rxlev);
+		msgb_put_u8(msg, mr->cell[i].bsic);
+		msgb_put_u8(msg, mr->cell[i].neigh_idx);
+		msgb_put_u16(msg, mr->cell[i].arfcn);
+	}
+
+	return 0;
+}
+
+struct v2_reader {
+	const uint8_t *cur;
+	const uint8_t *end;
+	bool err;
+};
+
+static uint8_t get_u8(struct v2_reader *r)
+{
+	if (r->cur + 1 > r->end) {
+		r->err = true;
+		return 0;
+	}
+	return *r->cur++;
+}
+
+static uint16_t get_u16(struct v2_reader *r)
+{
+	uint16_t v;
+
+	if (r->cur + 2 > r->end) {
+		r->err = true;
+		return 0;
+	}
+	v = osmo_load16be(r->cur);
+	r->cur += 2;
+	return v;
+}
+
+static void get_str(struct v2_reader *r, char *dst, size_t dst_size)
+{
+	uint8_t len = get_u8(r);
+
+	if (r->err || len >= dst_size || r->cur + len > r->end) {
+		r->err = true;
+		return;
+	}
+	memcpy(dst, r->cur, len);
+	dst[len] = '\0';
+	r->cur += len;
+}
+
+static int decode_v2(struct meas_feed_meas *mfm, const uint8_t *data, size_t len)
+{
+	struct gsm_meas_rep *mr = &mfm->mr;
+	struct v2_reader r = { .cur = data, .end = data + len };
+	int i;
+
+	mfm->hdr.msg_type = get_u8(&r);
+	get_u8(&r);
+	mfm->hdr.version = get_u16(&r);
+
+	mfm->lchan_type = get_u8(&r);
+	mfm->pchan_type = get_u8(&r);
+	mfm->bts_nr = get_u8(&r);
+	mfm->trx_nr = get_u8(&r);
+	mfm->ts_nr = get_u8(&r);
+	mfm->ss_nr = get_u8(&r);
+
+	mr->nr = get_u8(&r);
+	mr->flags = get_u8(&r);
+	mr->ul.full.rx_lev = get_u8(&r);
+	mr->ul.full.rx_qual = get_u8(&r);
+	mr->ul.sub.rx_lev = get_u8(&r);
+	mr->ul.sub.rx_qual = get_u8(&r);
+	mr->dl.full.rx_lev = get_u8(&r);
+	mr->dl.full.rx_qual = get_u8(&r);
+	mr->dl.sub.rx_lev = get_u8(&r);
+	mr->dl.sub.rx_qual = get_u8(&r);
+	mr->bs_power = get_u8(&r);
+	mr->ms_timing_offset = (int16_t)get_u16(&r);
+	mr->ms_l1.pwr = (int8_t)get_u8(&r);
+	mr->ms_l1.ta = get_u8(&r);
+	mr->num_cell = get_u8(&r);
+
+	get_str(&r, mfm->imsi, sizeof(mfm->imsi));
+	get_str(&r, mfm->name, sizeof(mfm->name));
+	get_str(&r, mfm->scenario, sizeof(mfm->scenario));
+
+	if (r.err || mr->num_cell > ARRAY_SIZE(mr->cell))
+		return -EINVAL;
+
+	for (i = 0; i < mr->num_cell; i++) {
+		mr->cell[i].rxlev = get_u8(&r);
+		mr->cell[i].bsic = get_u8(&r);
+		mr->cell[i].neigh_idx = get_u8(&r);
+		mr->cell[i].arfcn = get_u16(&r);
+	}
+
+	return r.err ? -EINVAL : 0;
+}
+
+/* Decode a meas_feed message of any supported version into the host layout struct meas_feed_meas. mfm->hdr.version
+ * reflects the version received. Return 0 on success, -EINVAL on a truncated or malformed message, -ENOTSUP on an
+ * unknown version. */
+int meas_feed_meas_decode(struct meas_feed_meas *mfm, const uint8_t *data, size_t len)
+{
+	memset(mfm, 0, sizeof(*mfm));
+
+	if (len < sizeof(struct meas_feed_hdr))
+		return -EINVAL;
+
+	/* v2 carries its version in network byte order, v1 in the sender's host byte order */
+	if (osmo_load16be(data + 2) == MEAS_FEED_VERSION_2)
+		return decode_v2(mfm, data, len);
+
+	if (((const struct meas_feed_hdr *) data)->version != MEAS_FEED_VERSION)
+		return -ENOTSUP;
+	if (len < sizeof(*mfm))
+		return -EINVAL;
+
+	memcpy(mfm, data, sizeof(*mfm));
+	mfm->mr.lchan = NULL;
+	mfm->imsi[sizeof(mfm->imsi) - 1] = '\0';
+	mfm->name[sizeof(mfm->name) - 1] = '\0';
+	mfm->scenario[sizeof(mfm->scenario) - 1] = '\0';
+	if (mfm->mr.num_cell < 0 || mfm->mr.num_cell > ARRAY_SIZE(mfm->mr.cell))
+		mfm->mr.num_cell = 0;
+
+	return 0;
+}
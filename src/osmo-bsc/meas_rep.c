@@ -20,10 +20,106 @@
  */
 
 #include <errno.h>
+#include <string.h>
+
+#include <osmocom/core/bit16gen.h>
+#include <osmocom/gsm/protocol/gsm_08_58.h>
+#include <osmocom/gsm/rsl.h>
+#include <osmocom/gsm/tlv.h>
 
 #include <osmocom/bsc/gsm_data.h>
 #include <osmocom/bsc/meas_rep.h>
 
+/* BTS send the IEs of a MEASUREMENT RESULT in the order of 3GPP TS 48.058 8.4.8. Take them in that order without
+ * going through a full struct tlv_parsed; return -1 for anything else, to be left to the generic parser. */
+static int meas_res_ies_parse_fast(struct rsl_meas_res_ies *ies, const uint8_t *buf, unsigned int len)
+{
+	const uint8_t *pos = buf;
+	const uint8_t *end = buf + len;
+
+	memset(ies, 0, sizeof(*ies));
+
+	/* Mandatory: Measurement Result Number (TV), Uplink Measurements (TLV), BS Power (TV) */
+	if (end - pos < 2 || pos[0] != RSL_IE_MEAS_RES_NR)
+		return -1;
+	ies->meas_res_nr = &pos[1];
+	pos += 2;
+
+	if (end - pos < 2 || pos[0] != RSL_IE_UPLINK_MEAS || end - pos < 2 + pos[1])
+		return -1;
+	ies->uplink_meas = &pos[2];
+	ies->uplink_meas_len = pos[1];
+	pos += 2 + pos[1];
+
+	if (end - pos < 2 || pos[0] != RSL_IE_BS_POWER)
+		return -1;
+	ies->bs_power = &pos[1];
+	pos += 2;
+
+	/* Optional: L1 Information (TV, 2 bytes), L3 Information (TL16V), MS Timing Offset (TV) */
+	if (end - pos >= 3 && pos[0] == RSL_IE_L1_INFO) {
+		ies->l1_info = &pos[1];
+		pos += 3;
+	}
+
+	if (end - pos >= 3 && pos[0] == RSL_IE_L3_INFO) {
+		uint16_t l3_len = osmo_load16be(&pos[1]);
+		if (end - pos < 3 + l3_len)
+			return -1;
+		ies->l3_info = &pos[3];
+		ies->l3_info_len = l3_len;
+		pos += 3 + l3_len;
+	}
+
+	if (end - pos >= 2 && pos[0] == RSL_IE_MS_TIMING_OFFSET) {
+		ies->ms_timing_offset = &pos[1];
+		pos += 2;
+	}
+
+	return pos == end ? 0 : -1;
+}
+
+static void meas_res_ies_parse_generic(struct rsl_meas_res_ies *ies, const uint8_t *buf, unsigned int len)
+{
+	struct tlv_parsed tp;
+
+	memset(ies, 0, sizeof(*ies));
+	rsl_tlv_parse(&tp, buf, len);
+
+	if (TLVP_PRESENT(&tp, RSL_IE_MEAS_RES_NR))
+		ies->meas_res_nr = TLVP_VAL(&tp, RSL_IE_MEAS_RES_NR);
+	if (TLVP_PRESENT(&tp, RSL_IE_UPLINK_MEAS)) {
+		ies->uplink_meas = TLVP_VAL(&tp, RSL_IE_UPLINK_MEAS);
+		ies->uplink_meas_len = TLVP_LEN(&tp, RSL_IE_UPLINK_MEAS);
+	}
+	if (TLVP_PRESENT(&tp, RSL_IE_BS_POWER))
+		ies->bs_power = TLVP_VAL(&tp, RSL_IE_BS_POWER);
+	if (TLVP_PRESENT(&tp, RSL_IE_L1_INFO))
+		ies->l1_info = TLVP_VAL(&tp, RSL_IE_L1_INFO);
+	if (TLVP_PRESENT(&tp, RSL_IE_L3_INFO)) {
+		ies->l3_info = TLVP_VAL(&tp, RSL_IE_L3_INFO);
+		ies->l3_info_len = TLVP_LEN(&tp, RSL_IE_L3_INFO);
+	}
+	if (TLVP_PRESENT(&tp, RSL_IE_MS_TIMING_OFFSET))
+		ies->ms_timing_offset = TLVP_VAL(&tp, RSL_IE_MS_TIMING_OFFSET);
+}
+
+/*! Parse the IEs of an RSL MEASUREMENT RESULT, as they follow the Channel Number.
+ * \param[out] ies  Pointers into buf for the IEs found.
+ * \param[in] buf  The IEs after struct abis_rsl_dchan_hdr.
+ * \param[in] len  Length of buf.
+ * \returns 0 on success, -EIO if a mandatory IE is missing. */
+int rsl_meas_res_ies_parse(struct rsl_meas_res_ies *ies, const uint8_t *buf, unsigned int len)
+{
+	if (meas_res_ies_parse_fast(ies, buf, len) == 0)
+		return 0;
+
+	meas_res_ies_parse_generic(ies, buf, len);
+	if (!ies->meas_res_nr || !ies->uplink_meas || !ies->bs_power)
+		return -EIO;
+	return 0;
+}
+
 static int get_field(const struct gsm_meas_rep *rep,
 		     enum meas_rep_field field)
 {
@@ -86,15 +182,15 @@ int get_meas_rep_avg(const struct gsm_lchan *lchan,
 	if (num < 1)
 		return -EINVAL;
 
-	if (num > lchan->meas_rep_count)
+	if (!lchan->meas || num > lchan->meas->meas_rep_count)
 		return -EINVAL;
 
-	idx = calc_initial_idx(ARRAY_SIZE(lchan->meas_rep),
-				lchan->meas_rep_idx, num);
+	idx = calc_initial_idx(ARRAY_SIZE(lchan->meas->meas_rep),
+				lchan->meas->meas_rep_idx, num);
 
 	for (i = 0; i < num; i++) {
-		int j = (idx+i) % ARRAY_SIZE(lchan->meas_rep);
-		int val = get_field(&lchan->meas_rep[j], field);
+		int j = (idx+i) % ARRAY_SIZE(lchan->meas->meas_rep);
+		int val = get_field(&lchan->meas->meas_rep[j], field);
 
 		if (val >= 0) {
 			avg += val;
@@ -116,12 +212,15 @@ int meas_rep_n_out_of_m_be(const struct gsm_lchan *lchan,
 	unsigned int i, idx;
 	int count = 0;
 
-	idx = calc_initial_idx(ARRAY_SIZE(lchan->meas_rep),
-				lchan->meas_rep_idx, m);
+	if (!lchan->meas)
+		return 0;
+
+	idx = calc_initial_idx(ARRAY_SIZE(lchan->meas->meas_rep),
+				lchan->meas->meas_rep_idx, m);
 
 	for (i = 0; i < m; i++) {
-		int j = (idx + i) % ARRAY_SIZE(lchan->meas_rep);
-		int val = get_field(&lchan->meas_rep[j], field);
+		int j = (idx + i) % ARRAY_SIZE(lchan->meas->meas_rep);
+		int val = get_field(&lchan->meas->meas_rep[j], field);
 
 		if (val >= be) /* implies that val < 0 will not count */
 			count++;
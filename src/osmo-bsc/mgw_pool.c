@@ -0,0 +1,370 @@
+/* Pool of MGCP clients: spread new call endpoints across several MGWs
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <errno.h>
+#include <inttypes.h>
+
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/timer.h>
+#include <osmocom/core/rate_ctr.h>
+#include <osmocom/core/stat_item.h>
+#include <osmocom/vty/vty.h>
+
+#include <osmocom/mgcp_client/mgcp_client.h>
+
+#include <osmocom/bsc/gsm_data.h>
+#include <osmocom/bsc/debug.h>
+#include <osmocom/bsc/mgw_pool.h>
+
+#define LOG_MGW(member, level, fmt, args...) \
+	LOGP(DMSC, level, "(mgw=%u) " fmt, (member)->nr, ## args)
+
+static const struct rate_ctr_desc mgw_ctr_description[] = {
+	[MGW_CTR_ENDPOINT_ALLOCATED] =	{"endpoint:allocated", "Call endpoints allocated on this MGW"},
+	[MGW_CTR_CRCX_SUCCESS] =	{"crcx:success", "CRCX towards this MGW answered successfully"},
+	[MGW_CTR_CRCX_FAILURE] =	{"crcx:failure", "CRCX towards this MGW failed or timed out"},
+	[MGW_CTR_BLOCKED] =		{"blocked", "Number of times this MGW was taken out of the pool for repeated failures"},
+};
+
+static const struct rate_ctr_group_desc mgw_ctrg_desc = {
+	"mgw",
+	"media gateway",
+	OSMO_STATS_CLASS_GLOBAL,
+	ARRAY_SIZE(mgw_ctr_description),
+	mgw_ctr_description,
+};
+
+static const struct osmo_stat_item_desc mgw_stat_desc[] = {
+	[MGW_STAT_ENDPOINTS] =	{ "endpoints", "Number of call endpoints currently allocated on this MGW", "", 16, 0 },
+	[MGW_STAT_PENDING] =	{ "pending", "Number of CRCX transactions awaiting response from this MGW", "", 16, 0 },
+	[MGW_STAT_LATENCY] =	{ "latency", "Average CRCX response time of this MGW", "us", 16, 0 },
+	[MGW_STAT_HEALTHY] =	{ "healthy", "Whether this MGW is picked for new calls (1) or skipped (0)", "", 16, 1 },
+};
+
+static const struct osmo_stat_item_group_desc mgw_statg_desc = {
+	.group_name_prefix = "mgw",
+	.group_description = "media gateway",
+	.class_id = OSMO_STATS_CLASS_GLOBAL,
+	.num_items = ARRAY_SIZE(mgw_stat_desc),
+	.item_desc = mgw_stat_desc,
+};
+
+struct mgw_pool_member *mgw_pool_member_find(struct gsm_network *net, unsigned int nr)
+{
+	struct mgw_pool_member *member;
+	llist_for_each_entry(member, &net->mgw.pool, entry) {
+		if (member->nr == nr)
+			return member;
+	}
+	return NULL;
+}
+
+/* Add an MGW to the pool. If conf is NULL, a new default config is allocated. */
+struct mgw_pool_member *mgw_pool_member_alloc(struct gsm_network *net, unsigned int nr,
+					      struct mgcp_client_conf *conf)
+{
+	struct mgw_pool_member *member;
+	struct mgw_pool_member *pos;
+
+	OSMO_ASSERT(nr <= MGW_POOL_MEMBER_NR_MAX);
+	OSMO_ASSERT(!mgw_pool_member_find(net, nr));
+
+	member = talloc_zero(net, struct mgw_pool_member);
+	OSMO_ASSERT(member);
+	*member = (struct mgw_pool_member){
+		.net = net,
+		.nr = nr,
+		.conf = conf,
+	};
+
+	if (!member->conf) {
+		member->conf = talloc_zero(member, struct mgcp_client_conf);
+		OSMO_ASSERT(member->conf);
+		mgcp_client_conf_init(member->conf);
+	}
+
+	member->ctrs = rate_ctr_group_alloc(member, &mgw_ctrg_desc, nr);
+	member->statg = osmo_stat_item_group_alloc(member, &mgw_statg_desc, nr);
+
+	/* keep the list sorted by nr */
+	llist_for_each_entry(pos, &net->mgw.pool, entry) {
+		if (pos->nr > nr)
+			break;
+	}
+	llist_add_tail(&member->entry, &pos->entry);
+	return member;
+}
+
+/* Remove an MGW from the pool; only possible as long as it has not been connected. */
+int mgw_pool_member_free(struct mgw_pool_member *member)
+{
+	if (member->client)
+		return -EBUSY;
+	llist_del(&member->entry);
+	rate_ctr_group_free(member->ctrs);
+	osmo_stat_item_group_free(member->statg);
+	talloc_free(member);
+	return 0;
+}
+
+/* The MGCP client only picks up its config when connecting, and cannot be torn down to connect anew; so refuse to
+ * change the config of an MGW that is already connected. */
+int mgw_pool_member_set_remote_addr(struct mgw_pool_member *member, const char *addr)
+{
+	if (member->client)
+		return -EBUSY;
+	osmo_talloc_replace_string(member, (char**)&member->conf->remote_addr, addr);
+	return 0;
+}
+
+int mgw_pool_member_set_remote_port(struct mgw_pool_member *member, int port)
+{
+	if (member->client)
+		return -EBUSY;
+	member->conf->remote_port = port;
+	return 0;
+}
+
+int mgw_pool_member_set_local_addr(struct mgw_pool_member *member, const char *addr)
+{
+	if (member->client)
+		return -EBUSY;
+	osmo_talloc_replace_string(member, (char**)&member->conf->local_addr, addr);
+	return 0;
+}
+
+int mgw_pool_member_set_local_port(struct mgw_pool_member *member, int port)
+{
+	if (member->client)
+		return -EBUSY;
+	member->conf->local_port = port;
+	return 0;
+}
+
+/* Set up an MGCP client for each pool member. Member 0 uses net->mgw.conf and becomes net->mgw.client. */
+int mgw_pool_connect(struct gsm_network *net)
+{
+	struct mgw_pool_member *member;
+
+	if (!mgw_pool_member_find(net, 0))
+		mgw_pool_member_alloc(net, 0, net->mgw.conf);
+
+	llist_for_each_entry(member, &net->mgw.pool, entry) {
+		int local_port = member->conf->local_port;
+
+		/* Let additional MGWs bind to the same local address as the first one; since they cannot share its
+		 * local port, they get an ephemeral one unless configured otherwise. */
+		if (member->nr && !member->conf->local_addr && net->mgw.conf->local_addr) {
+			member->conf->local_addr = talloc_strdup(member->conf, net->mgw.conf->local_addr);
+			member->local_addr_default = true;
+		}
+		if (member->nr && local_port < 0)
+			member->conf->local_port = 0;
+
+		member->client = mgcp_client_init(net, member->conf);
+		member->conf->local_port = local_port;
+		if (!member->client || mgcp_client_connect(member->client)) {
+			LOG_MGW(member, LOGL_ERROR, "MGW connect failed at (%s:%d)\n",
+				member->conf->remote_addr, member->conf->remote_port);
+			return -EIO;
+		}
+		if (member->nr == 0)
+			net->mgw.client = member->client;
+	}
+	return 0;
+}
+
+static bool blocked_at(const struct mgw_pool_member *member, const struct timespec *now)
+{
+	if (!member->blocked_until.tv_sec && !member->blocked_until.tv_nsec)
+		return false;
+	if (now->tv_sec != member->blocked_until.tv_sec)
+		return now->tv_sec < member->blocked_until.tv_sec;
+	return now->tv_nsec < member->blocked_until.tv_nsec;
+}
+
+bool mgw_pool_member_healthy(const struct mgw_pool_member *member)
+{
+	struct timespec now;
+	osmo_clock_gettime(CLOCK_MONOTONIC, &now);
+	return !blocked_at(member, &now);
+}
+
+/* The lower the cost, the more attractive an MGW is for a new call: outstanding transactions times the
+ * response latency, rounded to milliseconds so that similarly fast MGWs compare equal. */
+static uint64_t member_cost(const struct mgw_pool_member *member)
+{
+	uint64_t latency_ms = member->latency_us / 1000 + 1;
+	return (member->pending + 1) * latency_ms;
+}
+
+/* Return the pool member that should serve the next new call endpoint, or NULL if no MGW is connected.
+ * MGWs that failed repeatedly are skipped, unless all are failing. Among equal cost, the MGW with the
+ * fewest endpoints wins. */
+struct mgw_pool_member *mgw_pool_pick(struct gsm_network *net)
+{
+	struct mgw_pool_member *member;
+	struct mgw_pool_member *best = NULL;
+	bool best_blocked = true;
+	uint64_t best_cost = 0;
+	struct timespec now;
+
+	osmo_clock_gettime(CLOCK_MONOTONIC, &now);
+
+	llist_for_each_entry(member, &net->mgw.pool, entry) {
+		bool blocked;
+		uint64_t cost;
+
+		if (!member->client)
+			continue;
+
+		blocked = blocked_at(member, &now);
+		cost = member_cost(member);
+
+		if (best) {
+			if (blocked && !best_blocked)
+				continue;
+			if (blocked == best_blocked) {
+				if (cost > best_cost)
+					continue;
+				if (cost == best_cost && member->endpoints >= best->endpoints)
+					continue;
+			}
+		}
+		best = member;
+		best_blocked = blocked;
+		best_cost = cost;
+	}
+
+	if (best && best_blocked)
+		LOG_MGW(best, LOGL_NOTICE, "All MGWs in the pool are failing, using the least loaded one\n");
+	return best;
+}
+
+void mgw_pool_member_endpoint_get(struct mgw_pool_member *member)
+{
+	if (!member)
+		return;
+	member->endpoints++;
+	rate_ctr_inc(&member->ctrs->ctr[MGW_CTR_ENDPOINT_ALLOCATED]);
+	osmo_stat_item_set(member->statg->items[MGW_STAT_ENDPOINTS], member->endpoints);
+}
+
+void mgw_pool_member_endpoint_put(struct mgw_pool_member *member)
+{
+	if (!member)
+		return;
+	OSMO_ASSERT(member->endpoints);
+	member->endpoints--;
+	osmo_stat_item_set(member->statg->items[MGW_STAT_ENDPOINTS], member->endpoints);
+}
+
+void mgw_pool_member_crcx_sent(struct mgw_pool_member *member)
+{
+	if (!member)
+		return;
+	member->pending++;
+	osmo_stat_item_set(member->statg->items[MGW_STAT_PENDING], member->pending);
+}
+
+/* Account for the end of a CRCX transaction started with mgw_pool_member_crcx_sent(). */
+void mgw_pool_member_crcx_result(struct mgw_pool_member *member, const struct timespec *sent,
+				 enum mgw_pool_crcx_result result)
+{
+	struct timespec now;
+	int64_t elapsed_us;
+
+	if (!member)
+		return;
+
+	OSMO_ASSERT(member->pending);
+	member->pending--;
+	osmo_stat_item_set(member->statg->items[MGW_STAT_PENDING], member->pending);
+
+	osmo_clock_gettime(CLOCK_MONOTONIC, &now);
+
+	switch (result) {
+	case MGW_POOL_CRCX_SUCCESS:
+		rate_ctr_inc(&member->ctrs->ctr[MGW_CTR_CRCX_SUCCESS]);
+		elapsed_us = (int64_t)(now.tv_sec - sent->tv_sec) * 1000000
+			     + (now.tv_nsec - sent->tv_nsec) / 1000;
+		if (elapsed_us < 0)
+			elapsed_us = 0;
+		/* exponential moving average with weight 1/8 for the new sample */
+		if (!member->latency_us)
+			member->latency_us = elapsed_us;
+		else
+			member->latency_us = (member->latency_us * 7 + elapsed_us) / 8;
+		osmo_stat_item_set(member->statg->items[MGW_STAT_LATENCY], member->latency_us);
+
+		if (blocked_at(member, &now) || member->consecutive_failures)
+			LOG_MGW(member, LOGL_DEBUG, "MGW responds again\n");
+		member->consecutive_failures = 0;
+		member->blocked_until = (struct timespec){};
+		osmo_stat_item_set(member->statg->items[MGW_STAT_HEALTHY], 1);
+		break;
+
+	case MGW_POOL_CRCX_FAILURE:
+		rate_ctr_inc(&member->ctrs->ctr[MGW_CTR_CRCX_FAILURE]);
+		if (++member->consecutive_failures < MGW_POOL_FAIL_THRESHOLD)
+			break;
+		LOG_MGW(member, LOGL_ERROR, "%u consecutive failures, skipping this MGW for new calls during %ds\n",
+			member->consecutive_failures, MGW_POOL_BLOCK_TIME);
+		member->consecutive_failures = 0;
+		member->blocked_until = now;
+		member->blocked_until.tv_sec += MGW_POOL_BLOCK_TIME;
+		rate_ctr_inc(&member->ctrs->ctr[MGW_CTR_BLOCKED]);
+		osmo_stat_item_set(member->statg->items[MGW_STAT_HEALTHY], 0);
+		break;
+
+	default:
+		break;
+	}
+}
+
+void mgw_pool_config_write(struct vty *vty, const char *indent)
+{
+	struct mgw_pool_member *member;
+	llist_for_each_entry(member, &bsc_gsmnet->mgw.pool, entry) {
+		if (!member->nr)
+			continue;
+		vty_out(vty, "%smgw pool-member %u remote-ip %s%s", indent, member->nr,
+			member->conf->remote_addr ? : "", VTY_NEWLINE);
+		if (member->conf->remote_port >= 0)
+			vty_out(vty, "%smgw pool-member %u remote-port %d%s", indent, member->nr,
+				member->conf->remote_port, VTY_NEWLINE);
+		if (member->conf->local_addr && !member->local_addr_default)
+			vty_out(vty, "%smgw pool-member %u local-ip %s%s", indent, member->nr,
+				member->conf->local_addr, VTY_NEWLINE);
+		if (member->conf->local_port >= 0)
+			vty_out(vty, "%smgw pool-member %u local-port %d%s", indent, member->nr,
+				member->conf->local_port, VTY_NEWLINE);
+	}
+}
+
+void mgw_pool_vty_show(struct vty *vty, struct gsm_network *net)
+{
+	struct mgw_pool_member *member;
+	llist_for_each_entry(member, &net->mgw.pool, entry) {
+		vty_out(vty, "MGW %u: %s:%d %s, endpoints: %u, pending CRCX: %u, latency: %" PRIu32 " us%s",
+			member->nr,
+			member->conf->remote_addr ? : "(default)", member->conf->remote_port,
+			!member->client ? "not connected"
+			: (mgw_pool_member_healthy(member) ? "healthy" : "SKIPPED"),
+			member->endpoints, member->pending, member->latency_us, VTY_NEWLINE);
+	}
+}
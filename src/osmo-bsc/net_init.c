@@ -49,6 +49,14 @@ static struct osmo_tdef gsm_network_T_defs[] = {
 	{ .T=993210, .default_val=20, .desc="After L3 Complete, wait for MSC to confirm" },
 	{ .T=999, .default_val=60, .desc="After Clear Request, wait for MSC to Clear Command (sanity)" },
 	{ .T=992427, .default_val=4, .desc="MGCP timeout (2427 is the default MGCP port number)" },
+	{ .T=-993101, .default_val=1000, .unit=OSMO_TDEF_MS,
+		.desc="Drop queued Channel Requests older than this, and repeated ones received within this time" },
+	{ .T=-993102, .default_val=20, .unit=OSMO_TDEF_MS,
+		.desc="Hold back Immediate Assignments and Rejects this long to send several MS in one AGCH block" },
+	{ .T=-993103, .default_val=60,
+		.desc="Stop throttling the configuration of a BTS that takes longer than this to come up" },
+	{ .T=-993104, .default_val=60,
+		.desc="Keep the dyn-ts-reserve switched away from PDCH this long after the last TCH request" },
 	{}
 };
 
@@ -64,6 +72,7 @@ struct osmo_tdef g_mgw_tdefs[] = {
 struct gsm_network *gsm_network_init(void *ctx)
 {
 	struct gsm_network *net = talloc_zero(ctx, struct gsm_network);
+	unsigned int i;
 	if (!net)
 		return NULL;
 
@@ -78,11 +87,15 @@ struct gsm_network *gsm_network_init(void *ctx)
 	net->a5_encryption_mask = (1 << 3) | (1 << 1);
 
 	INIT_LLIST_HEAD(&net->subscr_conns);
+	for (i = 0; i < ARRAY_SIZE(net->lcls_gcr_hash); i++)
+		INIT_LLIST_HEAD(&net->lcls_gcr_hash[i]);
 
 	net->bsc_subscribers = talloc_zero(net, struct llist_head);
 	INIT_LLIST_HEAD(net->bsc_subscribers);
 
 	INIT_LLIST_HEAD(&net->bts_list);
+	INIT_LLIST_HEAD(&net->bts_bringup.waiting);
+	INIT_LLIST_HEAD(&net->warm_start.snapshots);
 	net->num_bts = 0;
 
 	net->T_defs = gsm_network_T_defs;
@@ -90,6 +103,7 @@ struct gsm_network *gsm_network_init(void *ctx)
 
 	net->mgw.tdefs = g_mgw_tdefs;
 	osmo_tdefs_reset(net->mgw.tdefs);
+	INIT_LLIST_HEAD(&net->mgw.pool);
 
 	net->null_nri_ranges = osmo_nri_ranges_alloc(net);
 	net->nri_bitlen = OSMO_NRI_BITLEN_DEFAULT;
@@ -0,0 +1,93 @@
+/* Direct NRI value to MSC lookup table, for MSC pooling
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <string.h>
+
+#include <osmocom/core/talloc.h>
+#include <osmocom/gsm/gsm23236.h>
+
+#include <osmocom/bsc/gsm_data.h>
+#include <osmocom/bsc/bsc_msc_data.h>
+#include <osmocom/bsc/nri_lookup.h>
+
+/* Mark the lookup table as outdated, to be rebuilt on the next nri_lookup(). Call whenever an MSC's NRI
+ * ranges, the NULL-NRI ranges or the NRI bitlen change. */
+void nri_lookup_invalidate(struct gsm_network *net)
+{
+	net->nri_lookup.valid = false;
+}
+
+static void nri_lookup_mark_range(struct nri_lookup_table *l, const struct osmo_nri_range *r,
+				  struct bsc_msc_data *msc)
+{
+	int v;
+
+	for (v = r->first; v <= r->last && v < l->num_entries; v++) {
+		struct nri_lookup_entry *e = &l->entries[v];
+
+		if (!msc) {
+			e->null_nri = true;
+			continue;
+		}
+		/* Overlapping ranges map to whichever MSC comes first in net->mscs */
+		if (!e->msc)
+			e->msc = msc;
+		else if (e->msc != msc)
+			e->overlap = true;
+	}
+}
+
+static void nri_lookup_rebuild(struct gsm_network *net)
+{
+	struct nri_lookup_table *l = &net->nri_lookup;
+	struct bsc_msc_data *msc;
+	struct osmo_nri_range *r;
+	unsigned int num_entries = 1 << net->nri_bitlen;
+
+	if (l->num_entries != num_entries) {
+		talloc_free(l->entries);
+		l->entries = talloc_zero_array(net, struct nri_lookup_entry, num_entries);
+		OSMO_ASSERT(l->entries);
+		l->num_entries = num_entries;
+	} else {
+		memset(l->entries, 0, num_entries * sizeof(l->entries[0]));
+	}
+	l->bitlen = net->nri_bitlen;
+
+	llist_for_each_entry(msc, &net->mscs, entry) {
+		llist_for_each_entry(r, &msc->nri_ranges->entries, entry)
+			nri_lookup_mark_range(l, r, msc);
+	}
+	llist_for_each_entry(r, &net->null_nri_ranges->entries, entry)
+		nri_lookup_mark_range(l, r, NULL);
+
+	l->valid = true;
+}
+
+/* Return the MSC mapping and NULL-NRI flag of an NRI value extracted with the current net->nri_bitlen, or NULL
+ * if nri_v is out of range. */
+const struct nri_lookup_entry *nri_lookup(struct gsm_network *net, int16_t nri_v)
+{
+	struct nri_lookup_table *l = &net->nri_lookup;
+
+	if (!l->valid || l->bitlen != net->nri_bitlen)
+		nri_lookup_rebuild(net);
+
+	if (nri_v < 0 || nri_v >= l->num_entries)
+		return NULL;
+	return &l->entries[nri_v];
+}
@@ -135,7 +135,7 @@ page_subscriber(struct bsc_msc_data *msc, struct gsm_bts *bts,
 	}
 
 	subscr->lac = lac;
-	subscr->tmsi = tmsi;
+	bsc_subscr_set_tmsi(subscr, tmsi);
 
 	ret = bsc_grace_paging_request(msc->network->rf_ctrl->policy, subscr, chan_needed, msc, bts);
 	if (ret == 0)
@@ -586,8 +586,7 @@ static void bssmap_handle_ass_req_lcls(struct gsm_subscriber_connection *conn,
 				 gcr_len, osmo_hexdump_nospc(gcr, gcr_len));
 		} else {
 			LOGPFSM(conn->fi, "Setting GCR to %s\n", osmo_hexdump_nospc(gcr, gcr_len));
-			memcpy(&conn->lcls.global_call_ref, gcr, gcr_len);
-			conn->lcls.global_call_ref_len = gcr_len;
+			lcls_set_gcr(conn, gcr, gcr_len);
 		}
 	}
 
@@ -91,13 +91,56 @@ static void lcls_send_notify(struct gsm_subscriber_connection *conn)
 	osmo_fsm_inst_dispatch(conn->fi, GSCON_EV_TX_SCCP, msg);
 }
 
-static struct gsm_subscriber_connection *
-find_conn_with_same_gcr(const struct gsm_subscriber_connection *conn_local)
+/* FNV-1a over the GCR octets, reduced to a bucket index of gsm_network->lcls_gcr_hash */
+static unsigned int gcr_hash(const uint8_t *gcr, uint8_t gcr_len)
+{
+	uint32_t h = 2166136261u;
+	uint8_t i;
+
+	for (i = 0; i < gcr_len; i++) {
+		h ^= gcr[i];
+		h *= 16777619u;
+	}
+	return h % LCLS_GCR_HASH_BUCKETS;
+}
+
+/* Set the Global Call Reference of a conn and (re-)index it by that GCR. */
+void lcls_set_gcr(struct gsm_subscriber_connection *conn, const uint8_t *gcr, uint8_t gcr_len)
+{
+	OSMO_ASSERT(gcr_len <= sizeof(conn->lcls.global_call_ref));
+
+	lcls_clear_gcr(conn);
+	if (!gcr_len)
+		return;
+
+	memcpy(conn->lcls.global_call_ref, gcr, gcr_len);
+	conn->lcls.global_call_ref_len = gcr_len;
+	llist_add_tail(&conn->lcls.gcr_hash_entry,
+		       &conn->network->lcls_gcr_hash[gcr_hash(gcr, gcr_len)]);
+}
+
+/* Remove the Global Call Reference of a conn from the GCR index; to be called before the conn is freed. */
+void lcls_clear_gcr(struct gsm_subscriber_connection *conn)
+{
+	llist_del_init(&conn->lcls.gcr_hash_entry);
+	conn->lcls.global_call_ref_len = 0;
+}
+
+/* Return another conn that has the same Global Call Reference as conn_local, or NULL if there is none. */
+struct gsm_subscriber_connection *
+lcls_find_conn_with_same_gcr(const struct gsm_subscriber_connection *conn_local)
 {
 	struct gsm_network *net = conn_local->network;
 	struct gsm_subscriber_connection *conn_other;
+	struct llist_head *bucket;
+
+	if (!conn_local->lcls.global_call_ref_len)
+		return NULL;
+
+	bucket = &net->lcls_gcr_hash[gcr_hash(conn_local->lcls.global_call_ref,
+					       conn_local->lcls.global_call_ref_len)];
 
-	llist_for_each_entry(conn_other, &net->subscr_conns, entry) {
+	llist_for_each_entry(conn_other, bucket, lcls.gcr_hash_entry) {
 		/* don't report back the same connection */
 		if (conn_other == conn_local)
 			continue;
@@ -143,7 +186,7 @@ static int lcls_perform_correlation(struct gsm_subscriber_connection *conn_local
 		conn_local->lcls.other = NULL;
 	}
 
-	conn_other = find_conn_with_same_gcr(conn_local);
+	conn_other = lcls_find_conn_with_same_gcr(conn_local);
 	if (!conn_other) {
 		/* we found no other call with same GCR: not possible */
 		LOGPFSM(conn_local->lcls.fi, "Unsuccessful correlation\n");
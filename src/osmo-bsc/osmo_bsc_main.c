@@ -59,11 +59,14 @@
 #include <osmocom/abis/abis.h>
 #include <osmocom/bsc/abis_om2000.h>
 #include <osmocom/bsc/abis_nm.h>
+#include <osmocom/bsc/bts_bringup.h>
+#include <osmocom/bsc/bts_snapshot.h>
 #include <osmocom/bsc/abis_rsl.h>
 #include <osmocom/bsc/chan_alloc.h>
 #include <osmocom/bsc/e1_config.h>
 #include <osmocom/bsc/codec_pref.h>
 #include <osmocom/bsc/system_information.h>
+#include <osmocom/bsc/mgw_pool.h>
 
 #include <osmocom/mgcp_client/mgcp_client.h>
 
@@ -370,6 +373,9 @@ static int inp_sig_cb(unsigned int subsys, unsigned int signal,
 			  set bts->si_common.cell_alloc */
 			generate_cell_chan_list(ca, trx->bts);
 
+			bts_bringup_request(trx->bts);
+			abis_nm_bringup_start(trx->bts);
+
 			/* Request generic BTS-level attributes */
 			abis_nm_get_attr(trx->bts, NM_OC_BTS, 0xFF, 0xFF, 0xFF, bts_attr, sizeof(bts_attr));
 
@@ -382,14 +388,17 @@ static int inp_sig_cb(unsigned int subsys, unsigned int signal,
 					generate_ma_for_ts(&cur_trx->ts[i]);
 			}
 		}
-		if (isd->link_type == E1INP_SIGN_RSL)
+		if (isd->link_type == E1INP_SIGN_RSL) {
 			bootstrap_rsl(trx);
+			abis_nm_bringup_check(trx->bts);
+		}
 		break;
 	case S_L_INP_TEI_DN:
 		LOGP(DLMI, LOGL_ERROR, "Lost some E1 TEI link: %d %p\n", isd->link_type, trx);
 
 		if (isd->link_type == E1INP_SIGN_OML) {
 			rate_ctr_inc(&trx->bts->bts_ctrs->ctr[BTS_CTR_BTS_OML_FAIL]);
+			bts_bringup_abort(trx->bts);
 			all_ts_dispatch_event(trx, TS_EV_OML_DOWN);
 		} else if (isd->link_type == E1INP_SIGN_RSL) {
 			rate_ctr_inc(&trx->bts->bts_ctrs->ctr[BTS_CTR_BTS_RSL_FAIL]);
@@ -520,6 +529,9 @@ static int bsc_network_configure(const char *config_file)
 		return rc;
 	}
 
+	/* A missing or outdated snapshot only means that all SI get generated */
+	bts_snapshot_load(bsc_gsmnet);
+
 	/* start telnet after reading config for vty_get_bind_addr() */
 	rc = telnet_init_dynif(tall_bsc_ctx, bsc_gsmnet, vty_get_bind_addr(),
 			       OSMO_VTY_PORT_NITB_BSC);
@@ -915,12 +927,8 @@ int main(int argc, char **argv)
 		}
 	}
 
-	bsc_gsmnet->mgw.client = mgcp_client_init(bsc_gsmnet, bsc_gsmnet->mgw.conf);
-
-	if (mgcp_client_connect(bsc_gsmnet->mgw.client)) {
-		LOGP(DNM, LOGL_ERROR, "MGW connect failed at (%s:%u)\n",
-		     bsc_gsmnet->mgw.conf->remote_addr,
-		     bsc_gsmnet->mgw.conf->remote_port);
+	if (mgw_pool_connect(bsc_gsmnet)) {
+		LOGP(DNM, LOGL_ERROR, "Failed to connect to the MGW pool. Exiting.\n");
 		exit(1);
 	}
 
@@ -141,6 +141,10 @@ static const struct rate_ctr_group_desc msc_ctrg_desc = {
 static const struct osmo_stat_item_desc msc_stat_desc[] = {
 	{ "msc_links:active", "Number of active MSC links", "", 16, 0 },
 	{ "msc_links:total", "Number of configured MSC links", "", 16, 0 },
+	{ "sccp_conn:pending", "Number of SCCP connections waiting for a Connection Confirm", "", 16, 0 },
+	{ "sccp_conn:active", "Number of established SCCP connections", "", 16, 0 },
+	{ "sccp_conn:cr_cc_latency", "Average time from SCCP Connection Request to Connection Confirm", "us", 16, 0 },
+	{ "mscpool:weight", "Configured share of new subscribers for weighted MSC pool selection", "", 16, 0 },
 };
 
 static const struct osmo_stat_item_group_desc msc_statg_desc = {
@@ -259,10 +263,56 @@ struct bsc_msc_data *osmo_msc_data_alloc(struct gsm_network *net, int nr)
 
 	msc_data->nri_ranges = osmo_nri_ranges_alloc(msc_data);
 	msc_data->allow_attach = true;
+	msc_data->pool_weight = 1;
+	osmo_stat_item_set(msc_data->msc_statg->items[MSC_STAT_MSCPOOL_WEIGHT], msc_data->pool_weight);
 
 	return msc_data;
 }
 
+/* Return the CR-CC latency to assume for an MSC that has not confirmed any SCCP connection yet: the mean of the
+ * MSCs that have, or 0 if none has. A fresh MSC thus competes on its connection count alone, instead of looking
+ * faster than all others. */
+uint32_t osmo_msc_pool_neutral_latency(const struct gsm_network *net)
+{
+	const struct bsc_msc_data *msc;
+	uint64_t sum = 0;
+	unsigned int n = 0;
+
+	llist_for_each_entry(msc, &net->mscs, entry) {
+		if (!msc->load.cr_cc_latency_valid)
+			continue;
+		sum += msc->load.cr_cc_latency_us;
+		n++;
+	}
+	return n ? sum / n : 0;
+}
+
+/* Load of an MSC for weighted MSC pool selection: the SCCP connections it is handling, scaled by how long it takes
+ * to confirm new ones. Connections still waiting for a CC count double, as they indicate a backlog at the MSC. */
+static uint64_t msc_pool_load(const struct bsc_msc_data *msc, uint32_t neutral_latency_us)
+{
+	uint32_t latency_us = msc->load.cr_cc_latency_valid ? msc->load.cr_cc_latency_us : neutral_latency_us;
+	return (uint64_t)(msc->load.active + 2 * msc->load.pending + 1) * (latency_us / 1000 + 1);
+}
+
+/* Return true if MSC a should rather receive a new subscriber than MSC b, comparing load per configured weight.
+ * For equal load, keep the order of round-robin: the lowest msc->nr >= round_robin_next_nr, then wrap.
+ * neutral_latency_us is the result of osmo_msc_pool_neutral_latency(). */
+bool osmo_msc_pool_weighted_better(const struct bsc_msc_data *a, const struct bsc_msc_data *b,
+				   uint8_t round_robin_next_nr, uint32_t neutral_latency_us)
+{
+	uint64_t cost_a = msc_pool_load(a, neutral_latency_us) * OSMO_MAX(b->pool_weight, 1);
+	uint64_t cost_b = msc_pool_load(b, neutral_latency_us) * OSMO_MAX(a->pool_weight, 1);
+	int order_a, order_b;
+
+	if (cost_a != cost_b)
+		return cost_a < cost_b;
+
+	order_a = (a->nr < round_robin_next_nr) ? a->nr + 0x10000 : a->nr;
+	order_b = (b->nr < round_robin_next_nr) ? b->nr + 0x10000 : b->nr;
+	return order_a < order_b;
+}
+
 struct osmo_cell_global_id *cgi_for_msc(struct bsc_msc_data *msc, struct gsm_bts *bts)
 {
 	static struct osmo_cell_global_id cgi;
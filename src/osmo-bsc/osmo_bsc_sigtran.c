@@ -144,6 +144,65 @@ static struct bsc_msc_data *get_msc_by_addr(const struct osmo_sccp_addr *msc_add
 	return NULL;
 }
 
+static void msc_load_stats_update(struct bsc_msc_data *msc)
+{
+	osmo_stat_item_set(msc->msc_statg->items[MSC_STAT_SCCP_CONN_PENDING], msc->load.pending);
+	osmo_stat_item_set(msc->msc_statg->items[MSC_STAT_SCCP_CONN_ACTIVE], msc->load.active);
+	osmo_stat_item_set(msc->msc_statg->items[MSC_STAT_SCCP_CR_CC_LATENCY], msc->load.cr_cc_latency_us);
+}
+
+/* Change the SCCP state of a conn. Keep count of pending and established SCCP connections per MSC, and measure
+ * the time from CR to CC, as input for the weighted MSC pool selection in bsc_find_msc(). */
+void osmo_bsc_sigtran_set_conn_state(struct gsm_subscriber_connection *conn, enum subscr_sccp_state state)
+{
+	struct bsc_msc_data *msc = conn->sccp.msc;
+	enum subscr_sccp_state old_state = conn->sccp.state;
+	struct timespec now;
+	uint64_t sample_us;
+
+	conn->sccp.state = state;
+	if (!msc || old_state == state)
+		return;
+
+	switch (old_state) {
+	case SUBSCR_SCCP_ST_WAIT_CONN_CONF:
+		if (msc->load.pending)
+			msc->load.pending--;
+		break;
+	case SUBSCR_SCCP_ST_CONNECTED:
+		if (msc->load.active)
+			msc->load.active--;
+		break;
+	default:
+		break;
+	}
+
+	switch (state) {
+	case SUBSCR_SCCP_ST_WAIT_CONN_CONF:
+		msc->load.pending++;
+		osmo_clock_gettime(CLOCK_MONOTONIC, &conn->sccp.cr_sent);
+		break;
+	case SUBSCR_SCCP_ST_CONNECTED:
+		msc->load.active++;
+		if (old_state != SUBSCR_SCCP_ST_WAIT_CONN_CONF)
+			break;
+		osmo_clock_gettime(CLOCK_MONOTONIC, &now);
+		sample_us = (now.tv_sec - conn->sccp.cr_sent.tv_sec) * 1000000
+			    + (now.tv_nsec - conn->sccp.cr_sent.tv_nsec) / 1000;
+		/* Moving average, weighing the new sample by 1/8 */
+		if (msc->load.cr_cc_latency_valid)
+			msc->load.cr_cc_latency_us = (msc->load.cr_cc_latency_us * UINT64_C(7) + sample_us) / 8;
+		else
+			msc->load.cr_cc_latency_us = sample_us;
+		msc->load.cr_cc_latency_valid = true;
+		break;
+	default:
+		break;
+	}
+
+	msc_load_stats_update(msc);
+}
+
 /* Received data from MSC, use the connection id which MSC it is */
 static int handle_data_from_msc(struct gsm_subscriber_connection *conn, struct msgb *msg)
 {
@@ -244,7 +303,7 @@ static int sccp_sap_up(struct osmo_prim_hdr *oph, void *_scu)
 		conn = get_bsc_conn_by_conn_id(scu_prim->u.connect.conn_id);
 		if (conn) {
 			osmo_fsm_inst_dispatch(conn->fi, GSCON_EV_A_CONN_CFM, scu_prim);
-			conn->sccp.state = SUBSCR_SCCP_ST_CONNECTED;
+			osmo_bsc_sigtran_set_conn_state(conn, SUBSCR_SCCP_ST_CONNECTED);
 			if (msgb_l2len(oph->msg) > 0)
 				handle_data_from_msc(conn, oph->msg);
 		} else {
@@ -274,7 +333,7 @@ static int sccp_sap_up(struct osmo_prim_hdr *oph, void *_scu)
 		/* indication of disconnect */
 		conn = get_bsc_conn_by_conn_id(scu_prim->u.disconnect.conn_id);
 		if (conn) {
-			conn->sccp.state = SUBSCR_SCCP_ST_NONE;
+			osmo_bsc_sigtran_set_conn_state(conn, SUBSCR_SCCP_ST_NONE);
 			if (msgb_l2len(oph->msg) > 0)
 				handle_data_from_msc(conn, oph->msg);
 			osmo_fsm_inst_dispatch(conn->fi, GSCON_EV_A_DISC_IND, scu_prim);
@@ -355,7 +414,7 @@ int osmo_bsc_sigtran_open_conn(struct gsm_subscriber_connection *conn, struct ms
 	rc = osmo_sccp_tx_conn_req_msg(msc->a.sccp_user, conn_id, &msc->a.bsc_addr,
 				       &msc->a.msc_addr, msg);
 	if (rc >= 0)
-		conn->sccp.state = SUBSCR_SCCP_ST_WAIT_CONN_CONF;
+		osmo_bsc_sigtran_set_conn_state(conn, SUBSCR_SCCP_ST_WAIT_CONN_CONF);
 
 	return rc;
 }
@@ -53,10 +53,18 @@
 #include <osmocom/bsc/gsm_08_08.h>
 #include <osmocom/bsc/gsm_04_08_rr.h>
 #include <osmocom/bsc/bsc_subscr_conn_fsm.h>
+#include <osmocom/bsc/timer_wheel.h>
+#include <osmocom/bsc/vty.h>
 
 void *tall_paging_ctx = NULL;
 
-#define PAGING_TIMER 0, 500000
+#define PAGING_TIMER_US 500000
+#define PAGING_TIMER 0, PAGING_TIMER_US
+
+/* T3113 of all paging requests of all BTS runs on one timer wheel, so that a paging storm does not fill the
+ * osmo_timer tree. T3113 lasts seconds, expiring up to two such ticks late does not matter. */
+#define PAGING_T3113_TICK_MS 100
+static struct timer_wheel paging_T3113_wheel;
 
 /*
  * TODO MSCSPLIT: the paging in libbsc is closely tied to MSC land in that the
@@ -70,8 +78,10 @@ void *tall_paging_ctx = NULL;
 static void paging_remove_request(struct gsm_bts_paging_state *paging_bts,
 				  struct gsm_paging_request *to_be_deleted)
 {
-	osmo_timer_del(&to_be_deleted->T3113);
-	llist_del(&to_be_deleted->entry);
+	timer_wheel_del(&to_be_deleted->T3113);
+	vty_stream_llist_del(&to_be_deleted->entry);
+	llist_del(&to_be_deleted->group_entry);
+	paging_bts->group_depth[to_be_deleted->group]--;
 	bsc_subscr_put(to_be_deleted->bsub);
 	talloc_free(to_be_deleted);
 }
@@ -106,6 +116,21 @@ static void page_ms(struct gsm_paging_request *request)
 	log_set_context(LOG_CTX_BSC_SUBSCR, NULL);
 }
 
+/* Take the groups in turn, so that a crowded paging group does not hold up the others */
+static struct gsm_paging_request *paging_next_request(struct gsm_bts_paging_state *paging_bts)
+{
+	unsigned int i, group;
+
+	for (i = 0; i < PAGING_GROUPS_MAX; i++) {
+		group = (paging_bts->next_group + i) % PAGING_GROUPS_MAX;
+		if (llist_empty(&paging_bts->groups[group]))
+			continue;
+		paging_bts->next_group = (group + 1) % PAGING_GROUPS_MAX;
+		return llist_first_entry(&paging_bts->groups[group], struct gsm_paging_request, group_entry);
+	}
+	return NULL;
+}
+
 static void paging_schedule_if_needed(struct gsm_bts_paging_state *paging_bts)
 {
 	if (llist_empty(&paging_bts->pending_requests))
@@ -209,8 +234,8 @@ static void paging_handle_pending_requests(struct gsm_bts_paging_state *paging_b
 		return;
 	}
 
-	request = llist_entry(paging_bts->pending_requests.next,
-			      struct gsm_paging_request, entry);
+	request = paging_next_request(paging_bts);
+	OSMO_ASSERT(request);
 
 	/* we need to determine the number of free channels */
 	if (paging_bts->free_chans_need != -1) {
@@ -227,9 +252,9 @@ static void paging_handle_pending_requests(struct gsm_bts_paging_state *paging_b
 	paging_bts->available_slots--;
 	request->attempts++;
 
-	/* take the current and add it to the back */
-	llist_del(&request->entry);
-	llist_add_tail(&request->entry, &paging_bts->pending_requests);
+	/* take the current and add it to the back of its group */
+	llist_del(&request->group_entry);
+	llist_add_tail(&request->group_entry, &paging_bts->groups[request->group]);
 
 skip_paging:
 	osmo_timer_schedule(&paging_bts->work_timer, PAGING_TIMER);
@@ -250,6 +275,9 @@ static void paging_init_if_needed(struct gsm_bts *bts)
 
 	bts->paging.bts = bts;
 
+	if (!paging_T3113_wheel.tick_ms)
+		timer_wheel_init(&paging_T3113_wheel, PAGING_T3113_TICK_MS);
+
 	/* This should be initialized only once. There is currently no code that sets bts->paging.bts
 	 * back to NULL, so let's just assert this one instead of graceful handling. */
 	OSMO_ASSERT(llist_empty(&bts->paging.pending_requests));
@@ -296,9 +324,27 @@ static void paging_T3113_expired(void *data)
 
 #define GSM_FRAME_DURATION_us	4615
 #define GSM51_MFRAME_DURATION_us (51 * GSM_FRAME_DURATION_us) /* 235365 us */
-static unsigned int calculate_timer_3113(struct gsm_bts *bts)
+/* Do not extend T3113 by more than this many runs of the paging worker */
+#define PAGING_T3113_BACKLOG_MAX_SENDS 32
+
+/* Number of PAGING CMD the worker sends, one per PAGING_TIMER, before it first pages a new request of group. The groups
+ * take turns, and a request stays queued until it is answered or expires: so the requests already pending for the
+ * group go first, and each other busy group sends one for every turn of this group. */
+static unsigned int paging_sends_ahead(const struct gsm_bts_paging_state *paging_bts, unsigned int group)
 {
-	unsigned int to_us, to;
+	unsigned int depth = paging_bts->group_depth[group];
+	unsigned int i, busy_groups = 0;
+
+	for (i = 0; i < PAGING_GROUPS_MAX; i++) {
+		if (i != group && paging_bts->group_depth[i])
+			busy_groups++;
+	}
+	return depth + (depth + 1) * busy_groups;
+}
+
+static unsigned int calculate_timer_3113(struct gsm_bts *bts, unsigned int group)
+{
+	unsigned int to_us, to, sends_ahead;
 	struct osmo_tdef *d = osmo_tdef_get_entry(bts->network->T_defs, 3113);
 
 	/* Note: d should always contain a valid pointer since all timers,
@@ -309,7 +355,8 @@ static unsigned int calculate_timer_3113(struct gsm_bts *bts)
 	if (!bts->T3113_dynamic)
 		return d->val;
 
-	/* TODO: take into account load of paging group for req->bsub */
+	/* The requests queued before this one hold up its first paging */
+	sends_ahead = OSMO_MIN(paging_sends_ahead(&bts->paging, group), PAGING_T3113_BACKLOG_MAX_SENDS);
 
 	/* MFRMS defines repeat interval of paging messages for MSs that belong
 	 * to same paging group across multiple 51 frame multiframes.
@@ -317,13 +364,37 @@ static unsigned int calculate_timer_3113(struct gsm_bts *bts)
 	 */
 	to_us = GSM51_MFRAME_DURATION_us * (bts->si_common.chan_desc.bs_pa_mfrms + 2) *
 		bts->si_common.rach_control.max_trans;
+	to_us += sends_ahead * PAGING_TIMER_US;
 
 	/* ceiling in seconds + extra time */
 	to = (to_us + 999999) / 1000000 + d->val;
-	LOG_BTS(bts, DPAG, LOGL_DEBUG, "Paging request: T3113 expires in %u seconds\n", to);
+	LOG_BTS(bts, DPAG, LOGL_DEBUG, "Paging request: T3113 expires in %u seconds (%u pending in paging group %u,"
+		" %u to send first)\n", to, bts->paging.group_depth[group], group, sends_ahead);
 	return to;
 }
 
+/* Histogram of how many requests were already pending in the paging group of a new request */
+static void paging_count_group_depth(struct gsm_bts *bts, unsigned int depth)
+{
+	int ctr;
+
+	if (depth >= 32)
+		ctr = BTS_CTR_PAGING_GROUP_DEPTH_32_MORE;
+	else if (depth >= 16)
+		ctr = BTS_CTR_PAGING_GROUP_DEPTH_16_31;
+	else if (depth >= 8)
+		ctr = BTS_CTR_PAGING_GROUP_DEPTH_8_15;
+	else if (depth >= 4)
+		ctr = BTS_CTR_PAGING_GROUP_DEPTH_4_7;
+	else if (depth >= 2)
+		ctr = BTS_CTR_PAGING_GROUP_DEPTH_2_3;
+	else if (depth == 1)
+		ctr = BTS_CTR_PAGING_GROUP_DEPTH_1;
+	else
+		ctr = BTS_CTR_PAGING_GROUP_DEPTH_0;
+	rate_ctr_inc(&bts->bts_ctrs->ctr[ctr]);
+}
+
 /*! Start paging + paging timer for given subscriber on given BTS
  * \param bts BTS on which to page
  * \param[in] bsub subscriber we want to page
@@ -353,10 +424,15 @@ static int _paging_request(struct gsm_bts *bts, struct bsc_subscr *bsub, int typ
 	req->bts = bts;
 	req->chan_type = type;
 	req->msc = msc;
-	osmo_timer_setup(&req->T3113, paging_T3113_expired, req);
-	t3113_timeout_s = calculate_timer_3113(bts);
-	osmo_timer_schedule(&req->T3113, t3113_timeout_s, 0);
+	req->group = gsm0502_calc_paging_group(&bts->si_common.chan_desc, str_to_imsi(bsub->imsi))
+		     % PAGING_GROUPS_MAX;
+	paging_count_group_depth(bts, bts_entry->group_depth[req->group]);
+	timer_wheel_entry_setup(&req->T3113, paging_T3113_expired, req);
+	t3113_timeout_s = calculate_timer_3113(bts, req->group);
+	timer_wheel_schedule(&paging_T3113_wheel, &req->T3113, t3113_timeout_s * 1000);
 	llist_add_tail(&req->entry, &bts_entry->pending_requests);
+	llist_add_tail(&req->group_entry, &bts_entry->groups[req->group]);
+	bts_entry->group_depth[req->group]++;
 	paging_schedule_if_needed(bts_entry);
 
 	return 0;
@@ -21,6 +21,7 @@
  *
  */
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <unistd.h>
 #include <stdlib.h>
@@ -29,6 +30,7 @@
 #include <assert.h>
 #include <sys/socket.h>
 #include <sys/un.h>
+#include <sys/uio.h>
 
 #include <osmocom/core/talloc.h>
 #include <osmocom/core/select.h>
@@ -409,14 +411,19 @@ static int pcu_rx_data_req(struct gsm_bts *bts, uint8_t msg_type,
 	return rc;
 }
 
-static int pcu_rx(struct gsm_network *net, uint8_t msg_type,
+static int pcu_rx(struct pcu_sock_state *state, uint8_t msg_type,
 	struct gsm_pcu_if *pcu_prim)
 {
 	int rc = 0;
 	struct gsm_bts *bts;
 
-	/* FIXME: allow multiple BTS */
-	bts = llist_entry(net->bts_list.next, struct gsm_bts, list);
+	bts = gsm_bts_num(state->net, pcu_prim->bts_nr);
+	if (!bts || bts->pcu_state != state) {
+		LOGP(DPCU, LOGL_ERROR, "Received PCU msg type %d for BTS %u, "
+			"which is not served by this PCU socket\n", msg_type,
+			pcu_prim->bts_nr);
+		return -EINVAL;
+	}
 
 	switch (msg_type) {
 	case PCU_IF_MSG_DATA_REQ:
@@ -436,6 +443,15 @@ static int pcu_rx(struct gsm_network *net, uint8_t msg_type,
  * PCU socket interface
  */
 
+static struct msgb *pcu_upqueue_dequeue(struct pcu_sock_state *state)
+{
+	struct msgb *msg = msgb_dequeue(&state->upqueue);
+
+	if (msg)
+		state->upqueue_len--;
+	return msg;
+}
+
 static int pcu_sock_send(struct gsm_bts *bts, struct msgb *msg)
 {
 	struct pcu_sock_state *state = bts->pcu_state;
@@ -457,32 +473,34 @@ static int pcu_sock_send(struct gsm_bts *bts, struct msgb *msg)
 		msgb_free(msg);
 		return -EIO;
 	}
+	if (state->upqueue_len >= PCU_SOCK_UPQUEUE_MAX_LEN) {
+		LOGP(DPCU, LOGL_DEBUG, "PCU socket queue full (%u msgs), "
+			"dropping message type %d for BTS %u\n", state->upqueue_len,
+			pcu_prim->msg_type, bts->nr);
+		state->upqueue_dropped++;
+		rate_ctr_inc(&bts->bts_ctrs->ctr[BTS_CTR_PCU_TX_DROPPED]);
+		msgb_free(msg);
+		return -ENOBUFS;
+	}
 	msgb_enqueue(&state->upqueue, msg);
+	state->upqueue_len++;
+	if (state->upqueue_len > state->upqueue_max_seen)
+		state->upqueue_max_seen = state->upqueue_len;
+
+	/* The actual send happens from the select loop, so that all messages
+	 * queued during one main loop iteration (e.g. several RACH/TIME
+	 * indications) are flushed with a single sendmmsg() */
 	conn_bfd->when |= BSC_FD_WRITE;
 
 	return 0;
 }
 
-static void pcu_sock_close(struct pcu_sock_state *state)
+static void pcu_sock_close_bts(struct gsm_bts *bts)
 {
-	struct osmo_fd *bfd = &state->conn_bfd;
-	struct gsm_bts *bts;
 	struct gsm_bts_trx *trx;
 	struct gsm_bts_trx_ts *ts;
 	int i, j;
 
-	/* FIXME: allow multiple BTS */
-	bts = llist_entry(state->net->bts_list.next, struct gsm_bts, list);
-
-	LOGP(DPCU, LOGL_NOTICE, "PCU socket has LOST connection\n");
-
-	close(bfd->fd);
-	bfd->fd = -1;
-	osmo_fd_unregister(bfd);
-
-	/* re-enable the generation of ACCEPT for new connections */
-	state->listen_bfd.when |= BSC_FD_READ;
-
 #if 0
 	/* remove si13, ... */
 	bts->si_valid &= ~(1 << SYSINFO_TYPE_13);
@@ -502,10 +520,31 @@ static void pcu_sock_close(struct pcu_sock_state *state)
 			}
 		}
 	}
+}
+
+static void pcu_sock_close(struct pcu_sock_state *state)
+{
+	struct osmo_fd *bfd = &state->conn_bfd;
+	struct gsm_bts *bts;
+
+	LOGP(DPCU, LOGL_NOTICE, "PCU socket %s has LOST connection\n",
+		state->path);
+
+	close(bfd->fd);
+	bfd->fd = -1;
+	osmo_fd_unregister(bfd);
+
+	/* re-enable the generation of ACCEPT for new connections */
+	state->listen_bfd.when |= BSC_FD_READ;
+
+	llist_for_each_entry(bts, &state->net->bts_list, list) {
+		if (bts->pcu_state == state)
+			pcu_sock_close_bts(bts);
+	}
 
 	/* flush the queue */
 	while (!llist_empty(&state->upqueue)) {
-		struct msgb *msg = msgb_dequeue(&state->upqueue);
+		struct msgb *msg = pcu_upqueue_dequeue(state);
 		msgb_free(msg);
 	}
 }
@@ -513,17 +552,13 @@ static void pcu_sock_close(struct pcu_sock_state *state)
 static int pcu_sock_read(struct osmo_fd *bfd)
 {
 	struct pcu_sock_state *state = (struct pcu_sock_state *)bfd->data;
-	struct gsm_pcu_if *pcu_prim;
-	struct msgb *msg;
+	struct gsm_pcu_if *pcu_prim = &state->rx_buf;
 	int rc;
 
-	msg = msgb_alloc(sizeof(*pcu_prim), "pcu_sock_rx");
-	if (!msg)
-		return -ENOMEM;
-
-	pcu_prim = (struct gsm_pcu_if *) msg->tail;
-
-	rc = recv(bfd->fd, msg->tail, msgb_tailroom(msg), 0);
+	/* as we always synchronously process the message in pcu_rx() and
+	 * its callbacks, the same receive buffer can be used for each
+	 * message. */
+	rc = recv(bfd->fd, pcu_prim, sizeof(*pcu_prim), 0);
 	if (rc == 0)
 		goto close;
 
@@ -533,16 +568,9 @@ static int pcu_sock_read(struct osmo_fd *bfd)
 		goto close;
 	}
 
-	rc = pcu_rx(state->net, pcu_prim->msg_type, pcu_prim);
-
-	/* as we always synchronously process the message in pcu_rx() and
-	 * its callbacks, we can free the message here. */
-	msgb_free(msg);
-
-	return rc;
+	return pcu_rx(state, pcu_prim->msg_type, pcu_prim);
 
 close:
-	msgb_free(msg);
 	pcu_sock_close(state);
 	return -1;
 }
@@ -550,27 +578,45 @@ close:
 static int pcu_sock_write(struct osmo_fd *bfd)
 {
 	struct pcu_sock_state *state = bfd->data;
-	int rc;
+	struct mmsghdr mmsg[PCU_SOCK_TX_BATCH];
+	struct iovec iov[PCU_SOCK_TX_BATCH];
+	int i, n, rc;
+
+	bfd->when &= ~BSC_FD_WRITE;
 
 	while (!llist_empty(&state->upqueue)) {
 		struct msgb *msg, *msg2;
-		struct gsm_pcu_if *pcu_prim;
 
-		/* peek at the beginning of the queue */
-		msg = llist_entry(state->upqueue.next, struct msgb, list);
-		pcu_prim = (struct gsm_pcu_if *)msg->data;
+		/* gather a batch from the beginning of the queue; each message
+		 * remains a separate SEQPACKET datagram */
+		n = 0;
+		llist_for_each_entry_safe(msg, msg2, &state->upqueue, list) {
+			if (n == ARRAY_SIZE(mmsg))
+				break;
 
-		bfd->when &= ~BSC_FD_WRITE;
+			/* bug hunter 8-): maybe someone forgot msgb_put(...) ? */
+			if (!msgb_length(msg)) {
+				struct gsm_pcu_if *pcu_prim = (struct gsm_pcu_if *)msg->data;
+				LOGP(DPCU, LOGL_ERROR, "message type (%d) with ZERO "
+					"bytes!\n", pcu_prim->msg_type);
+				llist_del(&msg->list);
+				state->upqueue_len--;
+				msgb_free(msg);
+				continue;
+			}
 
-		/* bug hunter 8-): maybe someone forgot msgb_put(...) ? */
-		if (!msgb_length(msg)) {
-			LOGP(DPCU, LOGL_ERROR, "message type (%d) with ZERO "
-				"bytes!\n", pcu_prim->msg_type);
-			goto dontsend;
+			iov[n].iov_base = msgb_data(msg);
+			iov[n].iov_len = msgb_length(msg);
+			memset(&mmsg[n], 0, sizeof(mmsg[n]));
+			mmsg[n].msg_hdr.msg_iov = &iov[n];
+			mmsg[n].msg_hdr.msg_iovlen = 1;
+			n++;
 		}
+		if (!n)
+			break;
 
-		/* try to send it over the socket */
-		rc = write(bfd->fd, msgb_data(msg), msgb_length(msg));
+		/* try to send them over the socket */
+		rc = sendmmsg(bfd->fd, mmsg, n, 0);
 		if (rc == 0)
 			goto close;
 		if (rc < 0) {
@@ -581,11 +627,15 @@ static int pcu_sock_write(struct osmo_fd *bfd)
 			goto close;
 		}
 
-dontsend:
-		/* _after_ we send it, we can deueue */
-		msg2 = msgb_dequeue(&state->upqueue);
-		assert(msg == msg2);
-		msgb_free(msg);
+		/* _after_ we sent them, we can dequeue */
+		for (i = 0; i < rc; i++)
+			msgb_free(pcu_upqueue_dequeue(state));
+
+		/* the socket buffer is full, wait until it becomes writable */
+		if (rc < n) {
+			bfd->when |= BSC_FD_WRITE;
+			break;
+		}
 	}
 	return 0;
 
@@ -653,6 +703,18 @@ static int pcu_sock_accept(struct osmo_fd *bfd, unsigned int flags)
 	return 0;
 }
 
+/* Find a PCU socket already opened by another BTS for the same path */
+static struct pcu_sock_state *pcu_sock_find(struct gsm_network *net, const char *path)
+{
+	struct gsm_bts *bts;
+
+	llist_for_each_entry(bts, &net->bts_list, list) {
+		if (bts->pcu_state && !strcmp(bts->pcu_state->path, path))
+			return bts->pcu_state;
+	}
+	return NULL;
+}
+
 /* Open connection to PCU */
 int pcu_sock_init(const char *path, struct gsm_bts *bts)
 {
@@ -660,12 +722,25 @@ int pcu_sock_init(const char *path, struct gsm_bts *bts)
 	struct osmo_fd *bfd;
 	int rc;
 
+	/* Several BTS may share one PCU socket, the PCU tells them apart by
+	 * the bts_nr in each primitive. */
+	state = pcu_sock_find(bts->network, path);
+	if (state) {
+		state->use_count++;
+		bts->pcu_state = state;
+		LOGP(DPCU, LOGL_INFO, "BTS %u shares PCU socket %s (%u BTS)\n",
+			bts->nr, path, state->use_count);
+		pcu_info_update(bts);
+		return 0;
+	}
+
 	state = talloc_zero(NULL, struct pcu_sock_state);
 	if (!state)
 		return -ENOMEM;
 
 	INIT_LLIST_HEAD(&state->upqueue);
 	state->net = bts->network;
+	state->path = talloc_strdup(state, path);
 	state->conn_bfd.fd = -1;
 
 	bfd = &state->listen_bfd;
@@ -694,6 +769,7 @@ int pcu_sock_init(const char *path, struct gsm_bts *bts)
 
 	LOGP(DPCU, LOGL_INFO, "Started listening on PCU socket: %s\n", path);
 
+	state->use_count = 1;
 	bts->pcu_state = state;
 	return 0;
 }
@@ -707,13 +783,20 @@ void pcu_sock_exit(struct gsm_bts *bts)
 	if (!state)
 		return;
 
+	/* other BTS still use this socket */
+	if (--state->use_count > 0) {
+		bts->pcu_state = NULL;
+		pcu_sock_close_bts(bts);
+		return;
+	}
+
 	conn_bfd = &state->conn_bfd;
 	if (conn_bfd->fd > 0)
 		pcu_sock_close(state);
+	/* only now, pcu_sock_close() cleans up the BTS that still point at state */
+	bts->pcu_state = NULL;
 	bfd = &state->listen_bfd;
 	close(bfd->fd);
 	osmo_fd_unregister(bfd);
 	talloc_free(state);
-	bts->pcu_state = NULL;
 }
-
@@ -1217,6 +1217,8 @@ static int generate_si13(enum osmo_sysinfo_type t, struct gsm_bts *bts)
 	return sizeof (*si13) + ret;
 }
 
+/* The warm start snapshot reuses the SI generated here as long as the BTS fields they are generated from do not
+ * change. When generating an SI from a further field, add that field to bts_snapshot_key() in bts_snapshot.c. */
 typedef int (*gen_si_fn_t)(enum osmo_sysinfo_type t, struct gsm_bts *bts);
 
 static const gen_si_fn_t gen_si_fn[_MAX_SYSINFO_TYPE] = {
@@ -0,0 +1,171 @@
+/* Coarse-grained hierarchical timer wheel for large numbers of timers */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <string.h>
+
+#include <osmocom/core/linuxlist.h>
+#include <osmocom/core/timer.h>
+#include <osmocom/core/timer_compat.h>
+
+#include <osmocom/bsc/timer_wheel.h>
+
+#define L0_MASK (TIMER_WHEEL_L0_SLOTS - 1)
+#define L1_MASK (TIMER_WHEEL_L1_SLOTS - 1)
+
+/* The tick that the clock is in now */
+static uint32_t timer_wheel_clock(const struct timer_wheel *wheel)
+{
+	struct timespec now, elapsed;
+
+	osmo_clock_gettime(CLOCK_MONOTONIC, &now);
+	timespecsub(&now, &wheel->base, &elapsed);
+	return ((uint64_t)elapsed.tv_sec * 1000 + elapsed.tv_nsec / 1000000) / wheel->tick_ms;
+}
+
+/* Put entry in the slot for its expiry, relative to wheel->now */
+static void timer_wheel_add(struct timer_wheel *wheel, struct timer_wheel_entry *entry)
+{
+	uint32_t l1_ahead;
+
+	/* Already due: expire with the current tick, which has not been processed yet when cascading */
+	if ((int32_t)(entry->expires - wheel->now) < 0)
+		entry->expires = wheel->now;
+
+	if (entry->expires - wheel->now < TIMER_WHEEL_L0_SLOTS) {
+		llist_add_tail(&entry->list, &wheel->l0[entry->expires & L0_MASK]);
+		return;
+	}
+
+	/* The current second level slot was already moved down, so it can only take entries from one round later */
+	l1_ahead = (entry->expires >> TIMER_WHEEL_L0_BITS) - (wheel->now >> TIMER_WHEEL_L0_BITS);
+	if (l1_ahead > TIMER_WHEEL_L1_SLOTS - 1)
+		l1_ahead = TIMER_WHEEL_L1_SLOTS - 1;
+	llist_add_tail(&entry->list,
+		       &wheel->l1[((wheel->now >> TIMER_WHEEL_L0_BITS) + l1_ahead) & L1_MASK]);
+}
+
+/* Advance by one tick and expire all entries of that tick */
+static void timer_wheel_tick(struct timer_wheel *wheel)
+{
+	struct timer_wheel_entry *entry, *entry2;
+	LLIST_HEAD(expired);
+	LLIST_HEAD(cascade);
+
+	wheel->now++;
+
+	if (!(wheel->now & L0_MASK)) {
+		llist_splice_init(&wheel->l1[(wheel->now >> TIMER_WHEEL_L0_BITS) & L1_MASK], &cascade);
+		llist_for_each_entry_safe(entry, entry2, &cascade, list) {
+			llist_del(&entry->list);
+			timer_wheel_add(wheel, entry);
+		}
+	}
+
+	llist_splice_init(&wheel->l0[wheel->now & L0_MASK], &expired);
+
+	/* A callback may stop other entries of this tick, so take them one by one */
+	while (!llist_empty(&expired)) {
+		entry = llist_first_entry(&expired, struct timer_wheel_entry, list);
+		llist_del_init(&entry->list);
+		wheel->count--;
+		entry->cb(entry->data);
+	}
+}
+
+static void timer_wheel_timer_cb(void *data)
+{
+	struct timer_wheel *wheel = data;
+	uint32_t clock = timer_wheel_clock(wheel);
+
+	/* Catch up with ticks missed while the main loop was busy */
+	while (wheel->count && (int32_t)(clock - wheel->now) > 0)
+		timer_wheel_tick(wheel);
+
+	if (wheel->count)
+		osmo_timer_schedule(&wheel->timer, wheel->tick_ms / 1000, (wheel->tick_ms % 1000) * 1000);
+}
+
+/*! Initialize a timer wheel.
+ * \param[out] wheel  Timer wheel to initialize.
+ * \param[in] tick_ms  Resolution of the timers: they expire up to twice this long after their time. */
+void timer_wheel_init(struct timer_wheel *wheel, unsigned int tick_ms)
+{
+	int i;
+
+	memset(wheel, 0, sizeof(*wheel));
+	wheel->tick_ms = tick_ms ? : 1;
+	osmo_clock_gettime(CLOCK_MONOTONIC, &wheel->base);
+	for (i = 0; i < TIMER_WHEEL_L0_SLOTS; i++)
+		INIT_LLIST_HEAD(&wheel->l0[i]);
+	for (i = 0; i < TIMER_WHEEL_L1_SLOTS; i++)
+		INIT_LLIST_HEAD(&wheel->l1[i]);
+	osmo_timer_setup(&wheel->timer, timer_wheel_timer_cb, wheel);
+}
+
+/*! Set up a timer that is not pending, like osmo_timer_setup(). */
+void timer_wheel_entry_setup(struct timer_wheel_entry *entry, void (*cb)(void *data), void *data)
+{
+	*entry = (struct timer_wheel_entry){
+		.cb = cb,
+		.data = data,
+	};
+	INIT_LLIST_HEAD(&entry->list);
+}
+
+/*! Start a timer, or restart it if it is pending.
+ * \param[in] wheel  Timer wheel to run the timer on.
+ * \param[in] entry  Timer set up by timer_wheel_entry_setup().
+ * \param[in] ms  Expire after this many milliseconds, rounded up to full ticks. */
+void timer_wheel_schedule(struct timer_wheel *wheel, struct timer_wheel_entry *entry, unsigned int ms)
+{
+	uint32_t clock = timer_wheel_clock(wheel);
+	uint32_t ticks = (ms + wheel->tick_ms - 1) / wheel->tick_ms;
+
+	timer_wheel_del(entry);
+
+	/* An empty wheel does not tick, skip the ticks that went by meanwhile */
+	if (!wheel->count)
+		wheel->now = clock;
+
+	/* The clock may be anywhere within its tick, count whole ticks from the start of the next one */
+	entry->wheel = wheel;
+	entry->expires = clock + ticks + 1;
+	timer_wheel_add(wheel, entry);
+	wheel->count++;
+
+	if (!osmo_timer_pending(&wheel->timer))
+		osmo_timer_schedule(&wheel->timer, wheel->tick_ms / 1000, (wheel->tick_ms % 1000) * 1000);
+}
+
+/*! Stop a timer, if it is pending. */
+void timer_wheel_del(struct timer_wheel_entry *entry)
+{
+	struct timer_wheel *wheel = entry->wheel;
+
+	if (!timer_wheel_pending(entry))
+		return;
+
+	llist_del_init(&entry->list);
+	wheel->count--;
+	if (!wheel->count)
+		osmo_timer_del(&wheel->timer);
+}
+
+bool timer_wheel_pending(const struct timer_wheel_entry *entry)
+{
+	return !llist_empty(&entry->list);
+}
@@ -21,6 +21,7 @@
  */
 
 #include <osmocom/core/logging.h>
+#include <osmocom/core/tdef.h>
 
 #include <osmocom/bsc/debug.h>
 
@@ -263,6 +264,124 @@ static void ts_fsm_not_initialized(struct osmo_fsm_inst *fi, uint32_t event, voi
 	osmo_fsm_inst_state_chg(fi, TS_ST_UNUSED, 0, 0);
 }
 
+static bool ts_is_dyn(const struct gsm_bts_trx_ts *ts)
+{
+	switch (ts->pchan_on_init) {
+	case GSM_PCHAN_TCH_F_TCH_H_PDCH:
+	case GSM_PCHAN_TCH_F_PDCH:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/* Whether an unused dynamic timeslot may activate PDCH */
+static bool ts_pdch_act_permitted(struct gsm_bts_trx_ts *ts)
+{
+	if (ts->trx->bts->gprs.mode == BTS_GPRS_NONE) {
+		LOG_TS(ts, LOGL_DEBUG, "GPRS mode is 'none': not activating PDCH.\n");
+		return false;
+	}
+	if (!ts->pdch_act_allowed) {
+		LOG_TS(ts, LOGL_DEBUG, "PDCH is disabled for this timeslot,"
+		       " either due to a PDCH ACT NACK, or from manual VTY command:"
+		       " not activating PDCH. (last error: %s)\n",
+		       ts->last_errmsg ? : "-");
+		return false;
+	}
+	return true;
+}
+
+static inline void ts_fsm_pdch_deact(struct osmo_fsm_inst *fi)
+{
+	osmo_fsm_inst_state_chg(fi, TS_ST_WAIT_PDCH_DEACT, CHAN_ACT_DEACT_TIMEOUT, T_CHAN_ACT_DEACT);
+}
+
+static unsigned int ts_dyn_reserve_target(const struct gsm_bts *bts)
+{
+	return bts->dyn_ts_reserve.demand ? bts->dyn_ts_reserve.num : 0;
+}
+
+/* Return the number of dynamic timeslots of bts that can serve a TCH without a PDCH deactivation, or are being
+ * switched away from PDCH with no lchan waiting yet. Do not count the timeslot 'except', if any. */
+unsigned int ts_dyn_reserve_count(struct gsm_bts *bts, const struct gsm_bts_trx_ts *except)
+{
+	struct gsm_bts_trx *trx;
+	unsigned int count = 0;
+	int i;
+
+	llist_for_each_entry(trx, &bts->trx_list, list) {
+		for (i = 0; i < ARRAY_SIZE(trx->ts); i++) {
+			struct gsm_bts_trx_ts *ts = &trx->ts[i];
+
+			if (ts == except || !ts->fi || !ts_is_dyn(ts))
+				continue;
+			if (ts->fi->state == TS_ST_UNUSED
+			    || (ts->fi->state == TS_ST_WAIT_PDCH_DEACT && !ts_lchans_waiting(ts)))
+				count++;
+		}
+	}
+	return count;
+}
+
+/* Switch idle dynamic timeslots of bts off or back on PDCH until as many are kept ready for TCH as the current voice
+ * demand asks for. */
+void ts_dyn_reserve_update(struct gsm_bts *bts)
+{
+	unsigned int target = ts_dyn_reserve_target(bts);
+	unsigned int count = ts_dyn_reserve_count(bts, NULL);
+	struct gsm_bts_trx *trx;
+	int i;
+
+	llist_for_each_entry(trx, &bts->trx_list, list) {
+		for (i = 0; i < ARRAY_SIZE(trx->ts) && count != target; i++) {
+			struct gsm_bts_trx_ts *ts = &trx->ts[i];
+
+			if (!ts->fi || !ts_is_dyn(ts) || !ts_is_usable(ts) || ts_lchans_waiting(ts))
+				continue;
+
+			if (count < target && ts->fi->state == TS_ST_PDCH) {
+				LOG_TS(ts, LOGL_DEBUG, "Switching off PDCH to keep %u dynamic timeslots ready for TCH\n",
+				       target);
+				ts_fsm_pdch_deact(ts->fi);
+				count++;
+			} else if (count > target && ts->fi->state == TS_ST_UNUSED && ts_pdch_act_permitted(ts)) {
+				LOG_TS(ts, LOGL_DEBUG, "No longer kept ready for TCH, activating PDCH\n");
+				osmo_fsm_inst_state_chg(ts->fi, TS_ST_WAIT_PDCH_ACT, CHAN_ACT_DEACT_TIMEOUT,
+							T_CHAN_ACT_DEACT);
+				count--;
+			}
+		}
+	}
+}
+
+static void ts_dyn_reserve_idle_cb(void *data)
+{
+	struct gsm_bts *bts = data;
+
+	LOG_BTS(bts, DRSL, LOGL_DEBUG, "No TCH requested for X993104, releasing the dyn-ts-reserve to PDCH\n");
+	bts->dyn_ts_reserve.demand = false;
+	ts_dyn_reserve_update(bts);
+}
+
+/* A TCH is being requested on bts: keep 'dyn-ts-reserve' dynamic timeslots switched away from PDCH until no further
+ * TCH was requested for X993104. */
+void ts_dyn_reserve_demand(struct gsm_bts *bts)
+{
+	if (!bts->dyn_ts_reserve.num)
+		return;
+
+	if (!bts->dyn_ts_reserve.idle_timer.cb)
+		osmo_timer_setup(&bts->dyn_ts_reserve.idle_timer, ts_dyn_reserve_idle_cb, bts);
+	osmo_timer_schedule(&bts->dyn_ts_reserve.idle_timer,
+			    osmo_tdef_get(bts->network->T_defs, -993104, OSMO_TDEF_S, -1), 0);
+
+	if (bts->dyn_ts_reserve.demand)
+		return;
+	bts->dyn_ts_reserve.demand = true;
+	ts_dyn_reserve_update(bts);
+}
+
 static void ts_fsm_unused_onenter(struct osmo_fsm_inst *fi, uint32_t prev_state)
 {
 	struct gsm_bts_trx_ts *ts = ts_fi_ts(fi);
@@ -277,18 +396,17 @@ static void ts_fsm_unused_onenter(struct osmo_fsm_inst *fi, uint32_t prev_state)
 		return;
 	}
 
+	ts->dyn_reserve_kept = false;
+
 	switch (ts->pchan_on_init) {
 	case GSM_PCHAN_TCH_F_TCH_H_PDCH:
 	case GSM_PCHAN_TCH_F_PDCH:
-		if (bts->gprs.mode == BTS_GPRS_NONE) {
-			LOG_TS(ts, LOGL_DEBUG, "GPRS mode is 'none': not activating PDCH.\n");
+		if (!ts_pdch_act_permitted(ts))
 			return;
-		}
-		if (!ts->pdch_act_allowed) {
-			LOG_TS(ts, LOGL_DEBUG, "PDCH is disabled for this timeslot,"
-			       " either due to a PDCH ACT NACK, or from manual VTY command:"
-			       " not activating PDCH. (last error: %s)\n",
-			       ts->last_errmsg ? : "-");
+		if (ts_dyn_reserve_count(bts, ts) < ts_dyn_reserve_target(bts)) {
+			LOG_TS(ts, LOGL_DEBUG, "Not activating PDCH, kept ready for TCH (dyn-ts-reserve %u)\n",
+			       bts->dyn_ts_reserve.num);
+			ts->dyn_reserve_kept = true;
 			return;
 		}
 		osmo_fsm_inst_state_chg(fi, TS_ST_WAIT_PDCH_ACT, CHAN_ACT_DEACT_TIMEOUT,
@@ -326,6 +444,12 @@ static void ts_fsm_unused(struct osmo_fsm_inst *fi, uint32_t event, void *data)
 				 * dyn TS this is already TCH/F, and we should never hit this. */
 			case LCHAN_IS_READY_TO_GO:
 				osmo_fsm_inst_state_chg(fi, TS_ST_IN_USE, 0, 0);
+				if (ts->dyn_reserve_kept) {
+					ts->dyn_reserve_kept = false;
+					rate_ctr_inc(&ts->trx->bts->bts_ctrs->ctr[BTS_CTR_DYN_TS_PDCH_DEACT_AVOIDED]);
+					/* This timeslot no longer counts towards the reserve, switch another one */
+					ts_dyn_reserve_update(ts->trx->bts);
+				}
 				return;
 			default:
 				osmo_fsm_inst_dispatch(lchan->fi, LCHAN_EV_TS_ERROR, NULL);
@@ -342,11 +466,6 @@ static void ts_fsm_unused(struct osmo_fsm_inst *fi, uint32_t event, void *data)
 	}
 }
 
-static inline void ts_fsm_pdch_deact(struct osmo_fsm_inst *fi)
-{
-	osmo_fsm_inst_state_chg(fi, TS_ST_WAIT_PDCH_DEACT, CHAN_ACT_DEACT_TIMEOUT, T_CHAN_ACT_DEACT);
-}
-
 static void ts_fsm_wait_pdch_act_onenter(struct osmo_fsm_inst *fi, uint32_t prev_state)
 {
 	int rc;
@@ -390,6 +509,7 @@ static void ts_fsm_wait_pdch_act(struct osmo_fsm_inst *fi, uint32_t event, void
 			case LCHAN_NEEDS_PCHAN_CHANGE:
 				/* PDCH onenter will see that the lchan is waiting and continue to switch
 				 * off PDCH right away. */
+				rate_ctr_inc(&ts->trx->bts->bts_ctrs->ctr[BTS_CTR_DYN_TS_PDCH_DEACT_WAIT]);
 				return;
 
 			default:
@@ -445,6 +565,7 @@ static void ts_fsm_pdch(struct osmo_fsm_inst *fi, uint32_t event, void *data)
 			struct gsm_lchan *lchan = data;
 			switch (is_lchan_sane(ts, lchan)) {
 			case LCHAN_NEEDS_PCHAN_CHANGE:
+				rate_ctr_inc(&ts->trx->bts->bts_ctrs->ctr[BTS_CTR_DYN_TS_PDCH_DEACT_WAIT]);
 				ts_fsm_pdch_deact(fi);
 				return;
 
@@ -521,6 +642,7 @@ static void ts_fsm_wait_pdch_deact(struct osmo_fsm_inst *fi, uint32_t event, voi
 			switch (is_lchan_sane(ts, lchan)) {
 			case LCHAN_NEEDS_PCHAN_CHANGE:
 				/* IN_USE onenter will see that the lchan is waiting and signal it. */
+				rate_ctr_inc(&ts->trx->bts->bts_ctrs->ctr[BTS_CTR_DYN_TS_PDCH_DEACT_WAIT]);
 				return;
 
 			case LCHAN_IS_READY_TO_GO:
@@ -1022,3 +1144,17 @@ bool ts_usable_as_pchan(struct gsm_bts_trx_ts *ts, enum gsm_phys_chan_config as_
 
 	return ts_is_capable_of_pchan(ts, as_pchan);
 }
+
+/* Whether the timeslot is, or is being switched to, PDCH, so that a TCH on it would wait for PDCH deactivation. */
+bool ts_is_pdch_mode(const struct gsm_bts_trx_ts *ts)
+{
+	if (!ts->fi)
+		return false;
+	switch (ts->fi->state) {
+	case TS_ST_WAIT_PDCH_ACT:
+	case TS_ST_PDCH:
+		return true;
+	default:
+		return false;
+	}
+}
@@ -0,0 +1,818 @@
+/* Columnar, append-only archive of measurement reports
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/utils.h>
+
+#include "meas_archive.h"
+
+/* File layout, all integers little endian:
+ *
+ * file header:   char magic[8]; u16 version; u16 header_len; u32 reserved;
+ * block header:  u32 magic; u32 block_len; u32 num_rec; u32 dict_len; u32 num_str; u32 reserved;
+ *                i64 t_min_ms; i64 t_max_ms;
+ * dictionary:    num_str NUL terminated strings, dict_len bytes in total, padded to 8 bytes
+ * columns:       for each entry of cols[] in order: num_rec * count values of width bytes, padded to 8 bytes
+ */
+#define FILE_MAGIC		"OSMOMEAR"
+#define FILE_HDR_LEN		16
+#define BLOCK_MAGIC		0x4b4c424d	/* "MBLK" */
+#define BLOCK_HDR_LEN		40
+
+#define STR_MAX_LEN		255
+#define DICT_HASH_SIZE		32768	/* power of two, above 3 strings per record */
+
+#define PAD8(x)			(((x) + 7) & ~(size_t)7)
+
+enum col {
+	COL_TIME,
+	COL_IMSI,
+	COL_NAME,
+	COL_SCENARIO,
+	COL_BTS_NR,
+	COL_TRX_NR,
+	COL_TS_NR,
+	COL_SS_NR,
+	COL_LCHAN_TYPE,
+	COL_PCHAN_TYPE,
+	COL_NR,
+	COL_FLAGS,
+	COL_UL_FULL_LEV,
+	COL_UL_SUB_LEV,
+	COL_UL_FULL_QUAL,
+	COL_UL_SUB_QUAL,
+	COL_DL_FULL_LEV,
+	COL_DL_SUB_LEV,
+	COL_DL_FULL_QUAL,
+	COL_DL_SUB_QUAL,
+	COL_BS_POWER,
+	COL_MS_TO,
+	COL_MS_L1_PWR,
+	COL_MS_L1_TA,
+	COL_NUM_CELL,
+	COL_CELL_RXLEV,
+	COL_CELL_BSIC,
+	COL_CELL_NEIGH_IDX,
+	COL_CELL_ARFCN,
+	_NUM_COLS
+};
+
+#define NUM_CELLS	ARRAY_SIZE(((struct gsm_meas_rep *)0)->cell)
+
+/* Byte width of one value, and number of values per report */
+static const struct {
+	uint8_t width;
+	uint8_t count;
+} cols[_NUM_COLS] = {
+	[COL_TIME]		= { 8, 1 },
+	[COL_IMSI]		= { 2, 1 },
+	[COL_NAME]		= { 2, 1 },
+	[COL_SCENARIO]		= { 2, 1 },
+	[COL_BTS_NR]		= { 1, 1 },
+	[COL_TRX_NR]		= { 1, 1 },
+	[COL_TS_NR]		= { 1, 1 },
+	[COL_SS_NR]		= { 1, 1 },
+	[COL_LCHAN_TYPE]	= { 1, 1 },
+	[COL_PCHAN_TYPE]	= { 1, 1 },
+	[COL_NR]		= { 1, 1 },
+	[COL_FLAGS]		= { 1, 1 },
+	[COL_UL_FULL_LEV]	= { 1, 1 },
+	[COL_UL_SUB_LEV]	= { 1, 1 },
+	[COL_UL_FULL_QUAL]	= { 1, 1 },
+	[COL_UL_SUB_QUAL]	= { 1, 1 },
+	[COL_DL_FULL_LEV]	= { 1, 1 },
+	[COL_DL_SUB_LEV]	= { 1, 1 },
+	[COL_DL_FULL_QUAL]	= { 1, 1 },
+	[COL_DL_SUB_QUAL]	= { 1, 1 },
+	[COL_BS_POWER]		= { 1, 1 },
+	[COL_MS_TO]		= { 2, 1 },
+	[COL_MS_L1_PWR]		= { 1, 1 },
+	[COL_MS_L1_TA]		= { 1, 1 },
+	[COL_NUM_CELL]		= { 1, 1 },
+	[COL_CELL_RXLEV]	= { 1, NUM_CELLS },
+	[COL_CELL_BSIC]		= { 1, NUM_CELLS },
+	[COL_CELL_NEIGH_IDX]	= { 1, NUM_CELLS },
+	[COL_CELL_ARFCN]	= { 2, NUM_CELLS },
+};
+
+static void put_le(uint8_t *p, unsigned int width, uint64_t v)
+{
+	unsigned int i;
+
+	for (i = 0; i < width; i++, v >>= 8)
+		p[i] = v & 0xff;
+}
+
+static uint64_t get_le(const uint8_t *p, unsigned int width)
+{
+	uint64_t v = 0;
+	unsigned int i;
+
+	for (i = width; i > 0; i--)
+		v = (v << 8) | p[i - 1];
+	return v;
+}
+
+static size_t col_size(enum col c, unsigned int num_rec)
+{
+	return PAD8((size_t)num_rec * cols[c].width * cols[c].count);
+}
+
+/* Value of column c, element k, of a report; strings are handled by the callers via dictionary indexes */
+static uint64_t rec_get(const struct meas_archive_rec *rec, enum col c, unsigned int k)
+{
+	const struct gsm_meas_rep *mr = &rec->mr;
+
+	switch (c) {
+	case COL_TIME:		return (uint64_t)rec->time_ms;
+	case COL_BTS_NR:	return rec->bts_nr;
+	case COL_TRX_NR:	return rec->trx_nr;
+	case COL_TS_NR:		return rec->ts_nr;
+	case COL_SS_NR:		return rec->ss_nr;
+	case COL_LCHAN_TYPE:	return rec->lchan_type;
+	case COL_PCHAN_TYPE:	return rec->pchan_type;
+	case COL_NR:		return mr->nr;
+	case COL_FLAGS:		return mr->flags;
+	case COL_UL_FULL_LEV:	return mr->ul.full.rx_lev;
+	case COL_UL_SUB_LEV:	return mr->ul.sub.rx_lev;
+	case COL_UL_FULL_QUAL:	return mr->ul.full.rx_qual;
+	case COL_UL_SUB_QUAL:	return mr->ul.sub.rx_qual;
+	case COL_DL_FULL_LEV:	return mr->dl.full.rx_lev;
+	case COL_DL_SUB_LEV:	return mr->dl.sub.rx_lev;
+	case COL_DL_FULL_QUAL:	return mr->dl.full.rx_qual;
+	case COL_DL_SUB_QUAL:	return mr->dl.sub.rx_qual;
+	case COL_BS_POWER:	return mr->bs_power;
+	case COL_MS_TO:		return (uint16_t)mr->ms_timing_offset;
+	case COL_MS_L1_PWR:	return (uint8_t)mr->ms_l1.pwr;
+	case COL_MS_L1_TA:	return mr->ms_l1.ta;
+	case COL_NUM_CELL:	return OSMO_MAX(0, OSMO_MIN(mr->num_cell, (int)NUM_CELLS));
+	case COL_CELL_RXLEV:	return mr->cell[k].rxlev;
+	case COL_CELL_BSIC:	return mr->cell[k].bsic;
+	case COL_CELL_NEIGH_IDX: return mr->cell[k].neigh_idx;
+	case COL_CELL_ARFCN:	return mr->cell[k].arfcn;
+	default:		return 0;
+	}
+}
+
+static void rec_set(struct meas_archive_rec *rec, enum col c, unsigned int k, uint64_t v)
+{
+	struct gsm_meas_rep *mr = &rec->mr;
+
+	switch (c) {
+	case COL_TIME:		rec->time_ms = (int64_t)v; break;
+	case COL_BTS_NR:	rec->bts_nr = v; break;
+	case COL_TRX_NR:	rec->trx_nr = v; break;
+	case COL_TS_NR:		rec->ts_nr = v; break;
+	case COL_SS_NR:		rec->ss_nr = v; break;
+	case COL_LCHAN_TYPE:	rec->lchan_type = v; break;
+	case COL_PCHAN_TYPE:	rec->pchan_type = v; break;
+	case COL_NR:		mr->nr = v; break;
+	case COL_FLAGS:		mr->flags = v; break;
+	case COL_UL_FULL_LEV:	mr->ul.full.rx_lev = v; break;
+	case COL_UL_SUB_LEV:	mr->ul.sub.rx_lev = v; break;
+	case COL_UL_FULL_QUAL:	mr->ul.full.rx_qual = v; break;
+	case COL_UL_SUB_QUAL:	mr->ul.sub.rx_qual = v; break;
+	case COL_DL_FULL_LEV:	mr->dl.full.rx_lev = v; break;
+	case COL_DL_SUB_LEV:	mr->dl.sub.rx_lev = v; break;
+	case COL_DL_FULL_QUAL:	mr->dl.full.rx_qual = v; break;
+	case COL_DL_SUB_QUAL:	mr->dl.sub.rx_qual = v; break;
+	case COL_BS_POWER:	mr->bs_power = v; break;
+	case COL_MS_TO:		mr->ms_timing_offset = (int16_t)(uint16_t)v; break;
+	case COL_MS_L1_PWR:	mr->ms_l1.pwr = (int8_t)(uint8_t)v; break;
+	case COL_MS_L1_TA:	mr->ms_l1.ta = v; break;
+	case COL_NUM_CELL:	mr->num_cell = OSMO_MIN(v, NUM_CELLS); break;
+	case COL_CELL_RXLEV:	mr->cell[k].rxlev = v; break;
+	case COL_CELL_BSIC:	mr->cell[k].bsic = v; break;
+	case COL_CELL_NEIGH_IDX: mr->cell[k].neigh_idx = v; break;
+	case COL_CELL_ARFCN:	mr->cell[k].arfcn = v; break;
+	default:		break;
+	}
+}
+
+static bool col_is_str(enum col c)
+{
+	return c == COL_IMSI || c == COL_NAME || c == COL_SCENARIO;
+}
+
+/* Size of a block without any padding at its end */
+static size_t block_min_len(uint32_t num_rec, uint32_t dict_len)
+{
+	size_t len = BLOCK_HDR_LEN + PAD8((size_t)dict_len);
+	enum col c;
+
+	for (c = 0; c < _NUM_COLS; c++)
+		len += col_size(c, num_rec);
+	return len;
+}
+
+static bool block_hdr_valid(const uint8_t *map, size_t size, size_t off)
+{
+	const uint8_t *blk = map + off;
+	uint32_t block_len, num_rec;
+
+	if (off + BLOCK_HDR_LEN > size)
+		return false;
+	block_len = get_le(blk + 4, 4);
+	num_rec = get_le(blk + 8, 4);
+	return get_le(blk, 4) == BLOCK_MAGIC && block_len >= BLOCK_HDR_LEN && block_len <= size - off
+		&& num_rec <= MEAS_ARCHIVE_BLOCK_RECS && block_min_len(num_rec, get_le(blk + 12, 4)) <= block_len;
+}
+
+/* A block torn in the middle of the archive still claims its full length, which then ends within whatever was
+ * written after it. A complete block is followed by the end of the archive or the start of another block. */
+static bool block_valid(const uint8_t *map, size_t size, size_t off)
+{
+	size_t end;
+
+	if (!block_hdr_valid(map, size, off))
+		return false;
+	end = off + get_le(map + off + 4, 4);
+	return end + 4 > size || get_le(map + end, 4) == BLOCK_MAGIC;
+}
+
+/* Return the offset of the first complete block at or after off, or size if there is none. Anything in between is
+ * the remainder of a torn block, which is resynchronized on by searching for the next valid block header. */
+static size_t block_find(const uint8_t *map, size_t size, size_t off)
+{
+	for (; off + BLOCK_HDR_LEN <= size; off++) {
+		if (block_valid(map, size, off))
+			return off;
+	}
+	return size;
+}
+
+/***********************************************************************
+ * Writer
+ ***********************************************************************/
+
+struct meas_archive_writer {
+	int fd;
+	/* End of the last completely written block */
+	off_t size;
+	/* A torn block could not be cut off, refuse to append behind it */
+	bool failed;
+
+	/* The block being collected */
+	unsigned int num_rec;
+	struct meas_archive_rec *recs;
+	/* Dictionary indexes of imsi, name and scenario of each report */
+	uint16_t (*str_idx)[3];
+	int64_t t_min;
+	int64_t t_max;
+
+	/* String dictionary of the block */
+	char *dict;
+	size_t dict_len;
+	uint32_t *dict_off;
+	unsigned int num_str;
+	/* Open addressing hash of dictionary index + 1, 0 is a free slot */
+	uint16_t *dict_hash;
+
+	/* Serialization buffer, written with a single write() per block */
+	uint8_t *buf;
+};
+
+static uint32_t str_hash(const char *s, size_t len)
+{
+	uint32_t h = 2166136261u;
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		h ^= (uint8_t)s[i];
+		h *= 16777619u;
+	}
+	return h;
+}
+
+static uint16_t dict_idx(struct meas_archive_writer *w, const char *s)
+{
+	size_t len;
+	uint32_t slot;
+
+	if (!s)
+		s = "";
+	len = strnlen(s, STR_MAX_LEN);
+
+	for (slot = str_hash(s, len) & (DICT_HASH_SIZE - 1); w->dict_hash[slot];
+	     slot = (slot + 1) & (DICT_HASH_SIZE - 1)) {
+		const char *d = w->dict + w->dict_off[w->dict_hash[slot] - 1];
+		if (!memcmp(d, s, len) && d[len] == '\0')
+			return w->dict_hash[slot] - 1;
+	}
+
+	w->dict = talloc_realloc_size(w, w->dict, w->dict_len + len + 1);
+	OSMO_ASSERT(w->dict);
+	memcpy(w->dict + w->dict_len, s, len);
+	w->dict[w->dict_len + len] = '\0';
+	w->dict_off[w->num_str] = w->dict_len;
+	w->dict_len += len + 1;
+	w->dict_hash[slot] = ++w->num_str;
+
+	return w->num_str - 1;
+}
+
+static int write_all(int fd, const uint8_t *buf, size_t len)
+{
+	while (len) {
+		ssize_t rc = write(fd, buf, len);
+		if (rc < 0) {
+			if (errno == EINTR)
+				continue;
+			return -errno;
+		}
+		buf += rc;
+		len -= rc;
+	}
+	return 0;
+}
+
+/* Walk the blocks of an existing archive and cut off a trailing block that was torn by a crash, so that appending
+ * continues on a block boundary. Return the resulting file size, or negative on error. */
+static off_t writer_recover(int fd, off_t size)
+{
+	const uint8_t *map;
+	size_t off = FILE_HDR_LEN;
+	size_t end = off;
+
+	map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (map == MAP_FAILED)
+		return -errno;
+	while ((off = block_find(map, size, off)) < size) {
+		off += get_le(map + off + 4, 4);
+		end = off;
+	}
+	munmap((void *)map, size);
+
+	if (end < size) {
+		fprintf(stderr, "Discarding %lld bytes of incomplete data at the end of the archive\n",
+			(long long)(size - end));
+		if (ftruncate(fd, end) < 0)
+			return -errno;
+	}
+	if (lseek(fd, end, SEEK_SET) < 0)
+		return -errno;
+	return end;
+}
+
+/* Cut off what a failed write left of a block, so that the next block follows the last complete one */
+static int writer_truncate(struct meas_archive_writer *w)
+{
+	if (ftruncate(w->fd, w->size) < 0 || lseek(w->fd, w->size, SEEK_SET) < 0) {
+		fprintf(stderr, "Unable to cut off an incomplete block: %s\n", strerror(errno));
+		w->failed = true;
+		return -errno;
+	}
+	return 0;
+}
+
+static int writer_destructor(struct meas_archive_writer *w)
+{
+	if (w->fd >= 0)
+		close(w->fd);
+	return 0;
+}
+
+/* Open an archive for appending, creating it if needed */
+struct meas_archive_writer *meas_archive_writer_open(void *ctx, const char *fname)
+{
+	struct meas_archive_writer *w;
+	uint8_t hdr[FILE_HDR_LEN];
+	struct stat st;
+
+	w = talloc_zero(ctx, struct meas_archive_writer);
+	if (!w)
+		return NULL;
+	w->fd = -1;
+	talloc_set_destructor(w, writer_destructor);
+
+	w->recs = talloc_zero_array(w, struct meas_archive_rec, MEAS_ARCHIVE_BLOCK_RECS);
+	w->str_idx = talloc_zero_size(w, sizeof(*w->str_idx) * MEAS_ARCHIVE_BLOCK_RECS);
+	w->dict_off = talloc_zero_array(w, uint32_t, 3 * MEAS_ARCHIVE_BLOCK_RECS);
+	w->dict_hash = talloc_zero_array(w, uint16_t, DICT_HASH_SIZE);
+	if (!w->recs || !w->str_idx || !w->dict_off || !w->dict_hash)
+		goto err;
+
+	w->fd = open(fname, O_RDWR | O_CREAT, 0644);
+	if (w->fd < 0) {
+		fprintf(stderr, "Unable to open %s: %s\n", fname, strerror(errno));
+		goto err;
+	}
+	if (fstat(w->fd, &st) < 0)
+		goto err;
+
+	if (st.st_size == 0) {
+		memset(hdr, 0, sizeof(hdr));
+		memcpy(hdr, FILE_MAGIC, 8);
+		put_le(hdr + 8, 2, MEAS_ARCHIVE_VERSION);
+		put_le(hdr + 10, 2, FILE_HDR_LEN);
+		if (write_all(w->fd, hdr, sizeof(hdr)) < 0)
+			goto err;
+		w->size = FILE_HDR_LEN;
+		return w;
+	}
+
+	if (pread(w->fd, hdr, sizeof(hdr), 0) != sizeof(hdr) || memcmp(hdr, FILE_MAGIC, 8)
+	    || get_le(hdr + 8, 2) != MEAS_ARCHIVE_VERSION) {
+		fprintf(stderr, "%s is not a version %u measurement archive\n", fname, MEAS_ARCHIVE_VERSION);
+		goto err;
+	}
+	w->size = writer_recover(w->fd, st.st_size);
+	if (w->size < 0)
+		goto err;
+
+	return w;
+err:
+	talloc_free(w);
+	return NULL;
+}
+
+/* Add a report to the current block; the block is written once it is full, or by meas_archive_flush(). */
+int meas_archive_append(struct meas_archive_writer *w, const struct meas_archive_rec *rec)
+{
+	unsigned int i = w->num_rec;
+
+	w->recs[i] = *rec;
+	w->recs[i].mr.lchan = NULL;
+	w->str_idx[i][0] = dict_idx(w, rec->imsi);
+	w->str_idx[i][1] = dict_idx(w, rec->name);
+	w->str_idx[i][2] = dict_idx(w, rec->scenario);
+
+	if (!i || rec->time_ms < w->t_min)
+		w->t_min = rec->time_ms;
+	if (!i || rec->time_ms > w->t_max)
+		w->t_max = rec->time_ms;
+
+	if (++w->num_rec >= MEAS_ARCHIVE_BLOCK_RECS)
+		return meas_archive_flush(w);
+	return 0;
+}
+
+/* Write out the current block, if it holds any reports */
+int meas_archive_flush(struct meas_archive_writer *w)
+{
+	uint8_t *buf;
+	size_t len, off;
+	unsigned int i, k;
+	enum col c;
+	int rc;
+
+	if (!w->num_rec)
+		return 0;
+	if (w->failed) {
+		rc = -EIO;
+		goto out;
+	}
+
+	len = block_min_len(w->num_rec, w->dict_len);
+	buf = talloc_realloc_size(w, w->buf, len);
+	if (!buf) {
+		rc = -ENOMEM;
+		goto out;
+	}
+	w->buf = buf;
+	memset(w->buf, 0, len);
+
+	put_le(w->buf + 0, 4, BLOCK_MAGIC);
+	put_le(w->buf + 4, 4, len);
+	put_le(w->buf + 8, 4, w->num_rec);
+	put_le(w->buf + 12, 4, w->dict_len);
+	put_le(w->buf + 16, 4, w->num_str);
+	put_le(w->buf + 24, 8, (uint64_t)w->t_min);
+	put_le(w->buf + 32, 8, (uint64_t)w->t_max);
+	off = BLOCK_HDR_LEN;
+
+	memcpy(w->buf + off, w->dict, w->dict_len);
+	off += PAD8(w->dict_len);
+
+	for (c = 0; c < _NUM_COLS; c++) {
+		uint8_t *p = w->buf + off;
+		for (i = 0; i < w->num_rec; i++) {
+			for (k = 0; k < cols[c].count; k++) {
+				uint64_t v;
+				if (col_is_str(c))
+					v = w->str_idx[i][c - COL_IMSI];
+				else
+					v = rec_get(&w->recs[i], c, k);
+				put_le(p, cols[c].width, v);
+				p += cols[c].width;
+			}
+		}
+		off += col_size(c, w->num_rec);
+	}
+
+	rc = write_all(w->fd, w->buf, len);
+	if (rc == 0)
+		w->size += len;
+	else
+		writer_truncate(w);
+
+out:
+	w->num_rec = 0;
+	w->dict_len = 0;
+	w->num_str = 0;
+	memset(w->dict_hash, 0, DICT_HASH_SIZE * sizeof(*w->dict_hash));
+
+	return rc;
+}
+
+int meas_archive_writer_close(struct meas_archive_writer *w)
+{
+	int rc = meas_archive_flush(w);
+
+	if (fsync(w->fd) < 0 && !rc)
+		rc = -errno;
+	talloc_free(w);
+	return rc;
+}
+
+/***********************************************************************
+ * Reader
+ ***********************************************************************/
+
+struct meas_archive_reader {
+	const uint8_t *map;
+	size_t size;
+	/* Offset of the next block to load */
+	size_t off;
+	unsigned int blocks_skipped;
+
+	/* The current block */
+	bool in_block;
+	uint32_t num_rec;
+	uint32_t rec_idx;
+	int64_t t_min;
+	int64_t t_max;
+	const uint8_t *col[_NUM_COLS];
+	const char **strs;
+	unsigned int num_str;
+	unsigned int strs_alloc;
+	/* Dictionary index of the filter's IMSI and BTS name in the current block */
+	int imsi_idx;
+	int name_idx;
+};
+
+static int reader_destructor(struct meas_archive_reader *r)
+{
+	if (r->map)
+		munmap((void *)r->map, r->size);
+	return 0;
+}
+
+struct meas_archive_reader *meas_archive_reader_open(void *ctx, const char *fname)
+{
+	struct meas_archive_reader *r;
+	struct stat st;
+	void *map;
+	int fd;
+
+	fd = open(fname, O_RDONLY);
+	if (fd < 0) {
+		fprintf(stderr, "Unable to open %s: %s\n", fname, strerror(errno));
+		return NULL;
+	}
+	if (fstat(fd, &st) < 0 || st.st_size < FILE_HDR_LEN) {
+		fprintf(stderr, "%s is not a measurement archive\n", fname);
+		close(fd);
+		return NULL;
+	}
+
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		fprintf(stderr, "Unable to map %s: %s\n", fname, strerror(errno));
+		return NULL;
+	}
+	madvise(map, st.st_size, MADV_SEQUENTIAL);
+
+	r = talloc_zero(ctx, struct meas_archive_reader);
+	if (!r) {
+		munmap(map, st.st_size);
+		return NULL;
+	}
+	r->map = map;
+	r->size = st.st_size;
+	talloc_set_destructor(r, reader_destructor);
+
+	if (memcmp(r->map, FILE_MAGIC, 8) || get_le(r->map + 8, 2) != MEAS_ARCHIVE_VERSION) {
+		fprintf(stderr, "%s is not a version %u measurement archive\n", fname, MEAS_ARCHIVE_VERSION);
+		talloc_free(r);
+		return NULL;
+	}
+
+	meas_archive_rewind(r);
+	return r;
+}
+
+void meas_archive_rewind(struct meas_archive_reader *r)
+{
+	r->off = get_le(r->map + 10, 2);
+	r->in_block = false;
+	r->blocks_skipped = 0;
+}
+
+unsigned int meas_archive_blocks_skipped(const struct meas_archive_reader *r)
+{
+	return r->blocks_skipped;
+}
+
+void meas_archive_reader_close(struct meas_archive_reader *r)
+{
+	talloc_free(r);
+}
+
+/* Set up the next complete block at or after r->off, skipping torn blocks; return 1 on success, 0 at the end of the
+ * archive, negative on a corrupt block. */
+static int block_load(struct meas_archive_reader *r)
+{
+	const uint8_t *blk;
+	uint32_t block_len, dict_len, num_str;
+	size_t off, next;
+	unsigned int i;
+	enum col c;
+
+	next = block_find(r->map, r->size, r->off);
+	if (next != r->off) {
+		if (next < r->size)
+			fprintf(stderr, "Skipping %zu bytes of incomplete data at offset %zu\n", next - r->off, r->off);
+		else
+			fprintf(stderr, "Ignoring %zu bytes of incomplete data at the end of the archive\n",
+				r->size - r->off);
+		r->off = next;
+	}
+	if (r->off >= r->size)
+		return 0;
+
+	blk = r->map + r->off;
+	block_len = get_le(blk + 4, 4);
+	r->num_rec = get_le(blk + 8, 4);
+	dict_len = get_le(blk + 12, 4);
+	num_str = get_le(blk + 16, 4);
+	r->t_min = (int64_t)get_le(blk + 24, 8);
+	r->t_max = (int64_t)get_le(blk + 32, 8);
+
+	if (num_str > dict_len)
+		goto corrupt;
+
+	off = BLOCK_HDR_LEN + PAD8(dict_len);
+
+	for (c = 0; c < _NUM_COLS; c++) {
+		r->col[c] = blk + off;
+		off += col_size(c, r->num_rec);
+	}
+
+	if (num_str > r->strs_alloc) {
+		r->strs = talloc_realloc(r, r->strs, const char *, num_str);
+		if (!r->strs)
+			return -ENOMEM;
+		r->strs_alloc = num_str;
+	}
+	for (i = 0, off = 0; i < num_str; i++) {
+		const char *s = (const char *)blk + BLOCK_HDR_LEN + off;
+		const char *nul = memchr(s, '\0', dict_len - off);
+		if (!nul)
+			goto corrupt;
+		r->strs[i] = s;
+		off += nul - s + 1;
+	}
+	r->num_str = num_str;
+
+	r->off += block_len;
+	return 1;
+
+corrupt:
+	fprintf(stderr, "Corrupt archive block at offset %zu\n", r->off);
+	return -EINVAL;
+}
+
+static int dict_find(const struct meas_archive_reader *r, const char *s)
+{
+	unsigned int i;
+
+	for (i = 0; i < r->num_str; i++) {
+		if (!strcmp(r->strs[i], s))
+			return i;
+	}
+	return -1;
+}
+
+/* Decide from the block header and dictionary alone whether any report of the block can match */
+static bool block_matches(struct meas_archive_reader *r, const struct meas_archive_filter *f)
+{
+	if (f->from_ms && r->t_max < f->from_ms)
+		return false;
+	if (f->to_ms && r->t_min > f->to_ms)
+		return false;
+
+	r->imsi_idx = f->imsi ? dict_find(r, f->imsi) : -1;
+	if (f->imsi && r->imsi_idx < 0)
+		return false;
+
+	r->name_idx = f->name ? dict_find(r, f->name) : -1;
+	if (f->name && r->name_idx < 0)
+		return false;
+
+	return true;
+}
+
+static uint64_t col_get(const struct meas_archive_reader *r, enum col c, unsigned int i, unsigned int k)
+{
+	return get_le(r->col[c] + (i * cols[c].count + k) * cols[c].width, cols[c].width);
+}
+
+/* Only the columns used by the filter are looked at */
+static bool rec_matches(const struct meas_archive_reader *r, const struct meas_archive_filter *f, unsigned int i)
+{
+	if (f->imsi && col_get(r, COL_IMSI, i, 0) != r->imsi_idx)
+		return false;
+	if (f->name && col_get(r, COL_NAME, i, 0) != r->name_idx)
+		return false;
+	if (f->bts_nr >= 0 && col_get(r, COL_BTS_NR, i, 0) != f->bts_nr)
+		return false;
+	if (f->from_ms || f->to_ms) {
+		int64_t t = (int64_t)col_get(r, COL_TIME, i, 0);
+		if (f->from_ms && t < f->from_ms)
+			return false;
+		if (f->to_ms && t > f->to_ms)
+			return false;
+	}
+	return true;
+}
+
+static const char *rec_str(const struct meas_archive_reader *r, enum col c, unsigned int i)
+{
+	uint64_t idx = col_get(r, c, i, 0);
+
+	return idx < r->num_str ? r->strs[idx] : "";
+}
+
+static void rec_decode(const struct meas_archive_reader *r, unsigned int i, struct meas_archive_rec *rec)
+{
+	unsigned int k;
+	enum col c;
+
+	memset(rec, 0, sizeof(*rec));
+	for (c = 0; c < _NUM_COLS; c++) {
+		if (col_is_str(c))
+			continue;
+		for (k = 0; k < cols[c].count; k++)
+			rec_set(rec, c, k, col_get(r, c, i, k));
+	}
+	rec->imsi = rec_str(r, COL_IMSI, i);
+	rec->name = rec_str(r, COL_NAME, i);
+	rec->scenario = rec_str(r, COL_SCENARIO, i);
+}
+
+/* Return the next report matching the filter in rec: 1 if found, 0 at the end of the archive, negative on error.
+ * The strings in rec point into the mapped archive and stay valid until the reader is closed. */
+int meas_archive_next(struct meas_archive_reader *r, const struct meas_archive_filter *f,
+		      struct meas_archive_rec *rec)
+{
+	int rc;
+
+	while (1) {
+		if (!r->in_block) {
+			rc = block_load(r);
+			if (rc <= 0)
+				return rc;
+			if (!block_matches(r, f)) {
+				r->blocks_skipped++;
+				continue;
+			}
+			r->in_block = true;
+			r->rec_idx = 0;
+		}
+
+		while (r->rec_idx < r->num_rec) {
+			unsigned int i = r->rec_idx++;
+			if (!rec_matches(r, f, i))
+				continue;
+			rec_decode(r, i, rec);
+			return 1;
+		}
+		r->in_block = false;
+	}
+}
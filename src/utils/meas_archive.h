@@ -0,0 +1,65 @@
+#ifndef OPENBSC_MEAS_ARCHIVE_H
+#define OPENBSC_MEAS_ARCHIVE_H
+
+/* Compact, append-only, columnar archive of measurement reports.
+ *
+ * The file starts with a header, followed by self-contained blocks of up to MEAS_ARCHIVE_BLOCK_RECS reports. Each
+ * block carries its time range and a dictionary of the IMSI, BTS name and scenario strings it uses, followed by
+ * one column per report field. All integers are stored little endian at fixed widths, so that archives can be
+ * exchanged between hosts, unlike the in-memory struct gsm_meas_rep sent in the meas_feed. Readers mmap() the
+ * file and skip whole blocks by time range or dictionary before looking at any column. A block torn by a failed
+ * write or a crash is cut off by the writer, and skipped by readers. */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <osmocom/bsc/meas_rep.h>
+
+#define MEAS_ARCHIVE_VERSION		1
+#define MEAS_ARCHIVE_BLOCK_RECS		4096
+
+struct meas_archive_rec {
+	/* Milliseconds since the epoch */
+	int64_t time_ms;
+	const char *imsi;
+	/* BTS name */
+	const char *name;
+	const char *scenario;
+	uint8_t bts_nr;
+	uint8_t trx_nr;
+	uint8_t ts_nr;
+	uint8_t ss_nr;
+	/* enum gsm_chan_t */
+	uint8_t lchan_type;
+	/* enum gsm_phys_chan_config */
+	uint8_t pchan_type;
+	struct gsm_meas_rep mr;
+};
+
+/* Select reports; NULL or negative members match anything, time bounds of 0 are open. */
+struct meas_archive_filter {
+	const char *imsi;
+	const char *name;
+	int bts_nr;
+	int64_t from_ms;
+	int64_t to_ms;
+};
+
+#define MEAS_ARCHIVE_FILTER_ALL { .bts_nr = -1 }
+
+struct meas_archive_writer;
+struct meas_archive_reader;
+
+struct meas_archive_writer *meas_archive_writer_open(void *ctx, const char *fname);
+int meas_archive_append(struct meas_archive_writer *w, const struct meas_archive_rec *rec);
+int meas_archive_flush(struct meas_archive_writer *w);
+int meas_archive_writer_close(struct meas_archive_writer *w);
+
+struct meas_archive_reader *meas_archive_reader_open(void *ctx, const char *fname);
+int meas_archive_next(struct meas_archive_reader *r, const struct meas_archive_filter *f,
+		      struct meas_archive_rec *rec);
+void meas_archive_rewind(struct meas_archive_reader *r);
+unsigned int meas_archive_blocks_skipped(const struct meas_archive_reader *r);
+void meas_archive_reader_close(struct meas_archive_reader *r);
+
+#endif
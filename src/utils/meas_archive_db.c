@@ -0,0 +1,126 @@
+/* convert between columnar measurement archives and the SQLite3 measurement database
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <string.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include <osmocom/core/utils.h>
+
+#include <osmocom/bsc/meas_rep.h>
+
+#include "meas_db.h"
+#include "meas_archive.h"
+
+static unsigned long long num_converted;
+
+static int archive_to_db(const char *archive_fname, const char *db_fname)
+{
+	struct meas_archive_filter filter = MEAS_ARCHIVE_FILTER_ALL;
+	struct meas_archive_reader *r;
+	struct meas_archive_rec rec;
+	struct meas_db_state *db;
+	int rc;
+
+	r = meas_archive_reader_open(NULL, archive_fname);
+	if (!r)
+		return -EIO;
+
+	db = meas_db_open(NULL, db_fname);
+	if (!db) {
+		meas_archive_reader_close(r);
+		return -EIO;
+	}
+
+	rc = meas_db_begin(db);
+	while (rc >= 0 && (rc = meas_archive_next(r, &filter, &rec)) > 0) {
+		rc = meas_db_insert(db, rec.imsi, rec.name, rec.time_ms / 1000,
+				    rec.scenario[0] ? rec.scenario : NULL, &rec.mr);
+		num_converted++;
+	}
+	if (rc >= 0)
+		rc = meas_db_commit(db);
+
+	meas_db_close(db);
+	meas_archive_reader_close(r);
+	return rc;
+}
+
+static int db_rep_cb(void *data, unsigned long timestamp, const char *imsi, const char *name,
+		     const char *scenario, const struct gsm_meas_rep *mr)
+{
+	struct meas_archive_writer *w = data;
+	struct meas_archive_rec rec = {
+		.time_ms = (int64_t)timestamp * 1000,
+		.imsi = imsi,
+		.name = name,
+		.scenario = scenario,
+		.mr = *mr,
+	};
+
+	num_converted++;
+	return meas_archive_append(w, &rec);
+}
+
+static int db_to_archive(const char *db_fname, const char *archive_fname)
+{
+	struct meas_archive_writer *w;
+	struct meas_db_state *db;
+	int rc;
+
+	db = meas_db_open(NULL, db_fname);
+	if (!db)
+		return -EIO;
+
+	w = meas_archive_writer_open(NULL, archive_fname);
+	if (!w) {
+		meas_db_close(db);
+		return -EIO;
+	}
+
+	rc = meas_db_foreach(db, db_rep_cb, w);
+	if (meas_archive_writer_close(w) < 0 && rc >= 0)
+		rc = -EIO;
+
+	meas_db_close(db);
+	return rc;
+}
+
+int main(int argc, char **argv)
+{
+	int rc;
+
+	if (argc < 4) {
+		fprintf(stderr, "Usage: osmo-meas-archive-db to-db ARCHIVE DATABASE\n"
+			"       osmo-meas-archive-db from-db DATABASE ARCHIVE\n"
+			"The database lacks the channel and neighbor cell details, from-db leaves them zero.\n");
+		exit(2);
+	}
+
+	if (!strcmp(argv[1], "to-db"))
+		rc = archive_to_db(argv[2], argv[3]);
+	else if (!strcmp(argv[1], "from-db"))
+		rc = db_to_archive(argv[2], argv[3]);
+	else {
+		fprintf(stderr, "Unknown command '%s'\n", argv[1]);
+		exit(2);
+	}
+
+	fprintf(stderr, "Converted %llu reports\n", num_converted);
+	exit(rc < 0 ? 1 : 0);
+}
@@ -0,0 +1,228 @@
+/* convert between columnar measurement archives and pcap traces of the meas_feed
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <string.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include <netinet/in.h>
+#include <netinet/ip.h>
+#include <netinet/udp.h>
+
+#include <osmocom/core/utils.h>
+
+#include <osmocom/bsc/meas_feed.h>
+
+#include <pcap/pcap.h>
+
+#include "meas_archive.h"
+
+#define MEAS_FEED_PORT	8888
+#define ETH_HDR_LEN	14
+
+static unsigned long long num_converted;
+
+static void pcap_cb(u_char *user, const struct pcap_pkthdr *h, const u_char *bytes)
+{
+	struct meas_archive_writer *w = (struct meas_archive_writer *) user;
+	const u_char *cur = bytes;
+	const struct iphdr *ip;
+	const struct udphdr *udp;
+	struct meas_feed_meas mfm;
+	struct meas_archive_rec rec;
+
+	if (h->caplen < ETH_HDR_LEN + sizeof(*ip) + sizeof(*udp))
+		return;
+
+	/* Check if there is IPv4 in the Ethernet */
+	if (cur[12] != 0x08 || cur[13] != 0x00)
+		return;
+	cur += ETH_HDR_LEN;
+	ip = (const struct iphdr *) cur;
+
+	if (ip->version != 4 || ip->protocol != IPPROTO_UDP)
+		return;
+	cur += ip->ihl * 4;
+	if (cur + sizeof(*udp) > bytes + h->caplen)
+		return;
+
+	udp = (const struct udphdr *) cur;
+	if (udp->dest != htons(MEAS_FEED_PORT))
+		return;
+	cur += sizeof(*udp);
+	if (ntohs(udp->len) < sizeof(*udp) || cur + ntohs(udp->len) - sizeof(*udp) > bytes + h->caplen)
+		return;
+
+	if (meas_feed_meas_decode(&mfm, cur, ntohs(udp->len) - sizeof(*udp)) < 0
+	    || mfm.hdr.msg_type != MEAS_FEED_MEAS)
+		return;
+
+	rec = (struct meas_archive_rec){
+		.time_ms = (int64_t)h->ts.tv_sec * 1000 + h->ts.tv_usec / 1000,
+		.imsi = mfm.imsi,
+		.name = mfm.name,
+		.scenario = mfm.scenario,
+		.bts_nr = mfm.bts_nr,
+		.trx_nr = mfm.trx_nr,
+		.ts_nr = mfm.ts_nr,
+		.ss_nr = mfm.ss_nr,
+		.lchan_type = mfm.lchan_type,
+		.pchan_type = mfm.pchan_type,
+		.mr = mfm.mr,
+	};
+
+	if (meas_archive_append(w, &rec) == 0)
+		num_converted++;
+}
+
+static int pcap_to_archive(const char *pcap_fname, const char *archive_fname)
+{
+	char errbuf[PCAP_ERRBUF_SIZE+1];
+	struct meas_archive_writer *w;
+	pcap_t *pc;
+
+	pc = pcap_open_offline(pcap_fname, errbuf);
+	if (!pc) {
+		fprintf(stderr, "Cannot open %s: %s\n", pcap_fname, errbuf);
+		return -EIO;
+	}
+
+	w = meas_archive_writer_open(NULL, archive_fname);
+	if (!w) {
+		pcap_close(pc);
+		return -EIO;
+	}
+
+	pcap_loop(pc, 0, pcap_cb, (u_char *) w);
+	pcap_close(pc);
+
+	return meas_archive_writer_close(w);
+}
+
+static uint16_t ip_csum(const void *data, size_t len)
+{
+	const uint8_t *p = data;
+	uint32_t sum = 0;
+	size_t i;
+
+	for (i = 0; i + 1 < len; i += 2)
+		sum += (p[i] << 8) | p[i + 1];
+	while (sum >> 16)
+		sum = (sum & 0xffff) + (sum >> 16);
+	return htons(~sum & 0xffff);
+}
+
+/* Write each report as an Ethernet/IPv4/UDP frame from and to the loopback address, the way the BSC would have
+ * sent it, so that meas_pcap2db and wireshark can read the result. */
+static int archive_to_pcap(const char *archive_fname, const char *pcap_fname)
+{
+	struct meas_archive_filter filter = MEAS_ARCHIVE_FILTER_ALL;
+	struct meas_archive_reader *r;
+	struct meas_archive_rec rec;
+	pcap_t *pc;
+	pcap_dumper_t *pd;
+	uint8_t frame[ETH_HDR_LEN + sizeof(struct iphdr) + sizeof(struct udphdr) + sizeof(struct meas_feed_meas)];
+	struct iphdr *ip = (struct iphdr *) (frame + ETH_HDR_LEN);
+	struct udphdr *udp = (struct udphdr *) (ip + 1);
+	struct meas_feed_meas *mfm = (struct meas_feed_meas *) (udp + 1);
+	int rc;
+
+	r = meas_archive_reader_open(NULL, archive_fname);
+	if (!r)
+		return -EIO;
+
+	pc = pcap_open_dead(DLT_EN10MB, sizeof(frame));
+	pd = pc ? pcap_dump_open(pc, pcap_fname) : NULL;
+	if (!pd) {
+		fprintf(stderr, "Cannot create %s: %s\n", pcap_fname, pc ? pcap_geterr(pc) : "");
+		if (pc)
+			pcap_close(pc);
+		meas_archive_reader_close(r);
+		return -EIO;
+	}
+
+	memset(frame, 0, sizeof(frame));
+	frame[12] = 0x08;
+	ip->version = 4;
+	ip->ihl = sizeof(*ip) / 4;
+	ip->ttl = 64;
+	ip->protocol = IPPROTO_UDP;
+	ip->tot_len = htons(sizeof(*ip) + sizeof(*udp) + sizeof(*mfm));
+	ip->saddr = htonl(INADDR_LOOPBACK);
+	ip->daddr = htonl(INADDR_LOOPBACK);
+	ip->check = ip_csum(ip, sizeof(*ip));
+	udp->source = htons(MEAS_FEED_PORT);
+	udp->dest = htons(MEAS_FEED_PORT);
+	udp->len = htons(sizeof(*udp) + sizeof(*mfm));
+
+	while ((rc = meas_archive_next(r, &filter, &rec)) > 0) {
+		struct pcap_pkthdr h = {
+			.ts = {
+				.tv_sec = rec.time_ms / 1000,
+				.tv_usec = (rec.time_ms % 1000) * 1000,
+			},
+			.caplen = sizeof(frame),
+			.len = sizeof(frame),
+		};
+
+		memset(mfm, 0, sizeof(*mfm));
+		mfm->hdr.msg_type = MEAS_FEED_MEAS;
+		mfm->hdr.version = MEAS_FEED_VERSION;
+		osmo_strlcpy(mfm->imsi, rec.imsi, sizeof(mfm->imsi));
+		osmo_strlcpy(mfm->name, rec.name, sizeof(mfm->name));
+		osmo_strlcpy(mfm->scenario, rec.scenario, sizeof(mfm->scenario));
+		mfm->mr = rec.mr;
+		mfm->lchan_type = rec.lchan_type;
+		mfm->pchan_type = rec.pchan_type;
+		mfm->bts_nr = rec.bts_nr;
+		mfm->trx_nr = rec.trx_nr;
+		mfm->ts_nr = rec.ts_nr;
+		mfm->ss_nr = rec.ss_nr;
+
+		pcap_dump((u_char *) pd, &h, frame);
+		num_converted++;
+	}
+
+	pcap_dump_close(pd);
+	pcap_close(pc);
+	meas_archive_reader_close(r);
+	return rc;
+}
+
+int main(int argc, char **argv)
+{
+	int rc;
+
+	if (argc < 4) {
+		fprintf(stderr, "Usage: osmo-meas-archive-pcap to-pcap ARCHIVE PCAP\n"
+			"       osmo-meas-archive-pcap from-pcap PCAP ARCHIVE\n");
+		exit(2);
+	}
+
+	if (!strcmp(argv[1], "to-pcap"))
+		rc = archive_to_pcap(argv[2], argv[3]);
+	else if (!strcmp(argv[1], "from-pcap"))
+		rc = pcap_to_archive(argv[2], argv[3]);
+	else {
+		fprintf(stderr, "Unknown command '%s'\n", argv[1]);
+		exit(2);
+	}
+
+	fprintf(stderr, "Converted %llu reports\n", num_converted);
+	exit(rc < 0 ? 1 : 0);
+}
@@ -0,0 +1,226 @@
+/* query a columnar measurement archive, or replay it as meas_feed
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include <getopt.h>
+#include <inttypes.h>
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <osmocom/core/socket.h>
+#include <osmocom/core/utils.h>
+
+#include <osmocom/gsm/gsm_utils.h>
+
+#include <osmocom/bsc/meas_feed.h>
+
+#include "meas_archive.h"
+
+static struct meas_archive_filter filter = MEAS_ARCHIVE_FILTER_ALL;
+static bool count_only;
+static unsigned int replay_rate;
+
+static void print_rec(const struct meas_archive_rec *rec)
+{
+	const struct gsm_meas_rep *mr = &rec->mr;
+
+	printf("%" PRId64 ".%03u %s %s %u/%u/%u/%u nr=%u UL %d dBm q%u",
+	       rec->time_ms / 1000, (unsigned int)(rec->time_ms % 1000), rec->imsi[0] ? rec->imsi : "-",
+	       rec->name[0] ? rec->name : "-", rec->bts_nr, rec->trx_nr, rec->ts_nr, rec->ss_nr, mr->nr,
+	       rxlev2dbm(mr->ul.full.rx_lev), mr->ul.full.rx_qual);
+	if (mr->flags & MEAS_REP_F_DL_VALID)
+		printf(" DL %d dBm q%u", rxlev2dbm(mr->dl.full.rx_lev), mr->dl.full.rx_qual);
+	printf(" bs_power=%u", mr->bs_power);
+	if (mr->flags & MEAS_REP_F_MS_L1)
+		printf(" ms_pwr=%d ta=%u", mr->ms_l1.pwr, mr->ms_l1.ta);
+	printf(" neigh=%d\n", mr->num_cell);
+}
+
+static int cmd_query(struct meas_archive_reader *r)
+{
+	struct meas_archive_rec rec;
+	unsigned long long n = 0;
+	int rc;
+
+	while ((rc = meas_archive_next(r, &filter, &rec)) > 0) {
+		n++;
+		if (!count_only)
+			print_rec(&rec);
+	}
+
+	if (count_only)
+		printf("%llu\n", n);
+	fprintf(stderr, "%llu reports, %u blocks skipped\n", n, meas_archive_blocks_skipped(r));
+
+	return rc;
+}
+
+static int cmd_replay(struct meas_archive_reader *r, const char *host, uint16_t port)
+{
+	struct meas_archive_rec rec;
+	struct meas_feed_meas mfm;
+	struct timespec gap = {};
+	unsigned long long n = 0;
+	int fd, rc;
+
+	fd = osmo_sock_init(AF_INET, SOCK_DGRAM, IPPROTO_UDP, host, port, OSMO_SOCK_F_CONNECT);
+	if (fd < 0) {
+		fprintf(stderr, "Unable to connect to %s:%u\n", host, port);
+		return fd;
+	}
+
+	if (replay_rate) {
+		gap.tv_sec = 1 / replay_rate;
+		gap.tv_nsec = (1000000000ULL / replay_rate) % 1000000000ULL;
+	}
+
+	while ((rc = meas_archive_next(r, &filter, &rec)) > 0) {
+		memset(&mfm, 0, sizeof(mfm));
+		mfm.hdr.msg_type = MEAS_FEED_MEAS;
+		mfm.hdr.version = MEAS_FEED_VERSION;
+		osmo_strlcpy(mfm.imsi, rec.imsi, sizeof(mfm.imsi));
+		osmo_strlcpy(mfm.name, rec.name, sizeof(mfm.name));
+		osmo_strlcpy(mfm.scenario, rec.scenario, sizeof(mfm.scenario));
+		mfm.mr = rec.mr;
+		mfm.lchan_type = rec.lchan_type;
+		mfm.pchan_type = rec.pchan_type;
+		mfm.bts_nr = rec.bts_nr;
+		mfm.trx_nr = rec.trx_nr;
+		mfm.ts_nr = rec.ts_nr;
+		mfm.ss_nr = rec.ss_nr;
+
+		if (send(fd, &mfm, sizeof(mfm), 0) < 0 && errno != ECONNREFUSED) {
+			rc = -errno;
+			break;
+		}
+		n++;
+		if (replay_rate)
+			nanosleep(&gap, NULL);
+	}
+
+	close(fd);
+	fprintf(stderr, "Replayed %llu reports to %s:%u\n", n, host, port);
+	return rc;
+}
+
+static void print_help(void)
+{
+	printf("Usage: osmo-meas-archive [options] ARCHIVE\n");
+	printf("       osmo-meas-archive [options] --replay HOST:PORT ARCHIVE\n");
+	printf("  -h --help\t\t\tThis text\n");
+	printf("  -i --imsi IMSI\t\tOnly reports of this subscriber\n");
+	printf("  -n --name NAME\t\tOnly reports of the BTS with this name\n");
+	printf("  -b --bts NR\t\t\tOnly reports of this BTS number\n");
+	printf("  -F --from SECONDS\t\tOnly reports at or after this UNIX time\n");
+	printf("  -T --to SECONDS\t\tOnly reports at or before this UNIX time\n");
+	printf("  -c --count\t\t\tOnly print the number of matching reports\n");
+	printf("  -R --replay HOST:PORT\t\tSend the matching reports as meas_feed to HOST:PORT\n");
+	printf("  -r --rate NUM\t\t\tReplay at most NUM reports per second (default: unlimited)\n");
+}
+
+int main(int argc, char **argv)
+{
+	struct meas_archive_reader *r;
+	char *replay_host = NULL;
+	uint16_t replay_port = 0;
+	int rc;
+
+	while (1) {
+		int option_index = 0, c;
+		static const struct option long_options[] = {
+			{ "help", 0, 0, 'h' },
+			{ "imsi", 1, 0, 'i' },
+			{ "name", 1, 0, 'n' },
+			{ "bts", 1, 0, 'b' },
+			{ "from", 1, 0, 'F' },
+			{ "to", 1, 0, 'T' },
+			{ "count", 0, 0, 'c' },
+			{ "replay", 1, 0, 'R' },
+			{ "rate", 1, 0, 'r' },
+			{ 0, 0, 0, 0 }
+		};
+		char *colon;
+
+		c = getopt_long(argc, argv, "hi:n:b:F:T:cR:r:", long_options, &option_index);
+		if (c == -1)
+			break;
+
+		switch (c) {
+		case 'h':
+			print_help();
+			exit(0);
+		case 'i':
+			filter.imsi = optarg;
+			break;
+		case 'n':
+			filter.name = optarg;
+			break;
+		case 'b':
+			filter.bts_nr = atoi(optarg);
+			break;
+		case 'F':
+			filter.from_ms = atoll(optarg) * 1000;
+			break;
+		case 'T':
+			filter.to_ms = atoll(optarg) * 1000 + 999;
+			break;
+		case 'c':
+			count_only = true;
+			break;
+		case 'R':
+			colon = strrchr(optarg, ':');
+			if (!colon) {
+				fprintf(stderr, "--replay needs HOST:PORT\n");
+				exit(2);
+			}
+			*colon = '\0';
+			replay_host = optarg;
+			replay_port = atoi(colon + 1);
+			break;
+		case 'r':
+			replay_rate = atoi(optarg);
+			break;
+		default:
+			print_help();
+			exit(2);
+		}
+	}
+
+	if (argc - optind < 1) {
+		fprintf(stderr, "You have to specify the archive file name\n");
+		exit(2);
+	}
+
+	r = meas_archive_reader_open(NULL, argv[optind]);
+	if (!r)
+		exit(1);
+
+	if (replay_host)
+		rc = cmd_replay(r, replay_host, replay_port);
+	else
+		rc = cmd_query(r);
+
+	meas_archive_reader_close(r);
+
+	exit(rc < 0 ? 1 : 0);
+}
@@ -180,6 +180,19 @@ err_io:
 	return -EIO;
 }
 
+/* Switch the database to write-ahead logging, so that committing a batch of reports costs one sequential write
+ * instead of journal and database file syncs, and readers don't block the ingest. */
+int meas_db_set_wal(struct meas_db_state *st)
+{
+	SCK_OK(st->db, sqlite3_exec(st->db, "PRAGMA journal_mode=WAL", NULL, NULL, NULL));
+	SCK_OK(st->db, sqlite3_exec(st->db, "PRAGMA synchronous=NORMAL", NULL, NULL, NULL));
+
+	return 0;
+
+err_io:
+	return -EIO;
+}
+
 static const char *create_stmts[] = {
 	"CREATE TABLE IF NOT EXISTS meas_rep ("
 		"id INTEGER PRIMARY KEY AUTOINCREMENT,"
@@ -328,3 +341,77 @@ void meas_db_close(struct meas_db_state *st)
 	talloc_free(st);
 
 }
+
+#define SEL_MR "SELECT m.time, m.imsi, m.name, m.scenario, m.nr, m.bs_power, m.ms_timing_offset, m.fpc, " \
+		"m.ms_l1_pwr, m.ms_l1_ta, " \
+		"ul.rx_lev_full, ul.rx_lev_sub, ul.rx_qual_full, ul.rx_qual_sub, ul.dtx, " \
+		"dl.id, dl.rx_lev_full, dl.rx_lev_sub, dl.rx_qual_full, dl.rx_qual_sub, dl.dtx " \
+	"FROM meas_rep AS m " \
+		"LEFT JOIN meas_rep_unidir AS ul ON ul.id = m.ul_unidir " \
+		"LEFT JOIN meas_rep_unidir AS dl ON dl.id = m.dl_unidir " \
+	"ORDER BY m.id"
+
+static const char *col_text(sqlite3_stmt *stmt, int col)
+{
+	const char *s = (const char *) sqlite3_column_text(stmt, col);
+	return s ? s : "";
+}
+
+static void _read_ud(sqlite3_stmt *stmt, int col, struct gsm_meas_rep_unidir *ud)
+{
+	ud->full.rx_lev = dbm2rxlev(sqlite3_column_int(stmt, col));
+	ud->sub.rx_lev = dbm2rxlev(sqlite3_column_int(stmt, col + 1));
+	ud->full.rx_qual = sqlite3_column_int(stmt, col + 2);
+	ud->sub.rx_qual = sqlite3_column_int(stmt, col + 3);
+}
+
+/* Call cb for each measurement report stored in the database, in the order of insertion. Fields the database
+ * doesn't store, like the neighbor cell measurements, are left zero. */
+int meas_db_foreach(struct meas_db_state *st, meas_db_rep_cb cb, void *data)
+{
+	sqlite3_stmt *sel;
+	int rc;
+
+	PREP_CHK(st->db, SEL_MR, &sel);
+
+	while ((rc = sqlite3_step(sel)) == SQLITE_ROW) {
+		struct gsm_meas_rep mr = {};
+
+		mr.nr = sqlite3_column_int(sel, 4);
+		mr.bs_power = sqlite3_column_int(sel, 5);
+		if (sqlite3_column_type(sel, 6) != SQLITE_NULL) {
+			mr.flags |= MEAS_REP_F_MS_TO;
+			mr.ms_timing_offset = sqlite3_column_int(sel, 6);
+		}
+		if (sqlite3_column_int(sel, 7))
+			mr.flags |= MEAS_REP_F_FPC;
+		if (sqlite3_column_type(sel, 8) != SQLITE_NULL) {
+			mr.flags |= MEAS_REP_F_MS_L1;
+			mr.ms_l1.pwr = sqlite3_column_int(sel, 8);
+			mr.ms_l1.ta = sqlite3_column_int(sel, 9);
+		}
+		_read_ud(sel, 10, &mr.ul);
+		if (sqlite3_column_int(sel, 14))
+			mr.flags |= MEAS_REP_F_UL_DTX;
+		if (sqlite3_column_type(sel, 15) != SQLITE_NULL) {
+			mr.flags |= MEAS_REP_F_DL_VALID;
+			_read_ud(sel, 16, &mr.dl);
+			if (sqlite3_column_int(sel, 20))
+				mr.flags |= MEAS_REP_F_DL_DTX;
+		}
+
+		rc = cb(data, sqlite3_column_int64(sel, 0), col_text(sel, 1), col_text(sel, 2),
+			col_text(sel, 3), &mr);
+		if (rc < 0)
+			break;
+	}
+
+	if (rc != SQLITE_DONE && rc >= 0)
+		fprintf(stderr, "SQL Error while reading measurement reports: %s\n", sqlite3_errmsg(st->db));
+	sqlite3_finalize(sel);
+
+	return rc == SQLITE_DONE ? 0 : (rc < 0 ? rc : -EIO);
+
+err_io:
+	return -EIO;
+}
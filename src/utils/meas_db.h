@@ -8,10 +8,15 @@ void meas_db_close(struct meas_db_state *st);
 
 int meas_db_begin(struct meas_db_state *st);
 int meas_db_commit(struct meas_db_state *st);
+int meas_db_set_wal(struct meas_db_state *st);
 
 int meas_db_insert(struct meas_db_state *st, const char *imsi,
 		   const char *name, unsigned long timestamp,
 		   const char *scenario,
 		   const struct gsm_meas_rep *mr);
 
+typedef int (*meas_db_rep_cb)(void *data, unsigned long timestamp, const char *imsi, const char *name,
+			      const char *scenario, const struct gsm_meas_rep *mr);
+int meas_db_foreach(struct meas_db_state *st, meas_db_rep_cb cb, void *data);
+
 #endif
@@ -112,6 +112,7 @@ static void print_meas_feed_json(struct meas_feed_meas *mfm)
 		now, mfm->imsi, mfm->name, mfm->scenario);
 
 	switch (mfm->hdr.version) {
+	case MEAS_FEED_VERSION_2:
 	case 1:
 		printf("\"chan_info\":{");
 		print_chan_info_json(mfm);
@@ -128,10 +129,8 @@ static void print_meas_feed_json(struct meas_feed_meas *mfm)
 
 }
 
-static int handle_meas(struct msgb *msg)
+static int handle_meas(struct meas_feed_meas *mfm)
 {
-	struct meas_feed_meas *mfm = (struct meas_feed_meas *) msgb_data(msg);
-
 	print_meas_feed_json(mfm);
 
 	return 0;
@@ -139,14 +138,14 @@ static int handle_meas(struct msgb *msg)
 
 static int handle_msg(struct msgb *msg)
 {
-	struct meas_feed_hdr *mfh = (struct meas_feed_hdr *) msgb_data(msg);
+	struct meas_feed_meas mfm;
 
-	if (mfh->version != MEAS_FEED_VERSION)
+	if (meas_feed_meas_decode(&mfm, msgb_data(msg), msgb_length(msg)) < 0)
 		return -EINVAL;
 
-	switch (mfh->msg_type) {
+	switch (mfm.hdr.msg_type) {
 	case MEAS_FEED_MEAS:
-		handle_meas(msg);
+		handle_meas(&mfm);
 		break;
 	default:
 		break;
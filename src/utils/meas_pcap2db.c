@@ -64,7 +64,7 @@ static void pcap_cb(u_char *user, const struct pcap_pkthdr *h,
 	const char *cur = bytes;
 	const struct iphdr *ip;
 	const struct udphdr *udp;
-	const struct meas_feed_meas *mfm;
+	struct meas_feed_meas mfm;
 	uint16_t udplen;
 
 	if (h->caplen < 14+20+8)
@@ -90,13 +90,16 @@ static void pcap_cb(u_char *user, const struct pcap_pkthdr *h,
 		return;
 
 	udplen = ntohs(udp->len);
-	if (udplen != sizeof(*udp) + sizeof(*mfm))
+	if (udplen < sizeof(*udp) || cur + udplen > (const char *) bytes + h->caplen)
 		return;
 	cur += sizeof(*udp);
 
-	mfm = (const struct meas_feed_meas *) cur;
+	/* either the raw version 1 or the packed version 2 */
+	if (meas_feed_meas_decode(&mfm, (const uint8_t *) cur, udplen - sizeof(*udp)) < 0
+	    || mfm.hdr.msg_type != MEAS_FEED_MEAS)
+		return;
 
-	handle_mfm(h, mfm);
+	handle_mfm(h, &mfm);
 }
 
 int main(int argc, char **argv)
@@ -0,0 +1,195 @@
+/* listen to meas_feed on UDP and append it to a columnar measurement archive
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include <signal.h>
+#include <getopt.h>
+
+#include <netinet/in.h>
+
+#include <osmocom/core/socket.h>
+#include <osmocom/core/utils.h>
+#include <osmocom/core/select.h>
+#include <osmocom/core/timer.h>
+
+#include <osmocom/bsc/meas_feed.h>
+
+#include "meas_archive.h"
+
+static struct osmo_fd udp_ofd;
+static struct meas_archive_writer *archive;
+static struct osmo_timer_list flush_timer;
+static volatile sig_atomic_t quit;
+
+static uint16_t udp_port = 8888;
+static unsigned int flush_s = 10;
+static unsigned long long num_stored, num_invalid;
+
+static int64_t now_ms(void)
+{
+	struct timespec ts;
+
+	osmo_clock_gettime(CLOCK_REALTIME, &ts);
+	return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static int handle_meas(const uint8_t *data, size_t len)
+{
+	struct meas_feed_meas mfm;
+	struct meas_archive_rec rec;
+
+	if (meas_feed_meas_decode(&mfm, data, len) < 0 || mfm.hdr.msg_type != MEAS_FEED_MEAS) {
+		num_invalid++;
+		return -EINVAL;
+	}
+
+	rec = (struct meas_archive_rec){
+		.time_ms = now_ms(),
+		.imsi = mfm.imsi,
+		.name = mfm.name,
+		.scenario = mfm.scenario,
+		.bts_nr = mfm.bts_nr,
+		.trx_nr = mfm.trx_nr,
+		.ts_nr = mfm.ts_nr,
+		.ss_nr = mfm.ss_nr,
+		.lchan_type = mfm.lchan_type,
+		.pchan_type = mfm.pchan_type,
+		.mr = mfm.mr,
+	};
+
+	num_stored++;
+	return meas_archive_append(archive, &rec);
+}
+
+static int udp_fd_cb(struct osmo_fd *ofd, unsigned int what)
+{
+	static uint8_t buf[1024];
+	int rc;
+
+	if (!(what & BSC_FD_READ))
+		return 0;
+
+	rc = read(ofd->fd, buf, sizeof(buf));
+	if (rc < 0)
+		return rc;
+
+	rc = handle_meas(buf, rc);
+	if (rc < 0 && rc != -EINVAL)
+		fprintf(stderr, "Unable to write to the archive: %s\n", strerror(-rc));
+
+	return 0;
+}
+
+/* Write out the partial block regularly, so that a reader sees recent reports and a crash loses little */
+static void flush_timer_cb(void *data)
+{
+	int rc = meas_archive_flush(archive);
+
+	if (rc < 0)
+		fprintf(stderr, "Unable to write to the archive: %s\n", strerror(-rc));
+	osmo_timer_schedule(&flush_timer, flush_s, 0);
+}
+
+static void signal_handler(int signum)
+{
+	quit = 1;
+}
+
+static void print_help(void)
+{
+	printf("Usage: osmo-meas-udp2archive [options] ARCHIVE\n");
+	printf("  -h --help\t\t\tThis text\n");
+	printf("  -p --port PORT\t\tUDP port to receive the meas_feed on (default 8888)\n");
+	printf("  -f --flush SECONDS\t\tWrite out incomplete blocks every SECONDS (default 10)\n");
+}
+
+static void handle_options(int argc, char **argv)
+{
+	while (1) {
+		int option_index = 0, c;
+		static const struct option long_options[] = {
+			{ "help", 0, 0, 'h' },
+			{ "port", 1, 0, 'p' },
+			{ "flush", 1, 0, 'f' },
+			{ 0, 0, 0, 0 }
+		};
+
+		c = getopt_long(argc, argv, "hp:f:", long_options, &option_index);
+		if (c == -1)
+			break;
+
+		switch (c) {
+		case 'h':
+			print_help();
+			exit(0);
+		case 'p':
+			udp_port = atoi(optarg);
+			break;
+		case 'f':
+			flush_s = atoi(optarg);
+			if (!flush_s)
+				flush_s = 1;
+			break;
+		default:
+			print_help();
+			exit(2);
+		}
+	}
+}
+
+int main(int argc, char **argv)
+{
+	int rc;
+
+	handle_options(argc, argv);
+
+	if (argc - optind < 1) {
+		fprintf(stderr, "You have to specify the archive file name\n");
+		exit(2);
+	}
+
+	archive = meas_archive_writer_open(NULL, argv[optind]);
+	if (!archive)
+		exit(1);
+
+	udp_ofd.cb = udp_fd_cb;
+	rc = osmo_sock_init_ofd(&udp_ofd, AF_INET, SOCK_DGRAM,
+				IPPROTO_UDP, NULL, udp_port, OSMO_SOCK_F_BIND);
+	if (rc < 0) {
+		fprintf(stderr, "Unable to create UDP listen socket\n");
+		exit(1);
+	}
+
+	osmo_timer_setup(&flush_timer, flush_timer_cb, NULL);
+	osmo_timer_schedule(&flush_timer, flush_s, 0);
+
+	signal(SIGINT, signal_handler);
+	signal(SIGTERM, signal_handler);
+
+	while (!quit)
+		osmo_select_main(0);
+
+	rc = meas_archive_writer_close(archive);
+	fprintf(stderr, "Stored %llu reports, ignored %llu invalid datagrams\n", num_stored, num_invalid);
+
+	exit(rc < 0 ? 1 : 0);
+}
@@ -19,20 +19,25 @@
  *
  */
 
+#define _GNU_SOURCE
 #include <string.h>
 #include <errno.h>
 #include <unistd.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <time.h>
+#include <signal.h>
+#include <getopt.h>
 
 #include <netinet/in.h>
+#include <sys/socket.h>
 
 #include <osmocom/core/socket.h>
 #include <osmocom/core/utils.h>
 #include <osmocom/core/msgb.h>
 #include <osmocom/core/select.h>
 #include <osmocom/core/talloc.h>
+#include <osmocom/core/timer.h>
 
 #include <osmocom/gsm/gsm_utils.h>
 
@@ -40,72 +45,322 @@
 
 #include "meas_db.h"
 
+/* Number of datagrams to receive per recvmmsg() call in batch mode */
+#define RX_BATCH	64
+#define RX_BUF_SIZE	1024
+
 static struct osmo_fd udp_ofd;
 static struct meas_db_state *db;
 
-static int handle_msg(struct msgb *msg)
+static struct {
+	uint16_t port;
+	/* Commit after this many reports; 0 means autocommit each report, as without batching */
+	unsigned int batch_size;
+	/* Commit a partial batch after this many milliseconds */
+	unsigned int batch_ms;
+	bool wal;
+	/* Print a throughput summary every this many seconds and on exit, 0 to disable */
+	unsigned int summary_s;
+} cfg = {
+	.port = 8888,
+	.batch_size = 0,
+	.batch_ms = 1000,
+	.wal = false,
+	.summary_s = 0,
+};
+
+/* Batch mode: receive buffers, set up once and reused for each recvmmsg() */
+static uint8_t rx_buf[RX_BATCH][RX_BUF_SIZE];
+static struct iovec rx_iov[RX_BATCH];
+static union {
+	char buf[CMSG_SPACE(sizeof(uint32_t))];
+	struct cmsghdr align;
+} rx_cmsg[RX_BATCH];
+static struct mmsghdr rx_mmsg[RX_BATCH];
+
+static struct {
+	unsigned long long rx;
+	unsigned long long invalid;
+	unsigned long long db_errors;
+	unsigned long long committed;
+	unsigned long long commits;
+	/* Datagrams the kernel dropped for lack of socket buffer space (SO_RXQ_OVFL) */
+	uint32_t kernel_drops;
+	/* Reports inserted in the currently open transaction */
+	unsigned int in_txn;
+	struct timespec start;
+	unsigned long long rx_at_last_summary;
+	struct timespec last_summary;
+} stats;
+
+static struct osmo_timer_list commit_timer;
+static struct osmo_timer_list summary_timer;
+static volatile sig_atomic_t quit;
+
+static void batch_commit(void)
+{
+	if (!stats.in_txn)
+		return;
+
+	osmo_timer_del(&commit_timer);
+	if (meas_db_commit(db) < 0) {
+		stats.db_errors++;
+	} else {
+		stats.committed += stats.in_txn;
+		stats.commits++;
+	}
+	stats.in_txn = 0;
+}
+
+static void commit_timer_cb(void *data)
 {
-	struct meas_feed_hdr *mfh = (struct meas_feed_hdr *) msgb_data(msg);
-	struct meas_feed_meas *mfm = (struct meas_feed_meas *) msgb_data(msg);
+	batch_commit();
+}
+
+static int handle_meas(const uint8_t *data, size_t len)
+{
+	struct meas_feed_meas mfm;
 	const char *scenario;
 	time_t now = time(NULL);
+	int rc;
 
-	if (mfh->version != MEAS_FEED_VERSION)
-		return -EINVAL;
+	stats.rx++;
 
-	if (mfh->msg_type != MEAS_FEED_MEAS)
+	if (meas_feed_meas_decode(&mfm, data, len) < 0 || mfm.hdr.msg_type != MEAS_FEED_MEAS) {
+		stats.invalid++;
 		return -EINVAL;
+	}
 
-	if (strlen(mfm->scenario))
-		scenario = mfm->scenario;
+	if (strlen(mfm.scenario))
+		scenario = mfm.scenario;
 	else
 		scenario = NULL;
 
-	meas_db_insert(db, mfm->imsi, mfm->name, now,
-			scenario, &mfm->mr);
+	if (cfg.batch_size && !stats.in_txn) {
+		if (meas_db_begin(db) < 0) {
+			stats.db_errors++;
+			return -EIO;
+		}
+		osmo_timer_schedule(&commit_timer, cfg.batch_ms / 1000, (cfg.batch_ms % 1000) * 1000);
+	}
+
+	rc = meas_db_insert(db, mfm.imsi, mfm.name, now, scenario, &mfm.mr);
+	if (rc < 0) {
+		stats.db_errors++;
+		return rc;
+	}
+
+	if (!cfg.batch_size) {
+		stats.committed++;
+		return 0;
+	}
 
+	if (++stats.in_txn >= cfg.batch_size)
+		batch_commit();
 	return 0;
 }
 
-static int udp_fd_cb(struct osmo_fd *ofd, unsigned int what)
+static void rx_batch_init(void)
 {
-	int rc;
+	int i;
+
+	for (i = 0; i < RX_BATCH; i++) {
+		rx_iov[i] = (struct iovec){
+			.iov_base = rx_buf[i],
+			.iov_len = sizeof(rx_buf[i]),
+		};
+		rx_mmsg[i].msg_hdr = (struct msghdr){
+			.msg_iov = &rx_iov[i],
+			.msg_iovlen = 1,
+		};
+	}
+}
+
+static void rx_batch_kernel_drops(const struct msghdr *mh)
+{
+	struct cmsghdr *cm;
+
+	for (cm = CMSG_FIRSTHDR(mh); cm; cm = CMSG_NXTHDR((struct msghdr *)mh, cm)) {
+		if (cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SO_RXQ_OVFL)
+			memcpy(&stats.kernel_drops, CMSG_DATA(cm), sizeof(stats.kernel_drops));
+	}
+}
+
+static int udp_rx_batch(struct osmo_fd *ofd)
+{
+	int i, n;
+
+	/* Drain the socket, up to a bound so that the timers still get their turn under full load */
+	do {
+		for (i = 0; i < RX_BATCH; i++) {
+			rx_mmsg[i].msg_hdr.msg_control = rx_cmsg[i].buf;
+			rx_mmsg[i].msg_hdr.msg_controllen = sizeof(rx_cmsg[i].buf);
+		}
 
-	if (what & BSC_FD_READ) {
-		struct msgb *msg = msgb_alloc(1024, "UDP Rx");
+		n = recvmmsg(ofd->fd, rx_mmsg, RX_BATCH, MSG_DONTWAIT, NULL);
+		if (n < 0) {
+			if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+				return 0;
+			return -errno;
+		}
 
-		rc = read(ofd->fd, msgb_data(msg), msgb_tailroom(msg));
-		if (rc < 0)
-			return rc;
-		msgb_put(msg, rc);
-		handle_msg(msg);
+		for (i = 0; i < n; i++) {
+			rx_batch_kernel_drops(&rx_mmsg[i].msg_hdr);
+			handle_meas(rx_buf[i], rx_mmsg[i].msg_len);
+		}
+	} while (n == RX_BATCH && stats.in_txn + RX_BATCH <= 16 * OSMO_MAX(cfg.batch_size, RX_BATCH));
+
+	return 0;
+}
+
+static int udp_rx_single(struct osmo_fd *ofd)
+{
+	struct msgb *msg = msgb_alloc(RX_BUF_SIZE, "UDP Rx");
+	int rc;
+
+	rc = read(ofd->fd, msgb_data(msg), msgb_tailroom(msg));
+	if (rc < 0) {
 		msgb_free(msg);
+		return rc;
 	}
+	msgb_put(msg, rc);
+	handle_meas(msgb_data(msg), msgb_length(msg));
+	msgb_free(msg);
 
 	return 0;
 }
 
+static int udp_fd_cb(struct osmo_fd *ofd, unsigned int what)
+{
+	if (!(what & BSC_FD_READ))
+		return 0;
+
+	if (cfg.batch_size)
+		return udp_rx_batch(ofd);
+	return udp_rx_single(ofd);
+}
+
+static double elapsed_s(const struct timespec *from, const struct timespec *to)
+{
+	return (to->tv_sec - from->tv_sec) + (to->tv_nsec - from->tv_nsec) / 1e9;
+}
+
+static void print_summary(bool final)
+{
+	struct timespec now;
+	double interval, total;
+
+	osmo_clock_gettime(CLOCK_MONOTONIC, &now);
+	interval = elapsed_s(&stats.last_summary, &now);
+	total = elapsed_s(&stats.start, &now);
+
+	fprintf(stderr, "%s: rx %llu reports (%.0f/s now, %.0f/s avg), stored %llu in %llu commits,"
+		" %u pending, invalid %llu, db errors %llu, dropped by kernel %u\n",
+		final ? "total" : "summary", stats.rx,
+		interval > 0 ? (stats.rx - stats.rx_at_last_summary) / interval : 0.,
+		total > 0 ? stats.rx / total : 0.,
+		stats.committed, stats.commits, stats.in_txn, stats.invalid, stats.db_errors,
+		stats.kernel_drops);
+
+	stats.rx_at_last_summary = stats.rx;
+	stats.last_summary = now;
+}
+
+static void summary_timer_cb(void *data)
+{
+	print_summary(false);
+	osmo_timer_schedule(&summary_timer, cfg.summary_s, 0);
+}
+
+static void signal_handler(int signum)
+{
+	quit = 1;
+}
+
+static void print_help(void)
+{
+	printf("Usage: osmo-meas-udp2db [options] DATABASE\n");
+	printf("  -h --help\t\t\tThis text\n");
+	printf("  -p --port PORT\t\tUDP port to receive the meas_feed on (default 8888)\n");
+	printf("  -b --batch-size NUM\t\tStore NUM reports per transaction, receive with recvmmsg()"
+	       " (default 0: one transaction per report)\n");
+	printf("  -t --batch-time MS\t\tCommit a partial batch after MS milliseconds (default 1000)\n");
+	printf("  -w --wal\t\t\tUse SQLite write-ahead logging\n");
+	printf("  -s --summary SECONDS\t\tPrint a throughput and drop summary every SECONDS, and on exit (default off)\n");
+}
+
+static void handle_options(int argc, char **argv)
+{
+	while (1) {
+		int option_index = 0, c;
+		static const struct option long_options[] = {
+			{ "help", 0, 0, 'h' },
+			{ "port", 1, 0, 'p' },
+			{ "batch-size", 1, 0, 'b' },
+			{ "batch-time", 1, 0, 't' },
+			{ "wal", 0, 0, 'w' },
+			{ "summary", 1, 0, 's' },
+			{ 0, 0, 0, 0 }
+		};
+
+		c = getopt_long(argc, argv, "hp:b:t:ws:", long_options, &option_index);
+		if (c == -1)
+			break;
+
+		switch (c) {
+		case 'h':
+			print_help();
+			exit(0);
+		case 'p':
+			cfg.port = atoi(optarg);
+			break;
+		case 'b':
+			cfg.batch_size = atoi(optarg);
+			break;
+		case 't':
+			cfg.batch_ms = atoi(optarg);
+			if (!cfg.batch_ms)
+				cfg.batch_ms = 1;
+			break;
+		case 'w':
+			cfg.wal = true;
+			break;
+		case 's':
+			cfg.summary_s = atoi(optarg);
+			break;
+		default:
+			print_help();
+			exit(2);
+		}
+	}
+}
+
 int main(int argc, char **argv)
 {
 	char *db_fname;
 	int rc;
+	int on = 1;
 
 	msgb_talloc_ctx_init(NULL, 0);
 
-	if (argc < 2) {
+	handle_options(argc, argv);
+
+	if (argc - optind < 1) {
 		fprintf(stderr, "You have to specify the database file name\n");
 		exit(2);
 	}
 
-	db_fname = argv[1];
+	db_fname = argv[optind];
 
 	udp_ofd.cb = udp_fd_cb;
 	rc =  osmo_sock_init_ofd(&udp_ofd, AF_INET, SOCK_DGRAM,
-			 	 IPPROTO_UDP, NULL, 8888, OSMO_SOCK_F_BIND);
+			 	 IPPROTO_UDP, NULL, cfg.port, OSMO_SOCK_F_BIND);
 	if (rc < 0) {
 		fprintf(stderr, "Unable to create UDP listen socket\n");
 		exit(1);
 	}
+	if (setsockopt(udp_ofd.fd, SOL_SOCKET, SO_RXQ_OVFL, &on, sizeof(on)) < 0)
+		fprintf(stderr, "Unable to enable drop counting on the UDP socket: %s\n", strerror(errno));
 
 	db = meas_db_open(NULL, db_fname);
 	if (!db) {
@@ -113,14 +368,29 @@ int main(int argc, char **argv)
 		exit(1);
 	}
 
-	/* FIXME: timer-based BEGIN/COMMIT */
+	if (cfg.wal && meas_db_set_wal(db) < 0)
+		fprintf(stderr, "Unable to switch the database to write-ahead logging\n");
 
-	while (1) {
+	rx_batch_init();
+	osmo_timer_setup(&commit_timer, commit_timer_cb, NULL);
+	osmo_timer_setup(&summary_timer, summary_timer_cb, NULL);
+
+	osmo_clock_gettime(CLOCK_MONOTONIC, &stats.start);
+	stats.last_summary = stats.start;
+	if (cfg.summary_s)
+		osmo_timer_schedule(&summary_timer, cfg.summary_s, 0);
+
+	signal(SIGINT, signal_handler);
+	signal(SIGTERM, signal_handler);
+
+	while (!quit) {
 		osmo_select_main(0);
 	};
 
+	batch_commit();
+	if (cfg.summary_s)
+		print_summary(true);
 	meas_db_close(db);
 
 	exit(0);
 }
-
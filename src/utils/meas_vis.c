@@ -84,9 +84,8 @@ static struct ms_state *find_alloc_ms(const char *imsi)
 	return ms;
 }
 
-static int handle_meas(struct msgb *msg)
+static int handle_meas(struct meas_feed_meas *mfm)
 {
-	struct meas_feed_meas *mfm = (struct meas_feed_meas *) msgb_data(msg);
 	struct ms_state *ms = find_alloc_ms(mfm->imsi);
 	time_t now = time(NULL);
 
@@ -105,14 +104,14 @@ static int handle_meas(struct msgb *msg)
 
 static int handle_msg(struct msgb *msg)
 {
-	struct meas_feed_hdr *mfh = (struct meas_feed_hdr *) msgb_data(msg);
+	struct meas_feed_meas mfm;
 
-	if (mfh->version != MEAS_FEED_VERSION)
+	if (meas_feed_meas_decode(&mfm, msgb_data(msg), msgb_length(msg)) < 0)
 		return -EINVAL;
 
-	switch (mfh->msg_type) {
+	switch (mfm.hdr.msg_type) {
 	case MEAS_FEED_MEAS:
-		handle_meas(msg);
+		handle_meas(&mfm);
 		break;
 	default:
 		break;
@@ -17,17 +17,28 @@
  *
  */
 
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
 
+#include <osmocom/abis/e1_input.h>
 #include <osmocom/core/application.h>
+#include <osmocom/core/signal.h>
 #include <osmocom/core/utils.h>
+#include <osmocom/gsm/protocol/gsm_08_58.h>
 #include <osmocom/gsm/protocol/gsm_12_21.h>
 #include <osmocom/gsm/gsm23003.h>
+#include <osmocom/gsm/rsl.h>
+#include <osmocom/gsm/tlv.h>
 
 #include <osmocom/bsc/gsm_data.h>
 #include <osmocom/bsc/abis_nm.h>
 #include <osmocom/bsc/debug.h>
+#include <osmocom/bsc/meas_rep.h>
+#include <osmocom/bsc/signal.h>
 
 static const uint8_t load_config[] = {
 	0x42, 0x12, 0x00, 0x08, 0x31, 0x36, 0x38, 0x64,
@@ -164,6 +175,394 @@ static void test_abis_nm_ipaccess_cgi()
 	OSMO_ASSERT(pass);
 }
 
+static void test_sw_image(void)
+{
+	char path[] = "/tmp/abis_test_sw_image_XXXXXX";
+	uint8_t content[1000];
+	struct abis_nm_sw_image *img, *img2, *img3;
+	int fd, i;
+
+	printf("\n%s()\n", __func__);
+
+	for (i = 0; i < sizeof(content); i++)
+		content[i] = i;
+	fd = mkstemp(path);
+	OSMO_ASSERT(fd >= 0);
+	OSMO_ASSERT(write(fd, content, sizeof(content)) == sizeof(content));
+
+	img = abis_nm_sw_image_get(path);
+	OSMO_ASSERT(img);
+	printf("image: len=%zu use_count=%u content %s\n", img->len, img->use_count,
+	       memcmp(img->data, content, sizeof(content)) ? "DIFFERS" : "matches");
+
+	img2 = abis_nm_sw_image_get(path);
+	printf("same file again: %s image, use_count=%u\n", img2 == img ? "same" : "OTHER", img->use_count);
+	abis_nm_sw_image_put(img2);
+
+	/* Rewritten right away with the same size, possibly within the same ctime second */
+	content[0] = 0xff;
+	OSMO_ASSERT(pwrite(fd, content, 1, 0) == 1);
+	img2 = abis_nm_sw_image_get(path);
+	OSMO_ASSERT(img2);
+	printf("rewritten file: %s image, content %s\n", img2 == img ? "SAME" : "new",
+	       memcmp(img2->data, content, sizeof(content)) ? "DIFFERS" : "matches");
+	content[0] = 0;
+
+	/* A Software Load in progress must not notice the file being truncated or replaced */
+	OSMO_ASSERT(ftruncate(fd, 10) == 0);
+	printf("file truncated: image len=%zu content %s\n", img->len,
+	       memcmp(img->data, content, sizeof(content)) ? "DIFFERS" : "matches");
+
+	img3 = abis_nm_sw_image_get(path);
+	OSMO_ASSERT(img3);
+	printf("changed file: %s image, len=%zu\n", img3 == img ? "SAME" : "new", img3->len);
+
+	abis_nm_sw_image_put(img3);
+	abis_nm_sw_image_put(img2);
+	abis_nm_sw_image_put(img);
+
+	OSMO_ASSERT(ftruncate(fd, 0) == 0);
+	printf("empty file: %s\n", abis_nm_sw_image_get(path) ? "ERROR" : "refused");
+	close(fd);
+	unlink(path);
+	printf("missing file: %s\n", abis_nm_sw_image_get(path) ? "ERROR" : "refused");
+}
+
+/* IEs of MEASUREMENT RESULT messages, following the Channel Number */
+#define MEAS_RES_L3_INFO \
+	RSL_IE_L3_INFO, 0x00, 0x12, \
+	0x06, 0x15, 0x36, 0x36, 0x01, 0xc0, 0x00, 0x00, 0x00, 0x00, \
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+
+static const uint8_t meas_res_full[] = {
+	RSL_IE_MEAS_RES_NR, 0x17,
+	RSL_IE_UPLINK_MEAS, 0x03, 0x2a, 0x28, 0x09,
+	RSL_IE_BS_POWER, 0x00,
+	RSL_IE_L1_INFO, 0x13, 0x02,
+	MEAS_RES_L3_INFO,
+	RSL_IE_MS_TIMING_OFFSET, 0x41,
+};
+
+static const uint8_t meas_res_mandatory_only[] = {
+	RSL_IE_MEAS_RES_NR, 0x18,
+	RSL_IE_UPLINK_MEAS, 0x03, 0x2a, 0x28, 0x09,
+	RSL_IE_BS_POWER, 0x02,
+};
+
+static const uint8_t meas_res_reordered[] = {
+	RSL_IE_MEAS_RES_NR, 0x19,
+	RSL_IE_UPLINK_MEAS, 0x03, 0x2a, 0x28, 0x09,
+	RSL_IE_BS_POWER, 0x00,
+	RSL_IE_MS_TIMING_OFFSET, 0x41,
+	RSL_IE_L1_INFO, 0x13, 0x02,
+	MEAS_RES_L3_INFO,
+};
+
+static const uint8_t meas_res_extra_ie[] = {
+	RSL_IE_MEAS_RES_NR, 0x1a,
+	RSL_IE_UPLINK_MEAS, 0x03, 0x2a, 0x28, 0x09,
+	RSL_IE_BS_POWER, 0x00,
+	RSL_IE_MS_POWER, 0x05,
+	RSL_IE_L1_INFO, 0x13, 0x02,
+};
+
+static const uint8_t meas_res_no_bs_power[] = {
+	RSL_IE_MEAS_RES_NR, 0x1b,
+	RSL_IE_UPLINK_MEAS, 0x03, 0x2a, 0x28, 0x09,
+	RSL_IE_L1_INFO, 0x13, 0x02,
+};
+
+static const uint8_t meas_res_truncated_l3[] = {
+	RSL_IE_MEAS_RES_NR, 0x1c,
+	RSL_IE_UPLINK_MEAS, 0x03, 0x2a, 0x28, 0x09,
+	RSL_IE_BS_POWER, 0x00,
+	RSL_IE_L3_INFO, 0x00, 0x12, 0x06, 0x15,
+};
+
+struct meas_res_test {
+	const char *name;
+	const uint8_t *data;
+	unsigned int len;
+};
+
+#define MEAS_RES_TEST(x) { #x, x, sizeof(x) }
+
+static const struct meas_res_test meas_res_tests[] = {
+	MEAS_RES_TEST(meas_res_full),
+	MEAS_RES_TEST(meas_res_mandatory_only),
+	MEAS_RES_TEST(meas_res_reordered),
+	MEAS_RES_TEST(meas_res_extra_ie),
+	MEAS_RES_TEST(meas_res_no_bs_power),
+	MEAS_RES_TEST(meas_res_truncated_l3),
+};
+
+/* The IEs as rsl_rx_meas_res() used to take them, from a full struct tlv_parsed */
+static void expect_ie(const struct tlv_parsed *tp, uint8_t iei, const uint8_t *val, unsigned int len)
+{
+	if (!TLVP_PRESENT(tp, iei)) {
+		OSMO_ASSERT(!val);
+		return;
+	}
+	OSMO_ASSERT(val == TLVP_VAL(tp, iei));
+	OSMO_ASSERT(!len || len == TLVP_LEN(tp, iei));
+}
+
+static void test_meas_res_parse(void)
+{
+	int i;
+
+	printf("\n%s()\n", __func__);
+
+	for (i = 0; i < ARRAY_SIZE(meas_res_tests); i++) {
+		const struct meas_res_test *t = &meas_res_tests[i];
+		struct rsl_meas_res_ies ies;
+		struct tlv_parsed tp;
+		int rc;
+
+		rc = rsl_meas_res_ies_parse(&ies, t->data, t->len);
+		printf("%s: rc=%d", t->name, rc);
+		if (rc < 0) {
+			printf("\n");
+			continue;
+		}
+		printf(" nr=%u ul=%s bs_power=%u", *ies.meas_res_nr,
+		       osmo_hexdump_nospc(ies.uplink_meas, ies.uplink_meas_len), *ies.bs_power);
+		if (ies.l1_info)
+			printf(" l1=%s", osmo_hexdump_nospc(ies.l1_info, 2));
+		if (ies.l3_info)
+			printf(" l3_len=%u", ies.l3_info_len);
+		if (ies.ms_timing_offset)
+			printf(" ms_to=%u", *ies.ms_timing_offset);
+		printf("\n");
+
+		rsl_tlv_parse(&tp, t->data, t->len);
+		expect_ie(&tp, RSL_IE_MEAS_RES_NR, ies.meas_res_nr, 0);
+		expect_ie(&tp, RSL_IE_UPLINK_MEAS, ies.uplink_meas, ies.uplink_meas_len);
+		expect_ie(&tp, RSL_IE_BS_POWER, ies.bs_power, 0);
+		expect_ie(&tp, RSL_IE_L1_INFO, ies.l1_info, 0);
+		expect_ie(&tp, RSL_IE_L3_INFO, ies.l3_info, ies.l3_info_len);
+		expect_ie(&tp, RSL_IE_MS_TIMING_OFFSET, ies.ms_timing_offset, 0);
+	}
+}
+
+#define BENCH_MEAS_RES 1000000
+
+static double elapsed_ms(const struct timespec *a, const struct timespec *b)
+{
+	return (b->tv_sec - a->tv_sec) * 1e3 + (b->tv_nsec - a->tv_nsec) / 1e6;
+}
+
+/* Time to parse the IEs of as many MEASUREMENT RESULTs as a BSC with some 50 TRX gets in several minutes. Real timings
+ * go to stderr, since they depend on the machine. Run as 'abis_test bench'. */
+static void bench_meas_res_parse(void)
+{
+	struct rsl_meas_res_ies ies;
+	struct tlv_parsed tp;
+	struct timespec t0, t1;
+	double generic_ms, fast_ms;
+	unsigned int sum = 0;
+	int i;
+
+	printf("\n%s()\n", __func__);
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < BENCH_MEAS_RES; i++) {
+		rsl_tlv_parse(&tp, meas_res_full, sizeof(meas_res_full));
+		sum += *TLVP_VAL(&tp, RSL_IE_MEAS_RES_NR);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	generic_ms = elapsed_ms(&t0, &t1);
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < BENCH_MEAS_RES; i++) {
+		OSMO_ASSERT(rsl_meas_res_ies_parse(&ies, meas_res_full, sizeof(meas_res_full)) == 0);
+		sum -= *ies.meas_res_nr;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	fast_ms = elapsed_ms(&t0, &t1);
+
+	OSMO_ASSERT(sum == 0);
+	printf("%d MEAS RES parsed\n", BENCH_MEAS_RES);
+	fprintf(stderr, "%d MEAS RES: rsl_tlv_parse() %.1f ms, rsl_meas_res_ies_parse() %.1f ms\n",
+		BENCH_MEAS_RES, generic_ms, fast_ms);
+}
+
+/* override, requires '-Wl,--wrap=abis_sendmsg'.
+ * Catch OML messages sent towards the BTS. */
+int __real_abis_sendmsg(struct msgb *msg);
+int __wrap_abis_sendmsg(struct msgb *msg)
+{
+	struct abis_om_hdr *oh = (struct abis_om_hdr *) msg->data;
+	struct abis_om_fom_hdr *foh = (struct abis_om_fom_hdr *) oh->data;
+
+	printf("Tx OML mt=0x%02x oc=0x%02x %u,%u,%u\n", foh->msg_type, foh->obj_class,
+	       foh->obj_inst.bts_nr, foh->obj_inst.trx_nr, foh->obj_inst.ts_nr);
+	msgb_free(msg);
+	return 0;
+}
+
+/* Receive an OML message without attributes from the BTS */
+static void rx_oml(struct gsm_bts *bts, uint8_t msg_type, uint8_t obj_class, uint8_t i0, uint8_t i1, uint8_t i2)
+{
+	struct msgb *msg = msgb_alloc(128, "OML");
+	struct abis_om_hdr *oh;
+	struct abis_om_fom_hdr *foh;
+
+	oh = (struct abis_om_hdr *) msgb_put(msg, sizeof(*oh));
+	oh->mdisc = ABIS_OM_MDISC_FOM;
+	oh->placement = ABIS_OM_PLACEMENT_ONLY;
+	oh->sequence = 0;
+	oh->length = sizeof(*foh);
+	foh = (struct abis_om_fom_hdr *) msgb_put(msg, sizeof(*foh));
+	foh->msg_type = msg_type;
+	foh->obj_class = obj_class;
+	foh->obj_inst.bts_nr = i0;
+	foh->obj_inst.trx_nr = i1;
+	foh->obj_inst.ts_nr = i2;
+
+	msg->l2h = (unsigned char *) oh;
+	msg->dst = bts->oml_link;
+	abis_nm_rcvmsg(msg);
+}
+
+static void print_oml_window(const struct gsm_bts *bts)
+{
+	printf("in flight: %d, queued: %u\n", bts->abis_nm_pend, llist_count(&bts->abis_queue));
+}
+
+static struct gsm_bts *create_nanobts(struct gsm_network *net, uint8_t bts_nr)
+{
+	struct gsm_bts *bts = gsm_bts_alloc(net, bts_nr);
+
+	OSMO_ASSERT(bts);
+	bts->type = GSM_BTS_TYPE_NANOBTS;
+	bts->oml_link = talloc_zero(bts, struct e1inp_sign_link);
+	bts->oml_link->trx = bts->c0;
+	return bts;
+}
+
+static void test_oml_window(void)
+{
+	struct gsm_network *net = gsm_network_init(NULL);
+	struct gsm_bts *bts = create_nanobts(net, 0);
+	int i;
+
+	printf("\n%s()\n", __func__);
+
+	printf("- two MO at once, the second message for a MO waits for the response to the first\n");
+	abis_nm_opstart(bts, NM_OC_CHANNEL, 0, 0, 0);
+	abis_nm_opstart(bts, NM_OC_CHANNEL, 0, 0, 1);
+	abis_nm_opstart(bts, NM_OC_CHANNEL, 0, 0, 0);
+	print_oml_window(bts);
+
+	printf("- response for 0,0,1\n");
+	rx_oml(bts, NM_MT_OPSTART_ACK, NM_OC_CHANNEL, 0, 0, 1);
+	print_oml_window(bts);
+
+	printf("- a response for a MO with nothing in flight releases nothing\n");
+	rx_oml(bts, NM_MT_OPSTART_ACK, NM_OC_CHANNEL, 0, 0, 5);
+	rx_oml(bts, NM_MT_OPSTART_ACK, NM_OC_CHANNEL, 0, 0, 1);
+	print_oml_window(bts);
+
+	printf("- response for 0,0,0\n");
+	rx_oml(bts, NM_MT_OPSTART_ACK, NM_OC_CHANNEL, 0, 0, 0);
+	print_oml_window(bts);
+	rx_oml(bts, NM_MT_OPSTART_ACK, NM_OC_CHANNEL, 0, 0, 0);
+	print_oml_window(bts);
+
+	printf("- a message to wildcard instances is answered for the BTS\n");
+	abis_nm_opstart(bts, NM_OC_BTS, 0xff, 0xff, 0xff);
+	rx_oml(bts, NM_MT_OPSTART_ACK, NM_OC_BTS, 0, 0xff, 0xff);
+	print_oml_window(bts);
+
+	printf("- %d messages in flight at most\n", ABIS_NM_MAX_IN_FLIGHT);
+	for (i = 0; i < 20; i++)
+		abis_nm_opstart(bts, NM_OC_CHANNEL, 0, i / 8, i % 8);
+	print_oml_window(bts);
+
+	printf("- each response lets one more go out\n");
+	for (i = 0; i < 20; i++)
+		rx_oml(bts, NM_MT_OPSTART_ACK, NM_OC_CHANNEL, 0, i / 8, i % 8);
+	print_oml_window(bts);
+
+	printf("- late responses are dropped\n");
+	rx_oml(bts, NM_MT_OPSTART_ACK, NM_OC_CHANNEL, 0, 0, 0);
+	print_oml_window(bts);
+}
+
+static int test_nm_sig_cb(unsigned int subsys, unsigned int signal, void *handler_data, void *signal_data)
+{
+	switch (signal) {
+	case S_NM_IPACC_RESTART_ACK:
+		printf("S_NM_IPACC_RESTART_ACK\n");
+		break;
+	case S_NM_IPACC_RESTART_NACK:
+		printf("S_NM_IPACC_RESTART_NACK\n");
+		break;
+	}
+	return 0;
+}
+
+static void test_oml_direct(void)
+{
+	struct gsm_network *net = gsm_network_init(NULL);
+	struct gsm_bts *bts = create_nanobts(net, 2);
+
+	printf("\n%s()\n", __func__);
+	osmo_signal_register_handler(SS_NM, test_nm_sig_cb, NULL);
+
+	printf("- a message sent without waiting for its response is not in flight\n");
+	abis_nm_ipaccess_restart(bts->c0);
+	print_oml_window(bts);
+
+	printf("- its response is processed all the same, as for ipaccess-config -r\n");
+	rx_oml(bts, NM_MT_IPACC_RESTART_ACK, NM_OC_BASEB_TRANSC, 2, 0, 0xff);
+	print_oml_window(bts);
+
+	printf("- but only once\n");
+	rx_oml(bts, NM_MT_IPACC_RESTART_ACK, NM_OC_BASEB_TRANSC, 2, 0, 0xff);
+	print_oml_window(bts);
+
+	printf("- a NACK answers it as well\n");
+	abis_nm_ipaccess_restart(bts->c0);
+	rx_oml(bts, NM_MT_IPACC_RESTART_NACK, NM_OC_BASEB_TRANSC, 2, 0, 0xff);
+	print_oml_window(bts);
+
+	osmo_signal_unregister_handler(SS_NM, test_nm_sig_cb, NULL);
+}
+
+static void set_nm_running(struct gsm_nm_state *s)
+{
+	s->operational = NM_OPSTATE_ENABLED;
+	s->availability = NM_AVSTATE_OK;
+	s->administrative = NM_STATE_UNLOCKED;
+}
+
+static void test_bringup_check(void)
+{
+	struct gsm_network *net = gsm_network_init(NULL);
+	struct gsm_bts *bts = create_nanobts(net, 1);
+	struct gsm_bts_trx *trx1 = gsm_bts_trx_alloc(bts);
+
+	printf("\n%s()\n", __func__);
+
+	/* C0 has a TCH/F on TS 1 that the BTS lacks, TRX 1 is configured rf_locked */
+	bts->c0->rsl_link = talloc_zero(bts, struct e1inp_sign_link);
+	set_nm_running(&bts->c0->mo.nm_state);
+	set_nm_running(&bts->c0->bb_transc.mo.nm_state);
+	bts->c0->ts[1].pchan_from_config = GSM_PCHAN_TCH_F;
+	bts->c0->ts[1].mo.nm_state.availability = NM_AVSTATE_NOT_INSTALLED;
+	trx1->mo.nm_state.administrative = NM_STATE_LOCKED;
+	trx1->ts[0].pchan_from_config = GSM_PCHAN_TCH_F;
+
+	abis_nm_bringup_start(bts);
+	abis_nm_bringup_check(bts);
+	printf("C0 TS 0 not running: bring-up %s\n", bts->oml_bringup.running ? "continues" : "DONE");
+
+	set_nm_running(&bts->c0->ts[0].mo.nm_state);
+	abis_nm_bringup_check(bts);
+	printf("C0 TS 0 running: bring-up %s\n", bts->oml_bringup.running ? "CONTINUES" : "done");
+}
 
 static const struct log_info_cat log_categories[] = {
 };
@@ -177,8 +576,18 @@ int main(int argc, char **argv)
 {
 	osmo_init_logging2(NULL, &log_info);
 
+	if (argc > 1 && !strcmp(argv[1], "bench")) {
+		bench_meas_res_parse();
+		return EXIT_SUCCESS;
+	}
+
 	test_sw_selection();
 	test_abis_nm_ipaccess_cgi();
+	test_sw_image();
+	test_meas_res_parse();
+	test_oml_window();
+	test_oml_direct();
+	test_bringup_check();
 
 	return EXIT_SUCCESS;
 }
@@ -0,0 +1,392 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+
+#include <osmocom/core/application.h>
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/stat_item.h>
+#include <osmocom/core/utils.h>
+#include <osmocom/gsm/protocol/gsm_08_08.h>
+
+#include <osmocom/mgcp_client/mgcp_client_endpoint_fsm.h>
+
+#include <osmocom/bsc/abis_rsl.h>
+#include <osmocom/bsc/assignment_fsm.h>
+#include <osmocom/bsc/bsc_msc_data.h>
+#include <osmocom/bsc/bsc_subscr_conn_fsm.h>
+#include <osmocom/bsc/debug.h>
+#include <osmocom/bsc/gsm_data.h>
+#include <osmocom/bsc/lchan_fsm.h>
+#include <osmocom/bsc/lchan_select.h>
+#include <osmocom/bsc/timeslot_fsm.h>
+
+#include "fixture/fixture.h"
+
+/* The BTS of the current test; RSL sent to earlier ones, e.g. when their lchans get released, is not printed */
+static struct gsm_bts *bts;
+static struct gsm_subscriber_connection *conn;
+
+/* The CI towards the MSC, and its CRCX that the fake MGW has not yet responded to */
+static struct osmo_mgcpc_ep_ci *msc_ci;
+static struct {
+	struct osmo_fsm_inst *notify;
+	uint32_t event_success;
+	void *notify_data;
+} held_crcx;
+
+static const struct mgcp_conn_peer fake_mgw_rtp = {
+	.addr = "10.9.8.7",
+	.port = 4321,
+};
+
+static const char *ci_label(const struct osmo_mgcpc_ep_ci *ci)
+{
+	return ci == msc_ci ? "to-MSC" : "to-BTS";
+}
+
+/* override, requires '-Wl,--wrap=osmo_mgcpc_ep_ci_request'.
+ * The fake MGW responds to all requests right away, except for the CRCX towards the MSC, which is held until the
+ * test releases it with msc_crcx_ok(). */
+void __real_osmo_mgcpc_ep_ci_request(struct osmo_mgcpc_ep_ci *ci,
+				     enum mgcp_verb verb, const struct mgcp_conn_peer *verb_info,
+				     struct osmo_fsm_inst *notify,
+				     uint32_t event_success, uint32_t event_failure,
+				     void *notify_data);
+void __wrap_osmo_mgcpc_ep_ci_request(struct osmo_mgcpc_ep_ci *ci,
+				     enum mgcp_verb verb, const struct mgcp_conn_peer *verb_info,
+				     struct osmo_fsm_inst *notify,
+				     uint32_t event_success, uint32_t event_failure,
+				     void *notify_data)
+{
+	struct mgcp_conn_peer fake_data = fake_mgw_rtp;
+
+	if (conn && ci == conn->user_plane.mgw_endpoint_ci_msc)
+		msc_ci = ci;
+
+	if (ci == msc_ci && verb == MGCP_VERB_CRCX) {
+		printf("MGCP %s %s (held)\n", osmo_mgcp_verb_name(verb), ci_label(ci));
+		held_crcx.notify = notify;
+		held_crcx.event_success = event_success;
+		held_crcx.notify_data = notify_data;
+		return;
+	}
+
+	printf("MGCP %s %s\n", osmo_mgcp_verb_name(verb), ci_label(ci));
+	if (!notify)
+		return;
+	osmo_fsm_inst_dispatch(notify, event_success, &fake_data);
+}
+
+/* override, requires '-Wl,--wrap=osmo_mgcpc_ep_ci_dlcx' */
+void __real_osmo_mgcpc_ep_ci_dlcx(struct osmo_mgcpc_ep_ci *ci);
+void __wrap_osmo_mgcpc_ep_ci_dlcx(struct osmo_mgcpc_ep_ci *ci)
+{
+	printf("MGCP DLCX %s\n", ci_label(ci));
+	if (ci == msc_ci)
+		held_crcx.notify = NULL;
+}
+
+/* override, requires '-Wl,--wrap=osmo_mgcpc_ep_ci_get_rtp_info' */
+const struct mgcp_conn_peer *__real_osmo_mgcpc_ep_ci_get_rtp_info(const struct osmo_mgcpc_ep_ci *ci);
+const struct mgcp_conn_peer *__wrap_osmo_mgcpc_ep_ci_get_rtp_info(const struct osmo_mgcpc_ep_ci *ci)
+{
+	return &fake_mgw_rtp;
+}
+
+/* override, requires '-Wl,--wrap=osmo_mgcpc_ep_ci_get_crcx_info_to_sockaddr' */
+bool __real_osmo_mgcpc_ep_ci_get_crcx_info_to_sockaddr(const struct osmo_mgcpc_ep_ci *ci,
+							struct sockaddr_storage *dest);
+bool __wrap_osmo_mgcpc_ep_ci_get_crcx_info_to_sockaddr(const struct osmo_mgcpc_ep_ci *ci,
+							struct sockaddr_storage *dest)
+{
+	struct sockaddr_in *sin = (struct sockaddr_in *)dest;
+
+	memset(dest, 0, sizeof(*dest));
+	sin->sin_family = AF_INET;
+	sin->sin_port = htons(fake_mgw_rtp.port);
+	inet_pton(AF_INET, fake_mgw_rtp.addr, &sin->sin_addr);
+	return true;
+}
+
+/* override, requires '-Wl,--wrap=gscon_sigtran_send'.
+ * Catch the BSSMAP messages that the assignment_fsm sends to the MSC. */
+int __real_gscon_sigtran_send(struct gsm_subscriber_connection *conn, struct msgb *msg);
+int __wrap_gscon_sigtran_send(struct gsm_subscriber_connection *conn, struct msgb *msg)
+{
+	if (!msg)
+		return -ENOMEM;
+
+	switch (msg->l3h[2]) {
+	case BSS_MAP_MSG_ASSIGMENT_COMPLETE:
+		printf("BSSMAP Assignment Complete\n");
+		break;
+	case BSS_MAP_MSG_ASSIGMENT_FAILURE:
+		printf("BSSMAP Assignment Failure\n");
+		break;
+	default:
+		printf("unexpected BSSMAP message 0x%02x\n", msg->l3h[2]);
+		break;
+	}
+	msgb_free(msg);
+	return 0;
+}
+
+/* override, requires '-Wl,--wrap=abis_rsl_sendmsg'.
+ * Catch RSL messages sent towards the BTS: print the Channel Activations and the RR messages. */
+int __real_abis_rsl_sendmsg(struct msgb *msg);
+int __wrap_abis_rsl_sendmsg(struct msgb *msg)
+{
+	struct abis_rsl_dchan_hdr *dh = (struct abis_rsl_dchan_hdr *) msg->data;
+	struct e1inp_sign_link *sign_link = msg->dst;
+
+	if (sign_link->trx->bts != bts)
+		goto out;
+
+	switch (dh->c.msg_type) {
+	case RSL_MT_CHAN_ACTIV:
+		printf("CHAN ACTIV ts=%u\n", dh->chan_nr & 0x07);
+		break;
+	case RSL_MT_DATA_REQ:
+		printf("DATA REQ ts=%u\n", dh->chan_nr & 0x07);
+		break;
+	default:
+		break;
+	}
+out:
+	msgb_free(msg);
+	return 0;
+}
+
+static void fake_time_passes(unsigned int ms)
+{
+	printf("- %u ms pass\n", ms);
+	osmo_clock_override_add(CLOCK_MONOTONIC, ms / 1000, (ms % 1000) * 1000000);
+}
+
+static void rx_rsl_dchan(struct gsm_lchan *lchan, uint8_t msg_type)
+{
+	struct msgb *msg = msgb_alloc_headroom(256, 64, "RSL");
+	struct abis_rsl_dchan_hdr *dh;
+
+	dh = (struct abis_rsl_dchan_hdr *) msgb_put(msg, sizeof(*dh));
+	dh->c.msg_discr = ABIS_RSL_MDISC_DED_CHAN;
+	dh->c.msg_type = msg_type;
+	dh->ie_chan = RSL_IE_CHAN_NR;
+	dh->chan_nr = gsm_lchan2chan_nr(lchan);
+
+	msg->dst = lchan->ts->trx->bts->c0->rsl_link;
+	msg->l2h = (unsigned char *)dh;
+
+	abis_rsl_rcvmsg(msg);
+}
+
+static void send_chan_act_ack(struct gsm_lchan *lchan)
+{
+	printf("CHAN ACTIV ACK ts=%u\n", lchan->ts->nr);
+	rx_rsl_dchan(lchan, RSL_MT_CHAN_ACTIV_ACK);
+}
+
+static void send_chan_act_nack(struct gsm_lchan *lchan)
+{
+	printf("CHAN ACTIV NACK ts=%u\n", lchan->ts->nr);
+	rx_rsl_dchan(lchan, RSL_MT_CHAN_ACTIV_NACK);
+}
+
+/* The fake MGW finally responds to the CRCX towards the MSC */
+static void msc_crcx_ok(void)
+{
+	OSMO_ASSERT(held_crcx.notify);
+	printf("- MGW responds to the CRCX towards the MSC\n");
+	osmo_fsm_inst_dispatch(held_crcx.notify, held_crcx.event_success, held_crcx.notify_data);
+	held_crcx.notify = NULL;
+}
+
+static void print_state(void)
+{
+	printf("assignment: %s\n",
+	       conn->assignment.fi ? osmo_fsm_inst_state_name(conn->assignment.fi) : "(none)");
+}
+
+/* 4 SDCCH on TS 0 and a TCH/F on TS 1 and 2, and a conn on an established SDCCH that is linked to an AoIP MSC */
+static void start_test(const char *name)
+{
+	static const enum gsm_phys_chan_config pchan[] = {
+		GSM_PCHAN_CCCH_SDCCH4, GSM_PCHAN_TCH_F, GSM_PCHAN_TCH_F,
+	};
+	struct gsm_network *net = bsc_gsmnet;
+	struct mgcp_client *fake_mgcp_client = (void*)talloc_zero(net, int);
+	struct gsm_lchan *lchan;
+
+	printf("\n%s()\n", name);
+	bts = fixture_bts_alloc(pchan, ARRAY_SIZE(pchan));
+	msc_ci = NULL;
+	held_crcx.notify = NULL;
+
+	lchan = lchan_select_by_type(bts, GSM_LCHAN_SDCCH);
+	OSMO_ASSERT(lchan);
+	/* serious hack into osmo_fsm */
+	lchan->fi->state = LCHAN_ST_ESTABLISHED;
+	lchan->ts->fi->state = TS_ST_IN_USE;
+
+	conn = bsc_subscr_con_allocate(net);
+	conn->user_plane.mgw_endpoint = osmo_mgcpc_ep_alloc(conn->fi,
+							   GSCON_EV_FORGET_MGW_ENDPOINT,
+							   fake_mgcp_client,
+							   net->mgw.tdefs,
+							   "test",
+							   "fake endpoint");
+	conn->sccp.msc = osmo_msc_data_alloc(net, 0);
+	OSMO_ASSERT(gscon_is_aoip(conn));
+
+	lchan->conn = conn;
+	conn->lchan = lchan;
+
+	/* kick the FSM from INIT through to the ACTIVE state */
+	osmo_fsm_inst_dispatch(conn->fi, GSCON_EV_A_CONN_REQ, NULL);
+	osmo_fsm_inst_dispatch(conn->fi, GSCON_EV_A_CONN_CFM, NULL);
+}
+
+static void rx_assignment_cmd(void)
+{
+	struct assignment_request req = {
+		.aoip = true,
+		.msc_rtp_addr = "1.2.3.4",
+		.msc_rtp_port = 1234,
+		.n_ch_mode_rate = 1,
+		.ch_mode_rate = {
+			{ .chan_mode = GSM48_CMODE_SPEECH_V1, .chan_rate = CH_RATE_FULL, },
+		},
+	};
+
+	printf("- BSSMAP Assignment Command\n");
+	osmo_fsm_inst_dispatch(conn->fi, GSCON_EV_ASSIGNMENT_START, &req);
+	print_state();
+}
+
+/* In pipelined mode, the CRCX towards the MSC is sent along with the Channel Activation. Here the MGW responds only
+ * after the lchan is established. */
+static void test_pipelined_mgw(void)
+{
+	struct gsm_network *net = bsc_gsmnet;
+	struct gsm_lchan *new_lchan;
+
+	start_test(__func__);
+	net->assignment_mgw_pipelining = true;
+
+	rx_assignment_cmd();
+	new_lchan = conn->assignment.new_lchan;
+	OSMO_ASSERT(new_lchan);
+
+	fake_time_passes(20);
+	send_chan_act_ack(new_lchan);
+	print_state();
+
+	fake_time_passes(80);
+	printf("- RR Assignment Complete, then SABM on the new lchan\n");
+	osmo_fsm_inst_dispatch(conn->assignment.fi, ASSIGNMENT_EV_RR_ASSIGNMENT_COMPLETE, NULL);
+	print_state();
+	osmo_fsm_inst_dispatch(new_lchan->fi, LCHAN_EV_RLL_ESTABLISH_IND, NULL);
+	print_state();
+
+	fake_time_passes(50);
+	msc_crcx_ok();
+	print_state();
+	printf("conn: %s, primary lchan on ts=%u\n", osmo_fsm_inst_state_name(conn->fi), conn->lchan->ts->nr);
+	printf("assignment latency p50: %d ms\n",
+	       osmo_stat_item_get_last(net->bsc_statg->items[BSC_STAT_ASSIGNMENT_LATENCY_P50]));
+}
+
+/* The lchan activation fails while the CRCX towards the MSC is still pending: the Assignment fails, the MSC side CI
+ * is DLCXed and the conn stays on its old lchan. */
+static void test_pipelined_mgw_rollback(void)
+{
+	struct gsm_network *net = bsc_gsmnet;
+	struct gsm_lchan *new_lchan;
+
+	start_test(__func__);
+	net->assignment_mgw_pipelining = true;
+
+	rx_assignment_cmd();
+	new_lchan = conn->assignment.new_lchan;
+	OSMO_ASSERT(new_lchan);
+
+	fake_time_passes(20);
+	printf("- the BTS refuses the new lchan\n");
+	send_chan_act_nack(new_lchan);
+	print_state();
+	printf("new lchan: %s\n", osmo_fsm_inst_state_name(new_lchan->fi));
+	printf("conn: %s, primary lchan on ts=%u\n", osmo_fsm_inst_state_name(conn->fi), conn->lchan->ts->nr);
+	printf("MSC side CRCX still pending: %s\n", held_crcx.notify ? "yes" : "no");
+}
+
+static const struct log_info_cat log_categories[] = {
+	[DRSL] = {
+		.name = "DRSL",
+		.description = "A-bis Radio Signalling Link (RSL)",
+		.color = "\033[1;35m",
+		.enabled = 1, .loglevel = LOGL_DEBUG,
+	},
+	[DRR] = {
+		.name = "DRR",
+		.description = "RR",
+		.color = "\033[1;35m",
+		.enabled = 1, .loglevel = LOGL_DEBUG,
+	},
+	[DMSC] = {
+		.name = "DMSC",
+		.description = "Mobile Switching Center",
+		.enabled = 1, .loglevel = LOGL_DEBUG,
+	},
+	[DCHAN] = {
+		.name = "DCHAN",
+		.description = "lchan FSM",
+		.color = "\033[1;32m",
+		.enabled = 1, .loglevel = LOGL_DEBUG,
+	},
+	[DTS] = {
+		.name = "DTS",
+		.description = "timeslot FSM",
+		.color = "\033[1;31m",
+		.enabled = 1, .loglevel = LOGL_DEBUG,
+	},
+	[DAS] = {
+		.name = "DAS",
+		.description = "assignment FSM",
+		.color = "\033[1;33m",
+		.enabled = 1, .loglevel = LOGL_DEBUG,
+	},
+};
+
+const struct log_info log_info = {
+	.cat = log_categories,
+	.num_cat = ARRAY_SIZE(log_categories),
+};
+
+int main(int argc, char **argv)
+{
+	fixture_init(talloc_named_const(NULL, 0, "assignment_test"), &log_info);
+	assignment_fsm_init();
+
+	test_pipelined_mgw();
+	test_pipelined_mgw_rollback();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,154 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <time.h>
+
+#include <osmocom/abis/e1_input.h>
+#include <osmocom/core/application.h>
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/timer.h>
+#include <osmocom/core/stat_item.h>
+
+#include <osmocom/bsc/abis_nm.h>
+#include <osmocom/bsc/bss.h>
+#include <osmocom/bsc/bts_bringup.h>
+#include <osmocom/bsc/debug.h>
+#include <osmocom/bsc/gsm_data.h>
+#include <osmocom/bsc/gsm_08_08.h>
+#include <osmocom/bsc/handover.h>
+#include <osmocom/bsc/osmo_bsc.h>
+#include <osmocom/bsc/lchan_fsm.h>
+#include <osmocom/bsc/timeslot_fsm.h>
+#include <osmocom/bsc/bsc_subscr_conn_fsm.h>
+
+#include "fixture/fixture.h"
+
+static struct gsm_bts *bts[5];
+
+static void fake_time_passes(unsigned int s)
+{
+	printf("- %u s pass\n", s);
+	osmo_clock_override_add(CLOCK_MONOTONIC, s, 0);
+	osmo_timers_prepare();
+	osmo_timers_update();
+}
+
+/* override, requires '-Wl,--wrap=abis_sendmsg'.
+ * Catch OML messages sent towards the BTS. */
+int __real_abis_sendmsg(struct msgb *msg);
+int __wrap_abis_sendmsg(struct msgb *msg)
+{
+	struct e1inp_sign_link *sign_link = msg->dst;
+
+	printf("bts %u: Tx OML\n", sign_link->trx->bts->nr);
+	msgb_free(msg);
+	return 0;
+}
+
+static struct gsm_bts *create_bts(uint8_t priority)
+{
+	struct gsm_bts *b = fixture_bts_alloc(NULL, 0);
+
+	b->bringup.priority = priority;
+	b->oml_link = talloc_zero(b, struct e1inp_sign_link);
+	b->oml_link->trx = b->c0;
+	return b;
+}
+
+/* The OML link comes up, as in inp_sig_cb(): the first OML message goes out once it is the BTS's turn */
+static void oml_up(struct gsm_bts *b)
+{
+	printf("- bts %u (priority %u): OML up\n", b->nr, b->bringup.priority);
+	bts_bringup_request(b);
+	abis_nm_opstart(b, NM_OC_SITE_MANAGER, 0xff, 0xff, 0xff);
+}
+
+static void print_bringup(void)
+{
+	struct gsm_network *net = bsc_gsmnet;
+	struct gsm_bts *b;
+
+	llist_for_each_entry(b, &net->bts_list, list)
+		printf("bts %u: %s\n", b->nr, get_value_string(bts_bringup_state_names, b->bringup.state));
+	printf("waiting %d, active %d, completed %" PRIu64 ", timeout %" PRIu64 "\n",
+	       osmo_stat_item_get_last(net->bsc_statg->items[BSC_STAT_BTS_BRINGUP_WAITING]),
+	       osmo_stat_item_get_last(net->bsc_statg->items[BSC_STAT_BTS_BRINGUP_ACTIVE]),
+	       net->bsc_ctrs->ctr[BSC_CTR_BTS_BRINGUP_COMPLETED].current,
+	       net->bsc_ctrs->ctr[BSC_CTR_BTS_BRINGUP_TIMEOUT].current);
+}
+
+static void test_bringup(void)
+{
+	printf("\n%s()\n", __func__);
+
+	bsc_gsmnet->bts_bringup.max_concurrent = 2;
+	bts[0] = create_bts(0);
+	bts[1] = create_bts(0);
+	bts[2] = create_bts(0);
+	bts[3] = create_bts(7);
+	bts[4] = create_bts(0);
+
+	printf("- max-concurrent 2: the third and fourth BTS wait, with their OML messages queued\n");
+	oml_up(bts[0]);
+	oml_up(bts[1]);
+	oml_up(bts[2]);
+	oml_up(bts[3]);
+	print_bringup();
+
+	printf("- bts 0 is up, bts 3 goes next for its higher priority\n");
+	bts_bringup_done(bts[0]);
+	print_bringup();
+
+	printf("- bts 1 loses OML, bts 2 goes next\n");
+	bts_bringup_abort(bts[1]);
+	print_bringup();
+
+	oml_up(bts[4]);
+	printf("- bts 3 and 2 take longer than X993103 and are no longer throttled, bts 4 goes next\n");
+	fake_time_passes(60);
+	print_bringup();
+
+	printf("- bts 0 is up once more, which changes nothing\n");
+	bts_bringup_done(bts[0]);
+	print_bringup();
+}
+
+static const struct log_info_cat log_categories[] = {
+	[DNM] = {
+		.name = "DNM",
+		.description = "A-bis Network Management / O&M (NM/OML)",
+		.color = "\033[1;36m",
+		.enabled = 1, .loglevel = LOGL_DEBUG,
+	},
+};
+
+const struct log_info log_info = {
+	.cat = log_categories,
+	.num_cat = ARRAY_SIZE(log_categories),
+};
+
+int main(int argc, char **argv)
+{
+	fixture_init(talloc_named_const(NULL, 0, "bts_bringup_test"), &log_info);
+
+	test_bringup();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,238 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <osmocom/abis/e1_input.h>
+#include <osmocom/core/application.h>
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/timer.h>
+
+#include <osmocom/bsc/bss.h>
+#include <osmocom/bsc/bts_snapshot.h>
+#include <osmocom/bsc/debug.h>
+#include <osmocom/bsc/gsm_data.h>
+#include <osmocom/bsc/gsm_08_08.h>
+#include <osmocom/bsc/handover.h>
+#include <osmocom/bsc/osmo_bsc.h>
+#include <osmocom/bsc/lchan_fsm.h>
+#include <osmocom/bsc/system_information.h>
+#include <osmocom/bsc/timeslot_fsm.h>
+#include <osmocom/bsc/bsc_subscr_conn_fsm.h>
+
+#include "fixture/fixture.h"
+
+static struct gsm_bts *bts[2];
+
+/* What the SI of one BTS come to: the RSL messages sent for them, and the state kept in the BTS */
+struct si_record {
+	uint8_t rsl[2048];
+	size_t rsl_len;
+	uint32_t si_valid;
+	uint8_t si2q_count;
+	sysinfo_buf_t si_buf[_MAX_SYSINFO_TYPE][SI2Q_MAX_NUM];
+	uint8_t neigh_list[1024/8];
+	uint8_t si5_neigh_list[1024/8];
+	uint8_t cell_alloc[1024/8];
+};
+
+/* The record that RSL messages are appended to, if any */
+static struct si_record *recording;
+
+static void fake_time_passes(unsigned int s)
+{
+	printf("- %u s pass\n", s);
+	osmo_clock_override_add(CLOCK_MONOTONIC, s, 0);
+	osmo_timers_prepare();
+	osmo_timers_update();
+}
+
+/* override, requires '-Wl,--wrap=abis_rsl_sendmsg'.
+ * Record the BCCH INFO and SACCH FILLING sent for the SI. */
+int __real_abis_rsl_sendmsg(struct msgb *msg);
+int __wrap_abis_rsl_sendmsg(struct msgb *msg)
+{
+	if (recording) {
+		OSMO_ASSERT(recording->rsl_len + msgb_length(msg) <= sizeof(recording->rsl));
+		memcpy(&recording->rsl[recording->rsl_len], msgb_data(msg), msgb_length(msg));
+		recording->rsl_len += msgb_length(msg);
+	}
+	msgb_free(msg);
+	return 0;
+}
+
+static struct gsm_bts *create_bts(uint16_t arfcn)
+{
+	struct gsm_bts *b = fixture_bts_alloc(NULL, 0);
+
+	b->band = GSM_BAND_1800;
+	b->location_area_code = 23;
+	b->cell_identity = 100 + b->nr;
+	b->c0->arfcn = arfcn;
+	return b;
+}
+
+/* Forget the SI of b, as after a restart */
+static void wipe_si(struct gsm_bts *b)
+{
+	memset(b->si_buf, 0, sizeof(b->si_buf));
+	b->si_valid = 0;
+	b->si2q_count = 0;
+	memset(b->si_common.data.neigh_list, 0, sizeof(b->si_common.data.neigh_list));
+	memset(b->si_common.data.si5_neigh_list, 0, sizeof(b->si_common.data.si5_neigh_list));
+	memset(b->si_common.data.cell_alloc, 0, sizeof(b->si_common.data.cell_alloc));
+}
+
+static void set_si(struct gsm_bts *b, struct si_record *r)
+{
+	int i;
+
+	memset(r, 0, sizeof(*r));
+	recording = r;
+	OSMO_ASSERT(gsm_bts_trx_set_system_infos(b->c0) == 0);
+	recording = NULL;
+
+	r->si_valid = b->si_valid;
+	r->si2q_count = b->si2q_count;
+	/* only the valid SI count, an SI found to be not needed may leave its buffer half written */
+	for (i = 0; i < _MAX_SYSINFO_TYPE; i++) {
+		if (GSM_BTS_HAS_SI(b, i))
+			memcpy(r->si_buf[i], b->si_buf[i], sizeof(r->si_buf[i]));
+	}
+	memcpy(r->neigh_list, b->si_common.data.neigh_list, sizeof(r->neigh_list));
+	memcpy(r->si5_neigh_list, b->si_common.data.si5_neigh_list, sizeof(r->si5_neigh_list));
+	memcpy(r->cell_alloc, b->si_common.data.cell_alloc, sizeof(r->cell_alloc));
+}
+
+static void print_ctrs(void)
+{
+	struct gsm_network *net = bsc_gsmnet;
+
+	printf("reused %" PRIu64 ", stale %" PRIu64 "\n",
+	       net->bsc_ctrs->ctr[BSC_CTR_WARM_START_SI_REUSED].current,
+	       net->bsc_ctrs->ctr[BSC_CTR_WARM_START_SI_STALE].current);
+}
+
+/* Set the SI of all BTS as after a (re)start of the BSC, and compare them to SI generated without a snapshot */
+static void start(bool restart)
+{
+	struct gsm_network *net = bsc_gsmnet;
+	static struct si_record expected[ARRAY_SIZE(bts)];
+	static struct si_record got[ARRAY_SIZE(bts)];
+	char *path;
+	int i;
+
+	path = net->warm_start.path;
+	net->warm_start.path = NULL;
+	for (i = 0; i < ARRAY_SIZE(bts); i++) {
+		wipe_si(bts[i]);
+		set_si(bts[i], &expected[i]);
+	}
+	net->warm_start.path = path;
+
+	if (restart) {
+		/* the snapshots of the previous run are gone with it, only the file remains */
+		INIT_LLIST_HEAD(&net->warm_start.snapshots);
+	}
+	OSMO_ASSERT(bts_snapshot_load(net) == 0);
+	printf("snapshot: %u BTS\n", bts_snapshot_count(net));
+
+	for (i = 0; i < ARRAY_SIZE(bts); i++) {
+		wipe_si(bts[i]);
+		set_si(bts[i], &got[i]);
+	}
+	print_ctrs();
+
+	for (i = 0; i < ARRAY_SIZE(bts); i++)
+		printf("bts %u: SI %s\n", bts[i]->nr,
+		       memcmp(&got[i], &expected[i], sizeof(got[i])) ? "DIFFER FROM THOSE GENERATED" : "identical");
+}
+
+static void test_restore(void)
+{
+	struct gsm_network *net = bsc_gsmnet;
+	char path[] = "/tmp/bts_snapshot_test.XXXXXX";
+	int fd;
+
+	printf("\n%s()\n", __func__);
+
+	fd = mkstemp(path);
+	OSMO_ASSERT(fd >= 0);
+	close(fd);
+	unlink(path);
+	net->warm_start.path = talloc_strdup(net, path);
+
+	bts[0] = create_bts(870);
+	bts[1] = create_bts(871);
+	/* a UMTS neighbor, to have SI2quater */
+	OSMO_ASSERT(bts_uarfcn_add(bts[0], 10564, 319, false) == 0);
+
+	printf("- first start: no snapshot yet, the SI are generated\n");
+	start(false);
+	/* the snapshot is written 5 s after the last change */
+	fake_time_passes(5);
+
+	printf("- restart: the SI of both BTS come from the snapshot\n");
+	start(true);
+
+	printf("- restart after the cell identity of bts 1 changed: its SI are generated anew\n");
+	bts[1]->cell_identity = 200;
+	start(true);
+	fake_time_passes(5);
+
+	printf("- restart once more: the SI of bts 1 come from the snapshot again\n");
+	start(true);
+
+	printf("- restart after the ARFCN of bts 0 changed: both generate their SI anew, bts 1 for its neighbor list\n");
+	bts[0]->c0->arfcn = 880;
+	start(true);
+
+	unlink(path);
+}
+
+static const struct log_info_cat log_categories[] = {
+	[DRR] = {
+		.name = "DRR",
+		.description = "RR",
+		.color = "\033[1;35m",
+		.enabled = 1, .loglevel = LOGL_DEBUG,
+	},
+	[DRSL] = {
+		.name = "DRSL",
+		.description = "A-bis Radio Signalling Link (RSL)",
+		.color = "\033[1;35m",
+		.enabled = 1, .loglevel = LOGL_DEBUG,
+	},
+};
+
+const struct log_info log_info = {
+	.cat = log_categories,
+	.num_cat = ARRAY_SIZE(log_categories),
+};
+
+int main(int argc, char **argv)
+{
+	fixture_init(talloc_named_const(NULL, 0, "bts_snapshot_test"), &log_info);
+
+	test_restore();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,172 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <osmocom/abis/e1_input.h>
+#include <osmocom/core/application.h>
+#include <osmocom/core/stat_item.h>
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/utils.h>
+
+#include <osmocom/bsc/abis_rsl.h>
+#include <osmocom/bsc/chan_alloc.h>
+#include <osmocom/bsc/debug.h>
+#include <osmocom/bsc/gsm_data.h>
+#include <osmocom/bsc/lchan_fsm.h>
+#include <osmocom/bsc/lchan_select.h>
+
+#include "fixture/fixture.h"
+
+static struct gsm_bts *bts[2];
+
+/* override, requires '-Wl,--wrap=abis_rsl_sendmsg'.
+ * Catch RSL messages sent towards the BTS. */
+int __real_abis_rsl_sendmsg(struct msgb *msg);
+int __wrap_abis_rsl_sendmsg(struct msgb *msg)
+{
+	struct abis_rsl_dchan_hdr *dh = (struct abis_rsl_dchan_hdr *) msg->data;
+	struct e1inp_sign_link *sign_link = msg->dst;
+
+	switch (dh->c.msg_type) {
+	case RSL_MT_CHAN_ACTIV:
+		printf("CHAN ACTIV bts=%u TS%u\n", sign_link->trx->bts->nr, dh->chan_nr & 0x07);
+		break;
+	default:
+		printf("unexpected RSL message 0x%02x\n", dh->c.msg_type);
+		break;
+	}
+	msgb_free(msg);
+	return 0;
+}
+
+static int32_t stat_get(struct osmo_stat_item_group *statg, unsigned int idx)
+{
+	return osmo_stat_item_get_last(statg->items[idx]);
+}
+
+/* Take a channel load sample of all BTS like the T3122 timer does, and print the gauges */
+static void sample(void)
+{
+	struct pchan_load pl;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(bts); i++)
+		bts_update_t3122_chan_load(bts[i]);
+	network_chan_load_publish(bsc_gsmnet);
+
+	for (i = 0; i < ARRAY_SIZE(bts); i++)
+		printf("bts %u: SDCCH4 %d/%d, TCH/F %d/%d\n", bts[i]->nr,
+		       stat_get(bts[i]->bts_statg, BTS_STAT_CHAN_CCCH_SDCCH4_USED),
+		       stat_get(bts[i]->bts_statg, BTS_STAT_CHAN_CCCH_SDCCH4_TOTAL),
+		       stat_get(bts[i]->bts_statg, BTS_STAT_CHAN_TCH_F_USED),
+		       stat_get(bts[i]->bts_statg, BTS_STAT_CHAN_TCH_F_TOTAL));
+	printf("bsc: SDCCH %d/%d, TCH %d/%d\n",
+	       stat_get(bsc_gsmnet->bsc_statg, BSC_STAT_CHAN_SDCCH_USED),
+	       stat_get(bsc_gsmnet->bsc_statg, BSC_STAT_CHAN_SDCCH_TOTAL),
+	       stat_get(bsc_gsmnet->bsc_statg, BSC_STAT_CHAN_TCH_USED),
+	       stat_get(bsc_gsmnet->bsc_statg, BSC_STAT_CHAN_TCH_TOTAL));
+
+	/* The network-wide sum is only updated by the changes of each BTS; it must match a count over all BTS */
+	network_chan_load(&pl, bsc_gsmnet);
+	for (i = 0; i < ARRAY_SIZE(pl.pchan); i++) {
+		OSMO_ASSERT(bsc_gsmnet->chan_load_last[i].used == pl.pchan[i].used);
+		OSMO_ASSERT(bsc_gsmnet->chan_load_last[i].total == pl.pchan[i].total);
+	}
+}
+
+static void activate(struct gsm_bts *b, enum gsm_chan_t type)
+{
+	struct lchan_activate_info info = {
+		.activ_for = FOR_VTY,
+		.chan_mode = GSM48_CMODE_SIGN,
+	};
+	struct gsm_lchan *lchan = lchan_select_by_type(b, type);
+
+	OSMO_ASSERT(lchan);
+	lchan_activate(lchan, &info);
+}
+
+static void test_network_sum(void)
+{
+	static const enum gsm_phys_chan_config pchan0[] = { GSM_PCHAN_CCCH_SDCCH4, GSM_PCHAN_TCH_F, GSM_PCHAN_TCH_F };
+	static const enum gsm_phys_chan_config pchan1[] = { GSM_PCHAN_CCCH_SDCCH4, GSM_PCHAN_TCH_F };
+
+	printf("\n%s()\n", __func__);
+	bts[0] = fixture_bts_alloc(pchan0, ARRAY_SIZE(pchan0));
+	bts[1] = fixture_bts_alloc(pchan1, ARRAY_SIZE(pchan1));
+	/* an ip.access style BTS, whose TRX goes out of service with its NM state */
+	bts[1]->type = GSM_BTS_TYPE_OSMOBTS;
+	sample();
+
+	printf("- an SDCCH on bts 0 and the TCH/F of bts 1 go into use\n");
+	activate(bts[0], GSM_LCHAN_SDCCH);
+	activate(bts[1], GSM_LCHAN_TCH_F);
+	sample();
+
+	printf("- nothing changes\n");
+	sample();
+
+	printf("- the TRX of bts 1 goes out of service, its load drops out of the sum\n");
+	bts[1]->c0->mo.nm_state.operational = NM_OPSTATE_DISABLED;
+	sample();
+
+	printf("- the TRX of bts 1 comes back\n");
+	bts[1]->c0->mo.nm_state.operational = NM_OPSTATE_ENABLED;
+	sample();
+}
+
+static const struct log_info_cat log_categories[] = {
+	[DRSL] = {
+		.name = "DRSL",
+		.description = "A-bis Radio Signalling Link (RSL)",
+		.color = "\033[1;35m",
+		.enabled = 1, .loglevel = LOGL_DEBUG,
+	},
+	[DRLL] = {
+		.name = "DRLL",
+		.description = "RLL",
+		.color = "\033[1;35m",
+		.enabled = 1, .loglevel = LOGL_DEBUG,
+	},
+	[DCHAN] = {
+		.name = "DCHAN",
+		.description = "lchan FSM",
+		.color = "\033[1;32m",
+		.enabled = 1, .loglevel = LOGL_DEBUG,
+	},
+	[DTS] = {
+		.name = "DTS",
+		.description = "timeslot FSM",
+		.color = "\033[1;31m",
+		.enabled = 1, .loglevel = LOGL_DEBUG,
+	},
+};
+
+const struct log_info log_info = {
+	.cat = log_categories,
+	.num_cat = ARRAY_SIZE(log_categories),
+};
+
+int main(int argc, char **argv)
+{
+	fixture_init(talloc_named_const(NULL, 0, "chan_load_test"), &log_info);
+
+	test_network_sum();
+
+	return EXIT_SUCCESS;
+}
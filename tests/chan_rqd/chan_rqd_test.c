@@ -0,0 +1,503 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
+
+#include <osmocom/core/application.h>
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/timer.h>
+#include <osmocom/core/stat_item.h>
+#include <osmocom/core/utils.h>
+
+#include <osmocom/bsc/abis_rsl.h>
+#include <osmocom/bsc/debug.h>
+#include <osmocom/bsc/bss.h>
+#include <osmocom/bsc/gsm_data.h>
+#include <osmocom/bsc/gsm_08_08.h>
+#include <osmocom/bsc/handover.h>
+#include <osmocom/bsc/osmo_bsc.h>
+#include <osmocom/bsc/lchan_fsm.h>
+#include <osmocom/bsc/timeslot_fsm.h>
+#include <osmocom/bsc/bsc_subscr_conn_fsm.h>
+
+#include "fixture/fixture.h"
+
+/* The BTS of the current test; RSL sent to earlier ones, e.g. when their lchans time out, is not printed */
+static struct gsm_bts *bts;
+/* Let the BTS refuse Immediate Assignment commands */
+static bool imm_ass_cmd_fail;
+
+/* RA values that map to the same cause with and without NECI */
+#define RA_EMERG	0xa1
+#define RA_PAG		0x81
+#define RA_CALL		0xc1
+#define RA_LU(n)	(0x00 + (n))
+
+/* One iteration of the main loop: run the timers that are due */
+static void main_loop(void)
+{
+	osmo_timers_prepare();
+	osmo_timers_update();
+}
+
+static void fake_time_passes(unsigned int ms)
+{
+	printf("- %u ms pass\n", ms);
+	osmo_clock_override_add(CLOCK_MONOTONIC, ms / 1000, (ms % 1000) * 1000000);
+	main_loop();
+}
+
+/* 4 SDCCH on TS 0 and one TCH/F on TS 1 */
+static struct gsm_bts *create_bts(void)
+{
+	static const enum gsm_phys_chan_config pchan[] = { GSM_PCHAN_CCCH_SDCCH4, GSM_PCHAN_TCH_F };
+
+	return fixture_bts_alloc(pchan, ARRAY_SIZE(pchan));
+}
+
+/* Receive a CHAN RQD from the RACH; n makes up the frame number of the request reference */
+static void chan_rqd(uint8_t ra, unsigned int n)
+{
+	struct msgb *msg = msgb_alloc_headroom(256, 64, "RSL");
+	struct abis_rsl_dchan_hdr *dh;
+	struct gsm48_req_ref ref = {
+		.ra = ra,
+		.t1 = n & 0x1f,
+		.t2 = (n >> 5) & 0x1f,
+	};
+	uint8_t *buf;
+
+	dh = (struct abis_rsl_dchan_hdr *) msgb_put(msg, sizeof(*dh));
+	dh->c.msg_discr = ABIS_RSL_MDISC_COM_CHAN;
+	dh->c.msg_type = RSL_MT_CHAN_RQD;
+	dh->ie_chan = RSL_IE_CHAN_NR;
+	dh->chan_nr = RSL_CHAN_RACH;
+
+	buf = msgb_put(msg, 1 + sizeof(ref) + 2);
+	buf[0] = RSL_IE_REQ_REFERENCE;
+	memcpy(&buf[1], &ref, sizeof(ref));
+	buf[1 + sizeof(ref)] = RSL_IE_ACCESS_DELAY;
+	buf[2 + sizeof(ref)] = 1;
+
+	msg->dst = bts->c0->rsl_link;
+	msg->l2h = (unsigned char *)dh;
+
+	abis_rsl_rcvmsg(msg);
+}
+
+static void send_chan_act_ack(struct gsm_lchan *lchan)
+{
+	struct msgb *msg = msgb_alloc_headroom(256, 64, "RSL");
+	struct abis_rsl_dchan_hdr *dh;
+
+	dh = (struct abis_rsl_dchan_hdr *) msgb_put(msg, sizeof(*dh));
+	dh->c.msg_discr = ABIS_RSL_MDISC_DED_CHAN;
+	dh->c.msg_type = RSL_MT_CHAN_ACTIV_ACK;
+	dh->ie_chan = RSL_IE_CHAN_NR;
+	dh->chan_nr = gsm_lchan2chan_nr(lchan);
+
+	msg->dst = lchan->ts->trx->bts->c0->rsl_link;
+	msg->l2h = (unsigned char *)dh;
+
+	printf("CHAN ACTIV ACK chan_nr=0x%02x\n", dh->chan_nr);
+	abis_rsl_rcvmsg(msg);
+}
+
+static const char *lchan_type_str(const struct gsm_lchan *lchan)
+{
+	switch (lchan->type) {
+	case GSM_LCHAN_SDCCH:
+		return "SDCCH";
+	case GSM_LCHAN_TCH_F:
+		return "TCH/F";
+	case GSM_LCHAN_TCH_H:
+		return "TCH/H";
+	default:
+		return "?";
+	}
+}
+
+static void print_imm_ass_cmd(const uint8_t *l3)
+{
+	const struct gsm48_imm_ass *ia = (const struct gsm48_imm_ass *) l3;
+	const struct gsm48_imm_ass_rej *iar = (const struct gsm48_imm_ass_rej *) l3;
+
+	switch (iar->msg_type) {
+	case GSM48_MT_RR_IMM_ASS:
+		printf("IMM ASS: l2_plen=0x%02x chan_nr=0x%02x ra=0x%02x ma=[%s]\n", ia->l2_plen,
+		       ia->chan_desc.chan_nr, ia->req_ref.ra, osmo_hexdump_nospc(ia->mob_alloc, ia->mob_alloc_len));
+		break;
+	case GSM48_MT_RR_IMM_ASS_EXT:
+		/* 3GPP TS 44.018 9.1.19: two times Channel Description, Request Reference and Timing Advance, then the
+		 * Mobile Allocation */
+		printf("IMM ASS EXT: l2_plen=0x%02x chan_nr=0x%02x ra=0x%02x chan_nr=0x%02x ra=0x%02x ma=[%s]\n",
+		       l3[0], l3[4], l3[7], l3[11], l3[14], osmo_hexdump_nospc(&l3[19], l3[18]));
+		break;
+	case GSM48_MT_RR_IMM_ASS_REJ:
+		printf("IMM ASS REJ: 0x%02x/%u 0x%02x/%u 0x%02x/%u 0x%02x/%u\n",
+		       iar->req_ref1.ra, iar->wait_ind1, iar->req_ref2.ra, iar->wait_ind2,
+		       iar->req_ref3.ra, iar->wait_ind3, iar->req_ref4.ra, iar->wait_ind4);
+		break;
+	default:
+		printf("IMM ASS CMD with unexpected message type 0x%02x\n", iar->msg_type);
+		break;
+	}
+}
+
+/* override, requires '-Wl,--wrap=abis_rsl_sendmsg'.
+ * Catch RSL messages sent towards the BTS. */
+int __real_abis_rsl_sendmsg(struct msgb *msg);
+int __wrap_abis_rsl_sendmsg(struct msgb *msg)
+{
+	struct abis_rsl_dchan_hdr *dh = (struct abis_rsl_dchan_hdr *) msg->data;
+	struct e1inp_sign_link *sign_link = msg->dst;
+	struct gsm_lchan *lchan;
+
+	if (sign_link->trx->bts != bts)
+		goto out;
+
+	switch (dh->c.msg_type) {
+	case RSL_MT_CHAN_ACTIV:
+		lchan = rsl_lchan_lookup(sign_link->trx, dh->chan_nr, NULL);
+		printf("CHAN ACTIV %s ra=0x%02x\n", lchan_type_str(lchan), lchan->rqd_ref->ra);
+		break;
+	case RSL_MT_IMMEDIATE_ASSIGN_CMD:
+		OSMO_ASSERT(dh->data[0] == RSL_IE_FULL_IMM_ASS_INFO && dh->data[1] == GSM_MACBLOCK_LEN);
+		print_imm_ass_cmd(&dh->data[2]);
+		if (imm_ass_cmd_fail) {
+			printf("(BTS refuses)\n");
+			msgb_free(msg);
+			return -EIO;
+		}
+		break;
+	case RSL_MT_RF_CHAN_REL:
+		printf("RF CHAN REL chan_nr=0x%02x\n", dh->chan_nr);
+		break;
+	default:
+		printf("unexpected RSL message 0x%02x\n", dh->c.msg_type);
+		break;
+	}
+out:
+	msgb_free(msg);
+	return 0;
+}
+
+static void print_ctrs(void)
+{
+	static const int ctrs[] = {
+		BTS_CTR_CHREQ_TOTAL,
+		BTS_CTR_CHREQ_NO_CHANNEL,
+		BTS_CTR_CHREQ_DUPLICATE,
+		BTS_CTR_CHREQ_PRIORITIZED,
+		BTS_CTR_CHREQ_SHED,
+		BTS_CTR_CHREQ_EXPIRED,
+	};
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(ctrs); i++)
+		printf("%s%s %" PRIu64, i ? ", " : "", bts->bts_ctrs->desc->ctr_desc[ctrs[i]].name,
+		       bts->bts_ctrs->ctr[ctrs[i]].current);
+	printf("\n");
+}
+
+static void print_agch_ctrs(void)
+{
+	static const int ctrs[] = {
+		BTS_CTR_CHREQ_SUCCESSFUL,
+		BTS_CTR_AGCH_IMM_ASS_EXT,
+		BTS_CTR_AGCH_BLOCKS_SAVED,
+		BTS_CTR_AGCH_SEND_FAILED,
+	};
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(ctrs); i++)
+		printf("%s%s %" PRIu64, i ? ", " : "", bts->bts_ctrs->desc->ctr_desc[ctrs[i]].name,
+		       bts->bts_ctrs->ctr[ctrs[i]].current);
+	printf("\n");
+}
+
+static void print_queue_length(void)
+{
+	printf("queue length: %d\n",
+	       osmo_stat_item_get_last(bts->bts_statg->items[BTS_STAT_CHREQ_QUEUE_LENGTH]));
+}
+
+static void start_test(const char *name)
+{
+	printf("\n%s()\n", name);
+	bts = create_bts();
+}
+
+static void test_dedup(void)
+{
+	start_test(__func__);
+
+	printf("- the same RACH burst reported twice\n");
+	chan_rqd(RA_LU(1), 1);
+	chan_rqd(RA_LU(1), 1);
+	print_queue_length();
+	main_loop();
+
+	printf("- and once more after it was served\n");
+	chan_rqd(RA_LU(1), 1);
+	main_loop();
+
+	printf("- the MS retries in another frame\n");
+	chan_rqd(RA_LU(1), 2);
+	main_loop();
+	print_ctrs();
+}
+
+static void test_priority(void)
+{
+	start_test(__func__);
+
+	printf("- five requests in one main loop iteration\n");
+	chan_rqd(RA_LU(1), 1);
+	chan_rqd(RA_CALL, 2);
+	chan_rqd(RA_PAG, 3);
+	chan_rqd(RA_EMERG, 4);
+	chan_rqd(RA_LU(2), 5);
+	printf("- the first is served right away, the others in the next main loop iteration by priority\n");
+	print_queue_length();
+	main_loop();
+	print_queue_length();
+	print_ctrs();
+}
+
+static void test_expiry(void)
+{
+	start_test(__func__);
+
+	printf("- the second request waits in the queue for longer than X993101\n");
+	chan_rqd(RA_LU(1), 1);
+	chan_rqd(RA_LU(2), 2);
+	fake_time_passes(1001);
+
+	printf("- the queue is empty, the next request is served right away\n");
+	chan_rqd(RA_LU(3), 3);
+	print_ctrs();
+}
+
+static void test_shedding(void)
+{
+	int i;
+
+	start_test(__func__);
+
+	printf("- a call is served right away\n");
+	chan_rqd(RA_CALL, 200);
+	printf("- 32 requests fill the queue\n");
+	for (i = 0; i < 32; i++)
+		chan_rqd(RA_LU(i), i);
+	print_queue_length();
+
+	printf("- one more of the same priority is rejected, right away on the idle AGCH\n");
+	chan_rqd(RA_LU(1), 100);
+	printf("- an emergency call is queued first, the last request is rejected instead\n");
+	chan_rqd(RA_EMERG, 101);
+	print_queue_length();
+	print_ctrs();
+
+	printf("- 16 requests are served per main loop iteration, the channels last for 5\n");
+	printf("- the wait indication is T3122\n");
+	main_loop();
+	print_queue_length();
+	main_loop();
+	print_queue_length();
+	fake_time_passes(20);
+	print_ctrs();
+}
+
+/* Serve three CHAN RQD on SDCCH of a BTS with the given Mobile Allocation on TS 0, and acknowledge all activations.
+ * The first Immediate Assignment goes out right away and keeps the AGCH busy for the other two. */
+static void three_imm_ass(const uint8_t *ma, unsigned int ma_len)
+{
+	struct gsm_bts_trx_ts *ts = &bts->c0->ts[0];
+
+	if (ma_len) {
+		ts->hopping.enabled = true;
+		ts->hopping.ma_len = ma_len;
+		memcpy(ts->hopping.ma_data, ma, ma_len);
+	}
+
+	chan_rqd(RA_LU(1), 1);
+	chan_rqd(RA_LU(2), 2);
+	chan_rqd(RA_LU(3), 3);
+	main_loop();
+	send_chan_act_ack(&ts->lchan[0]);
+	send_chan_act_ack(&ts->lchan[1]);
+	send_chan_act_ack(&ts->lchan[2]);
+}
+
+static void test_imm_ass_ext(void)
+{
+	start_test(__func__);
+
+	printf("- the second Immediate Assignment waits for the third, both go out together\n");
+	three_imm_ass(NULL, 0);
+	fake_time_passes(20);
+	print_agch_ctrs();
+}
+
+static void test_imm_ass_ext_hopping(void)
+{
+	static const uint8_t ma[] = { 0x01, 0x02, 0x03, 0x04 };
+
+	start_test(__func__);
+
+	printf("- a Mobile Allocation of 4 octets still fits\n");
+	three_imm_ass(ma, sizeof(ma));
+	fake_time_passes(20);
+	print_agch_ctrs();
+}
+
+static void test_imm_ass_ma_too_long(void)
+{
+	static const uint8_t ma[] = { 0x01, 0x02, 0x03, 0x04, 0x05 };
+
+	start_test(__func__);
+
+	printf("- a Mobile Allocation of 5 octets does not fit, each Immediate Assignment goes out by itself\n");
+	three_imm_ass(ma, sizeof(ma));
+	fake_time_passes(20);
+	print_agch_ctrs();
+}
+
+static void test_imm_ass_rej_two(void)
+{
+	int i;
+
+	start_test(__func__);
+
+	printf("- 8 requests for 5 channels: the first reject goes out right away, then one for two MS, with the last one"
+	       " repeated\n");
+	for (i = 0; i < 8; i++)
+		chan_rqd(RA_LU(i), i);
+	main_loop();
+	fake_time_passes(20);
+	print_agch_ctrs();
+}
+
+static void test_agch_send_failed(void)
+{
+	start_test(__func__);
+
+	chan_rqd(RA_LU(1), 1);
+	chan_rqd(RA_LU(2), 2);
+	main_loop();
+	printf("- the first Immediate Assignment goes out right away\n");
+	send_chan_act_ack(&bts->c0->ts[0].lchan[0]);
+	printf("- the held back one fails to be sent, its lchan is released\n");
+	imm_ass_cmd_fail = true;
+	send_chan_act_ack(&bts->c0->ts[0].lchan[1]);
+	fake_time_passes(20);
+	imm_ass_cmd_fail = false;
+	print_agch_ctrs();
+}
+
+static const struct log_info_cat log_categories[] = {
+	[DHO] = {
+		.name = "DHO",
+		.description = "Hand-Over Process",
+		.color = "\033[1;38m",
+		.enabled = 1, .loglevel = LOGL_DEBUG,
+	},
+	[DHODEC] = {
+		.name = "DHODEC",
+		.description = "Hand-Over Decision",
+		.color = "\033[1;38m",
+		.enabled = 1, .loglevel = LOGL_DEBUG,
+	},
+	[DMEAS] = {
+		.name = "DMEAS",
+		.description = "Radio Measurement Processing",
+		.enabled = 1, .loglevel = LOGL_DEBUG,
+	},
+	[DREF] = {
+		.name = "DREF",
+		.description = "Reference Counting",
+		.enabled = 1, .loglevel = LOGL_DEBUG,
+	},
+	[DRSL] = {
+		.name = "DRSL",
+		.description = "A-bis Radio Signalling Link (RSL)",
+		.color = "\033[1;35m",
+		.enabled = 1, .loglevel = LOGL_DEBUG,
+	},
+	[DRR] = {
+		.name = "DRR",
+		.description = "RR",
+		.color = "\033[1;35m",
+		.enabled = 1, .loglevel = LOGL_DEBUG,
+	},
+	[DRLL] = {
+		.name = "DRLL",
+		.description = "RLL",
+		.color = "\033[1;35m",
+		.enabled = 1, .loglevel = LOGL_DEBUG,
+	},
+	[DMSC] = {
+		.name = "DMSC",
+		.description = "Mobile Switching Center",
+		.enabled = 1, .loglevel = LOGL_DEBUG,
+	},
+	[DCHAN] = {
+		.name = "DCHAN",
+		.description = "lchan FSM",
+		.color = "\033[1;32m",
+		.enabled = 1, .loglevel = LOGL_DEBUG,
+	},
+	[DTS] = {
+		.name = "DTS",
+		.description = "timeslot FSM",
+		.color = "\033[1;31m",
+		.enabled = 1, .loglevel = LOGL_DEBUG,
+	},
+	[DAS] = {
+		.name = "DAS",
+		.description = "assignment FSM",
+		.color = "\033[1;33m",
+		.enabled = 1, .loglevel = LOGL_DEBUG,
+	},
+};
+
+const struct log_info log_info = {
+	.cat = log_categories,
+	.num_cat = ARRAY_SIZE(log_categories),
+};
+
+int main(int argc, char **argv)
+{
+	fixture_init(talloc_named_const(NULL, 0, "chan_rqd_test"), &log_info);
+
+	test_dedup();
+	test_priority();
+	test_expiry();
+	test_shedding();
+	test_imm_ass_ext();
+	test_imm_ass_ext_hopping();
+	test_imm_ass_ma_too_long();
+	test_imm_ass_rej_two();
+	test_agch_send_failed();
+
+	return EXIT_SUCCESS;
+}
@@ -237,6 +237,22 @@ class TestCtrlBSC(TestCtrlBase):
 		+ ' TCH/F_PDCH,0,0 CCCH+SDCCH4+CBCH,0,0'
 		+ ' SDCCH8+CBCH,0,0 TCH/F_TCH/H_PDCH,0,0')
 
+    def testBtsSnapshot(self):
+        r = self.do_set('bts.0.bts-snapshot', '1')
+        self.assertEqual(r['mtype'], 'ERROR')
+        self.assertEqual(r['error'], 'Read Only attribute')
+
+        # No OML link, so no uptime and no channels to count
+        prefix = 'bts=0,oml=disconnected,uptime=0,oper=inoperational,admin=unlocked,policy=on,'
+        r = self.do_get('bts.0.bts-snapshot')
+        self.assertEqual(r['mtype'], 'GET_REPLY')
+        self.assertTrue(r['value'].startswith(prefix))
+        self.assertFalse('TCH/F=' in r['value'])
+
+        r2 = self.do_get('bts-snapshot')
+        self.assertEqual(r2['mtype'], 'GET_REPLY')
+        self.assertEqual(r2['value'].split(';')[0], r['value'])
+
     def testBtsOmlConnectionState(self):
         """Check OML state. It will not be connected"""
         r = self.do_set('bts.0.oml-connection-state', '1')
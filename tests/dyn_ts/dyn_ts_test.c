@@ -0,0 +1,272 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+
+#include <osmocom/core/application.h>
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/timer.h>
+#include <osmocom/core/utils.h>
+
+#include <osmocom/bsc/abis_rsl.h>
+#include <osmocom/bsc/debug.h>
+#include <osmocom/bsc/gsm_data.h>
+#include <osmocom/bsc/lchan_fsm.h>
+#include <osmocom/bsc/lchan_select.h>
+#include <osmocom/bsc/timeslot_fsm.h>
+
+#include "fixture/fixture.h"
+
+/* The BTS of the current test; RSL sent to earlier ones, e.g. when their lchans time out, is not printed */
+static struct gsm_bts *bts;
+
+/* TS 1 to 4 of C0 are ip.access style dynamic timeslots */
+#define DYN_TS_FIRST 1
+#define DYN_TS_LAST 4
+
+static void fake_time_passes(unsigned int s)
+{
+	printf("- %u s pass\n", s);
+	osmo_clock_override_add(CLOCK_MONOTONIC, s, 0);
+	osmo_timers_prepare();
+	osmo_timers_update();
+}
+
+/* override, requires '-Wl,--wrap=abis_rsl_sendmsg'.
+ * Catch RSL messages sent towards the BTS. */
+int __real_abis_rsl_sendmsg(struct msgb *msg);
+int __wrap_abis_rsl_sendmsg(struct msgb *msg)
+{
+	struct abis_rsl_dchan_hdr *dh = (struct abis_rsl_dchan_hdr *) msg->data;
+	struct e1inp_sign_link *sign_link = msg->dst;
+
+	if (sign_link->trx->bts != bts)
+		goto out;
+
+	switch (dh->c.msg_type) {
+	case RSL_MT_IPAC_PDCH_ACT:
+		printf("PDCH ACT TS%u\n", dh->chan_nr & 0x07);
+		break;
+	case RSL_MT_IPAC_PDCH_DEACT:
+		printf("PDCH DEACT TS%u\n", dh->chan_nr & 0x07);
+		break;
+	case RSL_MT_CHAN_ACTIV:
+		printf("CHAN ACTIV TS%u\n", dh->chan_nr & 0x07);
+		break;
+	default:
+		printf("unexpected RSL message 0x%02x\n", dh->c.msg_type);
+		break;
+	}
+out:
+	msgb_free(msg);
+	return 0;
+}
+
+/* The BTS acknowledges all pending PDCH ACT and DEACT */
+static void ack_all(void)
+{
+	int i;
+
+	for (i = DYN_TS_FIRST; i <= DYN_TS_LAST; i++) {
+		struct gsm_bts_trx_ts *ts = &bts->c0->ts[i];
+		switch (ts->fi->state) {
+		case TS_ST_WAIT_PDCH_ACT:
+			osmo_fsm_inst_dispatch(ts->fi, TS_EV_PDCH_ACT_ACK, NULL);
+			break;
+		case TS_ST_WAIT_PDCH_DEACT:
+			osmo_fsm_inst_dispatch(ts->fi, TS_EV_PDCH_DEACT_ACK, NULL);
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+static void print_ts(void)
+{
+	int i;
+
+	for (i = DYN_TS_FIRST; i <= DYN_TS_LAST; i++)
+		printf("%sTS%d %s", i == DYN_TS_FIRST ? "" : ", ", i, osmo_fsm_inst_state_name(bts->c0->ts[i].fi));
+	printf("\n");
+}
+
+static void print_ctrs(void)
+{
+	static const int ctrs[] = {
+		BTS_CTR_DYN_TS_PDCH_DEACT_AVOIDED,
+		BTS_CTR_DYN_TS_PDCH_DEACT_WAIT,
+	};
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(ctrs); i++)
+		printf("%s%s %" PRIu64, i ? ", " : "", bts->bts_ctrs->desc->ctr_desc[ctrs[i]].name,
+		       bts->bts_ctrs->ctr[ctrs[i]].current);
+	printf("\n");
+}
+
+/* A BTS with SDCCH on TS 0 and dynamic TCH/F_PDCH on TS 1 to 4. GPRS comes up without voice demand: all dynamic
+ * timeslots go to PDCH. */
+static void start_test(const char *name)
+{
+	static const enum gsm_phys_chan_config pchan[] = {
+		GSM_PCHAN_CCCH_SDCCH4,
+		GSM_PCHAN_TCH_F_PDCH,
+		GSM_PCHAN_TCH_F_PDCH,
+		GSM_PCHAN_TCH_F_PDCH,
+		GSM_PCHAN_TCH_F_PDCH,
+	};
+
+	printf("\n%s()\n", name);
+	bts = fixture_bts_alloc(pchan, ARRAY_SIZE(pchan));
+	bts->gprs.mode = BTS_GPRS_GPRS;
+	ts_dyn_reserve_update(bts);
+	ack_all();
+	print_ts();
+}
+
+static void test_reserve(void)
+{
+	struct lchan_activate_info info = {
+		.activ_for = FOR_VTY,
+		.chan_mode = GSM48_CMODE_SIGN,
+	};
+	struct gsm_lchan *lchan;
+
+	start_test(__func__);
+	bts->chan_alloc_reverse = true;
+
+	printf("- dyn-ts-reserve 2: the first TCH request switches two timeslots off PDCH\n");
+	bts->dyn_ts_reserve.num = 2;
+	lchan = lchan_select_by_type(bts, GSM_LCHAN_TCH_F);
+	OSMO_ASSERT(lchan);
+	printf("- the allocator prefers those over the timeslots on PDCH: TS%u\n", lchan->ts->nr);
+	ack_all();
+	print_ts();
+
+	printf("- a TCH on a kept timeslot activates right away, another one is switched off PDCH to refill the"
+	       " reserve\n");
+	lchan_activate(lchan, &info);
+	ack_all();
+	print_ts();
+	print_ctrs();
+}
+
+static void test_release(void)
+{
+	start_test(__func__);
+
+	printf("- dyn-ts-reserve 2: a TCH request switches two timeslots off PDCH\n");
+	bts->dyn_ts_reserve.num = 2;
+	OSMO_ASSERT(lchan_select_by_type(bts, GSM_LCHAN_TCH_F));
+	ack_all();
+	print_ts();
+
+	printf("- another TCH request restarts X993104\n");
+	fake_time_passes(30);
+	OSMO_ASSERT(lchan_select_by_type(bts, GSM_LCHAN_TCH_F));
+	fake_time_passes(30);
+	print_ts();
+
+	printf("- no TCH requested for X993104: the reserve goes back to PDCH\n");
+	fake_time_passes(30);
+	ack_all();
+	print_ts();
+	print_ctrs();
+}
+
+static const struct log_info_cat log_categories[] = {
+	[DHO] = {
+		.name = "DHO",
+		.description = "Hand-Over Process",
+		.color = "\033[1;38m",
+		.enabled = 1, .loglevel = LOGL_DEBUG,
+	},
+	[DHODEC] = {
+		.name = "DHODEC",
+		.description = "Hand-Over Decision",
+		.color = "\033[1;38m",
+		.enabled = 1, .loglevel = LOGL_DEBUG,
+	},
+	[DMEAS] = {
+		.name = "DMEAS",
+		.description = "Radio Measurement Processing",
+		.enabled = 1, .loglevel = LOGL_DEBUG,
+	},
+	[DREF] = {
+		.name = "DREF",
+		.description = "Reference Counting",
+		.enabled = 1, .loglevel = LOGL_DEBUG,
+	},
+	[DRSL] = {
+		.name = "DRSL",
+		.description = "A-bis Radio Signalling Link (RSL)",
+		.color = "\033[1;35m",
+		.enabled = 1, .loglevel = LOGL_DEBUG,
+	},
+	[DRR] = {
+		.name = "DRR",
+		.description = "RR",
+		.color = "\033[1;35m",
+		.enabled = 1, .loglevel = LOGL_DEBUG,
+	},
+	[DRLL] = {
+		.name = "DRLL",
+		.description = "RLL",
+		.color = "\033[1;35m",
+		.enabled = 1, .loglevel = LOGL_DEBUG,
+	},
+	[DMSC] = {
+		.name = "DMSC",
+		.description = "Mobile Switching Center",
+		.enabled = 1, .loglevel = LOGL_DEBUG,
+	},
+	[DCHAN] = {
+		.name = "DCHAN",
+		.description = "lchan FSM",
+		.color = "\033[1;32m",
+		.enabled = 1, .loglevel = LOGL_DEBUG,
+	},
+	[DTS] = {
+		.name = "DTS",
+		.description = "timeslot FSM",
+		.color = "\033[1;31m",
+		.enabled = 1, .loglevel = LOGL_DEBUG,
+	},
+	[DAS] = {
+		.name = "DAS",
+		.description = "assignment FSM",
+		.color = "\033[1;33m",
+		.enabled = 1, .loglevel = LOGL_DEBUG,
+	},
+};
+
+const struct log_info log_info = {
+	.cat = log_categories,
+	.num_cat = ARRAY_SIZE(log_categories),
+};
+
+int main(int argc, char **argv)
+{
+	fixture_init(talloc_named_const(NULL, 0, "dyn_ts_test"), &log_info);
+
+	test_reserve();
+	test_release();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,134 @@
+/* Common setup of the tests that run the BSC FSMs
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <time.h>
+
+#include <osmocom/abis/e1_input.h>
+#include <osmocom/core/application.h>
+#include <osmocom/core/msgb.h>
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/timer.h>
+
+#include <osmocom/bsc/bss.h>
+#include <osmocom/bsc/bsc_subscr_conn_fsm.h>
+#include <osmocom/bsc/gsm_08_08.h>
+#include <osmocom/bsc/handover.h>
+#include <osmocom/bsc/lchan_fsm.h>
+#include <osmocom/bsc/osmo_bsc.h>
+#include <osmocom/bsc/timeslot_fsm.h>
+
+#include "fixture.h"
+
+struct gsm_network *bsc_gsmnet;
+
+/* Set up logging to stderr, start the fake time at 123 s and allocate bsc_gsmnet with the FSMs registered */
+void fixture_init(void *ctx, const struct log_info *log_info)
+{
+	struct timespec *ts;
+
+	msgb_talloc_ctx_init(ctx, 0);
+	osmo_init_logging2(ctx, log_info);
+	log_set_print_category(osmo_stderr_target, 1);
+	log_set_print_filename2(osmo_stderr_target, LOG_FILENAME_NONE);
+	osmo_fsm_log_addr(false);
+
+	osmo_clock_override_enable(CLOCK_MONOTONIC, true);
+	ts = osmo_clock_override_gettimespec(CLOCK_MONOTONIC);
+	*ts = (struct timespec){ .tv_sec = 123 };
+
+	bsc_network_alloc();
+	OSMO_ASSERT(bsc_gsmnet);
+	ts_fsm_init();
+	lchan_fsm_init();
+	bsc_subscr_conn_fsm_init();
+	bts_model_unknown_init();
+}
+
+/* Add a BTS with an RSL link on C0. If pchan is given, configure that many timeslots of C0 with it and bring C0 and
+ * these timeslots up, as if the BTS had reported them running. */
+struct gsm_bts *fixture_bts_alloc(const enum gsm_phys_chan_config *pchan, unsigned int pchan_count)
+{
+	struct e1inp_sign_link *rsl_link;
+	struct gsm_bts *bts;
+	int i;
+
+	bts = bsc_bts_alloc_register(bsc_gsmnet, GSM_BTS_TYPE_UNKNOWN, 0x3f);
+	OSMO_ASSERT(bts);
+
+	rsl_link = talloc_zero(bts, struct e1inp_sign_link);
+	OSMO_ASSERT(rsl_link);
+	rsl_link->trx = bts->c0;
+	bts->c0->rsl_link = rsl_link;
+
+	if (!pchan)
+		return bts;
+	OSMO_ASSERT(pchan_count <= ARRAY_SIZE(bts->c0->ts));
+
+	bts->c0->mo.nm_state.operational = NM_OPSTATE_ENABLED;
+	bts->c0->mo.nm_state.availability = NM_AVSTATE_OK;
+	bts->c0->mo.nm_state.administrative = NM_STATE_UNLOCKED;
+	bts->c0->bb_transc.mo.nm_state.operational = NM_OPSTATE_ENABLED;
+	bts->c0->bb_transc.mo.nm_state.availability = NM_AVSTATE_OK;
+	bts->c0->bb_transc.mo.nm_state.administrative = NM_STATE_UNLOCKED;
+
+	for (i = 0; i < pchan_count; i++) {
+		bts->c0->ts[i].pchan_from_config = pchan[i];
+		bts->c0->ts[i].mo.nm_state.operational = NM_OPSTATE_ENABLED;
+		bts->c0->ts[i].mo.nm_state.availability = NM_AVSTATE_OK;
+		bts->c0->ts[i].mo.nm_state.administrative = NM_STATE_UNLOCKED;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(bts->c0->ts); i++) {
+		/* make sure ts->lchans[] get initialized */
+		osmo_fsm_inst_dispatch(bts->c0->ts[i].fi, TS_EV_RSL_READY, 0);
+		osmo_fsm_inst_dispatch(bts->c0->ts[i].fi, TS_EV_OML_READY, 0);
+	}
+	return bts;
+}
+
+/* Stand-ins for what the BSC objects use of the A interface and TRAU */
+void rtp_socket_free() {}
+void rtp_send_frame() {}
+void rtp_socket_upstream() {}
+void rtp_socket_create() {}
+void rtp_socket_connect() {}
+void rtp_socket_proxy() {}
+void trau_mux_unmap() {}
+void trau_mux_map_lchan() {}
+void trau_recv_lchan() {}
+void trau_send_frame() {}
+int osmo_bsc_sigtran_send(struct gsm_subscriber_connection *conn, struct msgb *msg) { return 0; }
+int osmo_bsc_sigtran_open_conn(struct gsm_subscriber_connection *conn, struct msgb *msg) { return 0; }
+void osmo_bsc_sigtran_set_conn_state(struct gsm_subscriber_connection *conn, enum subscr_sccp_state state)
+{ conn->sccp.state = state; }
+void bsc_sapi_n_reject(struct gsm_subscriber_connection *conn, int dlci) {}
+void bsc_cipher_mode_compl(struct gsm_subscriber_connection *conn, struct msgb *msg, uint8_t chosen_encr) {}
+int bsc_compl_l3(struct gsm_subscriber_connection *conn, struct msgb *msg, uint16_t chosen_channel)
+{ return 0; }
+void bsc_dtap(struct gsm_subscriber_connection *conn, uint8_t link_id, struct msgb *msg) {}
+void bsc_assign_compl(struct gsm_subscriber_connection *conn, uint8_t rr_cause) {}
+void bsc_cm_update(struct gsm_subscriber_connection *conn,
+		   const uint8_t *cm2, uint8_t cm2_len,
+		   const uint8_t *cm3, uint8_t cm3_len) {}
+int bsc_tx_bssmap_ho_required(struct gsm_lchan *lchan, const struct gsm0808_cell_id_list2 *target_cells)
+{ return 0; }
+int bsc_tx_bssmap_ho_request_ack(struct gsm_subscriber_connection *conn, struct msgb *rr_ho_command)
+{ return 0; }
+int bsc_tx_bssmap_ho_detect(struct gsm_subscriber_connection *conn) { return 0; }
+enum handover_result bsc_tx_bssmap_ho_complete(struct gsm_subscriber_connection *conn,
+					       struct gsm_lchan *lchan) { return HO_RESULT_OK; }
+void bsc_tx_bssmap_ho_failure(struct gsm_subscriber_connection *conn) {}
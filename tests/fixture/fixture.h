@@ -0,0 +1,9 @@
+/* Common setup of the tests that run the BSC FSMs */
+#pragma once
+
+#include <osmocom/bsc/gsm_data.h>
+
+struct log_info;
+
+void fixture_init(void *ctx, const struct log_info *log_info);
+struct gsm_bts *fixture_bts_alloc(const enum gsm_phys_chan_config *pchan, unsigned int pchan_count);
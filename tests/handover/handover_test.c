@@ -20,6 +20,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <errno.h>
+#include <time.h>
 
 #include <assert.h>
 
@@ -50,8 +51,6 @@
 
 void *ctx;
 
-struct gsm_network *bsc_gsmnet;
-
 /* override, requires '-Wl,--wrap=osmo_mgcpc_ep_ci_request'.
  * Catch modification of an MGCP connection. */
 void __real_osmo_mgcpc_ep_ci_request(struct osmo_mgcpc_ep_ci *ci,
@@ -1388,6 +1387,49 @@ const struct log_info log_info = {
 	.num_cat = ARRAY_SIZE(log_categories),
 };
 
+/* Time the processing of measurement reports, with the log target at NOTICE and at DEBUG.
+ * Run as 'handover_test bench [<nr-of-reports>] 2>/dev/null' to not measure the terminal. */
+static int bench_meas_rep(int num_reports)
+{
+	static const int levels[] = { LOGL_NOTICE, LOGL_DEBUG };
+	struct gsm_lchan *lchan[4];
+	struct gsm_bts *bts[2];
+	int i, l;
+
+	bts[0] = create_bts(870);
+	bts[1] = create_bts(871);
+	for (i = 0; i < ARRAY_SIZE(bts); i++)
+		gsm_generate_si(bts[i], SYSINFO_TYPE_2);
+	for (i = 0; i < ARRAY_SIZE(lchan); i++)
+		lchan[i] = create_lchan(bts[0], 1, "AMR");
+
+	/* a good serving cell and a weak neighbor, so that no handover gets triggered */
+	meas_dl_rxlev = 50;
+	meas_dl_rxqual = 0;
+	meas_num_nc = 1;
+	meas_bcch_f_nc[0] = 0;
+	meas_rxlev_nc[0] = 10;
+	meas_bsic_nc[0] = 0x3f;
+
+	for (l = 0; l < ARRAY_SIZE(levels); l++) {
+		struct timespec start, end;
+		double secs;
+
+		log_set_log_level(osmo_stderr_target, levels[l]);
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for (i = 0; i < num_reports; i++)
+			gen_meas_rep(lchan[i % ARRAY_SIZE(lchan)]);
+		clock_gettime(CLOCK_MONOTONIC, &end);
+
+		secs = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+		printf("%d measurement reports at %s: %.3f s, %.0f reports/s, %.2f us/report\n",
+		       num_reports, log_level_str(levels[l]), secs, num_reports / secs, secs * 1e6 / num_reports);
+	}
+
+	return EXIT_SUCCESS;
+}
+
 int main(int argc, char **argv)
 {
 	char **test_case;
@@ -1399,6 +1441,7 @@ int main(int argc, char **argv)
 	int algorithm;
 	int test_case_i;
 	int last_test_i;
+	bool bench = argc > 1 && !strcmp(argv[1], "bench");
 
 	ctx = talloc_named_const(NULL, 0, "handover_test");
 	msgb_talloc_ctx_init(ctx, 0);
@@ -1406,12 +1449,12 @@ int main(int argc, char **argv)
 	test_case_i = argc > 1? atoi(argv[1]) : -1;
 	last_test_i = ARRAY_SIZE(test_cases) - 1;
 
-	if (test_case_i < 0 || test_case_i > last_test_i) {
+	if (!bench && (test_case_i < 0 || test_case_i > last_test_i)) {
 		for (i = 0; i <= last_test_i; i++) {
 			printf("Test #%d (algorithm %s):\n%s\n", i,
 				test_cases[i][0], test_cases[i][1]);
 		}
-		printf("\nPlease specify test case number 0..%d\n", last_test_i);
+		printf("\nPlease specify test case number 0..%d, or 'bench [<nr-of-reports>]'\n", last_test_i);
 		return EXIT_FAILURE;
 	}
 
@@ -1452,6 +1495,12 @@ int main(int argc, char **argv)
 	/* We don't really need any specific model here */
 	bts_model_unknown_init();
 
+	if (bench) {
+		handover_decision_1_init();
+		hodec2_init(bsc_gsmnet);
+		return bench_meas_rep(argc > 2 ? atoi(argv[2]) : 100000);
+	}
+
 	test_case = test_cases[test_case_i];
 
 	fprintf(stderr, "--------------------\n");
@@ -1756,34 +1805,3 @@ int main(int argc, char **argv)
 	talloc_free(ctx);
 	return EXIT_SUCCESS;
 }
-
-void rtp_socket_free() {}
-void rtp_send_frame() {}
-void rtp_socket_upstream() {}
-void rtp_socket_create() {}
-void rtp_socket_connect() {}
-void rtp_socket_proxy() {}
-void trau_mux_unmap() {}
-void trau_mux_map_lchan() {}
-void trau_recv_lchan() {}
-void trau_send_frame() {}
-int osmo_bsc_sigtran_send(struct gsm_subscriber_connection *conn, struct msgb *msg) { return 0; }
-int osmo_bsc_sigtran_open_conn(struct gsm_subscriber_connection *conn, struct msgb *msg) { return 0; }
-void bsc_sapi_n_reject(struct gsm_subscriber_connection *conn, int dlci) {}
-void bsc_cipher_mode_compl(struct gsm_subscriber_connection *conn, struct msgb *msg, uint8_t chosen_encr) {}
-int bsc_compl_l3(struct gsm_subscriber_connection *conn, struct msgb *msg, uint16_t chosen_channel)
-{ return 0; }
-void bsc_dtap(struct gsm_subscriber_connection *conn, uint8_t link_id, struct msgb *msg) {}
-void bsc_assign_compl(struct gsm_subscriber_connection *conn, uint8_t rr_cause) {}
-void bsc_cm_update(struct gsm_subscriber_connection *conn,
-		   const uint8_t *cm2, uint8_t cm2_len,
-		   const uint8_t *cm3, uint8_t cm3_len) {}
-struct gsm0808_handover_required;
-int bsc_tx_bssmap_ho_required(struct gsm_lchan *lchan, const struct gsm0808_cell_id_list2 *target_cells)
-{ return 0; }
-int bsc_tx_bssmap_ho_request_ack(struct gsm_subscriber_connection *conn, struct msgb *rr_ho_command)
-{ return 0; }
-int bsc_tx_bssmap_ho_detect(struct gsm_subscriber_connection *conn) { return 0; }
-enum handover_result bsc_tx_bssmap_ho_complete(struct gsm_subscriber_connection *conn,
-					       struct gsm_lchan *lchan) { return HO_RESULT_OK; }
-void bsc_tx_bssmap_ho_failure(struct gsm_subscriber_connection *conn) {}
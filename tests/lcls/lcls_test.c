@@ -0,0 +1,139 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <osmocom/core/application.h>
+#include <osmocom/core/linuxlist.h>
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/utils.h>
+
+#include <osmocom/bsc/bsc_subscr_conn_fsm.h>
+#include <osmocom/bsc/debug.h>
+#include <osmocom/bsc/gsm_data.h>
+#include <osmocom/bsc/osmo_bsc_lcls.h>
+
+#include "fixture/fixture.h"
+
+/* Two GCRs that land in the same bucket of the GCR index, and one that does not */
+static const uint8_t gcr_a[] = { 0x03, 0xf2, 0x10, 0x01, 0x02, 0x03, 0x04, 0x05, 0x00, 0x00, 0x00, 0x00, 0x01 };
+static const uint8_t gcr_a_collision[] = { 0x03, 0xf2, 0x10, 0x01, 0x02, 0x03, 0x04, 0x05, 0x00, 0x00, 0x00, 0x14, 0x8d };
+static const uint8_t gcr_b[] = { 0x03, 0xf2, 0x10, 0x01, 0x02, 0x03, 0x04, 0x05, 0x00, 0x00, 0x00, 0x00, 0x02 };
+
+static struct gsm_subscriber_connection *conn[4];
+static const char * const conn_names[] = { "conn0", "conn1", "conn2", "conn3" };
+
+static const char *conn_name(const struct gsm_subscriber_connection *c)
+{
+	int i;
+	if (!c)
+		return "none";
+	for (i = 0; i < ARRAY_SIZE(conn); i++) {
+		if (conn[i] == c)
+			return conn_names[i];
+	}
+	return "?";
+}
+
+static unsigned int indexed_conns(void)
+{
+	unsigned int i;
+	unsigned int n = 0;
+	for (i = 0; i < ARRAY_SIZE(bsc_gsmnet->lcls_gcr_hash); i++)
+		n += llist_count(&bsc_gsmnet->lcls_gcr_hash[i]);
+	return n;
+}
+
+static void print_lookup(void)
+{
+	int i;
+	for (i = 0; i < ARRAY_SIZE(conn); i++) {
+		if (!conn[i])
+			continue;
+		printf("%s -> %s\n", conn_name(conn[i]), conn_name(lcls_find_conn_with_same_gcr(conn[i])));
+	}
+	printf("indexed conns: %u\n", indexed_conns());
+}
+
+static void test_gcr_index(void)
+{
+	int i;
+
+	printf("\n%s()\n", __func__);
+	for (i = 0; i < ARRAY_SIZE(conn); i++)
+		conn[i] = bsc_subscr_con_allocate(bsc_gsmnet);
+
+	printf("- conn0 and conn1 share a GCR, conn2 has a different GCR in the same bucket, conn3 has none\n");
+	lcls_set_gcr(conn[0], gcr_a, sizeof(gcr_a));
+	lcls_set_gcr(conn[1], gcr_a, sizeof(gcr_a));
+	lcls_set_gcr(conn[2], gcr_a_collision, sizeof(gcr_a_collision));
+	print_lookup();
+
+	printf("- a shorter GCR with the same leading octets does not match\n");
+	lcls_set_gcr(conn[3], gcr_a, sizeof(gcr_a) - 1);
+	print_lookup();
+
+	printf("- conn1 gets the GCR of conn2, conn3 a GCR of its own\n");
+	lcls_set_gcr(conn[1], gcr_a_collision, sizeof(gcr_a_collision));
+	lcls_set_gcr(conn[3], gcr_b, sizeof(gcr_b));
+	print_lookup();
+
+	printf("- conn3 drops its GCR\n");
+	lcls_set_gcr(conn[3], NULL, 0);
+	print_lookup();
+
+	printf("- conn2 is freed\n");
+	osmo_fsm_inst_term(conn[2]->fi, OSMO_FSM_TERM_REQUEST, NULL);
+	conn[2] = NULL;
+	print_lookup();
+
+	printf("- all conns are freed\n");
+	for (i = 0; i < ARRAY_SIZE(conn); i++) {
+		if (!conn[i])
+			continue;
+		osmo_fsm_inst_term(conn[i]->fi, OSMO_FSM_TERM_REQUEST, NULL);
+		conn[i] = NULL;
+	}
+	printf("indexed conns: %u\n", indexed_conns());
+}
+
+static const struct log_info_cat log_categories[] = {
+	[DMSC] = {
+		.name = "DMSC",
+		.description = "Mobile Switching Center",
+		.enabled = 1, .loglevel = LOGL_DEBUG,
+	},
+	[DLCLS] = {
+		.name = "DLCLS",
+		.description = "Local Call, Local Switch",
+		.enabled = 1, .loglevel = LOGL_DEBUG,
+	},
+};
+
+const struct log_info log_info = {
+	.cat = log_categories,
+	.num_cat = ARRAY_SIZE(log_categories),
+};
+
+int main(int argc, char **argv)
+{
+	fixture_init(talloc_named_const(NULL, 0, "lcls_test"), &log_info);
+
+	test_gcr_index();
+
+	return EXIT_SUCCESS;
+}
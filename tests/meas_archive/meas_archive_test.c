@@ -0,0 +1,339 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/utils.h>
+
+#include "meas_archive.h"
+
+#define T_BASE	1600000000000LL
+#define T_STEP	480
+
+static void *ctx;
+static char path[] = "/tmp/meas_archive_test_XXXXXX";
+
+static const char *imsis[] = { "901700000000001", "901700000000002", "901700000000003" };
+static const char *names[] = { "north", "south" };
+
+/* Report number i, with every archived field depending on i */
+static void make_rec(struct meas_archive_rec *rec, unsigned int i)
+{
+	struct gsm_meas_rep *mr = &rec->mr;
+	int k;
+
+	memset(rec, 0, sizeof(*rec));
+	rec->time_ms = T_BASE + (int64_t)i * T_STEP;
+	rec->imsi = imsis[i % ARRAY_SIZE(imsis)];
+	rec->name = names[i % ARRAY_SIZE(names)];
+	rec->scenario = i < 5 ? "" : "drive";
+	rec->bts_nr = i % 3;
+	rec->trx_nr = i % 4;
+	rec->ts_nr = i % 8;
+	rec->ss_nr = i % 2;
+	rec->lchan_type = 1 + i % 3;
+	rec->pchan_type = i % 5;
+
+	mr->nr = i;
+	mr->flags = i & 0x1f;
+	mr->ul.full.rx_lev = i % 64;
+	mr->ul.sub.rx_lev = (i + 1) % 64;
+	mr->ul.full.rx_qual = i % 8;
+	mr->ul.sub.rx_qual = (i + 1) % 8;
+	mr->dl.full.rx_lev = (i + 2) % 64;
+	mr->dl.sub.rx_lev = (i + 3) % 64;
+	mr->dl.full.rx_qual = (i + 2) % 8;
+	mr->dl.sub.rx_qual = (i + 3) % 8;
+	mr->bs_power = i % 16;
+	mr->ms_timing_offset = (int)(i % 256) - 63;
+	mr->ms_l1.pwr = 33 - (int)(i % 40);
+	mr->ms_l1.ta = i % 64;
+	mr->num_cell = i % 7;
+	for (k = 0; k < mr->num_cell; k++) {
+		mr->cell[k].rxlev = (i + k) % 64;
+		mr->cell[k].bsic = k;
+		mr->cell[k].neigh_idx = k + 1;
+		mr->cell[k].arfcn = 1000 + k + i % 24;
+	}
+}
+
+static bool rec_equal(const struct meas_archive_rec *a, const struct meas_archive_rec *b)
+{
+	const struct gsm_meas_rep *x = &a->mr;
+	const struct gsm_meas_rep *y = &b->mr;
+	int k;
+
+	if (a->time_ms != b->time_ms || strcmp(a->imsi, b->imsi) || strcmp(a->name, b->name)
+	    || strcmp(a->scenario, b->scenario) || a->bts_nr != b->bts_nr || a->trx_nr != b->trx_nr
+	    || a->ts_nr != b->ts_nr || a->ss_nr != b->ss_nr || a->lchan_type != b->lchan_type
+	    || a->pchan_type != b->pchan_type)
+		return false;
+	if (x->nr != y->nr || x->flags != y->flags || memcmp(&x->ul, &y->ul, sizeof(x->ul))
+	    || memcmp(&x->dl, &y->dl, sizeof(x->dl)) || x->bs_power != y->bs_power
+	    || x->ms_timing_offset != y->ms_timing_offset || x->ms_l1.pwr != y->ms_l1.pwr
+	    || x->ms_l1.ta != y->ms_l1.ta || x->num_cell != y->num_cell)
+		return false;
+	for (k = 0; k < x->num_cell; k++) {
+		if (x->cell[k].rxlev != y->cell[k].rxlev || x->cell[k].bsic != y->cell[k].bsic
+		    || x->cell[k].neigh_idx != y->cell[k].neigh_idx || x->cell[k].arfcn != y->cell[k].arfcn)
+			return false;
+	}
+	return true;
+}
+
+static void append(struct meas_archive_writer *w, unsigned int first, unsigned int n)
+{
+	struct meas_archive_rec rec;
+	unsigned int i;
+
+	for (i = first; i < first + n; i++) {
+		make_rec(&rec, i);
+		OSMO_ASSERT(meas_archive_append(w, &rec) == 0);
+	}
+}
+
+/* Write the reports first .. first + n - 1 as one block */
+static void write_block(struct meas_archive_writer *w, unsigned int first, unsigned int n)
+{
+	append(w, first, n);
+	OSMO_ASSERT(meas_archive_flush(w) == 0);
+}
+
+static off_t file_size(void)
+{
+	struct stat st;
+
+	OSMO_ASSERT(stat(path, &st) == 0);
+	return st.st_size;
+}
+
+/* Read the whole archive, verify every report against make_rec() and print the ranges of report numbers found */
+static void expect_reports(const char *expected)
+{
+	struct meas_archive_filter f = MEAS_ARCHIVE_FILTER_ALL;
+	struct meas_archive_reader *r = meas_archive_reader_open(ctx, path);
+	struct meas_archive_rec rec, ref;
+	char got[256] = "";
+	int first = -1, last = -1;
+	int rc;
+
+	OSMO_ASSERT(r);
+
+	while (1) {
+		int i;
+
+		rc = meas_archive_next(r, &f, &rec);
+		OSMO_ASSERT(rc >= 0);
+		i = rc ? (rec.time_ms - T_BASE) / T_STEP : -1;
+		if (rc) {
+			make_rec(&ref, i);
+			if (!rec_equal(&rec, &ref)) {
+				printf("report %d: MISMATCH\n", i);
+				OSMO_ASSERT(false);
+			}
+		}
+		if (first >= 0 && (!rc || i != last + 1)) {
+			snprintf(got + strlen(got), sizeof(got) - strlen(got), "%s%d-%d", got[0] ? " " : "", first, last);
+			first = -1;
+		}
+		if (!rc)
+			break;
+		if (first < 0)
+			first = i;
+		last = i;
+	}
+	meas_archive_reader_close(r);
+
+	printf("reports: %s%s\n", got, strcmp(got, expected) ? " ERROR" : "");
+	OSMO_ASSERT(!strcmp(got, expected));
+}
+
+static unsigned int count_reports(struct meas_archive_reader *r, const struct meas_archive_filter *f)
+{
+	struct meas_archive_rec rec;
+	unsigned int n = 0;
+
+	meas_archive_rewind(r);
+	while (meas_archive_next(r, f, &rec) > 0)
+		n++;
+	return n;
+}
+
+static struct meas_archive_writer *writer_new(void)
+{
+	struct meas_archive_writer *w;
+
+	unlink(path);
+	w = meas_archive_writer_open(ctx, path);
+	OSMO_ASSERT(w);
+	return w;
+}
+
+static void test_round_trip(void)
+{
+	struct meas_archive_writer *w = writer_new();
+	struct meas_archive_reader *r;
+	struct meas_archive_filter f;
+	unsigned int n;
+
+	printf("\n%s()\n", __func__);
+
+	/* One full block, written by meas_archive_append(), and the rest written on close */
+	append(w, 0, MEAS_ARCHIVE_BLOCK_RECS + 100);
+	OSMO_ASSERT(meas_archive_writer_close(w) == 0);
+	expect_reports("0-4195");
+
+	r = meas_archive_reader_open(ctx, path);
+	OSMO_ASSERT(r);
+
+	f = (struct meas_archive_filter){ .imsi = imsis[1], .bts_nr = -1 };
+	printf("imsi %s: %u reports\n", f.imsi, count_reports(r, &f));
+
+	f = (struct meas_archive_filter){ .name = "south", .bts_nr = 1 };
+	printf("name %s, bts 1: %u reports\n", f.name, count_reports(r, &f));
+
+	f = (struct meas_archive_filter){ .bts_nr = -1, .from_ms = T_BASE + MEAS_ARCHIVE_BLOCK_RECS * T_STEP };
+	n = count_reports(r, &f);
+	printf("from report %u: %u reports, %u blocks skipped\n", MEAS_ARCHIVE_BLOCK_RECS, n,
+	       meas_archive_blocks_skipped(r));
+
+	f = (struct meas_archive_filter){ .name = "east", .bts_nr = -1 };
+	n = count_reports(r, &f);
+	printf("name %s: %u reports, %u blocks skipped\n", f.name, n, meas_archive_blocks_skipped(r));
+
+	meas_archive_reader_close(r);
+}
+
+static void test_torn_tail(void)
+{
+	struct meas_archive_writer *w = writer_new();
+
+	printf("\n%s()\n", __func__);
+
+	write_block(w, 0, 10);
+	write_block(w, 10, 10);
+	OSMO_ASSERT(meas_archive_writer_close(w) == 0);
+
+	printf("- crash while writing the second block\n");
+	OSMO_ASSERT(truncate(path, file_size() - 7) == 0);
+	expect_reports("0-9");
+
+	printf("- reopen and append\n");
+	w = meas_archive_writer_open(ctx, path);
+	OSMO_ASSERT(w);
+	write_block(w, 20, 10);
+	OSMO_ASSERT(meas_archive_writer_close(w) == 0);
+	expect_reports("0-9 20-29");
+}
+
+static void test_torn_middle(void)
+{
+	struct meas_archive_writer *w = writer_new();
+	off_t off1, off2, size;
+	uint8_t *buf;
+	int fd;
+
+	printf("\n%s()\n", __func__);
+
+	write_block(w, 0, 10);
+	off1 = file_size();
+	write_block(w, 10, 10);
+	off2 = file_size();
+	write_block(w, 20, 10);
+	OSMO_ASSERT(meas_archive_writer_close(w) == 0);
+	size = file_size();
+
+	printf("- only the first half of the second block made it to the file\n");
+	buf = talloc_size(ctx, size);
+	OSMO_ASSERT(buf);
+	fd = open(path, O_RDWR);
+	OSMO_ASSERT(fd >= 0);
+	OSMO_ASSERT(pread(fd, buf, size, 0) == size);
+	OSMO_ASSERT(pwrite(fd, buf + off2, size - off2, off1 + (off2 - off1) / 2) == size - off2);
+	OSMO_ASSERT(ftruncate(fd, off1 + (off2 - off1) / 2 + size - off2) == 0);
+	close(fd);
+	talloc_free(buf);
+	expect_reports("0-9 20-29");
+
+	printf("- reopen and append\n");
+	w = meas_archive_writer_open(ctx, path);
+	OSMO_ASSERT(w);
+	write_block(w, 30, 10);
+	OSMO_ASSERT(meas_archive_writer_close(w) == 0);
+	expect_reports("0-9 20-39");
+}
+
+static void test_write_failure(void)
+{
+	struct meas_archive_writer *w = writer_new();
+	struct rlimit rl, limited;
+	off_t size;
+	int rc;
+
+	printf("\n%s()\n", __func__);
+
+	write_block(w, 0, 10);
+	size = file_size();
+
+	printf("- the file system fills up in the middle of the second block\n");
+	OSMO_ASSERT(getrlimit(RLIMIT_FSIZE, &rl) == 0);
+	limited = rl;
+	limited.rlim_cur = size + 100;
+	OSMO_ASSERT(setrlimit(RLIMIT_FSIZE, &limited) == 0);
+	append(w, 10, 10);
+	rc = meas_archive_flush(w);
+	printf("flush: %s\n", rc < 0 ? "failed" : "ok");
+	OSMO_ASSERT(setrlimit(RLIMIT_FSIZE, &rl) == 0);
+	printf("file size: %s\n", file_size() == size ? "as before" : "ERROR");
+	OSMO_ASSERT(file_size() == size);
+
+	printf("- the next block follows the first one\n");
+	write_block(w, 20, 10);
+	OSMO_ASSERT(meas_archive_writer_close(w) == 0);
+	expect_reports("0-9 20-29");
+}
+
+int main(int argc, char **argv)
+{
+	int fd;
+
+	ctx = talloc_named_const(NULL, 0, "meas_archive_test");
+	/* Exceeding RLIMIT_FSIZE should fail the write() rather than kill the test */
+	signal(SIGXFSZ, SIG_IGN);
+
+	fd = mkstemp(path);
+	OSMO_ASSERT(fd >= 0);
+	close(fd);
+
+	test_round_trip();
+	test_torn_tail();
+	test_torn_middle();
+	test_write_failure();
+
+	unlink(path);
+	OSMO_ASSERT(talloc_total_blocks(ctx) == 1);
+	talloc_free(ctx);
+	return 0;
+}
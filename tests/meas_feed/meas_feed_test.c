@@ -0,0 +1,162 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include <osmocom/core/msgb.h>
+#include <osmocom/core/utils.h>
+
+#include <osmocom/bsc/meas_feed.h>
+
+static void fill_report(struct meas_feed_meas *mfm, int num_cell)
+{
+	struct gsm_meas_rep *mr = &mfm->mr;
+	int i;
+
+	memset(mfm, 0, sizeof(*mfm));
+	mfm->hdr.msg_type = MEAS_FEED_MEAS;
+	mfm->hdr.version = MEAS_FEED_VERSION;
+	osmo_strlcpy(mfm->imsi, "901700000012345", sizeof(mfm->imsi));
+	osmo_strlcpy(mfm->name, "IMSI-901700000012345", sizeof(mfm->name));
+	osmo_strlcpy(mfm->scenario, "drive", sizeof(mfm->scenario));
+	mfm->lchan_type = 2;
+	mfm->pchan_type = 3;
+	mfm->bts_nr = 1;
+	mfm->trx_nr = 0;
+	mfm->ts_nr = 5;
+	mfm->ss_nr = 1;
+
+	mr->nr = 42;
+	mr->flags = MEAS_REP_F_DL_VALID | MEAS_REP_F_MS_TO | MEAS_REP_F_MS_L1;
+	mr->ul.full.rx_lev = 30;
+	mr->ul.full.rx_qual = 1;
+	mr->ul.sub.rx_lev = 31;
+	mr->ul.sub.rx_qual = 2;
+	mr->dl.full.rx_lev = 40;
+	mr->dl.full.rx_qual = 0;
+	mr->dl.sub.rx_lev = 41;
+	mr->dl.sub.rx_qual = 3;
+	mr->bs_power = 4;
+	mr->ms_timing_offset = -12;
+	mr->ms_l1.pwr = -3;
+	mr->ms_l1.ta = 7;
+	mr->num_cell = num_cell;
+	for (i = 0; i < num_cell; i++) {
+		mr->cell[i].rxlev = 20 + i;
+		mr->cell[i].bsic = 60 + i;
+		mr->cell[i].neigh_idx = i;
+		mr->cell[i].arfcn = 870 + i;
+	}
+}
+
+static bool same_report(const struct meas_feed_meas *a, const struct meas_feed_meas *b)
+{
+	const struct gsm_meas_rep *ma = &a->mr, *mb = &b->mr;
+	int i;
+
+	if (strcmp(a->imsi, b->imsi) || strcmp(a->name, b->name) || strcmp(a->scenario, b->scenario))
+		return false;
+	if (a->lchan_type != b->lchan_type || a->pchan_type != b->pchan_type || a->bts_nr != b->bts_nr
+	    || a->trx_nr != b->trx_nr || a->ts_nr != b->ts_nr || a->ss_nr != b->ss_nr)
+		return false;
+	if (ma->nr != mb->nr || ma->flags != mb->flags || ma->bs_power != mb->bs_power
+	    || ma->ms_timing_offset != mb->ms_timing_offset || ma->ms_l1.pwr != mb->ms_l1.pwr
+	    || ma->ms_l1.ta != mb->ms_l1.ta || ma->num_cell != mb->num_cell)
+		return false;
+	if (memcmp(&ma->ul, &mb->ul, sizeof(ma->ul)) || memcmp(&ma->dl, &mb->dl, sizeof(ma->dl)))
+		return false;
+	for (i = 0; i < ma->num_cell; i++) {
+		if (ma->cell[i].rxlev != mb->cell[i].rxlev || ma->cell[i].bsic != mb->cell[i].bsic
+		    || ma->cell[i].neigh_idx != mb->cell[i].neigh_idx || ma->cell[i].arfcn != mb->cell[i].arfcn)
+			return false;
+	}
+	return true;
+}
+
+static void test_v2_roundtrip(int num_cell)
+{
+	struct meas_feed_meas in, out;
+	struct msgb *msg = msgb_alloc(MEAS_FEED_V2_MAX_LEN, __func__);
+	int rc;
+
+	printf("\n%s(num_cell=%d)\n", __func__, num_cell);
+
+	fill_report(&in, num_cell);
+	rc = meas_feed_meas_encode_v2(msg, &in);
+	printf("encode rc=%d len=%u: %s\n", rc, msgb_length(msg), osmo_hexdump_nospc(msgb_data(msg), msgb_length(msg)));
+
+	rc = meas_feed_meas_decode(&out, msgb_data(msg), msgb_length(msg));
+	printf("decode rc=%d version=%u %s\n", rc, out.hdr.version, same_report(&in, &out) ? "same" : "DIFFERENT");
+
+	msgb_free(msg);
+}
+
+static void test_v2_truncated(void)
+{
+	struct meas_feed_meas in, out;
+	struct msgb *msg = msgb_alloc(MEAS_FEED_V2_MAX_LEN, __func__);
+	unsigned int len, accepted = 0;
+
+	printf("\n%s\n", __func__);
+
+	fill_report(&in, 3);
+	meas_feed_meas_encode_v2(msg, &in);
+
+	for (len = 0; len < msgb_length(msg); len++) {
+		if (meas_feed_meas_decode(&out, msgb_data(msg), len) != -EINVAL)
+			accepted++;
+	}
+	printf("%u of %u truncated lengths accepted\n", accepted, msgb_length(msg));
+
+	/* more neighbors than a report can hold */
+	msgb_data(msg)[4 + 6 + 2 + 8 + 5] = 7;
+	printf("num_cell=7: rc=%d\n", meas_feed_meas_decode(&out, msgb_data(msg), msgb_length(msg)));
+
+	msgb_free(msg);
+}
+
+static void test_v1(void)
+{
+	struct meas_feed_meas in, out;
+	uint8_t buf[sizeof(in) + 1];
+	int rc;
+
+	printf("\n%s\n", __func__);
+
+	fill_report(&in, 2);
+	memcpy(buf, &in, sizeof(in));
+	rc = meas_feed_meas_decode(&out, buf, sizeof(in));
+	printf("decode rc=%d version=%u %s\n", rc, out.hdr.version, same_report(&in, &out) ? "same" : "DIFFERENT");
+	printf("short: rc=%d\n", meas_feed_meas_decode(&out, buf, sizeof(in) - 1));
+
+	in.hdr.version = 3;
+	memcpy(buf, &in, sizeof(in));
+	printf("unknown version: rc=%d\n", meas_feed_meas_decode(&out, buf, sizeof(in)));
+}
+
+int main(int argc, char **argv)
+{
+	test_v2_roundtrip(0);
+	test_v2_roundtrip(2);
+	test_v2_roundtrip(6);
+	test_v2_truncated();
+	test_v1();
+
+	printf("\ndone\n");
+	return 0;
+}
@@ -0,0 +1,245 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <osmocom/core/application.h>
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/timer.h>
+#include <osmocom/core/utils.h>
+
+#include <osmocom/mgcp_client/mgcp_client.h>
+
+#include <osmocom/bsc/gsm_data.h>
+#include <osmocom/bsc/debug.h>
+#include <osmocom/bsc/mgw_pool.h>
+
+static void *ctx;
+struct gsm_network *bsc_gsmnet;
+static struct mgw_pool_member *m[3];
+
+/* Stand-ins for libosmo-mgcp-client, which would send MGCP */
+struct mgcp_client {
+	const struct mgcp_client_conf *conf;
+};
+
+void mgcp_client_conf_init(struct mgcp_client_conf *conf)
+{
+	*conf = (struct mgcp_client_conf){
+		.local_port = -1,
+		.remote_port = -1,
+	};
+}
+
+struct mgcp_client *mgcp_client_init(void *talloc_ctx, struct mgcp_client_conf *conf)
+{
+	struct mgcp_client *client = talloc_zero(talloc_ctx, struct mgcp_client);
+	OSMO_ASSERT(client);
+	client->conf = conf;
+	printf("mgcp_client_init(): local %s:%d remote %s:%d\n",
+	       conf->local_addr, conf->local_port, conf->remote_addr, conf->remote_port);
+	return client;
+}
+
+int mgcp_client_connect(struct mgcp_client *mgcp)
+{
+	return 0;
+}
+
+static void fake_time_init(void)
+{
+	struct timespec *ts;
+
+	osmo_clock_override_enable(CLOCK_MONOTONIC, true);
+	ts = osmo_clock_override_gettimespec(CLOCK_MONOTONIC);
+	*ts = (struct timespec){ .tv_sec = 123 };
+}
+
+static void fake_time_passes(unsigned int ms)
+{
+	osmo_clock_override_add(CLOCK_MONOTONIC, ms / 1000, (ms % 1000) * 1000000);
+}
+
+static void expect_pick(unsigned int nr)
+{
+	struct mgw_pool_member *picked = mgw_pool_pick(bsc_gsmnet);
+
+	OSMO_ASSERT(picked);
+	printf("pick: mgw %u%s\n", picked->nr, picked->nr == nr ? "" : " ERROR");
+	OSMO_ASSERT(picked->nr == nr);
+}
+
+static void crcx(struct mgw_pool_member *member, unsigned int latency_ms, enum mgw_pool_crcx_result result)
+{
+	struct timespec sent;
+
+	osmo_clock_gettime(CLOCK_MONOTONIC, &sent);
+	mgw_pool_member_crcx_sent(member);
+	fake_time_passes(latency_ms);
+	mgw_pool_member_crcx_result(member, &sent, result);
+}
+
+static void print_health(void)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(m); i++)
+		printf("mgw %u: %s, %u endpoints, %u pending, latency %u us\n", m[i]->nr,
+		       mgw_pool_member_healthy(m[i]) ? "healthy" : "SKIPPED",
+		       m[i]->endpoints, m[i]->pending, m[i]->latency_us);
+}
+
+static void test_connect(void)
+{
+	struct mgcp_client_conf *conf = bsc_gsmnet->mgw.conf;
+
+	printf("\n%s()\n", __func__);
+
+	conf->local_addr = "127.0.0.1";
+	conf->remote_addr = "10.0.0.100";
+	conf->remote_port = 2427;
+
+	/* as configured by 'mgw pool-member N ...' in the config file */
+	m[1] = mgw_pool_member_alloc(bsc_gsmnet, 1, NULL);
+	OSMO_ASSERT(mgw_pool_member_set_remote_addr(m[1], "10.0.0.101") == 0);
+	OSMO_ASSERT(mgw_pool_member_set_remote_port(m[1], 2427) == 0);
+	m[2] = mgw_pool_member_alloc(bsc_gsmnet, 2, NULL);
+	OSMO_ASSERT(mgw_pool_member_set_remote_addr(m[2], "10.0.0.102") == 0);
+	OSMO_ASSERT(mgw_pool_member_set_remote_port(m[2], 2427) == 0);
+	OSMO_ASSERT(mgw_pool_member_set_local_addr(m[2], "127.0.0.2") == 0);
+	OSMO_ASSERT(mgw_pool_member_set_local_port(m[2], 2730) == 0);
+
+	/* Member 0 binds to the default local port, member 1 to an ephemeral one, so that they do not collide */
+	OSMO_ASSERT(mgw_pool_connect(bsc_gsmnet) == 0);
+	m[0] = mgw_pool_member_find(bsc_gsmnet, 0);
+	OSMO_ASSERT(m[0] && m[0]->client == bsc_gsmnet->mgw.client);
+	OSMO_ASSERT(m[1]->client && m[2]->client);
+	/* the configured value stays, for writing the config */
+	OSMO_ASSERT(m[1]->conf->local_port == -1);
+	/* member 1 has its own copy of the default local address */
+	OSMO_ASSERT(m[1]->local_addr_default && !m[2]->local_addr_default);
+	OSMO_ASSERT(m[1]->conf->local_addr != conf->local_addr && !strcmp(m[1]->conf->local_addr, "127.0.0.1"));
+	OSMO_ASSERT(m[2]->conf->local_port == 2730);
+}
+
+static void test_reconfigure_connected(void)
+{
+	printf("\n%s()\n", __func__);
+
+	/* The MGCP client cannot connect anew, so a change to a connected MGW is refused and not half applied */
+	printf("set remote addr: rc=%d\n", mgw_pool_member_set_remote_addr(m[1], "10.0.0.201"));
+	printf("set remote port: rc=%d\n", mgw_pool_member_set_remote_port(m[1], 2428));
+	printf("set local addr: rc=%d\n", mgw_pool_member_set_local_addr(m[1], "127.0.0.3"));
+	printf("set local port: rc=%d\n", mgw_pool_member_set_local_port(m[1], 2731));
+	printf("free: rc=%d\n", mgw_pool_member_free(m[1]));
+	printf("mgw 1: local %s:%d remote %s:%d\n", m[1]->conf->local_addr, m[1]->conf->local_port,
+	       m[1]->conf->remote_addr, m[1]->conf->remote_port);
+}
+
+static void test_pick(void)
+{
+	int i;
+
+	printf("\n%s()\n", __func__);
+
+	/* All equal: the first one */
+	expect_pick(0);
+
+	/* Same cost, fewer endpoints */
+	mgw_pool_member_endpoint_get(m[0]);
+	expect_pick(1);
+
+	/* Slow responses make an MGW more expensive */
+	crcx(m[1], 50, MGW_POOL_CRCX_SUCCESS);
+	expect_pick(2);
+
+	/* So do outstanding transactions */
+	mgw_pool_member_crcx_sent(m[2]);
+	mgw_pool_member_crcx_sent(m[2]);
+	expect_pick(0);
+	print_health();
+
+	printf("- mgw 0 fails %d times\n", MGW_POOL_FAIL_THRESHOLD);
+	for (i = 0; i < MGW_POOL_FAIL_THRESHOLD; i++)
+		crcx(m[0], 0, MGW_POOL_CRCX_FAILURE);
+	expect_pick(2);
+
+	printf("- mgw 1 and 2 fail %d times\n", MGW_POOL_FAIL_THRESHOLD);
+	for (i = 0; i < MGW_POOL_FAIL_THRESHOLD; i++) {
+		crcx(m[1], 0, MGW_POOL_CRCX_FAILURE);
+		crcx(m[2], 0, MGW_POOL_CRCX_FAILURE);
+	}
+	print_health();
+	/* All failing: still pick one */
+	expect_pick(0);
+
+	/* An aborted CRCX changes nothing */
+	crcx(m[2], 0, MGW_POOL_CRCX_ABORTED);
+	expect_pick(0);
+
+	printf("- mgw 1 responds again\n");
+	crcx(m[1], 0, MGW_POOL_CRCX_SUCCESS);
+	expect_pick(1);
+
+	printf("- %d seconds later\n", MGW_POOL_BLOCK_TIME);
+	fake_time_passes(MGW_POOL_BLOCK_TIME * 1000);
+	print_health();
+	expect_pick(0);
+
+	mgw_pool_member_endpoint_put(m[0]);
+	mgw_pool_member_crcx_result(m[2], NULL, MGW_POOL_CRCX_ABORTED);
+	mgw_pool_member_crcx_result(m[2], NULL, MGW_POOL_CRCX_ABORTED);
+	print_health();
+}
+
+static const struct log_info_cat log_categories[] = {
+	[DMSC] = {
+		.name = "DMSC",
+		.description = "Mobile Switching Center",
+		.enabled = 1, .loglevel = LOGL_DEBUG,
+	},
+};
+
+static const struct log_info log_info = {
+	.cat = log_categories,
+	.num_cat = ARRAY_SIZE(log_categories),
+};
+
+int main(int argc, char **argv)
+{
+	ctx = talloc_named_const(NULL, 0, "mgw_pool_test");
+	osmo_init_logging2(ctx, &log_info);
+	log_set_print_filename2(osmo_stderr_target, LOG_FILENAME_NONE);
+	fake_time_init();
+
+	bsc_gsmnet = talloc_zero(ctx, struct gsm_network);
+	OSMO_ASSERT(bsc_gsmnet);
+	INIT_LLIST_HEAD(&bsc_gsmnet->mgw.pool);
+	bsc_gsmnet->mgw.conf = talloc_zero(bsc_gsmnet, struct mgcp_client_conf);
+	OSMO_ASSERT(bsc_gsmnet->mgw.conf);
+	mgcp_client_conf_init(bsc_gsmnet->mgw.conf);
+
+	test_connect();
+	test_reconfigure_connected();
+	test_pick();
+
+	talloc_free(ctx);
+	return 0;
+}
@@ -0,0 +1,147 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <osmocom/core/application.h>
+#include <osmocom/core/linuxlist.h>
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/utils.h>
+
+#include <osmocom/bsc/bsc_msc_data.h>
+#include <osmocom/bsc/debug.h>
+#include <osmocom/bsc/gsm_data.h>
+
+#include "fixture/fixture.h"
+
+static struct bsc_msc_data *msc[3];
+
+static void reset_mscs(void)
+{
+	int i;
+	for (i = 0; i < ARRAY_SIZE(msc); i++) {
+		msc[i]->pool_weight = 1;
+		msc[i]->allow_attach = true;
+		msc[i]->load.pending = 0;
+		msc[i]->load.active = 0;
+		msc[i]->load.cr_cc_latency_us = 0;
+		msc[i]->load.cr_cc_latency_valid = false;
+	}
+	bsc_gsmnet->mscs_round_robin_next_nr = 0;
+}
+
+/* Pick an MSC for a new subscriber the way bsc_find_msc() does with 'mscpool selection weighted'. The picked MSC
+ * gets one more established connection, or one more pending connection if pending is true. */
+static struct bsc_msc_data *pick(bool pending)
+{
+	struct gsm_network *net = bsc_gsmnet;
+	uint32_t neutral_latency_us = osmo_msc_pool_neutral_latency(net);
+	struct bsc_msc_data *m;
+	struct bsc_msc_data *best = NULL;
+
+	llist_for_each_entry(m, &net->mscs, entry) {
+		if (!m->allow_attach)
+			continue;
+		if (!best || osmo_msc_pool_weighted_better(m, best, net->mscs_round_robin_next_nr, neutral_latency_us))
+			best = m;
+	}
+	OSMO_ASSERT(best);
+	net->mscs_round_robin_next_nr = best->nr + 1;
+	if (pending)
+		best->load.pending++;
+	else
+		best->load.active++;
+	return best;
+}
+
+static void pick_n(int n, bool pending)
+{
+	int i;
+	printf("picks:");
+	for (i = 0; i < n; i++)
+		printf(" %d", pick(pending)->nr);
+	printf("\n");
+}
+
+static void test_equal_weights(void)
+{
+	printf("\n%s()\n", __func__);
+	reset_mscs();
+	printf("- no load, no latency samples: round-robin order\n");
+	pick_n(6, true);
+	printf("- msc 1 has a backlog of pending connections: it is skipped until the others catch up\n");
+	reset_mscs();
+	msc[1]->load.pending = 2;
+	pick_n(6, true);
+}
+
+static void test_pool_weight(void)
+{
+	printf("\n%s()\n", __func__);
+	reset_mscs();
+	printf("- msc 0 has weight 2, msc 1 weight 1, msc 2 does not allow attach\n");
+	msc[0]->pool_weight = 2;
+	msc[2]->allow_attach = false;
+	pick_n(6, false);
+	printf("established: msc 0: %u, msc 1: %u, msc 2: %u\n",
+	       msc[0]->load.active, msc[1]->load.active, msc[2]->load.active);
+}
+
+static void test_latency(void)
+{
+	printf("\n%s()\n", __func__);
+	reset_mscs();
+	printf("- msc 0 confirms in 20 ms, msc 2 in 40 ms, msc 1 has no samples yet\n");
+	msc[0]->load.cr_cc_latency_us = 20000;
+	msc[0]->load.cr_cc_latency_valid = true;
+	msc[2]->load.cr_cc_latency_us = 40000;
+	msc[2]->load.cr_cc_latency_valid = true;
+	printf("neutral latency: %u us\n", osmo_msc_pool_neutral_latency(bsc_gsmnet));
+	pick_n(6, false);
+	printf("- no MSC has samples\n");
+	reset_mscs();
+	printf("neutral latency: %u us\n", osmo_msc_pool_neutral_latency(bsc_gsmnet));
+	pick_n(3, false);
+}
+
+static const struct log_info_cat log_categories[] = {
+	[DMSC] = {
+		.name = "DMSC",
+		.description = "Mobile Switching Center",
+		.enabled = 1, .loglevel = LOGL_DEBUG,
+	},
+};
+
+const struct log_info log_info = {
+	.cat = log_categories,
+	.num_cat = ARRAY_SIZE(log_categories),
+};
+
+int main(int argc, char **argv)
+{
+	int i;
+
+	fixture_init(talloc_named_const(NULL, 0, "mscpool_test"), &log_info);
+	for (i = 0; i < ARRAY_SIZE(msc); i++)
+		msc[i] = osmo_msc_data_alloc(bsc_gsmnet, i);
+
+	test_equal_weights();
+	test_pool_weight();
+	test_latency();
+
+	return EXIT_SUCCESS;
+}
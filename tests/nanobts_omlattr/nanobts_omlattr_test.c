@@ -183,6 +183,82 @@ static void test_nanobts_attr_radio_get(struct gsm_bts *bts,
 	printf("\n");
 }
 
+static void assert_same(const char *label, struct msgb *cached, struct msgb *fresh)
+{
+	printf("%s cached=%s\n", label, osmo_hexdump_nospc(cached->data, cached->len));
+	printf("%s fresh= %s\n", label, osmo_hexdump_nospc(fresh->data, fresh->len));
+	OSMO_ASSERT(cached->len == fresh->len);
+	OSMO_ASSERT(memcmp(cached->data, fresh->data, cached->len) == 0);
+	msgb_free(cached);
+	msgb_free(fresh);
+}
+
+/* Drop the cached encodings, so that the next ones are made afresh. The standalone trx is not in bts->trx_list. */
+static void cache_flush(struct gsm_bts *bts, struct gsm_bts_trx *trx)
+{
+	TALLOC_FREE(bts->nanobts_attr_cache);
+	TALLOC_FREE(trx->nanobts_attr_cache);
+}
+
+/* The encodings are cached since the tests above; compare each with a fresh one */
+static void test_nanobts_attr_cache(struct gsm_bts *bts, struct gsm_bts_trx *trx)
+{
+	struct msgb *cached;
+	uint8_t bsic;
+	uint16_t arfcn;
+
+	printf("Testing cached attributes...\n");
+
+	cached = nanobts_attr_bts_get(bts);
+	cache_flush(bts, trx);
+	assert_same("bts", cached, nanobts_attr_bts_get(bts));
+
+	cached = nanobts_attr_nse_get(bts);
+	cache_flush(bts, trx);
+	assert_same("nse", cached, nanobts_attr_nse_get(bts));
+
+	cached = nanobts_attr_cell_get(bts);
+	cache_flush(bts, trx);
+	assert_same("cell", cached, nanobts_attr_cell_get(bts));
+
+	cached = nanobts_attr_nscv_get(bts);
+	cache_flush(bts, trx);
+	assert_same("nscv", cached, nanobts_attr_nscv_get(bts));
+
+	cached = nanobts_attr_radio_get(bts, trx);
+	cache_flush(bts, trx);
+	assert_same("radio", cached, nanobts_attr_radio_get(bts, trx));
+
+	printf("ok.\n");
+	printf("\n");
+
+	printf("Testing cached attributes after configuration changes...\n");
+
+	/* A change in the parameters must not return the previous encoding */
+	bsic = bts->bsic;
+	bts->bsic = 42;
+	cached = nanobts_attr_bts_get(bts);
+	cache_flush(bts, trx);
+	assert_same("bts", cached, nanobts_attr_bts_get(bts));
+	bts->bsic = bsic;
+
+	bts->gprs.mode = BTS_GPRS_EGPRS;
+	cached = nanobts_attr_cell_get(bts);
+	cache_flush(bts, trx);
+	assert_same("cell", cached, nanobts_attr_cell_get(bts));
+	bts->gprs.mode = BTS_GPRS_GPRS;
+
+	arfcn = trx->arfcn;
+	trx->arfcn = 867;
+	cached = nanobts_attr_radio_get(bts, trx);
+	cache_flush(bts, trx);
+	assert_same("radio", cached, nanobts_attr_radio_get(bts, trx));
+	trx->arfcn = arfcn;
+
+	printf("ok.\n");
+	printf("\n");
+}
+
 static const struct log_info_cat log_categories[] = {
 };
 
@@ -284,6 +360,7 @@ int main(int argc, char **argv)
 	test_nanobts_attr_cell_get(bts, attr_cell_expected);
 	test_nanobts_attr_nscv_get(bts, attr_nscv_expected);
 	test_nanobts_attr_radio_get(bts, trx, attr_radio_expected);
+	test_nanobts_attr_cache(bts, trx);
 
 	printf("Done\n");
 	talloc_free(bts);
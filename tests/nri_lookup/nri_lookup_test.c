@@ -0,0 +1,229 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/utils.h>
+#include <osmocom/gsm/gsm23236.h>
+
+#include <osmocom/bsc/gsm_data.h>
+#include <osmocom/bsc/bsc_msc_data.h>
+#include <osmocom/bsc/nri_lookup.h>
+
+static void *ctx;
+static struct gsm_network *net;
+
+static struct bsc_msc_data *add_msc(int nr)
+{
+	struct bsc_msc_data *msc = talloc_zero(net, struct bsc_msc_data);
+	OSMO_ASSERT(msc);
+	msc->nr = nr;
+	msc->network = net;
+	msc->nri_ranges = osmo_nri_ranges_alloc(msc);
+	llist_add_tail(&msc->entry, &net->mscs);
+	return msc;
+}
+
+static void add_range(struct osmo_nri_ranges *ranges, int first, int last)
+{
+	struct osmo_nri_range r = { .first = first, .last = last };
+	OSMO_ASSERT(osmo_nri_ranges_add(ranges, &r) == 0);
+}
+
+/* What bsc_find_msc() used to do for every Complete Layer 3: match the NRI against each MSC's ranges */
+static void walk_ranges(int16_t nri_v, struct bsc_msc_data **first_msc, bool *overlap, bool *null_nri)
+{
+	struct bsc_msc_data *msc;
+
+	*first_msc = NULL;
+	*overlap = false;
+	llist_for_each_entry(msc, &net->mscs, entry) {
+		if (!osmo_nri_v_matches_ranges(nri_v, msc->nri_ranges))
+			continue;
+		if (*first_msc)
+			*overlap = true;
+		else
+			*first_msc = msc;
+	}
+	*null_nri = osmo_nri_v_matches_ranges(nri_v, net->null_nri_ranges);
+}
+
+static void verify_all(void)
+{
+	int nri_v;
+	int num_nri = 1 << net->nri_bitlen;
+
+	for (nri_v = 0; nri_v < num_nri; nri_v++) {
+		const struct nri_lookup_entry *e = nri_lookup(net, nri_v);
+		struct bsc_msc_data *msc;
+		bool overlap, null_nri;
+
+		walk_ranges(nri_v, &msc, &overlap, &null_nri);
+		OSMO_ASSERT(e);
+		if (e->msc != msc || e->overlap != overlap || e->null_nri != null_nri) {
+			printf("ERROR: NRI %d: lookup says msc %d overlap %d null %d, ranges say msc %d overlap %d null %d\n",
+			       nri_v, e->msc ? e->msc->nr : -1, e->overlap, e->null_nri,
+			       msc ? msc->nr : -1, overlap, null_nri);
+			exit(1);
+		}
+	}
+	OSMO_ASSERT(nri_lookup(net, num_nri) == NULL);
+	printf("all %d NRI values of bitlen %u match the NRI ranges\n", num_nri, net->nri_bitlen);
+}
+
+static void print_lookup(int16_t nri_v)
+{
+	const struct nri_lookup_entry *e = nri_lookup(net, nri_v);
+
+	printf("NRI %d: ", nri_v);
+	if (!e) {
+		printf("exceeds bitlen %u\n", net->nri_bitlen);
+		return;
+	}
+	printf("%s%s%s\n", e->msc ? talloc_asprintf(ctx, "msc %d", e->msc->nr) : "no MSC",
+	       e->overlap ? ", overlap" : "", e->null_nri ? ", NULL-NRI" : "");
+}
+
+static void test_lookup(void)
+{
+	struct bsc_msc_data *msc0, *msc1, *msc2;
+
+	printf("\n%s()\n", __func__);
+
+	/* Same configuration as tests/nri_cfg.vty: msc 2 is configured before msc 1, and overlaps map to whichever
+	 * MSC comes first in the list. */
+	msc0 = add_msc(0);
+	add_range(msc0->nri_ranges, 23, 23);
+	add_range(msc0->nri_ranges, 100, 200);
+	add_range(msc0->nri_ranges, 256, 511);
+	add_range(msc0->nri_ranges, 1024, 1024);
+	msc2 = add_msc(2);
+	add_range(msc2->nri_ranges, 200, 300);
+	add_range(msc2->nri_ranges, 1024, 1025);
+	msc1 = add_msc(1);
+	add_range(msc1->nri_ranges, 42, 42);
+	add_range(msc1->nri_ranges, 200, 300);
+	add_range(msc1->nri_ranges, 512, 767);
+	add_range(msc1->nri_ranges, 1024, 1025);
+	add_range(net->null_nri_ranges, 0, 0);
+	add_range(net->null_nri_ranges, 42, 42);
+
+	print_lookup(0);
+	print_lookup(23);
+	print_lookup(42);
+	print_lookup(199);
+	print_lookup(200);
+	print_lookup(201);
+	print_lookup(301);
+	print_lookup(767);
+	print_lookup(1023);
+	print_lookup(1024);
+	verify_all();
+
+	printf("- remove NRI 200 from msc 0\n");
+	OSMO_ASSERT(osmo_nri_ranges_del(msc0->nri_ranges, &(struct osmo_nri_range){ .first = 200, .last = 200 }) == 0);
+	nri_lookup_invalidate(net);
+	print_lookup(200);
+	verify_all();
+
+	printf("- nri bitlen 11\n");
+	net->nri_bitlen = 11;
+	print_lookup(1024);
+	print_lookup(1025);
+	verify_all();
+
+	printf("- nri bitlen 10\n");
+	net->nri_bitlen = 10;
+	print_lookup(1024);
+	verify_all();
+}
+
+#define BENCH_MSCS 32
+#define BENCH_RANGES_PER_MSC 16
+#define BENCH_ITERATIONS 1000000
+
+static double elapsed_ms(const struct timespec *a, const struct timespec *b)
+{
+	return (b->tv_sec - a->tv_sec) * 1e3 + (b->tv_nsec - a->tv_nsec) / 1e6;
+}
+
+/* Compare the per-MSC range walk against the table lookup for a large MSC pool. Timings go to stderr, which the
+ * test suite ignores, since they depend on the machine. */
+static void bench_lookup(void)
+{
+	int i, j;
+	struct timespec t0, t1, t2;
+	unsigned int hits_walk = 0, hits_lookup = 0;
+	int16_t *nri_values;
+
+	printf("\n%s()\n", __func__);
+
+	net->nri_bitlen = 15;
+	for (i = 0; i < BENCH_MSCS; i++) {
+		struct bsc_msc_data *msc = add_msc(100 + i);
+		for (j = 0; j < BENCH_RANGES_PER_MSC; j++) {
+			int first = (j * BENCH_MSCS + i) * 64;
+			add_range(msc->nri_ranges, first, first + 31);
+		}
+	}
+	nri_lookup_invalidate(net);
+	verify_all();
+
+	nri_values = talloc_array(ctx, int16_t, BENCH_ITERATIONS);
+	srandom(42);
+	for (i = 0; i < BENCH_ITERATIONS; i++)
+		nri_values[i] = random() & 0x7fff;
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < BENCH_ITERATIONS; i++) {
+		struct bsc_msc_data *msc;
+		bool overlap, null_nri;
+		walk_ranges(nri_values[i], &msc, &overlap, &null_nri);
+		if (msc && !null_nri)
+			hits_walk++;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	for (i = 0; i < BENCH_ITERATIONS; i++) {
+		const struct nri_lookup_entry *e = nri_lookup(net, nri_values[i]);
+		if (e->msc && !e->null_nri)
+			hits_lookup++;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t2);
+
+	OSMO_ASSERT(hits_walk == hits_lookup);
+	printf("%d lookups over %d MSCs agree with the range walk\n", BENCH_ITERATIONS, BENCH_MSCS + 3);
+	fprintf(stderr, "range walk: %.1f ms, lookup table: %.1f ms\n", elapsed_ms(&t0, &t1), elapsed_ms(&t1, &t2));
+	talloc_free(nri_values);
+}
+
+int main(int argc, char **argv)
+{
+	ctx = talloc_named_const(NULL, 0, "nri_lookup_test");
+
+	net = talloc_zero(ctx, struct gsm_network);
+	INIT_LLIST_HEAD(&net->mscs);
+	net->null_nri_ranges = osmo_nri_ranges_alloc(net);
+	net->nri_bitlen = 10;
+
+	test_lookup();
+	bench_lookup();
+
+	talloc_free(ctx);
+	return 0;
+}
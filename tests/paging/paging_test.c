@@ -0,0 +1,259 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <osmocom/abis/e1_input.h>
+#include <osmocom/core/application.h>
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/timer.h>
+#include <osmocom/core/utils.h>
+#include <osmocom/gsm/mobile_identity.h>
+
+#include <osmocom/bsc/abis_rsl.h>
+#include <osmocom/bsc/bsc_msc_data.h>
+#include <osmocom/bsc/bsc_subscriber.h>
+#include <osmocom/bsc/debug.h>
+#include <osmocom/bsc/gsm_data.h>
+#include <osmocom/bsc/paging.h>
+
+#include "fixture/fixture.h"
+
+static void *ctx;
+/* The BTS of the current test; RSL sent to earlier ones is not printed */
+static struct gsm_bts *bts;
+
+/* The IMSIs end in the paging group: below 1000, and below the number of paging groups */
+#define IMSI_GROUP0_A "001010000001000"
+#define IMSI_GROUP0_B "001010000002000"
+#define IMSI_GROUP0_C "001010000003000"
+#define IMSI_GROUP1 "001010000001001"
+#define IMSI_GROUP2 "001010000001002"
+
+static void main_loop(void)
+{
+	osmo_timers_prepare();
+	osmo_timers_update();
+}
+
+static void fake_time_passes(unsigned int ms)
+{
+	printf("- %u ms pass\n", ms);
+	osmo_clock_override_add(CLOCK_MONOTONIC, ms / 1000, (ms % 1000) * 1000000);
+	main_loop();
+}
+
+/* 4 SDCCH on TS 0 and one TCH/F on TS 1. With oml_up, the worker sends PAGING CMD, otherwise it skips the BTS. */
+static struct gsm_bts *create_bts(bool oml_up)
+{
+	static const enum gsm_phys_chan_config pchan[] = { GSM_PCHAN_CCCH_SDCCH4, GSM_PCHAN_TCH_F };
+	struct gsm_bts *b = fixture_bts_alloc(pchan, ARRAY_SIZE(pchan));
+
+	if (oml_up)
+		b->oml_link = talloc_zero(b, struct e1inp_sign_link);
+	return b;
+}
+
+static void page(const char *imsi, struct bsc_msc_data *msc)
+{
+	struct bsc_subscr *bsub = bsc_subscr_find_or_create_by_imsi(bsc_gsmnet->bsc_subscribers, imsi);
+
+	OSMO_ASSERT(bsub);
+	/* page by IMSI */
+	bsub->tmsi = GSM_RESERVED_TMSI;
+	printf("Paging %s\n", imsi);
+	OSMO_ASSERT(paging_request_bts(bts, bsub, RSL_CHANNEED_ANY, msc) == 1);
+}
+
+static void print_pending(void)
+{
+	struct gsm_paging_request *req;
+
+	printf("pending:");
+	llist_for_each_entry(req, &bts->paging.pending_requests, entry)
+		printf(" %s", req->bsub->imsi);
+	printf("\n");
+}
+
+static void print_group_depths(void)
+{
+	unsigned int i;
+
+	printf("group depths: %u %u %u\n", bts->paging.group_depth[0], bts->paging.group_depth[1],
+	       bts->paging.group_depth[2]);
+	for (i = 3; i < PAGING_GROUPS_MAX; i++)
+		OSMO_ASSERT(!bts->paging.group_depth[i]);
+}
+
+static void flush(void)
+{
+	unsigned int i;
+
+	paging_flush_bts(bts, NULL);
+	OSMO_ASSERT(llist_empty(&bts->paging.pending_requests));
+	for (i = 0; i < PAGING_GROUPS_MAX; i++) {
+		OSMO_ASSERT(llist_empty(&bts->paging.groups[i]));
+		OSMO_ASSERT(!bts->paging.group_depth[i]);
+	}
+}
+
+/* override, requires '-Wl,--wrap=abis_rsl_sendmsg'.
+ * Catch RSL messages sent towards the BTS. */
+int __real_abis_rsl_sendmsg(struct msgb *msg);
+int __wrap_abis_rsl_sendmsg(struct msgb *msg)
+{
+	struct abis_rsl_dchan_hdr *dh = (struct abis_rsl_dchan_hdr *) msg->data;
+	struct e1inp_sign_link *sign_link = msg->dst;
+	struct osmo_mobile_identity mi;
+	char mi_str[64];
+
+	if (sign_link->trx->bts != bts)
+		goto out;
+
+	switch (dh->c.msg_type) {
+	case RSL_MT_PAGING_CMD:
+		OSMO_ASSERT(dh->data[0] == RSL_IE_PAGING_GROUP && dh->data[2] == RSL_IE_MS_IDENTITY);
+		OSMO_ASSERT(osmo_mobile_identity_decode(&mi, &dh->data[4], dh->data[3], false) == 0);
+		osmo_mobile_identity_to_str_buf(mi_str, sizeof(mi_str), &mi);
+		printf("PAGING CMD group=%u %s\n", dh->data[1], mi_str);
+		break;
+	default:
+		printf("unexpected RSL message 0x%02x\n", dh->c.msg_type);
+		break;
+	}
+out:
+	msgb_free(msg);
+	return 0;
+}
+
+static void test_round_robin(void)
+{
+	int i;
+
+	printf("\n%s()\n", __func__);
+	bts = create_bts(true);
+
+	printf("- three requests for paging group 0 come before those for groups 1 and 2\n");
+	page(IMSI_GROUP0_A, NULL);
+	page(IMSI_GROUP0_B, NULL);
+	page(IMSI_GROUP0_C, NULL);
+	page(IMSI_GROUP1, NULL);
+	page(IMSI_GROUP2, NULL);
+	print_group_depths();
+
+	printf("- the groups take turns, a request goes to the back of its group after each paging\n");
+	for (i = 0; i < 9; i++)
+		fake_time_passes(500);
+
+	flush();
+}
+
+static void test_group_depth(void)
+{
+	struct bsc_msc_data *msc1 = talloc_zero(ctx, struct bsc_msc_data);
+	struct bsc_msc_data *msc2 = talloc_zero(ctx, struct bsc_msc_data);
+
+	printf("\n%s()\n", __func__);
+	bts = create_bts(true);
+
+	page(IMSI_GROUP0_A, msc1);
+	page(IMSI_GROUP0_B, msc2);
+	page(IMSI_GROUP1, msc1);
+	print_group_depths();
+	printf("paging:group_depth:0 = %" PRIu64 ", paging:group_depth:1 = %" PRIu64 "\n",
+	       bts->bts_ctrs->ctr[BTS_CTR_PAGING_GROUP_DEPTH_0].current,
+	       bts->bts_ctrs->ctr[BTS_CTR_PAGING_GROUP_DEPTH_1].current);
+
+	printf("- the second MSC flushes its paging\n");
+	paging_flush_bts(bts, msc2);
+	print_pending();
+	print_group_depths();
+
+	printf("- group 0 is left with one request, which keeps getting paged in turn with group 1\n");
+	fake_time_passes(500);
+	fake_time_passes(500);
+	fake_time_passes(500);
+
+	flush();
+	talloc_free(msc1);
+	talloc_free(msc2);
+}
+
+/* T3113 defaults to 7 s, dynamic T3113 adds 4 s for BS_PA_MFRMS = 5 and MAX_TRANS = 7 retransmissions, plus 500 ms for
+ * each PAGING CMD that is due before a request gets paged the first time */
+static void test_T3113_backlog(void)
+{
+	printf("\n%s()\n", __func__);
+	bts = create_bts(false);
+
+	printf("- first in group 0: nothing ahead, 11 s\n");
+	page(IMSI_GROUP0_A, NULL);
+	printf("- second in group 0: one ahead, 12 s\n");
+	page(IMSI_GROUP0_B, NULL);
+	printf("- first in group 1: one of group 0 ahead, 12 s\n");
+	page(IMSI_GROUP1, NULL);
+	printf("- third in group 0: two of group 0 and three turns of group 1 ahead, 14 s\n");
+	page(IMSI_GROUP0_C, NULL);
+	print_pending();
+
+	fake_time_passes(11000);
+	print_pending();
+	fake_time_passes(200);
+	print_pending();
+	fake_time_passes(1000);
+	print_pending();
+	print_group_depths();
+	fake_time_passes(2000);
+	print_pending();
+	printf("paging:expired = %" PRIu64 "\n", bts->bts_ctrs->ctr[BTS_CTR_PAGING_EXPIRED].current);
+
+	flush();
+}
+
+static const struct log_info_cat log_categories[] = {
+	[DRSL] = {
+		.name = "DRSL",
+		.description = "A-bis Radio Signalling Link (RSL)",
+		.color = "\033[1;35m",
+		.enabled = 1, .loglevel = LOGL_DEBUG,
+	},
+	[DPAG] = {
+		.name = "DPAG",
+		.description = "Paging Subsystem",
+		.color = "\033[1;38m",
+		.enabled = 1, .loglevel = LOGL_DEBUG,
+	},
+};
+
+const struct log_info log_info = {
+	.cat = log_categories,
+	.num_cat = ARRAY_SIZE(log_categories),
+};
+
+int main(int argc, char **argv)
+{
+	ctx = talloc_named_const(NULL, 0, "paging_test");
+	fixture_init(ctx, &log_info);
+
+	test_round_robin();
+	test_group_depth();
+	test_T3113_backlog();
+
+	return EXIT_SUCCESS;
+}
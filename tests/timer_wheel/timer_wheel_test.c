@@ -0,0 +1,277 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/timer.h>
+#include <osmocom/core/utils.h>
+
+#include <osmocom/bsc/timer_wheel.h>
+
+static void *ctx;
+/* fake time since the start of the current test */
+static unsigned int now_ms;
+
+/* Both osmo_timer and the timer wheel run on the fake clock, so that expiry times are exact */
+static void fake_time_init(void)
+{
+	struct timespec *ts;
+
+	osmo_gettimeofday_override = true;
+	osmo_gettimeofday_override_time = (struct timeval){ .tv_sec = 123 };
+	osmo_clock_override_enable(CLOCK_MONOTONIC, true);
+	ts = osmo_clock_override_gettimespec(CLOCK_MONOTONIC);
+	*ts = (struct timespec){ .tv_sec = 123 };
+}
+
+static void fake_time_start(void)
+{
+	now_ms = 0;
+}
+
+/* Let ms go by in one step, as when the main loop was busy, then run the timers that are due */
+static void fake_time_passes(unsigned int ms)
+{
+	osmo_gettimeofday_override_add(ms / 1000, (ms % 1000) * 1000);
+	osmo_clock_override_add(CLOCK_MONOTONIC, ms / 1000, (ms % 1000) * 1000000);
+	now_ms += ms;
+	osmo_timers_update();
+}
+
+struct test_timer {
+	const char *name;
+	struct timer_wheel_entry entry;
+};
+
+static struct timer_wheel wheel;
+
+static void expired_cb(void *data)
+{
+	struct test_timer *t = data;
+	printf("%s expires after %u ms\n", t->name, now_ms);
+}
+
+static void run_until_idle(void)
+{
+	while (wheel.count)
+		fake_time_passes(100);
+}
+
+static void test_expiry(void)
+{
+	struct test_timer t[] = {
+		{ .name = "0ms" },
+		{ .name = "250ms" },
+		{ .name = "1s" },
+		{ .name = "30s (second level)" },
+		{ .name = "2000s (beyond the second level)" },
+	};
+	unsigned int ms[] = { 0, 250, 1000, 30000, 2000000 };
+	int i;
+
+	printf("\n%s()\n", __func__);
+	fake_time_start();
+	timer_wheel_init(&wheel, 100);
+
+	for (i = 0; i < ARRAY_SIZE(t); i++) {
+		timer_wheel_entry_setup(&t[i].entry, expired_cb, &t[i]);
+		timer_wheel_schedule(&wheel, &t[i].entry, ms[i]);
+	}
+	run_until_idle();
+
+	for (i = 0; i < ARRAY_SIZE(t); i++)
+		OSMO_ASSERT(!timer_wheel_pending(&t[i].entry));
+}
+
+static struct test_timer stop_t[5] = {
+	{ .name = "1" },
+	{ .name = "2" },
+	{ .name = "3" },
+	{ .name = "4" },
+	{ .name = "5" },
+};
+
+/* Stop an entry of the same tick, and restart one that was stopped before */
+static void stop_other_cb(void *data)
+{
+	expired_cb(data);
+	timer_wheel_del(&stop_t[3].entry);
+	timer_wheel_schedule(&wheel, &stop_t[1].entry, 200);
+}
+
+static void test_stop_restart(void)
+{
+	int i;
+
+	printf("\n%s()\n", __func__);
+	fake_time_start();
+	timer_wheel_init(&wheel, 100);
+
+	for (i = 0; i < ARRAY_SIZE(stop_t); i++) {
+		timer_wheel_entry_setup(&stop_t[i].entry, i ? expired_cb : stop_other_cb, &stop_t[i]);
+		timer_wheel_schedule(&wheel, &stop_t[i].entry, 500);
+	}
+	OSMO_ASSERT(wheel.count == 5);
+
+	timer_wheel_del(&stop_t[1].entry);
+	OSMO_ASSERT(!timer_wheel_pending(&stop_t[1].entry));
+	/* stopping twice is harmless */
+	timer_wheel_del(&stop_t[1].entry);
+	timer_wheel_schedule(&wheel, &stop_t[2].entry, 1000);
+	OSMO_ASSERT(wheel.count == 4);
+
+	run_until_idle();
+	OSMO_ASSERT(!timer_wheel_pending(&stop_t[3].entry));
+}
+
+static void test_late_main_loop(void)
+{
+	struct test_timer t1 = { .name = "300ms, main loop busy for 1s" };
+	struct test_timer t2 = { .name = "500ms, after 1min idle" };
+
+	printf("\n%s()\n", __func__);
+	fake_time_start();
+	timer_wheel_init(&wheel, 100);
+
+	timer_wheel_entry_setup(&t1.entry, expired_cb, &t1);
+	timer_wheel_schedule(&wheel, &t1.entry, 300);
+	fake_time_passes(1000);
+	OSMO_ASSERT(!timer_wheel_pending(&t1.entry));
+
+	/* An idle wheel does not tick, and does not need to catch up when it starts again */
+	fake_time_passes(60000);
+	timer_wheel_entry_setup(&t2.entry, expired_cb, &t2);
+	timer_wheel_schedule(&wheel, &t2.entry, 500);
+	run_until_idle();
+}
+
+/* A timer started late within a tick must not count that tick as a full one */
+static void test_mid_tick(void)
+{
+	struct test_timer t1 = { .name = "1s, keeps the wheel ticking" };
+	struct test_timer t2 = { .name = "100ms, started 90ms into a tick" };
+
+	printf("\n%s()\n", __func__);
+	fake_time_start();
+	timer_wheel_init(&wheel, 100);
+
+	timer_wheel_entry_setup(&t1.entry, expired_cb, &t1);
+	timer_wheel_schedule(&wheel, &t1.entry, 1000);
+	fake_time_passes(90);
+
+	timer_wheel_entry_setup(&t2.entry, expired_cb, &t2);
+	timer_wheel_schedule(&wheel, &t2.entry, 100);
+	while (timer_wheel_pending(&t2.entry))
+		fake_time_passes(10);
+	OSMO_ASSERT(now_ms >= 90 + 100);
+
+	run_until_idle();
+}
+
+#define BENCH_PAGES 100000
+/* T3113 of a page, a spread as with 'timer-dynamic' on BTS with different configurations */
+#define BENCH_T3113_MS(i) (7000 + ((i) % 1000))
+
+static unsigned int bench_expired;
+
+static void bench_cb(void *data)
+{
+	bench_expired++;
+}
+
+static double elapsed_ms(const struct timespec *a, const struct timespec *b)
+{
+	return (b->tv_sec - a->tv_sec) * 1e3 + (b->tv_nsec - a->tv_nsec) / 1e6;
+}
+
+/* Time spent in timer handling for a burst of pages, of which every other one gets answered before T3113 expires.
+ * The fake clock advances in steps of 100 ms, as the main loop would. Real timings go to stderr, since they depend
+ * on the machine. Run as 'timer_wheel_test bench'. */
+static void bench_paging_burst(void)
+{
+	struct osmo_timer_list *timers = talloc_zero_array(ctx, struct osmo_timer_list, BENCH_PAGES);
+	struct timer_wheel_entry *entries = talloc_zero_array(ctx, struct timer_wheel_entry, BENCH_PAGES);
+	struct timespec t0, t1;
+	double osmo_timer_ms, wheel_ms;
+	int i;
+
+	printf("\n%s()\n", __func__);
+	OSMO_ASSERT(timers && entries);
+
+	fake_time_start();
+	bench_expired = 0;
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < BENCH_PAGES; i++) {
+		osmo_timer_setup(&timers[i], bench_cb, NULL);
+		osmo_timer_schedule(&timers[i], BENCH_T3113_MS(i) / 1000, (BENCH_T3113_MS(i) % 1000) * 1000);
+	}
+	for (i = 0; i < BENCH_PAGES; i += 2)
+		osmo_timer_del(&timers[i]);
+	while (now_ms < 9000)
+		fake_time_passes(100);
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	osmo_timer_ms = elapsed_ms(&t0, &t1);
+	printf("osmo_timer: %d pages, %u expired\n", BENCH_PAGES, bench_expired);
+	OSMO_ASSERT(bench_expired == BENCH_PAGES / 2);
+
+	fake_time_start();
+	timer_wheel_init(&wheel, 100);
+	bench_expired = 0;
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < BENCH_PAGES; i++) {
+		timer_wheel_entry_setup(&entries[i], bench_cb, NULL);
+		timer_wheel_schedule(&wheel, &entries[i], BENCH_T3113_MS(i));
+	}
+	for (i = 0; i < BENCH_PAGES; i += 2)
+		timer_wheel_del(&entries[i]);
+	while (now_ms < 9000)
+		fake_time_passes(100);
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	wheel_ms = elapsed_ms(&t0, &t1);
+	printf("timer wheel: %d pages, %u expired\n", BENCH_PAGES, bench_expired);
+	OSMO_ASSERT(bench_expired == BENCH_PAGES / 2);
+	OSMO_ASSERT(!wheel.count);
+
+	fprintf(stderr, "%d pages: osmo_timer %.1f ms, timer wheel %.1f ms in timer handling\n",
+		BENCH_PAGES, osmo_timer_ms, wheel_ms);
+
+	talloc_free(timers);
+	talloc_free(entries);
+}
+
+int main(int argc, char **argv)
+{
+	ctx = talloc_named_const(NULL, 0, "timer_wheel_test");
+	fake_time_init();
+
+	if (argc > 1 && !strcmp(argv[1], "bench")) {
+		bench_paging_burst();
+		talloc_free(ctx);
+		return 0;
+	}
+
+	test_expiry();
+	test_stop_restart();
+	test_late_main_loop();
+	test_mid_tick();
+
+	talloc_free(ctx);
+	return 0;
+}
@@ -0,0 +1,251 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <osmocom/core/application.h>
+#include <osmocom/core/linuxlist.h>
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/timer.h>
+#include <osmocom/core/utils.h>
+#include <osmocom/vty/vty.h>
+
+#include <osmocom/bsc/debug.h>
+#include <osmocom/bsc/vty.h>
+
+#include "fixture/fixture.h"
+
+#define ITEMS_PER_STEP 2
+
+struct item {
+	struct llist_head entry;
+	int nr;
+};
+
+static void *ctx;
+static struct vty *vty;
+static LLIST_HEAD(items);
+static struct item *item[40];
+
+static struct vty_app_info vty_info = {
+	.name = "vty_stream_test",
+};
+
+/* Print all output of the code under test. The prompt does not end in a newline, add one. */
+int __wrap_vty_out(struct vty *vty, const char *format, ...)
+{
+	char buf[256];
+	va_list ap;
+	int len;
+
+	va_start(ap, format);
+	vsnprintf(buf, sizeof(buf), format, ap);
+	va_end(ap);
+
+	len = strlen(buf);
+	if (len && buf[len - 1] != '\n') {
+		while (len && buf[len - 1] == ' ')
+			buf[--len] = '\0';
+		printf("%s\n", buf);
+	} else
+		printf("%s", buf);
+	return len;
+}
+
+static void main_loop(void)
+{
+	printf("- main loop iteration\n");
+	osmo_timers_prepare();
+	osmo_timers_update();
+}
+
+static void items_alloc(int n)
+{
+	int i;
+	OSMO_ASSERT(n <= ARRAY_SIZE(item));
+	for (i = 0; i < n; i++) {
+		item[i] = talloc_zero(ctx, struct item);
+		item[i]->nr = i;
+		llist_add_tail(&item[i]->entry, &items);
+	}
+}
+
+static void items_free(void)
+{
+	int i;
+	for (i = 0; i < ARRAY_SIZE(item); i++) {
+		if (!item[i])
+			continue;
+		vty_stream_llist_del(&item[i]->entry);
+		talloc_free(item[i]);
+		item[i] = NULL;
+	}
+}
+
+static void item_del(int nr)
+{
+	printf("- item %d goes away\n", nr);
+	vty_stream_llist_del(&item[nr]->entry);
+	talloc_free(item[nr]);
+	item[nr] = NULL;
+}
+
+static bool items_step(struct vty *vty, void *cursor)
+{
+	struct vty_stream_llist_pos *pos = cursor;
+	char line[64] = "items:";
+	unsigned int n;
+
+	for (n = 0; n < ITEMS_PER_STEP && pos->next != pos->head; n++) {
+		snprintf(line + strlen(line), sizeof(line) - strlen(line), " %d",
+			 llist_entry(pos->next, struct item, entry)->nr);
+		pos->next = pos->next->next;
+	}
+	vty_out(vty, "%s\n", line);
+	return pos->next == pos->head;
+}
+
+/* Run a "show items" the way libosmovty runs a command: the prompt follows when the command returns, but only on
+ * VTY_TERM sessions. */
+static void show_items(void)
+{
+	struct vty_stream_llist_pos pos = {
+		.head = &items,
+		.next = items.next,
+	};
+
+	printf("%s> show items\n", vty_info.name);
+	vty_stream_start_llist(vty, items_step, &pos, sizeof(pos), 0);
+	if (vty->type == VTY_TERM)
+		printf("%s>\n", vty_info.name);
+}
+
+static void session_open(void)
+{
+	vty = talloc_zero(ctx, struct vty);
+	vty->type = VTY_TERM;
+	vty->node = VIEW_NODE;
+}
+
+static void test_short(void)
+{
+	printf("\n%s()\n", __func__);
+	items_alloc(3);
+	printf("- all output fits the first run, the prompt follows right away\n");
+	show_items();
+	main_loop();
+	items_free();
+}
+
+static void test_long(void)
+{
+	printf("\n%s()\n", __func__);
+	items_alloc(ARRAY_SIZE(item));
+	printf("- the prompt is held until the end of the output\n");
+	show_items();
+	main_loop();
+	main_loop();
+	main_loop();
+	items_free();
+}
+
+static void test_llist_del(void)
+{
+	printf("\n%s()\n", __func__);
+	items_alloc(ARRAY_SIZE(item));
+	show_items();
+	printf("- the next item to show, a later and an earlier one go away\n");
+	item_del(16);
+	item_del(20);
+	item_del(5);
+	main_loop();
+	printf("- the last item goes away\n");
+	item_del(39);
+	main_loop();
+	main_loop();
+	items_free();
+}
+
+static void test_replace(void)
+{
+	printf("\n%s()\n", __func__);
+	items_alloc(ARRAY_SIZE(item));
+	show_items();
+	printf("- a new command on the same session drops the rest of the output\n");
+	show_items();
+	main_loop();
+	main_loop();
+	main_loop();
+	items_free();
+}
+
+static void test_session_closed(void)
+{
+	printf("\n%s()\n", __func__);
+	items_alloc(ARRAY_SIZE(item));
+	show_items();
+	printf("- the session closes\n");
+	talloc_free(vty);
+	main_loop();
+	session_open();
+	items_free();
+}
+
+static void test_not_terminal(void)
+{
+	printf("\n%s()\n", __func__);
+	items_alloc(ARRAY_SIZE(item));
+	printf("- a config file gets all output at once\n");
+	vty->type = VTY_FILE;
+	show_items();
+	main_loop();
+	vty->type = VTY_TERM;
+	items_free();
+}
+
+static const struct log_info_cat log_categories[] = {
+	[DNM] = {
+		.name = "DNM",
+		.description = "A-bis Network Management / O&M (NM/OML)",
+		.enabled = 1, .loglevel = LOGL_DEBUG,
+	},
+};
+
+const struct log_info log_info = {
+	.cat = log_categories,
+	.num_cat = ARRAY_SIZE(log_categories),
+};
+
+int main(int argc, char **argv)
+{
+	ctx = talloc_named_const(NULL, 0, "vty_stream_test");
+	fixture_init(ctx, &log_info);
+	vty_info.tall_ctx = ctx;
+	vty_init(&vty_info);
+	session_open();
+
+	test_short();
+	test_long();
+	test_llist_del();
+	test_replace();
+	test_session_closed();
+	test_not_terminal();
+
+	return EXIT_SUCCESS;
+}